@@ -3095,8 +3095,11 @@ int wlan_get_rxreorder_tbl(mlan_private *priv, rx_reorder_tbl *buf)
 		ptbl->win_size = rx_reorder_tbl_ptr->win_size;
 
 		ptbl->amsdu = rx_reorder_tbl_ptr->amsdu;
+		ptbl->flush_time = rx_reorder_tbl_ptr->flush_time;
 		for (i = 0; i < rx_reorder_tbl_ptr->win_size; ++i) {
-			if (rx_reorder_tbl_ptr->rx_reorder_ptr[i])
+			if (rx_reorder_tbl_ptr->rx_reorder_ptr
+				    [(rx_reorder_tbl_ptr->start_idx + i) %
+				     rx_reorder_tbl_ptr->win_size])
 				ptbl->buffer[i] = MTRUE;
 			else
 				ptbl->buffer[i] = MFALSE;
@@ -111,6 +111,38 @@ void wlan_11n_delba(mlan_private *priv, int tid);
 void wlan_update_ampdu_txwinsize(pmlan_adapter pmadapter);
 /** Minimum number of AMSDU */
 #define MIN_NUM_AMSDU 2
+/** Maximum number of subframes in a scatter-gather AMSDU */
+#define MAX_NUM_AMSDU_SG 32
+/** Adaptive AMSDU size before any rate or retry feedback */
+#define AMSDU_ADAPT_SIZE_MAX 0xffff
+/** Smallest adaptive AMSDU size, still fits a few TCP ACKs */
+#define AMSDU_ADAPT_SIZE_MIN 512
+/** Airtime one adaptive AMSDU may take, in usec */
+#define AMSDU_ADAPT_AIRTIME 2000
+/** TX retry ratio in 1/1000 up to which AMSDU size is not reduced */
+#define AMSDU_ADAPT_RETRY_LOW 100
+/** TX retry ratio in 1/1000 from which no AMSDU is sent */
+#define AMSDU_ADAPT_RETRY_OFF 300
+/** Minimum number of TX frames to update the TX retry ratio */
+#define AMSDU_ADAPT_MIN_FRAMES 64
+
+/**
+ *  @brief This function gets the AMSDU size to use for a RA list
+ *
+ *  @param pmadapter A pointer to mlan_adapter
+ *  @param ptr       A pointer to RA list table
+ *
+ *  @return          AMSDU size in bytes, 0 to send no AMSDU
+ */
+static INLINE t_u32 wlan_11n_amsdu_size(pmlan_adapter pmadapter,
+					raListTbl *ptr)
+{
+	t_u32 size = MIN(ptr->max_amsdu, pmadapter->tx_buf_size);
+
+	if (pmadapter->amsdu_adapt)
+		size = MIN(size, ptr->amsdu_size);
+	return size;
+}
 /** AMSDU Aggr control cmd resp */
 mlan_status wlan_ret_amsdu_aggr_ctrl(pmlan_private pmpriv,
 				     HostCmd_DS_COMMAND *resp,
@@ -98,6 +98,174 @@ static int wlan_11n_form_amsdu_pkt(pmlan_adapter pmadapter, t_u8 *amsdu_buf,
 	return pkt_len + LLC_SNAP_LEN + *pad;
 }
 
+/**
+ *  @brief Add data to an Internet checksum
+ *
+ *  @param sum       Checksum so far
+ *  @param data      A pointer to the data
+ *  @param len       Length of the data
+ *
+ *  @return          Checksum, not folded
+ */
+static t_u32 wlan_11n_tso_csum(t_u32 sum, t_u8 *data, t_u32 len)
+{
+	while (len > 1) {
+		sum += ((t_u32)data[0] << 8) | data[1];
+		data += 2;
+		len -= 2;
+	}
+	if (len)
+		sum += (t_u32)data[0] << 8;
+	return sum;
+}
+
+/**
+ *  @brief Fold an Internet checksum to 16 bits and complement it
+ *
+ *  @param sum       Checksum
+ *
+ *  @return          Checksum to put in the header, host order
+ */
+static t_u16 wlan_11n_tso_csum_fold(t_u32 sum)
+{
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return (t_u16)~sum;
+}
+
+/**
+ *  @brief Build the next TCP segment of a TSO packet
+ *
+ *  The headers of the TSO packet are copied and fixed up for the
+ *  segment. The payload is copied from the packet by moal, which also
+ *  returns its checksum, so the payload is read only once.
+ *
+ *  @param pmadapter A pointer to mlan_adapter structure
+ *  @param pmbuf     A pointer to the TSO packet
+ *  @param buf       A pointer to the buffer for the segment
+ *  @param amsdu     MTRUE to build the segment as AMSDU subframe
+ *
+ *  @return          Segment size without padding, 0 on failure
+ */
+static t_u32 wlan_11n_form_tso_seg(pmlan_adapter pmadapter,
+				   pmlan_buffer pmbuf, t_u8 *buf, t_u8 amsdu)
+{
+	t_u8 *data = pmbuf->pbuf + pmbuf->data_offset;
+	t_u32 hdr_len = pmbuf->gso_hdr_len;
+	t_u32 offset = pmbuf->gso_offset;
+	t_u32 seg_len = wlan_11n_tso_seg_len(pmbuf);
+	t_u32 tcp_len = hdr_len - pmbuf->gso_tcp_off + seg_len;
+	t_u32 shift = amsdu ? LLC_SNAP_LEN : 0;
+	t_u8 *hdr = buf + shift;
+	t_u8 *ip = hdr + pmbuf->gso_ip_off;
+	t_u8 *tcp = hdr + pmbuf->gso_tcp_off;
+	t_u32 sum;
+	t_u16 csum = 0;
+
+	/* DA/SA stay in front, LLC/SNAP goes before the ethertype */
+	memcpy_ext(pmadapter, buf, data, MLAN_MAC_ADDR_LENGTH * 2,
+		   MLAN_MAC_ADDR_LENGTH * 2);
+	memcpy_ext(pmadapter, hdr + MLAN_ETHER_PKT_TYPE_OFFSET,
+		   data + MLAN_ETHER_PKT_TYPE_OFFSET,
+		   hdr_len - MLAN_ETHER_PKT_TYPE_OFFSET,
+		   hdr_len - MLAN_ETHER_PKT_TYPE_OFFSET);
+	if (amsdu) {
+		*(t_u16 *)(buf + MLAN_ETHER_PKT_TYPE_OFFSET) = mlan_htons(
+			hdr_len + seg_len + LLC_SNAP_LEN -
+			(MLAN_ETHER_PKT_TYPE_OFFSET + sizeof(t_u16)));
+		buf += MLAN_ETHER_PKT_TYPE_OFFSET + sizeof(t_u16);
+		buf[0] = 0xaa; /* LLC DSAP */
+		buf[1] = 0xaa; /* LLC SSAP */
+		buf[2] = 0x03; /* LLC CTRL */
+		buf[3] = 0x00; /* SNAP OUI */
+		buf[4] = 0x00;
+		buf[5] = 0x00;
+	}
+	if (pmadapter->callbacks.moal_copy_tx_data(
+		    pmadapter->pmoal_handle, pmbuf, hdr_len + offset,
+		    hdr + hdr_len, seg_len, &csum) != MLAN_STATUS_SUCCESS) {
+		PRINTM(MERROR, "TSO: failed to copy segment at %d\n", offset);
+		return 0;
+	}
+
+	if ((ip[0] >> 4) == 4) {
+		*(t_u16 *)(ip + 2) = mlan_htons(pmbuf->gso_tcp_off -
+						pmbuf->gso_ip_off + tcp_len);
+		*(t_u16 *)(ip + 4) =
+			mlan_htons(mlan_ntohs(*(t_u16 *)(ip + 4)) +
+				   offset / pmbuf->gso_size);
+		*(t_u16 *)(ip + 10) = 0;
+		*(t_u16 *)(ip + 10) = mlan_htons(wlan_11n_tso_csum_fold(
+			wlan_11n_tso_csum(0, ip, (ip[0] & 0x0f) * 4)));
+		/* Pseudo header: addresses, protocol and TCP length */
+		sum = wlan_11n_tso_csum(0, ip + 12, 8);
+	} else {
+		*(t_u16 *)(ip + 4) = mlan_htons(pmbuf->gso_tcp_off -
+						pmbuf->gso_ip_off - 40 +
+						tcp_len);
+		sum = wlan_11n_tso_csum(0, ip + 8, 32);
+	}
+	sum += MLAN_IP_PROTOCOL_TCP + tcp_len;
+
+	*(t_u32 *)(tcp + 4) =
+		mlan_htonl(mlan_ntohl(*(t_u32 *)(tcp + 4)) + offset);
+	if (offset)
+		tcp[13] &= ~MLAN_TCP_FLAG_CWR;
+	if (offset + seg_len < pmbuf->data_len - hdr_len)
+		tcp[13] &= ~(MLAN_TCP_FLAG_FIN | MLAN_TCP_FLAG_PSH);
+	*(t_u16 *)(tcp + 16) = 0;
+	sum = wlan_11n_tso_csum(sum, tcp, hdr_len - pmbuf->gso_tcp_off) + csum;
+	*(t_u16 *)(tcp + 16) = mlan_htons(wlan_11n_tso_csum_fold(sum));
+
+	pmbuf->gso_offset += seg_len;
+	return shift + hdr_len + seg_len;
+}
+
+/**
+ *  @brief Put TCP segments of a TSO packet into an AMSDU
+ *
+ *  As many segments as fit are built right in the AMSDU buffer, the
+ *  rest is left in the TSO packet.
+ *
+ *  @param pmadapter A pointer to mlan_adapter structure
+ *  @param amsdu_buf A pointer to the AMSDU buffer at the next subframe
+ *  @param room      Room left in the AMSDU buffer
+ *  @param pmbuf     A pointer to the TSO packet
+ *  @param pad       Pointer to the padding of the last subframe
+ *  @param nsegs     Pointer to the number of subframes formed
+ *
+ *  @return          Size of the subframes with padding
+ */
+static int wlan_11n_form_amsdu_tso(pmlan_adapter pmadapter, t_u8 *amsdu_buf,
+				   int room, pmlan_buffer pmbuf, int *pad,
+				   t_u32 *nsegs)
+{
+	int size = 0;
+	t_u32 len;
+
+	ENTER();
+
+	*nsegs = 0;
+	while (wlan_11n_tso_segs(pmbuf) &&
+	       (size + LLC_SNAP_LEN + pmbuf->gso_hdr_len +
+		wlan_11n_tso_seg_len(pmbuf)) <= (t_u32)room) {
+		len = wlan_11n_form_tso_seg(pmadapter, pmbuf, amsdu_buf + size,
+					    MTRUE);
+		if (!len) {
+			/* Drop the rest, TCP retransmits it */
+			pmbuf->gso_offset =
+				pmbuf->data_len - pmbuf->gso_hdr_len;
+			break;
+		}
+		*pad = (len & 3) ? (4 - (len & 3)) : 0;
+		size += len + *pad;
+		(*nsegs)++;
+	}
+
+	LEAVE();
+	return size;
+}
+
 /**
  *  @brief Add TxPD to AMSDU header
  *
@@ -169,48 +337,23 @@ static INLINE void wlan_11n_update_pktlen_amsdu_txpd(mlan_private *priv,
 	LEAVE();
 }
 
-/**
- *  @brief check if UAP AMSDU packet need forward out to connected peers
- *
- *  @param priv       A pointer to mlan_private
- *
- *  @return			  MTRUE--packet need forward
- *
- */
-static t_u8 wlan_uap_check_forward(mlan_private *priv, Eth803Hdr_t *hdr)
-{
-	/** include multicast packet */
-	if (hdr->dest_addr[0] & 0x01)
-		return MTRUE;
-	/** include unicast packet to another station */
-	if (wlan_get_station_entry(priv, hdr->dest_addr))
-		return MTRUE;
-	return MFALSE;
-}
-
 /**
  *  @brief Get number of aggregated packets
  *
  *  @param priv		A pointer to mlan_private structure
  *  @param data			A pointer to packet data
  *  @param total_pkt_len	Total packet length
- *  @param forward      A pointer forward flag
  *
  *  @return			Number of packets
  */
 static int wlan_11n_get_num_aggrpkts(mlan_private *priv, t_u8 *data,
-				     int total_pkt_len, t_u8 *forward)
+				     int total_pkt_len)
 {
 	int pkt_count = 0, pkt_len, pad;
 	t_u8 hdr_len = sizeof(Eth803Hdr_t);
 
-	t_u8 forward_flag = MFALSE;
-
 	ENTER();
 	while (total_pkt_len >= hdr_len) {
-		if (priv->bss_role == MLAN_BSS_ROLE_UAP &&
-		    wlan_uap_check_forward(priv, (Eth803Hdr_t *)data))
-			forward_flag = MTRUE;
 		/* Length will be in network format, change it to host */
 		pkt_len = mlan_ntohs(
 			(*(t_u16 *)(data + (2 * MLAN_MAC_ADDR_LENGTH))));
@@ -226,7 +369,6 @@ static int wlan_11n_get_num_aggrpkts(mlan_private *priv, t_u8 *data,
 		total_pkt_len -= pkt_len + pad + sizeof(Eth803Hdr_t);
 		++pkt_count;
 	}
-	*forward = forward_flag;
 	LEAVE();
 	return pkt_count;
 }
@@ -257,7 +399,6 @@ mlan_status wlan_11n_deaggregate_pkt(mlan_private *priv, pmlan_buffer pmbuf)
 	t_u8 rfc1042_eth_hdr[MLAN_MAC_ADDR_LENGTH] = {0xaa, 0xaa, 0x03,
 						      0x00, 0x00, 0x00};
 	t_u8 hdr_len = sizeof(Eth803Hdr_t);
-	t_u8 forward = MFALSE;
 	t_u8 eapol_type[2] = {0x88, 0x8e};
 	t_u8 tdls_action_type[2] = {0x89, 0x0d};
 	t_u32 in_ts_sec, in_ts_usec;
@@ -301,7 +442,7 @@ mlan_status wlan_11n_deaggregate_pkt(mlan_private *priv, pmlan_buffer pmbuf)
 		pmadapter->callbacks.moal_get_system_time(
 			pmadapter->pmoal_handle, &in_ts_sec, &in_ts_usec);
 	num_subframes = pmbuf->use_count =
-		wlan_11n_get_num_aggrpkts(priv, data, total_pkt_len, &forward);
+		wlan_11n_get_num_aggrpkts(priv, data, total_pkt_len);
 
 	// rx_trace 7
 	if (pmadapter->tp_state_on) {
@@ -313,8 +454,12 @@ mlan_status wlan_11n_deaggregate_pkt(mlan_private *priv, pmlan_buffer pmbuf)
 	if (pmadapter->tp_state_drop_point == 7 /*RX_DROP_P3*/)
 		goto done;
 	prx_pkt = (RxPacketHdr_t *)data;
-	/**  check if packet need send to host only */
-	if (pmbuf->pdesc && !forward) {
+	/*
+	 * Hand an skb backed AMSDU to moal, which delivers every subframe as
+	 * a clone of it. uAP bridging is decided per subframe through
+	 * mlan_process_deaggr_pkt(), only forwarded subframes get copied.
+	 */
+	if (pmbuf->pdesc) {
 		if (pmadapter->callbacks.moal_recv_amsdu_packet) {
 			ret = pmadapter->callbacks.moal_recv_amsdu_packet(
 				pmadapter->pmoal_handle, pmbuf);
@@ -475,6 +620,587 @@ done:
 	return ret;
 }
 
+/**
+ *  @brief Update the adaptive AMSDU size of a RA list
+ *
+ *  The size is limited to what the last known data rate to the RA sends
+ *  in AMSDU_ADAPT_AIRTIME, so a retry does not cost more than that, and
+ *  shrinks as the TX retry ratio grows until AMSDU is not sent at all.
+ *
+ *  @param priv     A pointer to mlan_private structure
+ *  @param ra_list  A pointer to RA list table
+ *
+ *  @return         N/A
+ */
+t_void wlan_11n_update_amsdu_size(mlan_private *priv, raListTbl *ra_list)
+{
+	t_u32 size = AMSDU_ADAPT_SIZE_MAX;
+	t_u32 ratio = priv->tx_retry_ratio;
+
+	/* rate is in 500 Kbps units: rate * usec / 16 gives bytes */
+	if (ra_list->airtime_rate)
+		size = MIN(size, (t_u32)ra_list->airtime_rate *
+					 AMSDU_ADAPT_AIRTIME / 16);
+	if (ratio >= AMSDU_ADAPT_RETRY_OFF)
+		size = 0;
+	else if (ratio > AMSDU_ADAPT_RETRY_LOW)
+		size = size * (AMSDU_ADAPT_RETRY_OFF - ratio) /
+		       (AMSDU_ADAPT_RETRY_OFF - AMSDU_ADAPT_RETRY_LOW);
+	if (size && size < AMSDU_ADAPT_SIZE_MIN)
+		size = AMSDU_ADAPT_SIZE_MIN;
+	if (size != ra_list->amsdu_size)
+		PRINTM(MDATA, "ralist %p: rate=%d retry=%d AMSDU %d -> %d\n",
+		       ra_list, ra_list->airtime_rate, ratio,
+		       ra_list->amsdu_size, size);
+	ra_list->amsdu_size = (t_u16)size;
+}
+
+/**
+ *  @brief Update the TX retry ratio from the firmware TX counters
+ *
+ *  The counters are the ones of the 802_11_GET_LOG response. The ratio
+ *  of the frames sent since the last update is smoothed and the AMSDU
+ *  size of all RA lists is updated with it.
+ *
+ *  @param priv     A pointer to mlan_private structure
+ *  @param tx_frame Number of frames sent
+ *  @param retry    Number of frames sent after retries
+ *  @param failed   Number of frames failed after all retries
+ *
+ *  @return         N/A
+ */
+t_void wlan_11n_update_tx_retry(mlan_private *priv, t_u32 tx_frame,
+				t_u32 retry, t_u32 failed)
+{
+	t_u32 total, retries, ratio;
+
+	ENTER();
+	if (!priv->adapter->amsdu_adapt) {
+		LEAVE();
+		return;
+	}
+	/* Counters went back, firmware was reset */
+	if (tx_frame < priv->tx_log_frames || retry < priv->tx_log_retry ||
+	    failed < priv->tx_log_failed)
+		goto save;
+	total = (tx_frame - priv->tx_log_frames) +
+		(failed - priv->tx_log_failed);
+	retries = (retry - priv->tx_log_retry) + (failed - priv->tx_log_failed);
+	/* Wait for enough frames, counters are kept for the next response */
+	if (total < AMSDU_ADAPT_MIN_FRAMES) {
+		LEAVE();
+		return;
+	}
+	while (total > 0x3fffff) {
+		total >>= 1;
+		retries >>= 1;
+	}
+	ratio = MIN(retries * 1000 / total, 1000);
+	priv->tx_retry_ratio = (priv->tx_retry_ratio * 3 + ratio) / 4;
+	PRINTM(MINFO, "TX retry ratio %d, smoothed %d\n", ratio,
+	       priv->tx_retry_ratio);
+	wlan_wmm_update_ralist_amsdu(priv);
+save:
+	priv->tx_log_frames = tx_frame;
+	priv->tx_log_retry = retry;
+	priv->tx_log_failed = failed;
+	LEAVE();
+}
+
+/**
+ *  @brief Get the number of scatter-gather AMSDU subframes the bus can
+ *  take now
+ *
+ *  @param pmadapter A pointer to mlan_adapter structure
+ *
+ *  @return          Max number of subframes, 0 if AMSDU has to be copied
+ */
+static t_u32 wlan_11n_amsdu_sg_frags(pmlan_adapter pmadapter)
+{
+#if defined(PCIE9098) || defined(PCIE9097) || defined(PCIEIW624)
+	t_u32 free_bds;
+
+	if (pmadapter->amsdu_sg && IS_PCIE(pmadapter->card_type) &&
+	    pmadapter->pcard_pcie->reg->use_adma) {
+		free_bds = pmadapter->pcard_pcie->txrx_bd_size -
+			   pmadapter->pcard_pcie->txbd_pending;
+		/* One descriptor is used by the TxPD header */
+		if (free_bds > MIN_NUM_AMSDU)
+			return MIN(free_bds - 1, MAX_NUM_AMSDU_SG);
+	}
+#endif
+	return 0;
+}
+
+/**
+ *  @brief Turn a packet into an AMSDU subframe in its own buffer
+ *
+ *  The subframe header and LLC/SNAP are built in the headroom of the
+ *  packet, so the payload is not copied. The padding of the previous
+ *  subframe is put in front of the subframe.
+ *
+ *  @param pmadapter A pointer to mlan_adapter structure
+ *  @param pmbuf     A pointer to the packet
+ *  @param prev_pad  Padding of the previous subframe
+ *  @param pad       Pointer to the padding of this subframe
+ *
+ *  @return          Subframe size with padding
+ */
+static int wlan_11n_form_amsdu_subframe(pmlan_adapter pmadapter,
+					pmlan_buffer pmbuf, int prev_pad,
+					int *pad)
+{
+	t_u8 addr[MLAN_MAC_ADDR_LENGTH * 2];
+	t_u8 *data = pmbuf->pbuf + pmbuf->data_offset;
+	t_u8 *subframe = data - LLC_SNAP_LEN;
+	int pkt_len = pmbuf->data_len;
+
+	ENTER();
+
+	/* DA/SA move to the front, the ethertype stays as SNAP type */
+	memcpy_ext(pmadapter, addr, data, sizeof(addr), sizeof(addr));
+	memcpy_ext(pmadapter, subframe, addr, sizeof(addr), sizeof(addr));
+	*(t_u16 *)(subframe + sizeof(addr)) = mlan_htons(
+		pkt_len + LLC_SNAP_LEN - (sizeof(addr) + sizeof(t_u16)));
+	subframe += sizeof(addr) + sizeof(t_u16);
+	subframe[0] = 0xaa; /* LLC DSAP */
+	subframe[1] = 0xaa; /* LLC SSAP */
+	subframe[2] = 0x03; /* LLC CTRL */
+	subframe[3] = 0x00; /* SNAP OUI */
+	subframe[4] = 0x00;
+	subframe[5] = 0x00;
+
+	pmbuf->data_offset -= LLC_SNAP_LEN + prev_pad;
+	pmbuf->data_len += LLC_SNAP_LEN + prev_pad;
+	*pad = (((pkt_len + LLC_SNAP_LEN) & 3)) ?
+		       (4 - (((pkt_len + LLC_SNAP_LEN)) & 3)) :
+		       0;
+
+	LEAVE();
+	return pkt_len + LLC_SNAP_LEN + *pad;
+}
+
+/**
+ *  @brief Restore the 802.3 packet from an AMSDU subframe
+ *
+ *  @param pmadapter A pointer to mlan_adapter structure
+ *  @param pmbuf     A pointer to the subframe
+ *  @param prev_pad  Padding of the previous subframe
+ *
+ *  @return          N/A
+ */
+static void wlan_11n_restore_amsdu_subframe(pmlan_adapter pmadapter,
+					    pmlan_buffer pmbuf, int prev_pad)
+{
+	t_u8 addr[MLAN_MAC_ADDR_LENGTH * 2];
+
+	pmbuf->data_offset += prev_pad;
+	pmbuf->data_len -= prev_pad;
+	memcpy_ext(pmadapter, addr, pmbuf->pbuf + pmbuf->data_offset,
+		   sizeof(addr), sizeof(addr));
+	pmbuf->data_offset += LLC_SNAP_LEN;
+	pmbuf->data_len -= LLC_SNAP_LEN;
+	memcpy_ext(pmadapter, pmbuf->pbuf + pmbuf->data_offset, addr,
+		   sizeof(addr), sizeof(addr));
+}
+
+/**
+ *  @brief Check if a packet can be a scatter-gather AMSDU subframe
+ *
+ *  @param pmbuf     A pointer to the packet
+ *
+ *  @return          MTRUE or MFALSE
+ */
+static INLINE t_u8 wlan_11n_amsdu_sg_allowed(pmlan_buffer pmbuf)
+{
+	/* Room for LLC/SNAP and padding is needed in front of the data */
+	return ((pmbuf->flags & MLAN_BUF_FLAG_MOAL_TX_BUF) &&
+		!(pmbuf->flags &
+		  (MLAN_BUF_FLAG_REQUEUED_PKT | MLAN_BUF_FLAG_TSO)) &&
+		pmbuf->data_offset >= LLC_SNAP_LEN + 3) ?
+		       MTRUE :
+		       MFALSE;
+}
+
+/**
+ *  @brief Put the subframes of a scatter-gather AMSDU back to the RA list
+ *
+ *  Caller must hold the ra_list_lock of the TID.
+ *
+ *  @param priv       A pointer to mlan_private structure
+ *  @param pra_list   Pointer to the RA List table
+ *  @param pmbuf_aggr A pointer to the AMSDU header buffer
+ *  @param ptrindex   Pointer index
+ *
+ *  @return           N/A
+ */
+static void wlan_11n_requeue_amsdu_sg(mlan_private *priv, raListTbl *pra_list,
+				      mlan_buffer *pmbuf_aggr, int ptrindex)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+	mlan_buffer *pmbuf = pmbuf_aggr->pnext;
+	mlan_buffer *pmbuf_next;
+	mlan_buffer *prev = MNULL;
+	int prev_pad = 0;
+	int pad = 0;
+	t_u32 i;
+	t_u32 n = pmbuf_aggr->use_count;
+
+	/* Restore the packets and reverse the list */
+	for (i = 0; i < n; i++) {
+		pmbuf_next = pmbuf->pnext;
+		wlan_11n_restore_amsdu_subframe(pmadapter, pmbuf, prev_pad);
+		pad = ((pmbuf->data_len + LLC_SNAP_LEN) & 3) ?
+			      (4 - ((pmbuf->data_len + LLC_SNAP_LEN) & 3)) :
+			      0;
+		prev_pad = pad;
+		pmbuf->pnext = prev;
+		prev = pmbuf;
+		pmbuf = pmbuf_next;
+	}
+	for (pmbuf = prev; pmbuf; pmbuf = pmbuf_next) {
+		pmbuf_next = pmbuf->pnext;
+		util_enqueue_list_head(pmadapter->pmoal_handle,
+				       &pra_list->buf_head,
+				       (pmlan_linked_list)pmbuf, MNULL, MNULL);
+	}
+	pra_list->total_pkts += n;
+	priv->wmm.pkts_queued[ptrindex] += n;
+	for (i = 0; i < n; i++)
+		util_scalar_increment(pmadapter->pmoal_handle,
+				      &priv->wmm.tx_pkts_queued,
+				      pmadapter->callbacks.moal_spin_lock,
+				      pmadapter->callbacks.moal_spin_unlock);
+	wlan_wmm_update_ralist_ready(priv, pra_list, ptrindex);
+	pmbuf_aggr->use_count = 0;
+	pmbuf_aggr->flags &= ~MLAN_BUF_FLAG_AMSDU_SG;
+}
+
+/**
+ *  @brief Aggregate multiple packets into one scatter-gather AMSDU packet
+ *
+ *  Only the TxPD is built in a new buffer, the subframes stay in the
+ *  packet buffers and are linked to it.
+ *
+ *  @param priv      A pointer to mlan_private structure
+ *  @param pra_list  Pointer to the RA List table containing the pointers
+ *                   to packets.
+ *  @param headroom  Any interface specific headroom that may be need. TxPD
+ *                   will be formed leaving this headroom.
+ *  @param ptrindex  Pointer index
+ *  @param max_frags Max number of subframes
+ *
+ *  @return     Final packet size or MLAN_STATUS_FAILURE
+ */
+static int wlan_11n_aggregate_pkt_sg(mlan_private *priv, raListTbl *pra_list,
+				     int headroom, int ptrindex,
+				     t_u32 max_frags)
+{
+	int pkt_size = 0;
+	pmlan_adapter pmadapter = priv->adapter;
+	mlan_buffer *pmbuf_aggr, *pmbuf_src, *pmbuf_last = MNULL;
+	t_u8 *data;
+	int pad = 0;
+	mlan_status ret = MLAN_STATUS_SUCCESS;
+	mlan_tx_param tx_param;
+#ifdef STA_SUPPORT
+	TxPD *ptx_pd = MNULL;
+#endif
+	t_u32 max_amsdu_size = wlan_11n_amsdu_size(pmadapter, pra_list);
+	t_u32 msdu_in_tx_amsdu_cnt = 0;
+	t_u8 ralist_valid = MTRUE;
+
+	ENTER();
+
+	PRINTM(MDAT_D, "Handling SG Aggr packet\n");
+
+	/* Allocate the TxPD buffer without holding ra_list_lock */
+	wlan_wmm_unlock_tid(priv, ptrindex);
+	pmbuf_aggr = wlan_alloc_mlan_buffer(pmadapter, headroom + sizeof(TxPD),
+					    headroom,
+					    MOAL_MALLOC_BUFFER |
+						    MOAL_MEM_FLAG_ATOMIC);
+	if (!pmbuf_aggr) {
+		PRINTM(MERROR, "Error allocating mlan_buffer\n");
+		LEAVE();
+		return MLAN_STATUS_FAILURE;
+	}
+	wlan_wmm_lock_tid(priv, ptrindex);
+	if (!wlan_is_ralist_valid(priv, pra_list, ptrindex))
+		pmbuf_src = MNULL;
+	else
+		pmbuf_src = (pmlan_buffer)util_peek_list(
+			pmadapter->pmoal_handle, &pra_list->buf_head, MNULL,
+			MNULL);
+	if (!pmbuf_src || !wlan_11n_amsdu_sg_allowed(pmbuf_src)) {
+		wlan_wmm_unlock_tid(priv, ptrindex);
+		wlan_free_mlan_buffer(pmadapter, pmbuf_aggr);
+		LEAVE();
+		return 0;
+	}
+
+	data = pmbuf_aggr->pbuf + headroom;
+	pmbuf_aggr->bss_index = pmbuf_src->bss_index;
+	pmbuf_aggr->buf_type = pmbuf_src->buf_type;
+	pmbuf_aggr->priority = pmbuf_src->priority;
+	pmbuf_aggr->pbuf = data;
+	pmbuf_aggr->data_offset = 0;
+	pmbuf_aggr->in_ts_sec = pmbuf_src->in_ts_sec;
+	pmbuf_aggr->in_ts_usec = pmbuf_src->in_ts_usec;
+	pmbuf_aggr->extra_ts_sec = pmbuf_src->extra_ts_sec;
+	pmbuf_aggr->extra_ts_usec = pmbuf_src->extra_ts_usec;
+	if (pmbuf_src->flags & MLAN_BUF_FLAG_TDLS)
+		pmbuf_aggr->flags |= MLAN_BUF_FLAG_TDLS;
+	if (pmbuf_src->flags & MLAN_BUF_FLAG_TCP_ACK)
+		pmbuf_aggr->flags |= MLAN_BUF_FLAG_TCP_ACK;
+	pmbuf_aggr->flags |= MLAN_BUF_FLAG_AMSDU_SG;
+	pmbuf_aggr->use_count = 0;
+	pmbuf_aggr->pnext = MNULL;
+
+	wlan_11n_form_amsdu_txpd(priv, pmbuf_aggr);
+	pkt_size = sizeof(TxPD);
+#ifdef STA_SUPPORT
+	if (GET_BSS_ROLE(priv) == MLAN_BSS_ROLE_STA)
+		ptx_pd = (TxPD *)pmbuf_aggr->pbuf;
+#endif
+	priv->msdu_in_tx_amsdu_cnt++;
+
+	/* Close the A-MSDU early once a bypass packet is waiting,
+	 * but never send it without a subframe */
+	while (pmbuf_src && pmbuf_aggr->use_count < max_frags &&
+	       (!pmbuf_aggr->use_count ||
+		wlan_bypass_tx_list_empty(pmadapter)) &&
+	       wlan_11n_amsdu_sg_allowed(pmbuf_src) &&
+	       ((pkt_size + (pmbuf_src->data_len + LLC_SNAP_LEN) + headroom) <=
+		max_amsdu_size)) {
+		pmbuf_src =
+			(pmlan_buffer)util_dequeue_list(pmadapter->pmoal_handle,
+							&pra_list->buf_head,
+							MNULL, MNULL);
+		/* Collects TP statistics */
+		if (pmadapter->tp_state_on && (pkt_size > sizeof(TxPD)))
+			pmadapter->callbacks.moal_tp_accounting(
+				pmadapter->pmoal_handle, pmbuf_src, 3);
+		pra_list->total_pkts--;
+
+		/* decrement for every PDU taken from the list */
+		priv->wmm.pkts_queued[ptrindex]--;
+		util_scalar_decrement(pmadapter->pmoal_handle,
+				      &priv->wmm.tx_pkts_queued,
+				      pmadapter->callbacks.moal_spin_lock,
+				      pmadapter->callbacks.moal_spin_unlock);
+		wlan_wmm_update_ralist_ready(priv, pra_list, ptrindex);
+
+		wlan_wmm_unlock_tid(priv, ptrindex);
+
+		pkt_size += wlan_11n_form_amsdu_subframe(pmadapter, pmbuf_src,
+							 pad, &pad);
+		pmbuf_src->pnext = MNULL;
+		if (pmbuf_last)
+			pmbuf_last->pnext = pmbuf_src;
+		else
+			pmbuf_aggr->pnext = pmbuf_src;
+		pmbuf_last = pmbuf_src;
+		pmbuf_aggr->use_count++;
+
+		wlan_wmm_lock_tid(priv, ptrindex);
+
+		if (!wlan_is_ralist_valid(priv, pra_list, ptrindex)) {
+			/* Send the subframes taken so far */
+			ralist_valid = MFALSE;
+			pmbuf_src = MNULL;
+			break;
+		}
+
+		pmbuf_src =
+			(pmlan_buffer)util_peek_list(pmadapter->pmoal_handle,
+						     &pra_list->buf_head, MNULL,
+						     MNULL);
+		priv->msdu_in_tx_amsdu_cnt++;
+		msdu_in_tx_amsdu_cnt++;
+	}
+
+	wlan_wmm_unlock_tid(priv, ptrindex);
+
+	/* Last AMSDU packet does not need padding */
+	pkt_size -= pad;
+	pmbuf_aggr->data_len = pkt_size;
+	wlan_11n_update_pktlen_amsdu_txpd(priv, pmbuf_aggr);
+	/* Only the interface header and TxPD are in this buffer */
+	pmbuf_aggr->data_len = sizeof(TxPD) + headroom;
+	pmbuf_aggr->pbuf = data - headroom;
+	tx_param.next_pkt_len =
+		((pmbuf_src) ? pmbuf_src->data_len + sizeof(TxPD) : 0);
+	/* Collects TP statistics */
+	if (pmadapter->tp_state_on) {
+		pmadapter->callbacks.moal_tp_accounting(pmadapter->pmoal_handle,
+							pmbuf_aggr, 4);
+		pmadapter->callbacks.moal_tp_accounting_rx_param(
+			pmadapter->pmoal_handle, 5, msdu_in_tx_amsdu_cnt);
+	}
+
+	/* Drop Tx packets at drop point 4 */
+	if (pmadapter->tp_state_drop_point == 4) {
+		wlan_write_data_complete(pmadapter, pmbuf_aggr, ret);
+		goto exit;
+	} else
+		ret = pmadapter->ops.host_to_card(priv, MLAN_TYPE_DATA,
+						  pmbuf_aggr, &tx_param);
+	switch (ret) {
+	case MLAN_STATUS_RESOURCE:
+		wlan_wmm_lock_tid(priv, ptrindex);
+		if (!ralist_valid ||
+		    !wlan_is_ralist_valid(priv, pra_list, ptrindex)) {
+			wlan_wmm_unlock_tid(priv, ptrindex);
+			pmbuf_aggr->status_code = MLAN_ERROR_PKT_INVALID;
+			wlan_write_data_complete(pmadapter, pmbuf_aggr,
+						 MLAN_STATUS_FAILURE);
+			LEAVE();
+			return MLAN_STATUS_FAILURE;
+		}
+#ifdef STA_SUPPORT
+		/* reset tx_lock_flag */
+		if ((GET_BSS_ROLE(priv) == MLAN_BSS_ROLE_STA) &&
+		    pmadapter->pps_uapsd_mode &&
+		    (pmadapter->tx_lock_flag == MTRUE)) {
+			pmadapter->tx_lock_flag = MFALSE;
+			if (ptx_pd != MNULL)
+				ptx_pd->flags = 0;
+		}
+#endif
+		/* The subframes go back as separate packets */
+		wlan_11n_requeue_amsdu_sg(priv, pra_list, pmbuf_aggr,
+					  ptrindex);
+		wlan_wmm_unlock_tid(priv, ptrindex);
+		wlan_free_mlan_buffer(pmadapter, pmbuf_aggr);
+		PRINTM(MINFO, "MLAN_STATUS_RESOURCE is returned\n");
+		break;
+	case MLAN_STATUS_FAILURE:
+		pmbuf_aggr->status_code = MLAN_ERROR_DATA_TX_FAIL;
+		pmadapter->dbg.num_tx_host_to_card_failure++;
+		wlan_write_data_complete(pmadapter, pmbuf_aggr, ret);
+		goto exit;
+	case MLAN_STATUS_PENDING:
+		break;
+	case MLAN_STATUS_SUCCESS:
+		wlan_write_data_complete(pmadapter, pmbuf_aggr, ret);
+		break;
+	default:
+		break;
+	}
+	if (ret != MLAN_STATUS_RESOURCE) {
+		wlan_wmm_lock_tid(priv, ptrindex);
+		if (wlan_is_ralist_valid(priv, pra_list, ptrindex)) {
+			priv->wmm.packets_out[ptrindex]++;
+			wlan_wmm_rotate_ralist_ready(priv, pra_list, ptrindex,
+						     pkt_size);
+		}
+		pmadapter->bssprio_tbl[priv->bss_priority].bssprio_cur =
+			pmadapter->bssprio_tbl[priv->bss_priority]
+				.bssprio_cur->pnext;
+		wlan_wmm_unlock_tid(priv, ptrindex);
+	}
+	priv->amsdu_tx_cnt++;
+
+exit:
+	LEAVE();
+	return MIN((pkt_size + headroom), INT_MAX);
+}
+
+/**
+ *  @brief Segment a TSO packet into packets at the head of the RA list
+ *
+ *  The TSO packet has been dequeued by the caller, which must not hold
+ *  the ra_list_lock of the TID. On success the lock is held on return.
+ *
+ *  @param priv      A pointer to mlan_private structure
+ *  @param pra_list  Pointer to the RA List table
+ *  @param pmbuf     A pointer to the TSO packet
+ *  @param ptrindex  Pointer index
+ *
+ *  @return          MLAN_STATUS_SUCCESS or MLAN_STATUS_FAILURE
+ */
+mlan_status wlan_11n_tso_segment(mlan_private *priv, raListTbl *pra_list,
+				 pmlan_buffer pmbuf, int ptrindex)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+	mlan_buffer *pmbuf_seg, *pmbuf_next, *segs = MNULL;
+	t_u32 headroom = sizeof(TxPD) + priv->intf_hr_len + DMA_ALIGNMENT;
+	mlan_status status = MLAN_STATUS_SUCCESS;
+	t_u32 n = 0, i;
+
+	ENTER();
+
+	/* Segments are linked in reverse order by pnext */
+	while (wlan_11n_tso_segs(pmbuf)) {
+		pmbuf_seg = wlan_alloc_mlan_buffer(
+			pmadapter,
+			headroom + pmbuf->gso_hdr_len + pmbuf->gso_size, 0,
+			MOAL_MALLOC_BUFFER | MOAL_MEM_FLAG_ATOMIC);
+		if (!pmbuf_seg) {
+			PRINTM(MERROR, "Error allocating TSO segment\n");
+			status = MLAN_STATUS_FAILURE;
+			break;
+		}
+		pmbuf_seg->bss_index = pmbuf->bss_index;
+		pmbuf_seg->buf_type = pmbuf->buf_type;
+		pmbuf_seg->priority = pmbuf->priority;
+		pmbuf_seg->in_ts_sec = pmbuf->in_ts_sec;
+		pmbuf_seg->in_ts_usec = pmbuf->in_ts_usec;
+		pmbuf_seg->extra_ts_sec = pmbuf->extra_ts_sec;
+		pmbuf_seg->extra_ts_usec = pmbuf->extra_ts_usec;
+		pmbuf_seg->flags |= pmbuf->flags & MLAN_BUF_FLAG_TDLS;
+		pmbuf_seg->data_offset = headroom;
+		pmbuf_seg->data_len = wlan_11n_form_tso_seg(
+			pmadapter, pmbuf,
+			pmbuf_seg->pbuf + pmbuf_seg->data_offset, MFALSE);
+		if (!pmbuf_seg->data_len) {
+			wlan_free_mlan_buffer(pmadapter, pmbuf_seg);
+			status = MLAN_STATUS_FAILURE;
+			break;
+		}
+		pmbuf_seg->pnext = segs;
+		segs = pmbuf_seg;
+		n++;
+	}
+	PRINTM(MDAT_D, "TSO packet %p: %d segments\n", pmbuf, n);
+
+	wlan_wmm_lock_tid(priv, ptrindex);
+	if (!wlan_is_ralist_valid(priv, pra_list, ptrindex)) {
+		wlan_write_data_complete(pmadapter, pmbuf,
+					 MLAN_STATUS_FAILURE);
+		wlan_wmm_unlock_tid(priv, ptrindex);
+		for (pmbuf_seg = segs; pmbuf_seg; pmbuf_seg = pmbuf_next) {
+			pmbuf_next = pmbuf_seg->pnext;
+			wlan_free_mlan_buffer(pmadapter, pmbuf_seg);
+		}
+		LEAVE();
+		return MLAN_STATUS_FAILURE;
+	}
+	/* The packet is sent once any segment is queued, a failure part way
+	 * only cuts it short and must not count it as dropped as well */
+	wlan_write_data_complete(pmadapter, pmbuf,
+				 n ? MLAN_STATUS_SUCCESS : status);
+	for (pmbuf_seg = segs; pmbuf_seg; pmbuf_seg = pmbuf_next) {
+		pmbuf_next = pmbuf_seg->pnext;
+		util_enqueue_list_head(pmadapter->pmoal_handle,
+				       &pra_list->buf_head,
+				       (pmlan_linked_list)pmbuf_seg, MNULL,
+				       MNULL);
+	}
+	pra_list->total_pkts += n;
+	priv->wmm.pkts_queued[ptrindex] += n;
+	for (i = 0; i < n; i++)
+		util_scalar_increment(pmadapter->pmoal_handle,
+				      &priv->wmm.tx_pkts_queued,
+				      pmadapter->callbacks.moal_spin_lock,
+				      pmadapter->callbacks.moal_spin_unlock);
+	wlan_wmm_update_ralist_ready(priv, pra_list, ptrindex);
+
+	LEAVE();
+	return MLAN_STATUS_SUCCESS;
+}
+
 /**
  *  @brief Aggregate multiple packets into one single AMSDU packet
  *
@@ -503,14 +1229,37 @@ int wlan_11n_aggregate_pkt(mlan_private *priv, raListTbl *pra_list,
 #ifdef STA_SUPPORT
 	TxPD *ptx_pd = MNULL;
 #endif
-	t_u32 max_amsdu_size = MIN(pra_list->max_amsdu, pmadapter->tx_buf_size);
+	t_u32 max_amsdu_size = wlan_11n_amsdu_size(pmadapter, pra_list);
 	t_u32 msdu_in_tx_amsdu_cnt = 0;
+	t_u32 max_frags;
+	t_u32 nsegs;
+	mlan_buffer *pmbuf_tso;
 	ENTER();
 
+	max_frags = wlan_11n_amsdu_sg_frags(pmadapter);
+	if (max_frags) {
+		pkt_size = wlan_11n_aggregate_pkt_sg(priv, pra_list, headroom,
+						     ptrindex, max_frags);
+		/* 0: the head packet can not be sent as SG, copy it */
+		if (pkt_size) {
+			LEAVE();
+			return pkt_size;
+		}
+		wlan_wmm_lock_tid(priv, ptrindex);
+		if (!wlan_is_ralist_valid(priv, pra_list, ptrindex)) {
+			wlan_wmm_unlock_tid(priv, ptrindex);
+			LEAVE();
+			return MLAN_STATUS_FAILURE;
+		}
+	}
+
 	PRINTM(MDAT_D, "Handling Aggr packet\n");
 
 	pmbuf_src = (pmlan_buffer)util_peek_list(
 		pmadapter->pmoal_handle, &pra_list->buf_head, MNULL, MNULL);
+	/* Allocate the aggregation buffer without holding ra_list_lock so
+	 * the TID stays open for enqueue meanwhile */
+	wlan_wmm_unlock_tid(priv, ptrindex);
 	if (pmbuf_src) {
 		pmbuf_aggr = wlan_alloc_mlan_buffer(
 			pmadapter, pmadapter->tx_buf_size, headroom,
@@ -518,12 +1267,21 @@ int wlan_11n_aggregate_pkt(mlan_private *priv, raListTbl *pra_list,
 				MOAL_MEM_FLAG_ATOMIC);
 		if (!pmbuf_aggr) {
 			PRINTM(MERROR, "Error allocating mlan_buffer\n");
-			pmadapter->callbacks.moal_spin_unlock(
-				pmadapter->pmoal_handle,
-				priv->wmm.ra_list_spinlock);
 			LEAVE();
 			return MLAN_STATUS_FAILURE;
 		}
+		wlan_wmm_lock_tid(priv, ptrindex);
+		if (!wlan_is_ralist_valid(priv, pra_list, ptrindex))
+			pmbuf_src = MNULL;
+		else
+			pmbuf_src = (pmlan_buffer)util_peek_list(
+				pmadapter->pmoal_handle, &pra_list->buf_head,
+				MNULL, MNULL);
+		if (!pmbuf_src) {
+			wlan_wmm_unlock_tid(priv, ptrindex);
+			wlan_free_mlan_buffer(pmadapter, pmbuf_aggr);
+			goto exit;
+		}
 
 		data = pmbuf_aggr->pbuf + headroom;
 		pmbuf_aggr->bss_index = pmbuf_src->bss_index;
@@ -549,13 +1307,27 @@ int wlan_11n_aggregate_pkt(mlan_private *priv, raListTbl *pra_list,
 #endif
 		priv->msdu_in_tx_amsdu_cnt++;
 	} else {
-		pmadapter->callbacks.moal_spin_unlock(
-			pmadapter->pmoal_handle, priv->wmm.ra_list_spinlock);
 		goto exit;
 	}
 
-	while (pmbuf_src && ((pkt_size + (pmbuf_src->data_len + LLC_SNAP_LEN) +
-			      headroom) <= max_amsdu_size)) {
+	while (pmbuf_src) {
+		/* Close the A-MSDU early once a bypass packet is waiting,
+		 * but never send it without a subframe */
+		if ((pkt_size > sizeof(TxPD)) &&
+		    !wlan_bypass_tx_list_empty(pmadapter))
+			break;
+		if (pmbuf_src->flags & MLAN_BUF_FLAG_TSO) {
+			/* At least one TCP segment of it has to fit */
+			if ((pkt_size + LLC_SNAP_LEN + pmbuf_src->gso_hdr_len +
+			     wlan_11n_tso_seg_len(pmbuf_src) + headroom) >
+			    max_amsdu_size)
+				break;
+		} else if ((pkt_size + (pmbuf_src->data_len + LLC_SNAP_LEN) +
+			    headroom) > max_amsdu_size) {
+			break;
+		}
+		nsegs = 1;
+		pmbuf_tso = MNULL;
 		pmbuf_src =
 			(pmlan_buffer)util_dequeue_list(pmadapter->pmoal_handle,
 							&pra_list->buf_head,
@@ -569,12 +1341,24 @@ int wlan_11n_aggregate_pkt(mlan_private *priv, raListTbl *pra_list,
 		/* decrement for every PDU taken from the list */
 		priv->wmm.pkts_queued[ptrindex]--;
 		util_scalar_decrement(pmadapter->pmoal_handle,
-				      &priv->wmm.tx_pkts_queued, MNULL, MNULL);
+				      &priv->wmm.tx_pkts_queued,
+				      pmadapter->callbacks.moal_spin_lock,
+				      pmadapter->callbacks.moal_spin_unlock);
+		wlan_wmm_update_ralist_ready(priv, pra_list, ptrindex);
 
-		pmadapter->callbacks.moal_spin_unlock(
-			pmadapter->pmoal_handle, priv->wmm.ra_list_spinlock);
+		wlan_wmm_unlock_tid(priv, ptrindex);
 
-		if (pmbuf_src) {
+		if (pmbuf_src && (pmbuf_src->flags & MLAN_BUF_FLAG_TSO)) {
+			pkt_size += wlan_11n_form_amsdu_tso(
+				pmadapter, (data + pkt_size),
+				max_amsdu_size - headroom - pkt_size, pmbuf_src,
+				&pad, &nsegs);
+			if (wlan_11n_tso_segs(pmbuf_src))
+				pmbuf_tso = pmbuf_src;
+			else
+				wlan_write_data_complete(pmadapter, pmbuf_src,
+							 MLAN_STATUS_SUCCESS);
+		} else if (pmbuf_src) {
 			pkt_size += wlan_11n_form_amsdu_pkt(
 				pmadapter, (data + pkt_size),
 				pmbuf_src->pbuf + pmbuf_src->data_offset,
@@ -586,27 +1370,44 @@ int wlan_11n_aggregate_pkt(mlan_private *priv, raListTbl *pra_list,
 						 MLAN_STATUS_SUCCESS);
 		}
 
-		pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
-						    priv->wmm.ra_list_spinlock);
+		wlan_wmm_lock_tid(priv, ptrindex);
 
 		if (!wlan_is_ralist_valid(priv, pra_list, ptrindex)) {
-			pmadapter->callbacks.moal_spin_unlock(
-				pmadapter->pmoal_handle,
-				priv->wmm.ra_list_spinlock);
+			wlan_wmm_unlock_tid(priv, ptrindex);
+			if (pmbuf_tso)
+				wlan_write_data_complete(pmadapter, pmbuf_tso,
+							 MLAN_STATUS_FAILURE);
 			LEAVE();
 			return MLAN_STATUS_FAILURE;
 		}
 
+		priv->msdu_in_tx_amsdu_cnt += nsegs;
+		msdu_in_tx_amsdu_cnt += nsegs;
+		if (pmbuf_tso) {
+			/* AMSDU is full, the rest of the TSO packet goes
+			 * back to the head */
+			util_enqueue_list_head(pmadapter->pmoal_handle,
+					       &pra_list->buf_head,
+					       (pmlan_linked_list)pmbuf_tso,
+					       MNULL, MNULL);
+			pra_list->total_pkts++;
+			priv->wmm.pkts_queued[ptrindex]++;
+			util_scalar_increment(
+				pmadapter->pmoal_handle,
+				&priv->wmm.tx_pkts_queued,
+				pmadapter->callbacks.moal_spin_lock,
+				pmadapter->callbacks.moal_spin_unlock);
+			wlan_wmm_update_ralist_ready(priv, pra_list, ptrindex);
+			pmbuf_src = pmbuf_tso;
+			break;
+		}
 		pmbuf_src =
 			(pmlan_buffer)util_peek_list(pmadapter->pmoal_handle,
 						     &pra_list->buf_head, MNULL,
 						     MNULL);
-		priv->msdu_in_tx_amsdu_cnt++;
-		msdu_in_tx_amsdu_cnt++;
 	}
 
-	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
-					      priv->wmm.ra_list_spinlock);
+	wlan_wmm_unlock_tid(priv, ptrindex);
 
 	/* Last AMSDU packet does not need padding */
 	pkt_size -= pad;
@@ -638,13 +1439,10 @@ int wlan_11n_aggregate_pkt(mlan_private *priv, raListTbl *pra_list,
 		break;
 #endif
 	case MLAN_STATUS_RESOURCE:
-		pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
-						    priv->wmm.ra_list_spinlock);
+		wlan_wmm_lock_tid(priv, ptrindex);
 
 		if (!wlan_is_ralist_valid(priv, pra_list, ptrindex)) {
-			pmadapter->callbacks.moal_spin_unlock(
-				pmadapter->pmoal_handle,
-				priv->wmm.ra_list_spinlock);
+			wlan_wmm_unlock_tid(priv, ptrindex);
 			pmbuf_aggr->status_code = MLAN_ERROR_PKT_INVALID;
 			wlan_write_data_complete(pmadapter, pmbuf_aggr,
 						 MLAN_STATUS_FAILURE);
@@ -671,10 +1469,12 @@ int wlan_11n_aggregate_pkt(mlan_private *priv, raListTbl *pra_list,
 		/* add back only one: aggregated packet is requeued as one */
 		priv->wmm.pkts_queued[ptrindex]++;
 		util_scalar_increment(pmadapter->pmoal_handle,
-				      &priv->wmm.tx_pkts_queued, MNULL, MNULL);
+				      &priv->wmm.tx_pkts_queued,
+				      pmadapter->callbacks.moal_spin_lock,
+				      pmadapter->callbacks.moal_spin_unlock);
 		pmbuf_aggr->flags |= MLAN_BUF_FLAG_REQUEUED_PKT;
-		pmadapter->callbacks.moal_spin_unlock(
-			pmadapter->pmoal_handle, priv->wmm.ra_list_spinlock);
+		wlan_wmm_update_ralist_ready(priv, pra_list, ptrindex);
+		wlan_wmm_unlock_tid(priv, ptrindex);
 		PRINTM(MINFO, "MLAN_STATUS_RESOURCE is returned\n");
 		pmbuf_aggr->status_code = MLAN_ERROR_PKT_INVALID;
 		break;
@@ -692,17 +1492,16 @@ int wlan_11n_aggregate_pkt(mlan_private *priv, raListTbl *pra_list,
 		break;
 	}
 	if (ret != MLAN_STATUS_RESOURCE) {
-		pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
-						    priv->wmm.ra_list_spinlock);
+		wlan_wmm_lock_tid(priv, ptrindex);
 		if (wlan_is_ralist_valid(priv, pra_list, ptrindex)) {
 			priv->wmm.packets_out[ptrindex]++;
-			priv->wmm.tid_tbl_ptr[ptrindex].ra_list_curr = pra_list;
+			wlan_wmm_rotate_ralist_ready(priv, pra_list, ptrindex,
+						     pkt_size);
 		}
 		pmadapter->bssprio_tbl[priv->bss_priority].bssprio_cur =
 			pmadapter->bssprio_tbl[priv->bss_priority]
 				.bssprio_cur->pnext;
-		pmadapter->callbacks.moal_spin_unlock(
-			pmadapter->pmoal_handle, priv->wmm.ra_list_spinlock);
+		wlan_wmm_unlock_tid(priv, ptrindex);
 	}
 	PRINTM_GET_SYS_TIME(MDATA, &sec, &usec);
 	PRINTM_NETINTF(MDATA, priv);
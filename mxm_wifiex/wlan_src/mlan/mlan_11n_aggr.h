@@ -30,9 +30,43 @@ Change log:
 #define _MLAN_11N_AGGR_H_
 
 /** Aggregate 11N packets */
+/**
+ *  @brief Get the payload length of the next TCP segment of a TSO packet
+ *
+ *  @param pmbuf    A pointer to the TSO packet
+ *
+ *  @return         Payload length
+ */
+static INLINE t_u32 wlan_11n_tso_seg_len(pmlan_buffer pmbuf)
+{
+	return MIN((t_u32)pmbuf->gso_size,
+		   pmbuf->data_len - pmbuf->gso_hdr_len - pmbuf->gso_offset);
+}
+
+/**
+ *  @brief Get the number of TCP segments left in a TSO packet
+ *
+ *  @param pmbuf    A pointer to the TSO packet
+ *
+ *  @return         Number of segments
+ */
+static INLINE t_u32 wlan_11n_tso_segs(pmlan_buffer pmbuf)
+{
+	return (pmbuf->data_len - pmbuf->gso_hdr_len - pmbuf->gso_offset +
+		pmbuf->gso_size - 1) /
+	       pmbuf->gso_size;
+}
+
 mlan_status wlan_11n_deaggregate_pkt(pmlan_private priv, pmlan_buffer pmbuf);
 /** Deaggregate 11N packets */
 int wlan_11n_aggregate_pkt(mlan_private *priv, raListTbl *ptr, int headroom,
 			   int ptrindex);
+/** Update the adaptive AMSDU size of a RA list */
+t_void wlan_11n_update_amsdu_size(mlan_private *priv, raListTbl *ra_list);
+/** Update the TX retry ratio from the firmware TX counters */
+t_void wlan_11n_update_tx_retry(mlan_private *priv, t_u32 tx_frame,
+				t_u32 retry, t_u32 failed);
+mlan_status wlan_11n_tso_segment(mlan_private *priv, raListTbl *pra_list,
+				 pmlan_buffer pmbuf, int ptrindex);
 
 #endif /* !_MLAN_11N_AGGR_H_ */
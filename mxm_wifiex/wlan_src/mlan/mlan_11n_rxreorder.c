@@ -124,7 +124,193 @@ static mlan_status wlan_11n_dispatch_pkt(t_void *priv, t_void *payload,
 }
 
 /**
- *  @brief This function restarts the reordering timeout timer
+ *  @brief This function returns the configured flush time of a TID,
+ *         the ceiling of its adaptive flush timeout
+ *
+ *  @param pmadapter        A pointer to mlan_adapter
+ *  @param tid              TID
+ *
+ *  @return                 Flush time in ms
+ */
+static t_u32 wlan_11n_reorder_max_flush_time(pmlan_adapter pmadapter, int tid)
+{
+	mlan_wmm_ac_e wmm_ac;
+	t_u32 max_flush_time = pmadapter->flush_time_ac_be_bk;
+
+	wmm_ac = wlan_wmm_convert_tos_to_ac(pmadapter, tid);
+	if ((WMM_AC_VI == wmm_ac) || (WMM_AC_VO == wmm_ac))
+		max_flush_time = pmadapter->flush_time_ac_vi_vo;
+	return MIN(max_flush_time, RX_REORDER_WHEEL_MAX);
+}
+
+/**
+ *  @brief This function reads the monotonic clock of the flush wheel
+ *
+ *  @param pmadapter        A pointer to mlan_adapter
+ *
+ *  @return                 Time in ms, wrapping
+ */
+static t_u32 wlan_11n_reorder_wheel_clock(pmlan_adapter pmadapter)
+{
+	t_u32 sec = 0, usec = 0;
+
+	pmadapter->callbacks.moal_get_system_time(pmadapter->pmoal_handle,
+						  &sec, &usec);
+	return sec * 1000 + usec / 1000;
+}
+
+/**
+ *  @brief This function links an armed timer into its flush wheel slot,
+ *         with the wheel lock held
+ *
+ *  @param wheel        A pointer to rx_reorder_wheel
+ *  @param cnxt         A pointer to reorder_tmr_cnxt_t
+ *
+ *  @return             N/A
+ */
+static t_void wlan_11n_reorder_wheel_link(rx_reorder_wheel *wheel,
+					  reorder_tmr_cnxt_t *cnxt)
+{
+	pmlan_list_head slot;
+
+	if (cnxt->expires - wheel->now < RX_REORDER_WHEEL_L0_SIZE)
+		slot = &wheel->l0[cnxt->expires &
+				  (RX_REORDER_WHEEL_L0_SIZE - 1)];
+	else
+		slot = &wheel->l1[(cnxt->expires >> RX_REORDER_WHEEL_L0_BITS) &
+				  (RX_REORDER_WHEEL_L1_SIZE - 1)];
+	util_enqueue_list_tail(MNULL, slot, (pmlan_linked_list)cnxt, MNULL,
+			       MNULL);
+}
+
+/**
+ *  @brief This function advances the flush wheel to the current time,
+ *         with the wheel lock held, and sets the flag to flush data of
+ *         every expired table
+ *
+ *  @param pmadapter    A pointer to mlan_adapter
+ *
+ *  @return             A pointer to mlan_private of an expired table,
+ *                      or MNULL if none expired
+ */
+static mlan_private *wlan_11n_reorder_wheel_advance(pmlan_adapter pmadapter)
+{
+	rx_reorder_wheel *wheel = &pmadapter->reorder_wheel;
+	reorder_tmr_cnxt_t *cnxt;
+	mlan_private *priv = MNULL;
+	t_u32 clock, ticks, idx;
+
+	clock = wlan_11n_reorder_wheel_clock(pmadapter);
+	ticks = MIN(clock - wheel->clock, RX_REORDER_WHEEL_MAX);
+	wheel->clock = clock;
+	for (; ticks && wheel->num_armed; ticks--) {
+		wheel->now++;
+		idx = wheel->now & (RX_REORDER_WHEEL_L0_SIZE - 1);
+		if (!idx) {
+			/* Level 0 wrapped, spread a level 1 slot over it */
+			idx = (wheel->now >> RX_REORDER_WHEEL_L0_BITS) &
+			      (RX_REORDER_WHEEL_L1_SIZE - 1);
+			while ((cnxt = (reorder_tmr_cnxt_t *)util_dequeue_list(
+					MNULL, &wheel->l1[idx], MNULL, MNULL)))
+				wlan_11n_reorder_wheel_link(wheel, cnxt);
+			idx = 0;
+		}
+		while ((cnxt = (reorder_tmr_cnxt_t *)util_dequeue_list(
+				MNULL, &wheel->l0[idx], MNULL, MNULL))) {
+			/* Set the flag to flush data */
+			cnxt->timer_is_set = MFALSE;
+			cnxt->ptr->flush_data = MTRUE;
+			wheel->num_armed--;
+			pmadapter->flush_data = MTRUE;
+			priv = cnxt->priv;
+		}
+	}
+	/* Nothing is left armed, the rest of the time needs no walk */
+	wheel->now += ticks;
+	return priv;
+}
+
+/**
+ *  @brief This function returns the ticks from now to the nearest armed
+ *         entry of the flush wheel, with the wheel lock held
+ *
+ *  @param wheel        A pointer to rx_reorder_wheel
+ *
+ *  @return             Ticks to the nearest expiry, 0 if none is armed
+ */
+static t_u32 wlan_11n_reorder_wheel_next(rx_reorder_wheel *wheel)
+{
+	reorder_tmr_cnxt_t *cnxt;
+	pmlan_list_head slot;
+	t_u32 delta = 0;
+	t_u32 base, dist, i;
+
+	if (!wheel->num_armed)
+		return 0;
+	/* Level 0 holds entries less than one turn away, in expiry order */
+	for (i = 1; i < RX_REORDER_WHEEL_L0_SIZE; i++) {
+		slot = &wheel->l0[(wheel->now + i) &
+				  (RX_REORDER_WHEEL_L0_SIZE - 1)];
+		if (slot->pnext != (pmlan_linked_list)slot) {
+			delta = i;
+			break;
+		}
+	}
+	/* A level 1 slot holds one turn, the first non-empty one is next */
+	base = wheel->now >> RX_REORDER_WHEEL_L0_BITS;
+	for (i = 1; i < RX_REORDER_WHEEL_L1_SIZE; i++) {
+		dist = ((base + i) << RX_REORDER_WHEEL_L0_BITS) - wheel->now;
+		if (delta && dist >= delta)
+			break;
+		slot = &wheel->l1[(base + i) & (RX_REORDER_WHEEL_L1_SIZE - 1)];
+		if (slot->pnext == (pmlan_linked_list)slot)
+			continue;
+		for (cnxt = (reorder_tmr_cnxt_t *)slot->pnext;
+		     cnxt != (reorder_tmr_cnxt_t *)slot; cnxt = cnxt->pnext) {
+			dist = cnxt->expires - wheel->now;
+			if (!delta || dist < delta)
+				delta = dist;
+		}
+		break;
+	}
+	return delta;
+}
+
+/**
+ *  @brief This function disarms the reordering timeout timer
+ *
+ *  @param pmadapter        A pointer to mlan_adapter
+ *  @param rx_reor_tbl_ptr  A pointer to structure RxReorderTbl
+ *
+ *  @return                 N/A
+ */
+static t_void wlan_11n_reorder_timer_stop(pmlan_adapter pmadapter,
+					  RxReorderTbl *rx_reor_tbl_ptr)
+{
+	rx_reorder_wheel *wheel = &pmadapter->reorder_wheel;
+	reorder_tmr_cnxt_t *cnxt = &rx_reor_tbl_ptr->timer_context;
+
+	pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
+					    wheel->plock);
+	if (cnxt->timer_is_set) {
+		/* The slot head is only needed for its lock */
+		util_unlink_list(MNULL, MNULL, (pmlan_linked_list)cnxt, MNULL,
+				 MNULL);
+		cnxt->timer_is_set = MFALSE;
+		wheel->num_armed--;
+		if (!wheel->num_armed && wheel->timer_is_set) {
+			pmadapter->callbacks.moal_stop_timer(
+				pmadapter->pmoal_handle, wheel->timer);
+			wheel->timer_is_set = MFALSE;
+		}
+	}
+	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
+					      wheel->plock);
+}
+
+/**
+ *  @brief This function restarts the reordering timeout timer with the
+ *         adaptive flush timeout of the table
  *
  *  @param pmadapter        A pointer to mlan_adapter
  *  @param rx_reor_tbl_ptr  A pointer to structure RxReorderTbl
@@ -134,25 +320,244 @@ static mlan_status wlan_11n_dispatch_pkt(t_void *priv, t_void *payload,
 static void mlan_11n_rxreorder_timer_restart(pmlan_adapter pmadapter,
 					     RxReorderTbl *rx_reor_tbl_ptr)
 {
-	t_u16 min_flush_time = pmadapter->flush_time_ac_be_bk;
-	mlan_wmm_ac_e wmm_ac;
+	rx_reorder_wheel *wheel = &pmadapter->reorder_wheel;
+	reorder_tmr_cnxt_t *cnxt = &rx_reor_tbl_ptr->timer_context;
+	mlan_private *priv = MNULL;
+	t_u32 max_flush_time;
+	t_s32 flush_time;
 	ENTER();
 
-	wmm_ac = wlan_wmm_convert_tos_to_ac(pmadapter, rx_reor_tbl_ptr->tid);
-	if ((WMM_AC_VI == wmm_ac) || (WMM_AC_VO == wmm_ac))
-		min_flush_time = pmadapter->flush_time_ac_vi_vo;
+	/* Mean plus four mean deviations of the observed hole fill time */
+	max_flush_time = wlan_11n_reorder_max_flush_time(pmadapter,
+							 rx_reor_tbl_ptr->tid);
+	flush_time = (rx_reor_tbl_ptr->hole_srtt >> 3) +
+		     rx_reor_tbl_ptr->hole_mdev;
+	if (flush_time < MIN_ADAPTIVE_FLUSH_TIME)
+		flush_time = MIN_ADAPTIVE_FLUSH_TIME;
+	rx_reor_tbl_ptr->flush_time = MIN((t_u32)flush_time, max_flush_time);
+
+	pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
+					    wheel->plock);
+	/* The wheel only moves on expiry, bring it to the current time */
+	priv = wlan_11n_reorder_wheel_advance(pmadapter);
+	if (cnxt->timer_is_set)
+		util_unlink_list(MNULL, MNULL, (pmlan_linked_list)cnxt, MNULL,
+				 MNULL);
+	else
+		wheel->num_armed++;
+	cnxt->expires = wheel->now + rx_reor_tbl_ptr->flush_time;
+	cnxt->timer_is_set = MTRUE;
+	wlan_11n_reorder_wheel_link(wheel, cnxt);
+	/* Re-arm only when this entry expires before the armed tick */
+	if (!wheel->timer_is_set || (t_s32)(cnxt->expires - wheel->next) < 0) {
+		wheel->timer_is_set = MTRUE;
+		wheel->next = cnxt->expires;
+		pmadapter->callbacks.moal_start_timer(
+			pmadapter->pmoal_handle, wheel->timer, MFALSE,
+			rx_reor_tbl_ptr->flush_time);
+	}
+	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
+					      wheel->plock);
 
-	if (rx_reor_tbl_ptr->timer_context.timer_is_set)
-		pmadapter->callbacks.moal_stop_timer(
-			pmadapter->pmoal_handle,
-			rx_reor_tbl_ptr->timer_context.timer);
+	if (priv)
+		wlan_recv_event(priv, MLAN_EVENT_ID_DRV_DEFER_RX_WORK, MNULL);
+	LEAVE();
+}
 
-	pmadapter->callbacks.moal_start_timer(
-		pmadapter->pmoal_handle, rx_reor_tbl_ptr->timer_context.timer,
-		MFALSE, min_flush_time);
+/**
+ *  @brief This function opens a hole: it records the time the hole
+ *         appeared at and arms the reordering timeout timer
+ *
+ *  @param pmadapter        A pointer to mlan_adapter
+ *  @param rx_reor_tbl_ptr  A pointer to structure RxReorderTbl
+ *
+ *  @return                 N/A
+ */
+static t_void wlan_11n_reorder_hole_open(pmlan_adapter pmadapter,
+					 RxReorderTbl *rx_reor_tbl_ptr)
+{
+	rx_reor_tbl_ptr->hole_start = wlan_11n_reorder_wheel_clock(pmadapter);
+	mlan_11n_rxreorder_timer_restart(pmadapter, rx_reor_tbl_ptr);
+}
 
-	rx_reor_tbl_ptr->timer_context.timer_is_set = MTRUE;
-	LEAVE();
+/**
+ *  @brief This function closes the pending hole, filled or flushed, and
+ *         feeds its wait time into the adaptive flush timeout and the
+ *         hole wait histogram
+ *
+ *  @param pmadapter        A pointer to mlan_adapter
+ *  @param rx_reor_tbl_ptr  A pointer to structure RxReorderTbl
+ *  @param flushed          MTRUE if the flush timeout released the hole
+ *
+ *  @return                 N/A
+ */
+static t_void wlan_11n_reorder_hole_close(pmlan_adapter pmadapter,
+					  RxReorderTbl *rx_reor_tbl_ptr,
+					  t_u8 flushed)
+{
+	rx_reorder_wheel *wheel = &pmadapter->reorder_wheel;
+	t_u32 wait = wlan_11n_reorder_wheel_clock(pmadapter) -
+		     rx_reor_tbl_ptr->hole_start;
+	t_s32 err;
+	int bucket = 0;
+
+	/* Same estimator as the TCP RTO: srtt gain 1/8, mdev gain 1/4 */
+	err = (t_s32)wait - (rx_reor_tbl_ptr->hole_srtt >> 3);
+	rx_reor_tbl_ptr->hole_srtt += err;
+	if (err < 0)
+		err = -err;
+	rx_reor_tbl_ptr->hole_mdev += err - (rx_reor_tbl_ptr->hole_mdev >> 2);
+
+	if (rx_reor_tbl_ptr->tid >= MAX_NUM_TID)
+		return;
+	while (wait && bucket < RX_REORDER_HIST_NUM - 1) {
+		wait >>= 1;
+		bucket++;
+	}
+	wheel->hole_hist[rx_reor_tbl_ptr->tid][bucket]++;
+	if (flushed)
+		wheel->hole_flush[rx_reor_tbl_ptr->tid]++;
+}
+
+/**
+ *  @brief This function returns the ring slot of a window offset
+ *
+ *  @param rx_reor_tbl_ptr  A pointer to structure RxReorderTbl
+ *  @param off              Offset from start_win, 0 .. win_size
+ *
+ *  @return                 Index into rx_reorder_ptr
+ */
+static INLINE int wlan_11n_reorder_slot(RxReorderTbl *rx_reor_tbl_ptr, int off)
+{
+	int idx = rx_reor_tbl_ptr->start_idx + off;
+
+	return (idx >= rx_reor_tbl_ptr->win_size) ?
+		       idx - rx_reor_tbl_ptr->win_size :
+		       idx;
+}
+
+/**
+ *  @brief This function finds the first zero bit of a word
+ *
+ *  @param word     Word to search
+ *
+ *  @return         Bit index 0 .. 31, or 32 if all bits are set
+ */
+static INLINE int wlan_11n_ffz(t_u32 word)
+{
+	int n = 0;
+
+	word = ~word;
+	if (!word)
+		return 32;
+	if (!(word & 0xffff)) {
+		n += 16;
+		word >>= 16;
+	}
+	if (!(word & 0xff)) {
+		n += 8;
+		word >>= 8;
+	}
+	if (!(word & 0xf)) {
+		n += 4;
+		word >>= 4;
+	}
+	if (!(word & 0x3)) {
+		n += 2;
+		word >>= 2;
+	}
+	if (!(word & 0x1))
+		n += 1;
+	return n;
+}
+
+/**
+ *  @brief This function counts the occupied slots from start_win up to
+ *         the first hole, a word of the bitmap at a time
+ *
+ *  @param rx_reor_tbl_ptr  A pointer to structure RxReorderTbl
+ *
+ *  @return                 Number of in-order packets ready
+ */
+static int wlan_11n_reorder_run(RxReorderTbl *rx_reor_tbl_ptr)
+{
+	int win_size = rx_reor_tbl_ptr->win_size;
+	int idx = rx_reor_tbl_ptr->start_idx;
+	int run = 0;
+	int bits, ones;
+
+	while (run < win_size) {
+		/* Bits left in this word before the end of the ring */
+		bits = MIN(32 - (idx & 31), win_size - idx);
+		ones = wlan_11n_ffz(rx_reor_tbl_ptr->bitmap[idx >> 5] >>
+				    (idx & 31));
+		if (ones < bits) {
+			run += ones;
+			break;
+		}
+		run += bits;
+		idx += bits;
+		if (idx == win_size)
+			idx = 0;
+	}
+	return MIN(run, win_size);
+}
+
+/**
+ *  @brief This function releases the first slots of the window and
+ *         dispatches the packets held there in order
+ *
+ *  The packets are passed up inside one moal_recv_batch so that the
+ *  network stack gets them as a single batch.
+ *
+ *  @param priv             A pointer to mlan_private
+ *  @param rx_reor_tbl_ptr  A pointer to structure RxReorderTbl
+ *  @param count            Number of slots to release, up to win_size
+ *  @param start_win        New start window
+ *
+ *  @return                 N/A
+ */
+static t_void wlan_11n_release_slots(t_void *priv,
+				     RxReorderTbl *rx_reor_tbl_ptr, int count,
+				     int start_win)
+{
+	mlan_private *pmpriv = (mlan_private *)priv;
+	pmlan_adapter pmadapter = pmpriv->adapter;
+	pmlan_callbacks pcb = &pmadapter->callbacks;
+	mlan_list_head list;
+	pmlan_buffer pmbuf;
+	t_void *payload;
+	int i, slot, num_pkts = 0;
+
+	util_init_list((pmlan_linked_list)&list);
+	pcb->moal_spin_lock(pmadapter->pmoal_handle, pmpriv->rx_pkt_lock);
+	for (i = 0; i < count && rx_reor_tbl_ptr->num_held; ++i) {
+		slot = wlan_11n_reorder_slot(rx_reor_tbl_ptr, i);
+		payload = rx_reor_tbl_ptr->rx_reorder_ptr[slot];
+		if (!payload)
+			continue;
+		rx_reor_tbl_ptr->rx_reorder_ptr[slot] = MNULL;
+		rx_reor_tbl_ptr->bitmap[slot >> 5] &= ~MBIT(slot & 31);
+		rx_reor_tbl_ptr->num_held--;
+		if (payload == (t_void *)RX_PKT_DROPPED_IN_FW)
+			continue;
+		util_enqueue_list_tail(pmadapter->pmoal_handle, &list,
+				       (pmlan_linked_list)payload, MNULL,
+				       MNULL);
+		num_pkts++;
+	}
+	rx_reor_tbl_ptr->start_idx = wlan_11n_reorder_slot(rx_reor_tbl_ptr,
+							   count);
+	rx_reor_tbl_ptr->start_win = start_win;
+	pcb->moal_spin_unlock(pmadapter->pmoal_handle, pmpriv->rx_pkt_lock);
+
+	if (num_pkts > 1 && pcb->moal_recv_batch)
+		pcb->moal_recv_batch(pmadapter->pmoal_handle, MTRUE);
+	while ((pmbuf = (pmlan_buffer)util_dequeue_list(
+			pmadapter->pmoal_handle, &list, MNULL, MNULL)))
+		wlan_11n_dispatch_pkt(priv, pmbuf, rx_reor_tbl_ptr);
+	if (num_pkts > 1 && pcb->moal_recv_batch)
+		pcb->moal_recv_batch(pmadapter->pmoal_handle, MFALSE);
 }
 
 /**
@@ -168,10 +573,7 @@ static void mlan_11n_rxreorder_timer_restart(pmlan_adapter pmadapter,
 static mlan_status wlan_11n_dispatch_pkt_until_start_win(
 	t_void *priv, RxReorderTbl *rx_reor_tbl_ptr, int start_win)
 {
-	t_u32 no_pkt_to_send, i, xchg;
-	mlan_status ret = MLAN_STATUS_SUCCESS;
-	void *rx_tmp_ptr = MNULL;
-	mlan_private *pmpriv = (mlan_private *)priv;
+	int no_pkt_to_send;
 
 	ENTER();
 
@@ -179,48 +581,11 @@ static mlan_status wlan_11n_dispatch_pkt_until_start_win(
 				 MIN((start_win - rx_reor_tbl_ptr->start_win),
 				     rx_reor_tbl_ptr->win_size) :
 				 rx_reor_tbl_ptr->win_size;
-
-	for (i = 0; i < no_pkt_to_send; ++i) {
-		pmpriv->adapter->callbacks.moal_spin_lock(
-			pmpriv->adapter->pmoal_handle, pmpriv->rx_pkt_lock);
-		rx_tmp_ptr = MNULL;
-		if (rx_reor_tbl_ptr->rx_reorder_ptr[i]) {
-			rx_tmp_ptr = rx_reor_tbl_ptr->rx_reorder_ptr[i];
-			rx_reor_tbl_ptr->rx_reorder_ptr[i] = MNULL;
-		}
-		pmpriv->adapter->callbacks.moal_spin_unlock(
-			pmpriv->adapter->pmoal_handle, pmpriv->rx_pkt_lock);
-		if (rx_tmp_ptr)
-			wlan_11n_dispatch_pkt(priv, rx_tmp_ptr,
-					      rx_reor_tbl_ptr);
-	}
-
-	pmpriv->adapter->callbacks.moal_spin_lock(pmpriv->adapter->pmoal_handle,
-						  pmpriv->rx_pkt_lock);
-	/*
-	 * We don't have a circular buffer, hence use rotation to simulate
-	 * circular buffer
-	 */
-	xchg = rx_reor_tbl_ptr->win_size - no_pkt_to_send;
-	for (i = 0; i < xchg; ++i) {
-		rx_reor_tbl_ptr->rx_reorder_ptr[i] =
-			rx_reor_tbl_ptr->rx_reorder_ptr[no_pkt_to_send + i];
-		rx_reor_tbl_ptr->rx_reorder_ptr[no_pkt_to_send + i] = MNULL;
-	}
-
-	/* clear the bits of reorder bitmap that has been dispatched */
-	if (no_pkt_to_send < (8 * (sizeof(rx_reor_tbl_ptr->bitmap))))
-		rx_reor_tbl_ptr->bitmap =
-			rx_reor_tbl_ptr->bitmap >> no_pkt_to_send;
-	else
-		rx_reor_tbl_ptr->bitmap = 0;
-
-	rx_reor_tbl_ptr->start_win = start_win;
-	pmpriv->adapter->callbacks.moal_spin_unlock(
-		pmpriv->adapter->pmoal_handle, pmpriv->rx_pkt_lock);
+	wlan_11n_release_slots(priv, rx_reor_tbl_ptr, no_pkt_to_send,
+			       start_win);
 
 	LEAVE();
-	return ret;
+	return MLAN_STATUS_SUCCESS;
 }
 
 /**
@@ -255,57 +620,112 @@ static t_void wlan_11n_display_tbl_ptr(pmlan_adapter pmadapter,
 static mlan_status wlan_11n_scan_and_dispatch(t_void *priv,
 					      RxReorderTbl *rx_reor_tbl_ptr)
 {
-	int i, j, xchg;
-	mlan_status ret = MLAN_STATUS_SUCCESS;
-	void *rx_tmp_ptr = MNULL;
 	mlan_private *pmpriv = (mlan_private *)priv;
+	int run;
 
 	ENTER();
 
-	for (i = 0; i < rx_reor_tbl_ptr->win_size; ++i) {
-		pmpriv->adapter->callbacks.moal_spin_lock(
-			pmpriv->adapter->pmoal_handle, pmpriv->rx_pkt_lock);
-		if (!rx_reor_tbl_ptr->rx_reorder_ptr[i]) {
-			pmpriv->adapter->callbacks.moal_spin_unlock(
-				pmpriv->adapter->pmoal_handle,
-				pmpriv->rx_pkt_lock);
-			break;
-		}
-		rx_tmp_ptr = rx_reor_tbl_ptr->rx_reorder_ptr[i];
-		rx_reor_tbl_ptr->rx_reorder_ptr[i] = MNULL;
-		pmpriv->adapter->callbacks.moal_spin_unlock(
-			pmpriv->adapter->pmoal_handle, pmpriv->rx_pkt_lock);
-		wlan_11n_dispatch_pkt(priv, rx_tmp_ptr, rx_reor_tbl_ptr);
-	}
-
 	pmpriv->adapter->callbacks.moal_spin_lock(pmpriv->adapter->pmoal_handle,
 						  pmpriv->rx_pkt_lock);
-	/*
-	 * We don't have a circular buffer, hence use rotation to simulate
-	 * circular buffer
-	 */
-	if (i > 0) {
-		xchg = rx_reor_tbl_ptr->win_size - i;
-		for (j = 0; j < xchg; ++j) {
-			rx_reor_tbl_ptr->rx_reorder_ptr[j] =
-				rx_reor_tbl_ptr->rx_reorder_ptr[i + j];
-			rx_reor_tbl_ptr->rx_reorder_ptr[i + j] = MNULL;
-		}
+	run = wlan_11n_reorder_run(rx_reor_tbl_ptr);
+	pmpriv->adapter->callbacks.moal_spin_unlock(
+		pmpriv->adapter->pmoal_handle, pmpriv->rx_pkt_lock);
+	if (run)
+		wlan_11n_release_slots(priv, rx_reor_tbl_ptr, run,
+				       (rx_reor_tbl_ptr->start_win + run) &
+					       (MAX_TID_VALUE - 1));
+	LEAVE();
+	return MLAN_STATUS_SUCCESS;
+}
+
+/**
+ *  @brief This function finds the RX reorder peer of a TA
+ *
+ *  @param priv     A pointer to mlan_private
+ *  @param ta       TA to find
+ *
+ *  @return         A pointer to rx_reorder_peer or MNULL
+ */
+static rx_reorder_peer *wlan_11n_find_rxreorder_peer(mlan_private *priv,
+						     t_u8 *ta)
+{
+	mlan_list_head *bucket = &priv->rx_reorder_hash[WMM_RA_HASH(ta)];
+	rx_reorder_peer *peer;
+
+	peer = (rx_reorder_peer *)util_peek_list(priv->adapter->pmoal_handle,
+						 bucket, MNULL, MNULL);
+	while (peer && peer != (rx_reorder_peer *)bucket) {
+		if (!memcmp(priv->adapter, peer->ta, ta, MLAN_MAC_ADDR_LENGTH))
+			return peer;
+		peer = peer->pnext;
 	}
+	return MNULL;
+}
 
-	/* clear the bits of reorder bitmap that has been dispatched */
-	if (i < (8 * sizeof(rx_reor_tbl_ptr->bitmap)))
-		rx_reor_tbl_ptr->bitmap = rx_reor_tbl_ptr->bitmap >> i;
-	else
-		rx_reor_tbl_ptr->bitmap = 0;
+/**
+ *  @brief This function indexes a new rxreorder table by TA/TID
+ *
+ *  @param priv             A pointer to mlan_private
+ *  @param rx_reor_tbl_ptr  A pointer to structure RxReorderTbl
+ *
+ *  @return                 MLAN_STATUS_SUCCESS or MLAN_STATUS_FAILURE
+ */
+static mlan_status wlan_11n_link_rxreorder_peer(mlan_private *priv,
+						RxReorderTbl *rx_reor_tbl_ptr)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+	rx_reorder_peer *peer;
 
-	rx_reor_tbl_ptr->start_win =
-		(rx_reor_tbl_ptr->start_win + i) & (MAX_TID_VALUE - 1);
+	/* TIDs beyond MAX_NUM_TID are only found by walking the list */
+	if (rx_reor_tbl_ptr->tid >= MAX_NUM_TID)
+		return MLAN_STATUS_SUCCESS;
+	peer = wlan_11n_find_rxreorder_peer(priv, rx_reor_tbl_ptr->ta);
+	if (!peer) {
+		if (pmadapter->callbacks.moal_malloc(pmadapter->pmoal_handle,
+						     sizeof(rx_reorder_peer),
+						     MLAN_MEM_DEF,
+						     (t_u8 **)&peer))
+			return MLAN_STATUS_FAILURE;
+		memset(pmadapter, peer, 0, sizeof(rx_reorder_peer));
+		memcpy_ext(pmadapter, peer->ta, rx_reor_tbl_ptr->ta,
+			   MLAN_MAC_ADDR_LENGTH, MLAN_MAC_ADDR_LENGTH);
+		util_enqueue_list_tail(
+			pmadapter->pmoal_handle,
+			&priv->rx_reorder_hash[WMM_RA_HASH(peer->ta)],
+			(pmlan_linked_list)peer, MNULL, MNULL);
+	}
+	if (!peer->tbl[rx_reor_tbl_ptr->tid])
+		peer->num_tbl++;
+	peer->tbl[rx_reor_tbl_ptr->tid] = rx_reor_tbl_ptr;
+	return MLAN_STATUS_SUCCESS;
+}
 
-	pmpriv->adapter->callbacks.moal_spin_unlock(
-		pmpriv->adapter->pmoal_handle, pmpriv->rx_pkt_lock);
-	LEAVE();
-	return ret;
+/**
+ *  @brief This function removes a rxreorder table from its TA/TID index
+ *
+ *  @param priv             A pointer to mlan_private
+ *  @param rx_reor_tbl_ptr  A pointer to structure RxReorderTbl
+ *
+ *  @return                 N/A
+ */
+static t_void wlan_11n_unlink_rxreorder_peer(mlan_private *priv,
+					     RxReorderTbl *rx_reor_tbl_ptr)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+	rx_reorder_peer *peer;
+
+	if (rx_reor_tbl_ptr->tid >= MAX_NUM_TID)
+		return;
+	peer = wlan_11n_find_rxreorder_peer(priv, rx_reor_tbl_ptr->ta);
+	if (!peer || peer->tbl[rx_reor_tbl_ptr->tid] != rx_reor_tbl_ptr)
+		return;
+	peer->tbl[rx_reor_tbl_ptr->tid] = MNULL;
+	if (--peer->num_tbl)
+		return;
+	util_unlink_list(pmadapter->pmoal_handle,
+			 &priv->rx_reorder_hash[WMM_RA_HASH(peer->ta)],
+			 (pmlan_linked_list)peer, MNULL, MNULL);
+	pmadapter->callbacks.moal_mfree(pmadapter->pmoal_handle, (t_u8 *)peer);
 }
 
 /**
@@ -335,20 +755,10 @@ static t_void wlan_11n_delete_rxreorder_tbl_entry(mlan_private *priv,
 		(rx_reor_tbl_ptr->start_win + rx_reor_tbl_ptr->win_size) &
 			(MAX_TID_VALUE - 1));
 
-	if (rx_reor_tbl_ptr->timer_context.timer) {
-		if (rx_reor_tbl_ptr->timer_context.timer_is_set) {
-			priv->adapter->callbacks.moal_stop_timer(
-				pmadapter->pmoal_handle,
-				rx_reor_tbl_ptr->timer_context.timer);
-			rx_reor_tbl_ptr->timer_context.timer_is_set = MFALSE;
-		}
-		priv->adapter->callbacks.moal_free_timer(
-			pmadapter->pmoal_handle,
-			rx_reor_tbl_ptr->timer_context.timer);
-		rx_reor_tbl_ptr->timer_context.timer = MNULL;
-	}
+	wlan_11n_reorder_timer_stop(pmadapter, rx_reor_tbl_ptr);
 
 	PRINTM(MDAT_D, "Delete rx_reor_tbl_ptr: %p\n", rx_reor_tbl_ptr);
+	wlan_11n_unlink_rxreorder_peer(priv, rx_reor_tbl_ptr);
 	util_unlink_list(pmadapter->pmoal_handle, &priv->rx_reorder_tbl_ptr,
 			 (pmlan_linked_list)rx_reor_tbl_ptr,
 			 pmadapter->callbacks.moal_spin_lock,
@@ -357,6 +767,8 @@ static t_void wlan_11n_delete_rxreorder_tbl_entry(mlan_private *priv,
 	pmadapter->callbacks.moal_mfree(
 		pmadapter->pmoal_handle,
 		(t_u8 *)rx_reor_tbl_ptr->rx_reorder_ptr);
+	pmadapter->callbacks.moal_mfree(pmadapter->pmoal_handle,
+					(t_u8 *)rx_reor_tbl_ptr->bitmap);
 	pmadapter->callbacks.moal_mfree(pmadapter->pmoal_handle,
 					(t_u8 *)rx_reor_tbl_ptr);
 	mlan_block_rx_process(pmadapter, MFALSE);
@@ -377,7 +789,8 @@ static int wlan_11n_find_last_seqnum(RxReorderTbl *rx_reorder_tbl_ptr)
 
 	ENTER();
 	for (i = (rx_reorder_tbl_ptr->win_size - 1); i >= 0; --i) {
-		if (rx_reorder_tbl_ptr->rx_reorder_ptr[i]) {
+		if (rx_reorder_tbl_ptr->rx_reorder_ptr[wlan_11n_reorder_slot(
+			    rx_reorder_tbl_ptr, i)]) {
 			LEAVE();
 			return i;
 		}
@@ -402,6 +815,11 @@ static t_void wlan_start_flush_data(mlan_private *priv,
 	ENTER();
 	wlan_11n_display_tbl_ptr(priv->adapter, rx_reor_tbl_ptr);
 
+	/* Everything held goes up, so no hole is left pending */
+	wlan_11n_reorder_timer_stop(priv->adapter, rx_reor_tbl_ptr);
+	if (rx_reor_tbl_ptr->num_held)
+		wlan_11n_reorder_hole_close(priv->adapter, rx_reor_tbl_ptr,
+					    MTRUE);
 	startWin = wlan_11n_find_last_seqnum(rx_reor_tbl_ptr);
 	if (startWin >= 0) {
 		PRINTM(MINFO, "Flush data %d\n", startWin);
@@ -415,22 +833,38 @@ static t_void wlan_start_flush_data(mlan_private *priv,
 }
 
 /**
- *  @brief This function set the flag to flushes data
+ *  @brief This function handles the RX reorder flush wheel timer: it
+ *         expires the due tables and re-arms the timer for the nearest
+ *         remaining expiry
  *
- *  @param context      Reorder context pointer
+ *  @param context      A pointer to mlan_adapter
  *
  *  @return             N/A
  */
-static t_void wlan_flush_data(t_void *context)
+static t_void wlan_11n_reorder_wheel_tick(t_void *context)
 {
-	reorder_tmr_cnxt_t *reorder_cnxt = (reorder_tmr_cnxt_t *)context;
+	pmlan_adapter pmadapter = (pmlan_adapter)context;
+	rx_reorder_wheel *wheel = &pmadapter->reorder_wheel;
+	mlan_private *priv = MNULL;
+	t_u32 delta;
 	ENTER();
-	/* Set the flag to flush data */
-	reorder_cnxt->priv->adapter->flush_data = MTRUE;
-	reorder_cnxt->ptr->flush_data = MTRUE;
-	reorder_cnxt->timer_is_set = MFALSE;
-	wlan_recv_event(reorder_cnxt->priv, MLAN_EVENT_ID_DRV_DEFER_RX_WORK,
-			MNULL);
+
+	pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
+					    wheel->plock);
+	priv = wlan_11n_reorder_wheel_advance(pmadapter);
+	delta = wlan_11n_reorder_wheel_next(wheel);
+	if (delta) {
+		wheel->next = wheel->now + delta;
+		pmadapter->callbacks.moal_start_timer(pmadapter->pmoal_handle,
+						      wheel->timer, MFALSE,
+						      delta);
+	} else
+		wheel->timer_is_set = MFALSE;
+	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
+					      wheel->plock);
+
+	if (priv)
+		wlan_recv_event(priv, MLAN_EVENT_ID_DRV_DEFER_RX_WORK, MNULL);
 	LEAVE();
 }
 
@@ -492,23 +926,52 @@ static t_void wlan_11n_create_rxreorder_tbl(mlan_private *priv, t_u8 *ta,
 		LEAVE();
 		return;
 	}
+	if (pmadapter->callbacks.moal_malloc(
+		    pmadapter->pmoal_handle,
+		    sizeof(t_u32) * ((win_size + 31) >> 5), MLAN_MEM_DEF,
+		    (t_u8 **)&new_node->bitmap)) {
+		PRINTM(MERROR, "Rx reorder bitmap memory allocation failed\n");
+		pmadapter->callbacks.moal_mfree(
+			pmadapter->pmoal_handle,
+			(t_u8 *)new_node->rx_reorder_ptr);
+		pmadapter->callbacks.moal_mfree(pmadapter->pmoal_handle,
+						(t_u8 *)new_node);
+		mlan_block_rx_process(pmadapter, MFALSE);
+		LEAVE();
+		return;
+	}
+	memset(pmadapter, new_node->bitmap, 0,
+	       sizeof(t_u32) * ((win_size + 31) >> 5));
+	new_node->tid = tid;
+	memcpy_ext(pmadapter, new_node->ta, ta, MLAN_MAC_ADDR_LENGTH,
+		   MLAN_MAC_ADDR_LENGTH);
+	if (wlan_11n_link_rxreorder_peer(priv, new_node)) {
+		PRINTM(MERROR, "Rx reorder peer memory allocation failed\n");
+		pmadapter->callbacks.moal_mfree(
+			pmadapter->pmoal_handle,
+			(t_u8 *)new_node->rx_reorder_ptr);
+		pmadapter->callbacks.moal_mfree(pmadapter->pmoal_handle,
+						(t_u8 *)new_node->bitmap);
+		pmadapter->callbacks.moal_mfree(pmadapter->pmoal_handle,
+						(t_u8 *)new_node);
+		mlan_block_rx_process(pmadapter, MFALSE);
+		LEAVE();
+		return;
+	}
 	PRINTM(MDAT_D, "Create ReorderPtr: %p start_win=%d last_seq=%d\n",
 	       new_node, new_node->start_win, last_seq);
 	new_node->timer_context.ptr = new_node;
 	new_node->timer_context.priv = priv;
 	new_node->timer_context.timer_is_set = MFALSE;
-	pmadapter->callbacks.moal_init_timer(pmadapter->pmoal_handle,
-					     &new_node->timer_context.timer,
-					     wlan_flush_data,
-					     &new_node->timer_context);
+	/* Start from the configured flush time until holes get measured */
+	new_node->flush_time = wlan_11n_reorder_max_flush_time(pmadapter, tid);
+	new_node->hole_srtt = (t_s32)(new_node->flush_time >> 1) << 3;
+	new_node->hole_mdev = (t_s32)(new_node->flush_time >> 1);
 	util_enqueue_list_tail(pmadapter->pmoal_handle,
 			       &priv->rx_reorder_tbl_ptr,
 			       (pmlan_linked_list)new_node,
 			       pmadapter->callbacks.moal_spin_lock,
 			       pmadapter->callbacks.moal_spin_unlock);
-	new_node->tid = tid;
-	memcpy_ext(pmadapter, new_node->ta, ta, MLAN_MAC_ADDR_LENGTH,
-		   MLAN_MAC_ADDR_LENGTH);
 	new_node->start_win = seq_num;
 	new_node->pkt_count = 0;
 	if (queuing_ra_based(priv)) {
@@ -530,7 +993,8 @@ static t_void wlan_11n_create_rxreorder_tbl(mlan_private *priv, t_u8 *ta,
 	new_node->win_size = win_size;
 	new_node->force_no_drop = MFALSE;
 	new_node->check_start_win = MTRUE;
-	new_node->bitmap = 0;
+	new_node->start_idx = 0;
+	new_node->num_held = 0;
 
 	new_node->ba_status = BA_STREAM_SETUP_INPROGRESS;
 	for (i = 0; i < win_size; ++i)
@@ -557,9 +1021,17 @@ static t_void wlan_11n_create_rxreorder_tbl(mlan_private *priv, t_u8 *ta,
 RxReorderTbl *wlan_11n_get_rxreorder_tbl(mlan_private *priv, int tid, t_u8 *ta)
 {
 	RxReorderTbl *rx_reor_tbl_ptr;
+	rx_reorder_peer *peer;
 
 	ENTER();
 
+	/* Per packet lookup: one hash bucket walk plus the TID index */
+	if (tid >= 0 && tid < MAX_NUM_TID) {
+		peer = wlan_11n_find_rxreorder_peer(priv, ta);
+		LEAVE();
+		return peer ? peer->tbl[tid] : MNULL;
+	}
+
 	rx_reor_tbl_ptr =
 		(RxReorderTbl *)util_peek_list(priv->adapter->pmoal_handle,
 					       &priv->rx_reorder_tbl_ptr, MNULL,
@@ -830,7 +1302,7 @@ mlan_status mlan_11n_rxreorder_pkt(void *priv, t_u16 seq_num, t_u16 tid,
 				   t_u8 *ta, t_u8 pkt_type, void *payload)
 {
 	RxReorderTbl *rx_reor_tbl_ptr;
-	int prev_start_win, start_win, end_win, win_size;
+	int prev_start_win, start_win, end_win, win_size, slot;
 	mlan_status ret = MLAN_STATUS_SUCCESS;
 	pmlan_adapter pmadapter = ((mlan_private *)priv)->adapter;
 
@@ -945,8 +1417,7 @@ mlan_status mlan_11n_rxreorder_pkt(void *priv, t_u16 seq_num, t_u16 tid,
 					(MAX_TID_VALUE - 1));
 			if (pkt_type != PKT_TYPE_BAR)
 				rx_reor_tbl_ptr->start_win = seq_num;
-			mlan_11n_rxreorder_timer_restart(pmadapter,
-							 rx_reor_tbl_ptr);
+			wlan_11n_reorder_hole_open(pmadapter, rx_reor_tbl_ptr);
 		}
 
 		prev_start_win = start_win = rx_reor_tbl_ptr->start_win;
@@ -1023,35 +1494,19 @@ mlan_status mlan_11n_rxreorder_pkt(void *priv, t_u16 seq_num, t_u16 tid,
 		       " end_win %d\n",
 		       seq_num, start_win, win_size, end_win);
 		if (pkt_type != PKT_TYPE_BAR) {
-			if (seq_num >= start_win) {
-				if (rx_reor_tbl_ptr->rx_reorder_ptr[seq_num -
-								    start_win]) {
-					PRINTM(MDAT_D, "Drop Duplicate Pkt\n");
-					ret = MLAN_STATUS_FAILURE;
-					goto done;
-				}
-				rx_reor_tbl_ptr
-					->rx_reorder_ptr[seq_num - start_win] =
-					payload;
-				MLAN_SET_BIT(rx_reor_tbl_ptr->bitmap,
-					     seq_num - start_win);
-			} else { /* Wrap condition */
-				if (rx_reor_tbl_ptr
-					    ->rx_reorder_ptr[(seq_num +
-							      (MAX_TID_VALUE)) -
-							     start_win]) {
-					PRINTM(MDAT_D, "Drop Duplicate Pkt\n");
-					ret = MLAN_STATUS_FAILURE;
-					goto done;
-				}
-				rx_reor_tbl_ptr
-					->rx_reorder_ptr[(seq_num +
-							  (MAX_TID_VALUE)) -
-							 start_win] = payload;
-				MLAN_SET_BIT(rx_reor_tbl_ptr->bitmap,
-					     (seq_num + (MAX_TID_VALUE)) -
-						     start_win);
+			if (seq_num >= start_win)
+				slot = seq_num - start_win;
+			else /* Wrap condition */
+				slot = (seq_num + (MAX_TID_VALUE)) - start_win;
+			slot = wlan_11n_reorder_slot(rx_reor_tbl_ptr, slot);
+			if (rx_reor_tbl_ptr->rx_reorder_ptr[slot]) {
+				PRINTM(MDAT_D, "Drop Duplicate Pkt\n");
+				ret = MLAN_STATUS_FAILURE;
+				goto done;
 			}
+			rx_reor_tbl_ptr->rx_reorder_ptr[slot] = payload;
+			rx_reor_tbl_ptr->bitmap[slot >> 5] |= MBIT(slot & 31);
+			rx_reor_tbl_ptr->num_held++;
 		}
 
 		wlan_11n_display_tbl_ptr(pmadapter, rx_reor_tbl_ptr);
@@ -1066,19 +1521,19 @@ mlan_status mlan_11n_rxreorder_pkt(void *priv, t_u16 seq_num, t_u16 tid,
 	}
 
 done:
-	if (rx_reor_tbl_ptr->bitmap == 0) {
+	if (rx_reor_tbl_ptr->num_held == 0) {
 		if (rx_reor_tbl_ptr->timer_context.timer_is_set) {
-			pmadapter->callbacks.moal_stop_timer(
-				pmadapter->pmoal_handle,
-				rx_reor_tbl_ptr->timer_context.timer);
-			rx_reor_tbl_ptr->timer_context.timer_is_set = MFALSE;
-		}
-	} else {
-		if (!rx_reor_tbl_ptr->timer_context.timer_is_set ||
-		    (prev_start_win != rx_reor_tbl_ptr->start_win)) {
-			mlan_11n_rxreorder_timer_restart(pmadapter,
-							 rx_reor_tbl_ptr);
+			wlan_11n_reorder_timer_stop(pmadapter,
+						    rx_reor_tbl_ptr);
+			wlan_11n_reorder_hole_close(pmadapter, rx_reor_tbl_ptr,
+						    MFALSE);
 		}
+	} else if (!rx_reor_tbl_ptr->timer_context.timer_is_set) {
+		wlan_11n_reorder_hole_open(pmadapter, rx_reor_tbl_ptr);
+	} else if (prev_start_win != rx_reor_tbl_ptr->start_win) {
+		/* The old hole got filled, but a newer one is still open */
+		wlan_11n_reorder_hole_close(pmadapter, rx_reor_tbl_ptr, MFALSE);
+		wlan_11n_reorder_hole_open(pmadapter, rx_reor_tbl_ptr);
 	}
 	LEAVE();
 	return ret;
@@ -1612,3 +2067,72 @@ void wlan_coex_ampdu_rxwinsize(pmlan_adapter pmadapter)
 		wlan_update_ampdu_rxwinsize(pmadapter, MFALSE);
 	return;
 }
+
+/**
+ *  @brief This function initializes the RX reorder flush wheel
+ *
+ *  @param pmadapter    A pointer to mlan_adapter
+ *
+ *  @return             MLAN_STATUS_SUCCESS or MLAN_STATUS_FAILURE
+ */
+mlan_status wlan_11n_init_reorder_wheel(pmlan_adapter pmadapter)
+{
+	rx_reorder_wheel *wheel = &pmadapter->reorder_wheel;
+	pmlan_callbacks pcb = &pmadapter->callbacks;
+	mlan_status ret;
+	int i;
+
+	ENTER();
+	memset(pmadapter, wheel, 0, sizeof(rx_reorder_wheel));
+	for (i = 0; i < RX_REORDER_WHEEL_L0_SIZE; i++)
+		util_init_list_head(pmadapter->pmoal_handle, &wheel->l0[i],
+				    MFALSE, MNULL);
+	for (i = 0; i < RX_REORDER_WHEEL_L1_SIZE; i++)
+		util_init_list_head(pmadapter->pmoal_handle, &wheel->l1[i],
+				    MFALSE, MNULL);
+	ret = pcb->moal_init_lock(pmadapter->pmoal_handle, &wheel->plock);
+	if (ret != MLAN_STATUS_SUCCESS)
+		goto done;
+	/* Armed for the nearest expiry, fall back to the jiffy timer */
+	if (pcb->moal_init_hrtimer)
+		ret = pcb->moal_init_hrtimer(pmadapter->pmoal_handle,
+					     &wheel->timer,
+					     wlan_11n_reorder_wheel_tick,
+					     pmadapter);
+	else
+		ret = pcb->moal_init_timer(pmadapter->pmoal_handle,
+					   &wheel->timer,
+					   wlan_11n_reorder_wheel_tick,
+					   pmadapter);
+done:
+	LEAVE();
+	return ret;
+}
+
+/**
+ *  @brief This function frees the RX reorder flush wheel
+ *
+ *  @param pmadapter    A pointer to mlan_adapter
+ *
+ *  @return             N/A
+ */
+t_void wlan_11n_free_reorder_wheel(pmlan_adapter pmadapter)
+{
+	rx_reorder_wheel *wheel = &pmadapter->reorder_wheel;
+	pmlan_callbacks pcb = &pmadapter->callbacks;
+
+	ENTER();
+	if (wheel->timer) {
+		if (wheel->timer_is_set)
+			pcb->moal_stop_timer(pmadapter->pmoal_handle,
+					     wheel->timer);
+		pcb->moal_free_timer(pmadapter->pmoal_handle, wheel->timer);
+		wheel->timer = MNULL;
+		wheel->timer_is_set = MFALSE;
+	}
+	if (wheel->plock) {
+		pcb->moal_free_lock(pmadapter->pmoal_handle, wheel->plock);
+		wheel->plock = MNULL;
+	}
+	LEAVE();
+}
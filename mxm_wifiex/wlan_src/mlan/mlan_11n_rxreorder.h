@@ -99,6 +99,8 @@ void wlan_11n_rxba_sync_event(mlan_private *priv, t_u8 *event_buf, t_u16 len);
 void wlan_update_rxreorder_tbl(pmlan_adapter pmadapter, t_u8 flag);
 void wlan_flush_rxreorder_tbl(pmlan_adapter pmadapter);
 void wlan_coex_ampdu_rxwinsize(pmlan_adapter pmadapter);
+mlan_status wlan_11n_init_reorder_wheel(pmlan_adapter pmadapter);
+t_void wlan_11n_free_reorder_wheel(pmlan_adapter pmadapter);
 
 /** clean up reorder_tbl */
 void wlan_cleanup_reorder_tbl(mlan_private *priv, t_u8 *ta);
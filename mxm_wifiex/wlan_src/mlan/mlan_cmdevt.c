@@ -4134,6 +4134,7 @@ mlan_status wlan_ret_802_11_tx_rate_query(pmlan_private pmpriv,
 {
 	mlan_adapter *pmadapter = pmpriv->adapter;
 	mlan_ds_rate *rate = MNULL;
+	t_u32 usec = 0;
 	ENTER();
 
 	pmpriv->tx_rate = resp->params.tx_rate.tx_rate;
@@ -4153,6 +4154,19 @@ mlan_status wlan_ret_802_11_tx_rate_query(pmlan_private pmpriv,
 	else
 		pmpriv->ext_tx_rate_info = 0;
 
+	if ((pmadapter->airtime_fair || pmadapter->amsdu_adapt) &&
+	    wlan_wmm_tx_rate_for_all_ra(pmpriv)) {
+		wlan_wmm_update_ralist_rate(
+			pmpriv, MNULL,
+			(t_u16)wlan_index_to_data_rate(
+				pmadapter, pmpriv->tx_rate,
+				pmpriv->tx_rate_info,
+				pmpriv->ext_tx_rate_info));
+		pmadapter->callbacks.moal_get_system_time(
+			pmadapter->pmoal_handle, &pmpriv->tx_rate_update_sec,
+			&usec);
+	}
+
 	if (!pmpriv->is_data_rate_auto) {
 		pmpriv->data_rate =
 			wlan_index_to_data_rate(pmadapter, pmpriv->tx_rate,
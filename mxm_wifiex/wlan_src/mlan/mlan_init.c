@@ -1024,6 +1024,28 @@ mlan_status wlan_init_priv_lock_list(pmlan_adapter pmadapter, t_u8 start_index)
 				ret = MLAN_STATUS_FAILURE;
 				goto error;
 			}
+			if (pcb->moal_init_lock(pmadapter->pmoal_handle,
+						&priv->wmm.ready_lock) !=
+			    MLAN_STATUS_SUCCESS) {
+				ret = MLAN_STATUS_FAILURE;
+				goto error;
+			}
+			if (pcb->moal_init_lock(pmadapter->pmoal_handle,
+						&priv->tdls_pending_lock) !=
+			    MLAN_STATUS_SUCCESS) {
+				ret = MLAN_STATUS_FAILURE;
+				goto error;
+			}
+			for (j = 0; j < MAX_NUM_TID; ++j) {
+				if (pcb->moal_init_lock(
+					    pmadapter->pmoal_handle,
+					    &priv->wmm.tid_tbl_ptr[j]
+						     .ra_list_lock) !=
+				    MLAN_STATUS_SUCCESS) {
+					ret = MLAN_STATUS_FAILURE;
+					goto error;
+				}
+			}
 #ifdef STA_SUPPORT
 			if (pcb->moal_init_lock(pmadapter->pmoal_handle,
 						&priv->curr_bcn_buf_lock) !=
@@ -1050,7 +1072,17 @@ mlan_status wlan_init_priv_lock_list(pmlan_adapter pmadapter, t_u8 start_index)
 					&priv->wmm.tid_tbl_ptr[j].ra_list,
 					MTRUE,
 					priv->adapter->callbacks.moal_init_lock);
+				/* Ready list is protected by ra_list_lock */
+				util_init_list_head(
+					(t_void *)pmadapter->pmoal_handle,
+					&priv->wmm.tid_tbl_ptr[j].ready_list,
+					MFALSE, MNULL);
 			}
+			pmadapter->tx_ready_map[i] = 0;
+			for (j = 0; j < WMM_RA_HASH_SIZE; ++j)
+				util_init_list_head(
+					(t_void *)pmadapter->pmoal_handle,
+					&priv->wmm.ra_hash[j], MFALSE, MNULL);
 			util_init_list_head(
 				(t_void *)pmadapter->pmoal_handle,
 				&priv->tx_ba_stream_tbl_ptr, MTRUE,
@@ -1059,24 +1091,31 @@ mlan_status wlan_init_priv_lock_list(pmlan_adapter pmadapter, t_u8 start_index)
 				(t_void *)pmadapter->pmoal_handle,
 				&priv->rx_reorder_tbl_ptr, MTRUE,
 				pmadapter->callbacks.moal_init_lock);
+			/* Changed with RX blocked, like rx_reorder_tbl_ptr */
+			for (j = 0; j < WMM_RA_HASH_SIZE; ++j)
+				util_init_list_head(
+					(t_void *)pmadapter->pmoal_handle,
+					&priv->rx_reorder_hash[j], MFALSE,
+					MNULL);
 			util_scalar_init((t_void *)pmadapter->pmoal_handle,
 					 &priv->wmm.tx_pkts_queued, 0,
-					 priv->wmm.ra_list_spinlock,
+					 priv->wmm.ready_lock,
 					 pmadapter->callbacks.moal_init_lock);
 			util_scalar_init((t_void *)pmadapter->pmoal_handle,
 					 &priv->wmm.highest_queued_prio,
 					 HIGH_PRIO_TID,
-					 priv->wmm.ra_list_spinlock,
+					 priv->wmm.ready_lock,
 					 pmadapter->callbacks.moal_init_lock);
 			util_init_list_head(
 				(t_void *)pmadapter->pmoal_handle,
 				&priv->sta_list, MTRUE,
 				pmadapter->callbacks.moal_init_lock);
-			/* Initialize tdls_pending_txq */
-			util_init_list_head(
-				(t_void *)pmadapter->pmoal_handle,
-				&priv->tdls_pending_txq, MTRUE,
-				pmadapter->callbacks.moal_init_lock);
+			/* Initialize tdls_pending_hash */
+			for (j = 0; j < WMM_RA_HASH_SIZE; ++j)
+				util_init_list_head(
+					(t_void *)pmadapter->pmoal_handle,
+					&priv->tdls_pending_hash[j], MFALSE,
+					MNULL);
 			/* Initialize bypass_txq */
 			util_init_list_head(
 				(t_void *)pmadapter->pmoal_handle,
@@ -1190,6 +1229,7 @@ mlan_status wlan_init_lock_list(pmlan_adapter pmadapter)
 	util_scalar_init((t_void *)pmadapter->pmoal_handle,
 			 &pmadapter->bypass_pkt_count, 0, MNULL,
 			 pmadapter->callbacks.moal_init_lock);
+	pmadapter->bypass_ready_map = 0;
 	util_scalar_init((t_void *)pmadapter->pmoal_handle,
 			 &pmadapter->pending_bridge_pkts, 0, MNULL,
 			 pmadapter->callbacks.moal_init_lock);
@@ -1289,6 +1329,19 @@ t_void wlan_free_lock_list(pmlan_adapter pmadapter)
 			if (priv->wmm.ra_list_spinlock)
 				pcb->moal_free_lock(pmadapter->pmoal_handle,
 						    priv->wmm.ra_list_spinlock);
+			if (priv->wmm.ready_lock)
+				pcb->moal_free_lock(pmadapter->pmoal_handle,
+						    priv->wmm.ready_lock);
+			if (priv->tdls_pending_lock)
+				pcb->moal_free_lock(pmadapter->pmoal_handle,
+						    priv->tdls_pending_lock);
+			for (j = 0; j < MAX_NUM_TID; ++j) {
+				if (priv->wmm.tid_tbl_ptr[j].ra_list_lock)
+					pcb->moal_free_lock(
+						pmadapter->pmoal_handle,
+						priv->wmm.tid_tbl_ptr[j]
+							.ra_list_lock);
+			}
 #ifdef STA_SUPPORT
 			if (priv->curr_bcn_buf_lock)
 				pcb->moal_free_lock(pmadapter->pmoal_handle,
@@ -1338,10 +1391,6 @@ t_void wlan_free_lock_list(pmlan_adapter pmadapter)
 				(t_void *)pmadapter->pmoal_handle,
 				&priv->sta_list,
 				priv->adapter->callbacks.moal_free_lock);
-			util_free_list_head(
-				(t_void *)pmadapter->pmoal_handle,
-				&priv->tdls_pending_txq,
-				pmadapter->callbacks.moal_free_lock);
 			util_free_list_head(
 				(t_void *)pmadapter->pmoal_handle,
 				&priv->bypass_txq,
@@ -1422,6 +1471,10 @@ mlan_status wlan_init_timer(pmlan_adapter pmadapter)
 		goto error;
 	}
 	pmadapter->wakeup_fw_timer_is_set = MFALSE;
+	if (wlan_11n_init_reorder_wheel(pmadapter) != MLAN_STATUS_SUCCESS) {
+		ret = MLAN_STATUS_FAILURE;
+		goto error;
+	}
 error:
 	LEAVE();
 	return ret;
@@ -1462,6 +1515,7 @@ t_void wlan_free_timer(pmlan_adapter pmadapter)
 	if (pmadapter->pwakeup_fw_timer)
 		pcb->moal_free_timer(pmadapter->pmoal_handle,
 				     pmadapter->pwakeup_fw_timer);
+	wlan_11n_free_reorder_wheel(pmadapter);
 
 	LEAVE();
 	return;
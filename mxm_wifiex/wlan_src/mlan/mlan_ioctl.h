@@ -2235,6 +2235,8 @@ typedef struct _mlan_bss_info {
 
 /** Max RX Win size */
 #define MAX_RX_WINSIZE 64
+/** Number of log2 ms buckets in the RX reorder hole wait histogram */
+#define RX_REORDER_HIST_NUM 11
 
 /** rx_reorder_tbl */
 typedef struct {
@@ -2248,6 +2250,8 @@ typedef struct {
 	t_u32 win_size;
 	/** amsdu flag */
 	t_u8 amsdu;
+	/** Adaptive flush timeout in ms */
+	t_u32 flush_time;
 	/** buffer status */
 	t_u32 buffer[MAX_RX_WINSIZE];
 } rx_reorder_tbl;
@@ -2305,6 +2309,12 @@ typedef struct _ralist_info {
 	t_u8 tid;
 	/** tx_pause flag */
 	t_u8 tx_pause;
+	/** packets dropped by CoDel */
+	t_u32 codel_drops;
+	/** packets ECN marked by CoDel */
+	t_u32 codel_marks;
+	/** AMSDU size in use */
+	t_u16 amsdu_size;
 } ralist_info, *pralist_info;
 
 /** mlan_debug_info data structure for MLAN_OID_GET_DEBUG_INFO */
@@ -2331,6 +2341,10 @@ typedef struct _mlan_debug_info {
 	t_u32 rx_tbl_num;
 	/** Rx reorder table*/
 	rx_reorder_tbl rx_tbl[MLAN_MAX_RX_BASTREAM_SUPPORTED];
+	/** Rx reorder hole wait histogram per TID, log2 ms buckets */
+	t_u32 rx_reorder_hist[MAX_NUM_TID][RX_REORDER_HIST_NUM];
+	/** Rx reorder holes released by the flush timeout per TID */
+	t_u32 rx_reorder_flush[MAX_NUM_TID];
 	/** TDLS peer number */
 	t_u32 tdls_peer_num;
 	/** TDLS peer list*/
@@ -2544,6 +2558,10 @@ typedef struct _mlan_debug_info {
 	t_u8 event_received;
 	/**  pendig tx pkts */
 	t_u32 tx_pkts_queued;
+	/** Number of times a TX queue ra_list_lock was taken */
+	t_u32 ralist_lock_acquired;
+	/** Number of times a TX queue ra_list_lock was contended */
+	t_u32 ralist_lock_contended;
 #ifdef UAP_SUPPORT
 	/**  pending bridge pkts */
 	t_u16 num_bridge_pkts;
@@ -757,6 +757,19 @@ typedef enum _baStatus_e {
 /** RA list table */
 typedef struct _raListTbl raListTbl, *praListTbl;
 
+/** RA list ready node */
+typedef struct _ralist_ready_node ralist_ready_node;
+
+/** RA list ready node */
+struct _ralist_ready_node {
+	/** Pointer to previous node */
+	ralist_ready_node *pprev;
+	/** Pointer to next node */
+	ralist_ready_node *pnext;
+	/** Pointer to the RA list */
+	raListTbl *ra_list;
+};
+
 /** RA list table */
 struct _raListTbl {
 	/** Pointer to previous node */
@@ -787,14 +800,76 @@ struct _raListTbl {
 	t_u8 is_tdls_link;
 	/** tx_pause flag */
 	t_u8 tx_pause;
+	/** Node in the TID ready list, linked while packets can be sent */
+	ralist_ready_node ready_node;
+	/** Airtime left in the current DRR round, in usec */
+	t_s32 airtime_deficit;
+	/** Last known data rate to the RA, in 500 Kbps units */
+	t_u16 airtime_rate;
+	/** Adaptive AMSDU size in bytes, 0 to send no AMSDU */
+	t_u16 amsdu_size;
+	/** CoDel: time the sojourn time stayed above target until, usec */
+	t_u32 codel_first_above;
+	/** CoDel: time of the next drop, usec */
+	t_u32 codel_drop_next;
+	/** CoDel: drops in the current dropping state */
+	t_u32 codel_count;
+	/** CoDel: codel_count when the last dropping state ended */
+	t_u32 codel_lastcount;
+	/** CoDel: in dropping state */
+	t_u8 codel_dropping;
+	/** Packets dropped by CoDel */
+	t_u32 codel_drops;
+	/** Packets ECN marked by CoDel */
+	t_u32 codel_marks;
+};
+
+/** RA hash entry holding the RA lists of one peer */
+typedef struct _ralist_peer ralist_peer;
+struct _ralist_peer {
+	/** Pointer to previous node */
+	ralist_peer *pprev;
+	/** Pointer to next node */
+	ralist_peer *pnext;
+	/** Receiver address of the peer */
+	t_u8 ra[MLAN_MAC_ADDR_LENGTH];
+	/** RA list of the peer for each TID */
+	raListTbl *ra_list[MAX_NUM_TID];
+};
+
+/** Number of buckets in the RA hash, must be a power of 2 */
+#define WMM_RA_HASH_SIZE 32
+/** RA hash bucket of a MAC address */
+#define WMM_RA_HASH(mac)                                                       \
+	(((mac)[3] ^ (mac)[4] ^ (mac)[5]) & (WMM_RA_HASH_SIZE - 1))
+
+/** TDLS peer with packets held while its link is set up */
+typedef struct _tdls_pending_peer tdls_pending_peer;
+struct _tdls_pending_peer {
+	/** Pointer to previous node */
+	tdls_pending_peer *pprev;
+	/** Pointer to next node */
+	tdls_pending_peer *pnext;
+	/** MAC address of the peer */
+	t_u8 mac[MLAN_MAC_ADDR_LENGTH];
+	/** Held packets of the peer for each TID */
+	mlan_list_head buf_head[MAX_NUM_TID];
+	/** Number of held packets for each TID */
+	t_u32 num_pkts[MAX_NUM_TID];
 };
 
 /** TID table */
 typedef struct _tidTbl {
 	/** RA list head */
 	mlan_list_head ra_list;
-	/** Current RA list */
-	raListTbl *ra_list_curr;
+	/** Ready RA lists in round robin order, head is served next */
+	mlan_list_head ready_list;
+	/** Lock protecting the queued packets and ready list of this TID */
+	t_void *ra_list_lock;
+	/** Number of times ra_list_lock was taken */
+	t_u32 lock_acquired;
+	/** Number of times ra_list_lock was found held by another context */
+	t_u32 lock_contended;
 } tid_tbl_t;
 
 /** Highest priority setting for a packet (uses voice AC) */
@@ -809,6 +884,22 @@ typedef struct _tidTbl {
 /** Max driver packet delay in msec */
 #define WMM_DRV_DELAY_MAX 510
 
+/** Airtime granted to a RA list per DRR round, in usec */
+#define WMM_AIRTIME_QUANTUM 4000
+/** Data rate assumed before a RA rate is known: 54 Mbps in 500 Kbps units */
+#define WMM_AIRTIME_DEF_RATE 108
+/** Seconds between TX rate queries while data is sent */
+#define WMM_TX_RATE_REFRESH 1
+
+/** Maximum number of packets sent from a RA list per dequeue */
+#define WMM_TX_BURST_MAX 64
+/** Maximum number of bytes sent from a RA list per dequeue */
+#define WMM_TX_BURST_BYTES (64 * 1024)
+/** CoDel target queueing delay in usec */
+#define WMM_CODEL_TARGET 5000
+/** CoDel interval in usec */
+#define WMM_CODEL_INTERVAL 100000
+
 /** Struct of WMM DESC */
 typedef struct _wmm_desc {
 	/** TID table */
@@ -819,8 +910,13 @@ typedef struct _wmm_desc {
 	t_u32 pkts_queued[MAX_NUM_TID];
 	/** Packets paused */
 	t_u32 pkts_paused[MAX_NUM_TID];
-	/** Spin lock to protect ra_list */
+	/** RA lists of each peer hashed by RA */
+	mlan_list_head ra_hash[WMM_RA_HASH_SIZE];
+	/** Spin lock to protect RA list membership and the tx BA stream table
+	 */
 	t_void *ra_list_spinlock;
+	/** Spin lock to protect tx_ready_map of the BSS and the WMM scalars */
+	t_void *ready_lock;
 
 	/** AC status */
 	WmmAcStatus_t ac_status[MAX_AC_QUEUES];
@@ -1234,8 +1330,10 @@ typedef struct _mlan_private {
 	t_u8 osen_ie_len;
 	/** Pointer to the station table */
 	mlan_list_head sta_list;
-	/** tdls pending queue */
-	mlan_list_head tdls_pending_txq;
+	/** TDLS peers with held packets, hashed with WMM_RA_HASH */
+	mlan_list_head tdls_pending_hash[WMM_RA_HASH_SIZE];
+	/** Lock of tdls_pending_hash, nests inside the TX queue locks */
+	t_void *tdls_pending_lock;
 	t_u16 tdls_idle_time;
 
 	/** MGMT IE */
@@ -1281,6 +1379,8 @@ typedef struct _mlan_private {
 	t_u16 rx_seq[MAX_NUM_TID];
 	/** Pointer to the Receive Reordering table*/
 	mlan_list_head rx_reorder_tbl_ptr;
+	/** Receive Reordering tables by TA, hashed with WMM_RA_HASH */
+	mlan_list_head rx_reorder_hash[WMM_RA_HASH_SIZE];
 	/** Lock for Rx packets */
 	t_void *rx_pkt_lock;
 
@@ -1355,6 +1455,18 @@ typedef struct _mlan_private {
 	t_u32 amsdu_tx_cnt;
 	/** tx msdu count in amsdu*/
 	t_u32 msdu_in_tx_amsdu_cnt;
+	/** TX frames in the last 802_11_GET_LOG response */
+	t_u32 tx_log_frames;
+	/** TX retries in the last 802_11_GET_LOG response */
+	t_u32 tx_log_retry;
+	/** TX failures in the last 802_11_GET_LOG response */
+	t_u32 tx_log_failed;
+	/** Smoothed TX retry ratio in 1/1000 */
+	t_u32 tx_retry_ratio;
+	/** Time in seconds the TX rate was last queried */
+	t_u32 tx_rate_query_sec;
+	/** Time in seconds the TX rate last set the RA list rates */
+	t_u32 tx_rate_update_sec;
 	/** channel load info for current channel */
 	t_u16 ch_load_param;
 	/** Noise floor value for current channel */
@@ -1390,9 +1502,13 @@ struct _TxBAStreamTbl {
 /** RX reorder table */
 typedef struct _RxReorderTbl RxReorderTbl;
 
-typedef struct {
-	/** Timer for flushing */
-	t_void *timer;
+typedef struct _reorder_tmr_cnxt_t {
+	/** Previous node in the flush wheel slot */
+	struct _reorder_tmr_cnxt_t *pprev;
+	/** Next node in the flush wheel slot */
+	struct _reorder_tmr_cnxt_t *pnext;
+	/** Flush wheel tick the timer expires at */
+	t_u32 expires;
 	/** Timer set flag */
 	t_u8 timer_is_set;
 	/** RxReorderTbl ptr */
@@ -1409,6 +1525,45 @@ typedef struct {
 #define DEF_FLUSH_TIME_AC_BE_BK 512
 /** minimal AMPDU flush time */
 #define MIN_FLUSH_TIME 100
+/** minimal adaptive RX reorder flush time in ms */
+#define MIN_ADAPTIVE_FLUSH_TIME 4
+
+/** RX reorder flush wheel level 0, one 1 ms tick per slot */
+#define RX_REORDER_WHEEL_L0_BITS 6
+#define RX_REORDER_WHEEL_L0_SIZE (1 << RX_REORDER_WHEEL_L0_BITS)
+/** RX reorder flush wheel level 1, one level 0 turn per slot */
+#define RX_REORDER_WHEEL_L1_BITS 6
+#define RX_REORDER_WHEEL_L1_SIZE (1 << RX_REORDER_WHEEL_L1_BITS)
+/** Longest timeout the RX reorder flush wheel can hold, in ticks */
+#define RX_REORDER_WHEEL_MAX                                                   \
+	((RX_REORDER_WHEEL_L1_SIZE - 1) * RX_REORDER_WHEEL_L0_SIZE)
+
+/** RX reorder flush wheel, shared by all RxReorderTbl of an adapter */
+typedef struct _rx_reorder_wheel {
+	/** Timer driving the wheel, armed for the nearest expiry */
+	t_void *timer;
+	/** Timer set flag */
+	t_u8 timer_is_set;
+	/** Lock protecting the wheel */
+	t_void *plock;
+	/** Current tick */
+	t_u32 now;
+	/** Tick the timer is armed for */
+	t_u32 next;
+	/** Monotonic time in ms the wheel was last advanced at */
+	t_u32 clock;
+	/** Number of armed entries */
+	t_u32 num_armed;
+	/** Level 0 slots */
+	mlan_list_head l0[RX_REORDER_WHEEL_L0_SIZE];
+	/** Level 1 slots */
+	mlan_list_head l1[RX_REORDER_WHEEL_L1_SIZE];
+	/** Hole wait histogram per TID, bucket n holds waits below 2^n ms */
+	t_u32 hole_hist[MAX_NUM_TID][RX_REORDER_HIST_NUM];
+	/** Holes released by the flush timeout per TID */
+	t_u32 hole_flush[MAX_NUM_TID];
+} rx_reorder_wheel;
+
 /** RX reorder table */
 struct _RxReorderTbl {
 	/** RxReorderTbl previous node */
@@ -1425,8 +1580,12 @@ struct _RxReorderTbl {
 	int last_seq;
 	/** Window size */
 	int win_size;
-	/** Pointer to pointer to RxReorderTbl */
+	/** Pointer to pointer to RxReorderTbl, a ring of win_size slots */
 	t_void **rx_reorder_ptr;
+	/** Ring slot holding start_win */
+	int start_idx;
+	/** Number of occupied slots */
+	int num_held;
 	/** Timer context */
 	reorder_tmr_cnxt_t timer_context;
 	/** BA stream status */
@@ -1440,8 +1599,31 @@ struct _RxReorderTbl {
 	t_u8 pkt_count;
 	/** flush data flag */
 	t_u8 flush_data;
-	/** BA window bitmap */
-	t_u64 bitmap;
+	/** Occupancy bitmap of the rx_reorder_ptr ring slots */
+	t_u32 *bitmap;
+	/** Flush wheel tick the pending hole opened at */
+	t_u32 hole_start;
+	/** Smoothed hole fill latency, ms << 3 */
+	t_s32 hole_srtt;
+	/** Hole fill latency mean deviation, ms << 2 */
+	t_s32 hole_mdev;
+	/** Current flush timeout in ms */
+	t_u32 flush_time;
+};
+
+/** RX reorder tables of one TA, hashed with WMM_RA_HASH */
+typedef struct _rx_reorder_peer rx_reorder_peer;
+struct _rx_reorder_peer {
+	/** Pointer to previous node */
+	rx_reorder_peer *pprev;
+	/** Pointer to next node */
+	rx_reorder_peer *pnext;
+	/** TA */
+	t_u8 ta[MLAN_MAC_ADDR_LENGTH];
+	/** Reorder table of each TID, MNULL if none */
+	RxReorderTbl *tbl[MAX_NUM_TID];
+	/** Number of reorder tables in tbl */
+	t_u8 num_tbl;
 };
 
 /** BSS priority node */
@@ -1581,6 +1763,8 @@ struct _sta_node {
 	t_u8 wapi_key_on;
 	/** tx pause status */
 	t_u8 tx_pause;
+	/** last rx data rate, in 500 Kbps units */
+	t_u16 airtime_rate;
 	/** station band mode */
 	t_u16 bandmode;
 	sta_stats stats;
@@ -1945,6 +2129,16 @@ typedef struct _mlan_init_para {
 	t_u32 antcfg;
 	/** dmcs*/
 	t_u8 dmcs;
+	/** airtime fair TX scheduling */
+	t_u8 airtime_fair;
+	/** Packets sent from a RA list per dequeue */
+	t_u8 tx_burst;
+	/** CoDel queue management of RA lists */
+	t_u8 tx_codel;
+	/** Scatter-gather AMSDU */
+	t_u8 amsdu_sg;
+	/** Adaptive AMSDU size */
+	t_u8 amsdu_adapt;
 } mlan_init_para, *pmlan_init_para;
 
 #ifdef SDIO
@@ -2219,6 +2413,10 @@ typedef struct _mlan_pcie_card {
 	mlan_buffer *tx_buf_list[MLAN_MAX_TXRX_BD];
 	/** Flush indicator for txbd_ring */
 	t_bool txbd_flush;
+	/** Defer TXBD write pointer updates while a TX burst is sent */
+	t_u8 txbd_wrptr_defer;
+	/** TXBD write pointer not yet written to the card */
+	t_u8 txbd_wrptr_dirty;
 	/** txrx data dma ring size */
 	t_u16 txrx_bd_size;
 	/** txrx num desc */
@@ -2355,6 +2553,18 @@ struct _mlan_adapter {
 	t_u8 priv_num;
 	/** Priority table for bss */
 	mlan_bssprio_tbl bssprio_tbl[MLAN_MAX_BSS_NUM];
+	/** Per BSS bitmap of TIDs with a non-empty ready list */
+	t_u8 tx_ready_map[MLAN_MAX_BSS_NUM];
+	/** Airtime fair (DRR) scheduling of the RA lists of a TID */
+	t_u8 airtime_fair;
+	/** Max packets sent from a RA list per dequeue, 0/1: no burst */
+	t_u8 tx_burst;
+	/** CoDel drop/ECN mark of RA list packets */
+	t_u8 tx_codel;
+	/** Build AMSDU from the queued packets without copying the payload */
+	t_u8 amsdu_sg;
+	/** Size AMSDU per RA list from TX rate and retry feedback */
+	t_u8 amsdu_adapt;
 	/** Callback table */
 	mlan_callbacks callbacks;
 	/** Init parameters */
@@ -2843,6 +3053,9 @@ struct _mlan_adapter {
 	mlan_mgmt_frame_wakeup mgmt_filter[MAX_MGMT_FRAME_FILTER];
 	/** Bypass TX queue pkt count  */
 	mlan_scalar bypass_pkt_count;
+	/** Per BSS bitmap of non-empty bypass TX queues,
+	 *  protected by the bypass_pkt_count lock */
+	t_u32 bypass_ready_map;
 #ifdef STA_SUPPORT
 	/** warm-reset IOCTL request buffer pointer */
 	pmlan_ioctl_req pwarm_reset_ioctl_req;
@@ -2911,6 +3124,8 @@ struct _mlan_adapter {
 	t_u16 flush_time_ac_be_bk;
 	/** AC VI/VO flush time */
 	t_u16 flush_time_ac_vi_vo;
+	/** RX reorder flush wheel */
+	rx_reorder_wheel reorder_wheel;
 	/** remain_on_channel flag */
 	t_u8 remain_on_channel;
 };
@@ -2931,6 +3146,8 @@ struct _mlan_adapter {
 #define MLAN_ETHER_PKT_TYPE_WAPI (0x88B4)
 /** Ethernet packet type for IP */
 #define MLAN_ETHER_PKT_TYPE_IP (0x0800)
+/** Ethernet packet type for IPv6 */
+#define MLAN_ETHER_PKT_TYPE_IPV6 (0x86DD)
 /** Ethernet packet type offset */
 #define MLAN_ETHER_PKT_TYPE_OFFSET (12)
 
@@ -2938,6 +3155,13 @@ struct _mlan_adapter {
 #define MLAN_IP_PROTOCOL_ICMP (0x01)
 /** IP packet Protocol number offset */
 #define MLAN_IP_PROTOCOL_OFFSET (11)
+/** IP packet Protocol number for TCP */
+#define MLAN_IP_PROTOCOL_TCP (0x06)
+
+/** TCP header flags */
+#define MLAN_TCP_FLAG_FIN MBIT(0)
+#define MLAN_TCP_FLAG_PSH MBIT(3)
+#define MLAN_TCP_FLAG_CWR MBIT(7)
 
 /** Rx packet Sniffer Operation Mode
  *
@@ -3125,6 +3349,10 @@ mlan_status wlan_handle_rx_packet(pmlan_adapter pmadapter, pmlan_buffer pmbuf);
 /** Process transmission */
 mlan_status wlan_process_tx(pmlan_private priv, pmlan_buffer pmbuf,
 			    mlan_tx_param *tx_param);
+/** Process transmission of a burst of packets */
+mlan_status wlan_process_tx_burst(pmlan_private priv, pmlan_list_head pburst,
+				  t_u32 next_pkt_len, t_u32 *psent_pkts,
+				  t_u32 *psent_bytes);
 /** Transmit a null data packet */
 mlan_status wlan_send_null_packet(pmlan_private priv, t_u8 flags);
 
@@ -3219,7 +3447,7 @@ mlan_status wlan_recv_packet_complete(pmlan_adapter pmadapter,
 t_void wlan_clean_txrx(pmlan_private priv);
 
 t_void wlan_add_buf_bypass_txqueue(mlan_adapter *pmadapter, pmlan_buffer pmbuf);
-t_void wlan_process_bypass_tx(mlan_adapter *pmadapter);
+mlan_status wlan_send_bypass_packet(mlan_adapter *pmadapter);
 t_void wlan_cleanup_bypass_txq(pmlan_private priv);
 t_u8 wlan_bypass_tx_list_empty(mlan_adapter *pmadapter);
 
@@ -4009,6 +4237,8 @@ t_void wlan_drop_tx_pkts(pmlan_private priv);
 #ifdef UAP_SUPPORT
 /* process the recevied packet and bridge the packet */
 mlan_status wlan_uap_recv_packet(mlan_private *priv, pmlan_buffer pmbuf);
+/* bridge a deaggregated AMSDU subframe */
+t_u8 wlan_uap_bridge_amsdu_pkt(mlan_private *priv, pmlan_buffer pmbuf);
 #endif /* UAP_SUPPORT */
 
 mlan_status wlan_misc_ioctl_custom_ie_list(pmlan_adapter pmadapter,
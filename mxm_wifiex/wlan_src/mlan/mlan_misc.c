@@ -443,6 +443,14 @@ mlan_status wlan_get_info_debug_info(pmlan_adapter pmadapter,
 			(t_u32)pmadapter->curr_tx_buf_size;
 		debug_info->rx_tbl_num =
 			wlan_get_rxreorder_tbl(pmpriv, debug_info->rx_tbl);
+		memcpy_ext(pmadapter, debug_info->rx_reorder_hist,
+			   pmadapter->reorder_wheel.hole_hist,
+			   sizeof(debug_info->rx_reorder_hist),
+			   sizeof(debug_info->rx_reorder_hist));
+		memcpy_ext(pmadapter, debug_info->rx_reorder_flush,
+			   pmadapter->reorder_wheel.hole_flush,
+			   sizeof(debug_info->rx_reorder_flush),
+			   sizeof(debug_info->rx_reorder_flush));
 		debug_info->tx_tbl_num =
 			wlan_get_txbastream_tbl(pmpriv, debug_info->tx_tbl);
 		debug_info->ralist_num =
@@ -643,6 +651,14 @@ mlan_status wlan_get_info_debug_info(pmlan_adapter pmadapter,
 			util_scalar_read(pmadapter->pmoal_handle,
 					 &pmpriv->wmm.tx_pkts_queued, MNULL,
 					 MNULL);
+		debug_info->ralist_lock_acquired = 0;
+		debug_info->ralist_lock_contended = 0;
+		for (i = 0; i < MAX_NUM_TID; i++) {
+			debug_info->ralist_lock_acquired +=
+				pmpriv->wmm.tid_tbl_ptr[i].lock_acquired;
+			debug_info->ralist_lock_contended +=
+				pmpriv->wmm.tid_tbl_ptr[i].lock_contended;
+		}
 #ifdef UAP_SUPPORT
 		debug_info->num_bridge_pkts =
 			util_scalar_read(pmadapter->pmoal_handle,
@@ -1111,6 +1111,8 @@ static mlan_status wlan_pcie_create_txbd_ring(mlan_adapter *pmadapter)
 	pmadapter->pcard_pcie->txbd_wrptr = 0;
 	pmadapter->pcard_pcie->txbd_pending = 0;
 	pmadapter->pcard_pcie->txbd_rdptr = 0;
+	pmadapter->pcard_pcie->txbd_wrptr_defer = MFALSE;
+	pmadapter->pcard_pcie->txbd_wrptr_dirty = MFALSE;
 
 	/* allocate shared memory for the BD ring and divide the same in to
 	   several descriptors */
@@ -1270,6 +1272,7 @@ static mlan_status wlan_pcie_delete_txbd_ring(mlan_adapter *pmadapter)
 	pmadapter->pcard_pcie->txbd_ring_size = 0;
 	pmadapter->pcard_pcie->txbd_wrptr = 0;
 	pmadapter->pcard_pcie->txbd_rdptr = 0;
+	pmadapter->pcard_pcie->txbd_wrptr_dirty = MFALSE;
 	pmadapter->pcard_pcie->txbd_ring_vbase = MNULL;
 	pmadapter->pcard_pcie->txbd_ring_pbase = 0;
 
@@ -1277,6 +1280,127 @@ static mlan_status wlan_pcie_delete_txbd_ring(mlan_adapter *pmadapter)
 	return MLAN_STATUS_SUCCESS;
 }
 
+/**
+ *  @brief This function allocates a DMA-mapped buffer for the RX ring
+ *
+ *  A buffer is taken from the moal page pool when available, the pool
+ *  keeps it mapped across recycles; otherwise a fresh mlan_buffer is
+ *  allocated and mapped here.
+ *
+ *  @param pmadapter  A pointer to mlan_adapter structure
+ *
+ *  @return 	      A pointer to mlan_buffer or MNULL
+ */
+static mlan_buffer *wlan_pcie_alloc_rx_buf(mlan_adapter *pmadapter)
+{
+	pmlan_callbacks pcb = &pmadapter->callbacks;
+	mlan_buffer *pmbuf = MNULL;
+
+	if (pcb->moal_alloc_rx_buffer &&
+	    pcb->moal_alloc_rx_buffer(pmadapter->pmoal_handle,
+				      MLAN_RX_DATA_BUF_SIZE,
+				      &pmbuf) == MLAN_STATUS_SUCCESS &&
+	    pmbuf)
+		return pmbuf;
+
+	pmbuf = wlan_alloc_mlan_buffer(pmadapter, MLAN_RX_DATA_BUF_SIZE,
+				       MLAN_RX_HEADER_LEN,
+				       MOAL_ALLOC_MLAN_BUFFER);
+	if (!pmbuf)
+		return MNULL;
+	if (MLAN_STATUS_FAILURE ==
+	    pcb->moal_map_memory(pmadapter->pmoal_handle,
+				 pmbuf->pbuf + pmbuf->data_offset,
+				 &pmbuf->buf_pa, MLAN_RX_DATA_BUF_SIZE,
+				 PCI_DMA_FROMDEVICE)) {
+		PRINTM(MERROR, "RX ring: moal_map_memory failed\n");
+		wlan_free_mlan_buffer(pmadapter, pmbuf);
+		return MNULL;
+	}
+	return pmbuf;
+}
+
+/**
+ *  @brief This function hands a completed RX ring buffer to the CPU
+ *
+ *  @param pmadapter  A pointer to mlan_adapter structure
+ *  @param pmbuf      A pointer to mlan_buffer detached from the RX ring
+ *
+ *  @return 	      MLAN_STATUS_SUCCESS or MLAN_STATUS_FAILURE
+ */
+static mlan_status wlan_pcie_unmap_rx_buf(mlan_adapter *pmadapter,
+					  mlan_buffer *pmbuf)
+{
+	pmlan_callbacks pcb = &pmadapter->callbacks;
+
+	/* Pool buffers stay mapped, only the device writes are synced */
+	if (pmbuf->flags & MLAN_BUF_FLAG_RX_POOL)
+		return pcb->moal_sync_rx_buffer(pmadapter->pmoal_handle, pmbuf,
+						MLAN_RX_DATA_BUF_SIZE, MFALSE);
+	return pcb->moal_unmap_memory(pmadapter->pmoal_handle,
+				      pmbuf->pbuf + pmbuf->data_offset,
+				      pmbuf->buf_pa, MLAN_RX_DATA_BUF_SIZE,
+				      PCI_DMA_FROMDEVICE);
+}
+
+/**
+ *  @brief This function gives a detached RX ring buffer back to the device
+ *
+ *  @param pmadapter  A pointer to mlan_adapter structure
+ *  @param pmbuf      A pointer to mlan_buffer detached from the RX ring
+ *
+ *  @return 	      MLAN_STATUS_SUCCESS or MLAN_STATUS_FAILURE
+ */
+static mlan_status wlan_pcie_remap_rx_buf(mlan_adapter *pmadapter,
+					  mlan_buffer *pmbuf)
+{
+	pmlan_callbacks pcb = &pmadapter->callbacks;
+
+	if (pmbuf->flags & MLAN_BUF_FLAG_RX_POOL)
+		return pcb->moal_sync_rx_buffer(pmadapter->pmoal_handle, pmbuf,
+						MLAN_RX_DATA_BUF_SIZE, MTRUE);
+	return pcb->moal_map_memory(pmadapter->pmoal_handle,
+				    pmbuf->pbuf + pmbuf->data_offset,
+				    &pmbuf->buf_pa, MLAN_RX_DATA_BUF_SIZE,
+				    PCI_DMA_FROMDEVICE);
+}
+
+/**
+ *  @brief This function clears the buffer address of an empty RX ring slot
+ *
+ *  Keeps the descriptor from pointing at a buffer that has been handed
+ *  up or freed when no replacement could be attached.
+ *
+ *  @param pmadapter  A pointer to mlan_adapter structure
+ *  @param rd_index   RX ring slot index
+ *
+ *  @return 	      N/A
+ */
+static void wlan_pcie_clear_rxbd_addr(mlan_adapter *pmadapter, t_u32 rd_index)
+{
+#if defined(PCIE8997) || defined(PCIE8897)
+	mlan_pcie_data_buf *prxbd_buf;
+#endif
+#if defined(PCIE9098) || defined(PCIE9097) || defined(PCIEIW624)
+	adma_dual_desc_buf *padma_bd_buf;
+#endif
+
+#if defined(PCIE8997) || defined(PCIE8897)
+	if (!pmadapter->pcard_pcie->reg->use_adma) {
+		prxbd_buf = (mlan_pcie_data_buf *)
+				    pmadapter->pcard_pcie->rxbd_ring[rd_index];
+		prxbd_buf->paddr = 0;
+	}
+#endif
+#if defined(PCIE9098) || defined(PCIE9097) || defined(PCIEIW624)
+	if (pmadapter->pcard_pcie->reg->use_adma) {
+		padma_bd_buf = (adma_dual_desc_buf *)pmadapter->pcard_pcie
+				       ->rxbd_ring[rd_index];
+		padma_bd_buf->paddr = 0;
+	}
+#endif
+}
+
 /**
  *  @brief This function creates buffer descriptor ring for RX
  *
@@ -1357,9 +1481,7 @@ static mlan_status wlan_pcie_create_rxbd_ring(mlan_adapter *pmadapter)
 
 	for (i = 0; i < pmadapter->pcard_pcie->txrx_bd_size; i++) {
 		/* Allocate buffer here so that firmware can DMA data on it */
-		pmbuf = wlan_alloc_mlan_buffer(pmadapter, MLAN_RX_DATA_BUF_SIZE,
-					       MLAN_RX_HEADER_LEN,
-					       MOAL_ALLOC_MLAN_BUFFER);
+		pmbuf = wlan_pcie_alloc_rx_buf(pmadapter);
 		if (!pmbuf) {
 			PRINTM(MERROR,
 			       "RX ring create : Unable to allocate mlan_buffer\n");
@@ -1370,18 +1492,6 @@ static mlan_status wlan_pcie_create_rxbd_ring(mlan_adapter *pmadapter)
 
 		pmadapter->pcard_pcie->rx_buf_list[i] = pmbuf;
 
-		if (MLAN_STATUS_FAILURE ==
-		    pcb->moal_map_memory(pmadapter->pmoal_handle,
-					 pmbuf->pbuf + pmbuf->data_offset,
-					 &pmbuf->buf_pa, MLAN_RX_DATA_BUF_SIZE,
-					 PCI_DMA_FROMDEVICE)) {
-			PRINTM(MERROR,
-			       "Rx ring create : moal_map_memory failed\n");
-			wlan_pcie_delete_rxbd_ring(pmadapter);
-			LEAVE();
-			return MLAN_STATUS_FAILURE;
-		}
-
 		PRINTM(MINFO,
 		       "RX ring: add new mlan_buffer base: %p, "
 		       "buf_base: %p, buf_pbase: %#x:%x, "
@@ -1444,7 +1554,6 @@ static mlan_status wlan_pcie_create_rxbd_ring(mlan_adapter *pmadapter)
 static mlan_status wlan_pcie_delete_rxbd_ring(mlan_adapter *pmadapter)
 {
 	t_u32 i;
-	pmlan_callbacks pcb = &pmadapter->callbacks;
 	mlan_buffer *pmbuf = MNULL;
 #if defined(PCIE8997) || defined(PCIE8897)
 	mlan_pcie_data_buf *prxbd_buf;
@@ -1457,11 +1566,9 @@ static mlan_status wlan_pcie_delete_rxbd_ring(mlan_adapter *pmadapter)
 	for (i = 0; i < pmadapter->pcard_pcie->txrx_bd_size; i++) {
 		if (pmadapter->pcard_pcie->rx_buf_list[i]) {
 			pmbuf = pmadapter->pcard_pcie->rx_buf_list[i];
-			pcb->moal_unmap_memory(pmadapter->pmoal_handle,
-					       pmbuf->pbuf + pmbuf->data_offset,
-					       pmbuf->buf_pa,
-					       MLAN_RX_DATA_BUF_SIZE,
-					       PCI_DMA_FROMDEVICE);
+			/* Pool buffers are unmapped by the pool on release */
+			if (!(pmbuf->flags & MLAN_BUF_FLAG_RX_POOL))
+				wlan_pcie_unmap_rx_buf(pmadapter, pmbuf);
 			wlan_free_mlan_buffer(
 				pmadapter,
 				pmadapter->pcard_pcie->rx_buf_list[i]);
@@ -2145,6 +2252,168 @@ static t_u8 wlan_check_txbd_not_full(mlan_adapter *pmadapter)
 
 #endif
 
+#if defined(PCIE9098) || defined(PCIE9097) || defined(PCIEIW624)
+/**
+ *  @brief This function sends a scatter-gather data packet to the card
+ *
+ *  The header buffer and each fragment get their own ADMA descriptor,
+ *  SOP is set on the first and EOP on the last one. Once attached, the
+ *  fragments complete from their own descriptors.
+ *
+ *  @param pmadapter A pointer to mlan_adapter structure
+ *  @param type      data or command
+ *  @param pmbuf     A pointer to the header buffer, with
+ *                   MLAN_BUF_FLAG_AMSDU_SG and use_count fragments
+ *
+ *  @return          MLAN_STATUS_PENDING, MLAN_STATUS_RESOURCE when the
+ *                   ring lacks free descriptors, or MLAN_STATUS_FAILURE
+ */
+static mlan_status wlan_pcie_send_data_sg(mlan_adapter *pmadapter, t_u8 type,
+					  mlan_buffer *pmbuf)
+{
+	const t_u32 num_tx_buffs = pmadapter->pcard_pcie->txrx_bd_size;
+	pmlan_callbacks pcb = &pmadapter->callbacks;
+	adma_dual_desc_buf *padma_bd_buf;
+	mlan_buffer *pbuf;
+	mlan_buffer *pbuf_next;
+	t_u32 nbufs = pmbuf->use_count + 1;
+	t_u32 total_len = 0;
+	t_u32 wrindx;
+	t_u32 i;
+	t_u16 *tmp;
+	t_u16 flags;
+	t_u16 pkt_size;
+	mlan_status status;
+
+	ENTER();
+
+	if (num_tx_buffs - pmadapter->pcard_pcie->txbd_pending < nbufs) {
+		/* Not an error: the caller requeues the subframes and retries
+		 * once TX completions have freed enough descriptors */
+		PRINTM(MINFO, "TX Ring full, can't send SG packet (%d)\n",
+		       nbufs);
+		pmadapter->data_sent = MTRUE;
+		LEAVE();
+		return MLAN_STATUS_RESOURCE;
+	}
+	for (i = 0, pbuf = pmbuf; i < nbufs; i++, pbuf = pbuf->pnext)
+		total_len += pbuf->data_len;
+	tmp = (t_u16 *)(pmbuf->pbuf + pmbuf->data_offset);
+	tmp[0] = wlan_cpu_to_le16((t_u16)total_len);
+	tmp[1] = wlan_cpu_to_le16(type);
+	pkt_size = ALIGN_SZ(total_len,
+			    pmadapter->pcard_pcie->reg->adma_align_size);
+	if (pkt_size < pmadapter->pcard_pcie->reg->adma_min_pkt_size)
+		pkt_size = pmadapter->pcard_pcie->reg->adma_min_pkt_size;
+
+	/* Map all buffers first, so a failure leaves the ring untouched */
+	for (i = 0, pbuf = pmbuf; i < nbufs; i++, pbuf = pbuf->pnext) {
+		if (MLAN_STATUS_FAILURE ==
+		    pcb->moal_map_memory(pmadapter->pmoal_handle,
+					 pbuf->pbuf + pbuf->data_offset,
+					 &pbuf->buf_pa, pbuf->data_len,
+					 PCI_DMA_TODEVICE)) {
+			PRINTM(MERROR,
+			       "SEND DATA SG: failed to moal_map_memory\n");
+			nbufs = i;
+			for (i = 0, pbuf = pmbuf; i < nbufs;
+			     i++, pbuf = pbuf->pnext)
+				pcb->moal_unmap_memory(
+					pmadapter->pmoal_handle,
+					pbuf->pbuf + pbuf->data_offset,
+					pbuf->buf_pa, pbuf->data_len,
+					PCI_DMA_TODEVICE);
+			LEAVE();
+			return MLAN_STATUS_FAILURE;
+		}
+	}
+	pmadapter->data_sent = MTRUE;
+	/* The fragments are completed from their own descriptors now */
+	pmbuf->flags &= ~MLAN_BUF_FLAG_AMSDU_SG;
+
+	pcb->moal_spin_lock(pmadapter->pmoal_handle,
+			    pmadapter->pmlan_pcie_lock);
+	for (i = 0, pbuf = pmbuf; i < nbufs; i++, pbuf = pbuf_next) {
+		pbuf_next = pbuf->pnext;
+		wrindx = pmadapter->pcard_pcie->txbd_wrptr & (num_tx_buffs - 1);
+		PRINTM(MDAT_D,
+		       "SEND DATA SG: Attach pmbuf %p at tx_ring[%d], txbd_wrptr=0x%x\n",
+		       pbuf, wrindx, pmadapter->pcard_pcie->txbd_wrptr);
+		pmadapter->pcard_pcie->tx_buf_list[wrindx] = pbuf;
+		padma_bd_buf = (adma_dual_desc_buf *)pmadapter->pcard_pcie
+				       ->txbd_ring[wrindx];
+		flags = wlan_get_adma_buf_flag(pmadapter, num_tx_buffs,
+					       wrindx) |
+			ADMA_BD_FLAG_SRC_HOST;
+		if (i == 0)
+			flags |= ADMA_BD_FLAG_SOP;
+		if (i == nbufs - 1)
+			flags |= ADMA_BD_FLAG_EOP;
+		padma_bd_buf->paddr = wlan_cpu_to_le64(pbuf->buf_pa);
+		padma_bd_buf->len = wlan_cpu_to_le16(
+			(i == nbufs - 1) ?
+				ALIGN_SZ(pbuf->data_len,
+					 pmadapter->pcard_pcie->reg
+						 ->adma_align_size) :
+				pbuf->data_len);
+		padma_bd_buf->flags = wlan_cpu_to_le16(flags);
+		padma_bd_buf->pkt_size = wlan_cpu_to_le16(pkt_size);
+		pmadapter->pcard_pcie->last_tx_pkt_size[wrindx] =
+			pbuf->data_len;
+		pmadapter->pcard_pcie->txbd_wrptr++;
+		pmadapter->pcard_pcie->txbd_wrptr &= ADMA_RW_PTR_WRAP_MASK;
+		pmadapter->pcard_pcie->txbd_pending++;
+	}
+	status = pcb->moal_write_reg(
+		pmadapter->pmoal_handle,
+		pmadapter->pcard_pcie->reg->reg_txbd_wrptr,
+		pmadapter->pcard_pcie->txbd_wrptr << ADMA_WPTR_START);
+	pmadapter->pcard_pcie->txbd_wrptr_dirty = MFALSE;
+	if (status) {
+		PRINTM(MERROR, "SEND DATA SG: failed to write REG_TXBD_WRPTR\n");
+		/* Take the descriptors back, the card has not seen them */
+		for (i = 0; i < nbufs; i++) {
+			pmadapter->pcard_pcie->txbd_wrptr--;
+			pmadapter->pcard_pcie->txbd_wrptr &=
+				ADMA_RW_PTR_WRAP_MASK;
+			wrindx = pmadapter->pcard_pcie->txbd_wrptr &
+				 (num_tx_buffs - 1);
+			pbuf = pmadapter->pcard_pcie->tx_buf_list[wrindx];
+			pmadapter->pcard_pcie->tx_buf_list[wrindx] = MNULL;
+			padma_bd_buf = (adma_dual_desc_buf *)pmadapter
+					       ->pcard_pcie->txbd_ring[wrindx];
+			padma_bd_buf->paddr = 0;
+			padma_bd_buf->len = 0;
+			padma_bd_buf->flags = 0;
+			padma_bd_buf->pkt_size = 0;
+			padma_bd_buf->reserved = 0;
+			pmadapter->pcard_pcie->txbd_pending--;
+			pcb->moal_unmap_memory(pmadapter->pmoal_handle,
+					       pbuf->pbuf + pbuf->data_offset,
+					       pbuf->buf_pa, pbuf->data_len,
+					       PCI_DMA_TODEVICE);
+		}
+		pmbuf->flags |= MLAN_BUF_FLAG_AMSDU_SG;
+	}
+	pcb->moal_spin_unlock(pmadapter->pmoal_handle,
+			      pmadapter->pmlan_pcie_lock);
+	if (status) {
+		LEAVE();
+		return MLAN_STATUS_FAILURE;
+	}
+
+	if (wlan_check_txbd_not_full(pmadapter))
+		pmadapter->data_sent = MFALSE;
+	else
+		wlan_pcie_process_tx_complete(pmadapter);
+	if (pmadapter->data_sent)
+		pmadapter->data_sent_cnt++;
+
+	LEAVE();
+	return MLAN_STATUS_PENDING;
+}
+#endif
+
 /**
  *  @brief This function downloads data to the card.
  *
@@ -2198,6 +2467,13 @@ static mlan_status wlan_pcie_send_data(mlan_adapter *pmadapter, t_u8 type,
 		ret = MLAN_STATUS_FAILURE;
 		goto done;
 	}
+#if defined(PCIE9098) || defined(PCIE9097) || defined(PCIEIW624)
+	if ((pmbuf->flags & MLAN_BUF_FLAG_AMSDU_SG) &&
+	    pmadapter->pcard_pcie->reg->use_adma) {
+		ret = wlan_pcie_send_data_sg(pmadapter, type, pmbuf);
+		goto done;
+	}
+#endif
 
 	PRINTM(MINFO, "SEND DATA: <Rd: %#x, Wr: %#x>\n",
 	       pmadapter->pcard_pcie->txbd_rdptr,
@@ -2289,14 +2565,27 @@ static mlan_status wlan_pcie_send_data(mlan_adapter *pmadapter, t_u8 type,
 		}
 #endif
 		pmadapter->pcard_pcie->txbd_pending++;
-		PRINTM(MINFO, "REG_TXBD_WRPT(0x%x) = 0x%x\n", reg_txbd_wrptr,
-		       ((pmadapter->pcard_pcie->txbd_wrptr << wr_ptr_start) |
-			rxbd_val));
-		/* Write the TX ring write pointer in to REG_TXBD_WRPTR */
-		status = pcb->moal_write_reg(
-			pmadapter->pmoal_handle, reg_txbd_wrptr,
-			(pmadapter->pcard_pcie->txbd_wrptr << wr_ptr_start) |
-				rxbd_val);
+		if (pmadapter->pcard_pcie->txbd_wrptr_defer &&
+		    wlan_check_txbd_not_full(pmadapter)) {
+			/* More packets of a TX burst follow, the write
+			 * pointer is updated once for all of them */
+			pmadapter->pcard_pcie->txbd_wrptr_dirty = MTRUE;
+			status = MLAN_STATUS_SUCCESS;
+		} else {
+			PRINTM(MINFO, "REG_TXBD_WRPT(0x%x) = 0x%x\n",
+			       reg_txbd_wrptr,
+			       ((pmadapter->pcard_pcie->txbd_wrptr
+				 << wr_ptr_start) |
+				rxbd_val));
+			/* Write the TX ring write pointer in to
+			 * REG_TXBD_WRPTR */
+			status = pcb->moal_write_reg(
+				pmadapter->pmoal_handle, reg_txbd_wrptr,
+				(pmadapter->pcard_pcie->txbd_wrptr
+				 << wr_ptr_start) |
+					rxbd_val);
+			pmadapter->pcard_pcie->txbd_wrptr_dirty = MFALSE;
+		}
 
 		pcb->moal_spin_unlock(pmadapter->pmoal_handle,
 				      pmadapter->pmlan_pcie_lock);
@@ -2383,6 +2672,55 @@ done:
 	return ret;
 }
 
+/**
+ *  @brief This function starts or ends a TX burst
+ *
+ *  While a burst is sent the TXBD write pointer is only written to the
+ *  card when the ring fills up; ending the burst writes any pending
+ *  update, so the card is notified once per burst.
+ *
+ *  @param pmadapter A pointer to mlan_adapter structure
+ *  @param enable    MTRUE to start a burst, MFALSE to end it
+ *
+ *  @return          N/A
+ */
+t_void wlan_pcie_set_tx_burst(mlan_adapter *pmadapter, t_u8 enable)
+{
+	pmlan_callbacks pcb = &pmadapter->callbacks;
+	t_u32 wr_ptr_start = 0;
+	t_u32 rxbd_val = 0;
+
+	ENTER();
+	pmadapter->pcard_pcie->txbd_wrptr_defer = enable;
+	if (enable || !pmadapter->pcard_pcie->txbd_wrptr_dirty) {
+		LEAVE();
+		return;
+	}
+#if defined(PCIE8997) || defined(PCIE8897)
+	if (!pmadapter->pcard_pcie->reg->use_adma) {
+		wr_ptr_start = TXBD_RW_PTR_START;
+		rxbd_val = pmadapter->pcard_pcie->rxbd_wrptr &
+			   pmadapter->pcard_pcie->reg->txrx_rw_ptr_wrap_mask;
+	}
+#endif
+#if defined(PCIE9098) || defined(PCIE9097) || defined(PCIEIW624)
+	if (pmadapter->pcard_pcie->reg->use_adma)
+		wr_ptr_start = ADMA_WPTR_START;
+#endif
+	pcb->moal_spin_lock(pmadapter->pmoal_handle,
+			    pmadapter->pmlan_pcie_lock);
+	if (pcb->moal_write_reg(pmadapter->pmoal_handle,
+				pmadapter->pcard_pcie->reg->reg_txbd_wrptr,
+				(pmadapter->pcard_pcie->txbd_wrptr
+				 << wr_ptr_start) |
+					rxbd_val))
+		PRINTM(MERROR, "TX burst: failed to write REG_TXBD_WRPTR\n");
+	pmadapter->pcard_pcie->txbd_wrptr_dirty = MFALSE;
+	pcb->moal_spin_unlock(pmadapter->pmoal_handle,
+			      pmadapter->pmlan_pcie_lock);
+	LEAVE();
+}
+
 /**
  *  @brief This function check the rx pending buffer
  *
@@ -2532,10 +2870,7 @@ static mlan_status wlan_pcie_process_recv_data(mlan_adapter *pmadapter)
 		}
 		pmbuf = pmadapter->pcard_pcie->rx_buf_list[rd_index];
 		if (MLAN_STATUS_FAILURE ==
-		    pcb->moal_unmap_memory(pmadapter->pmoal_handle,
-					   pmbuf->pbuf + pmbuf->data_offset,
-					   pmbuf->buf_pa, MLAN_RX_DATA_BUF_SIZE,
-					   PCI_DMA_FROMDEVICE)) {
+		    wlan_pcie_unmap_rx_buf(pmadapter, pmbuf)) {
 			PRINTM(MERROR,
 			       "RECV DATA: moal_unmap_memory failed.\n");
 			ret = MLAN_STATUS_FAILURE;
@@ -2601,14 +2936,12 @@ static mlan_status wlan_pcie_process_recv_data(mlan_adapter *pmadapter)
 
 				pmadapter->data_received = MTRUE;
 			}
-			/* Create new buffer and attach it to Rx Ring */
-			pmbuf = wlan_alloc_mlan_buffer(pmadapter,
-						       MLAN_RX_DATA_BUF_SIZE,
-						       MLAN_RX_HEADER_LEN,
-						       MOAL_ALLOC_MLAN_BUFFER);
+			/* Attach a new mapped buffer to Rx Ring */
+			pmbuf = wlan_pcie_alloc_rx_buf(pmadapter);
 			if (!pmbuf) {
 				PRINTM(MERROR,
 				       "RECV DATA: Unable to allocate mlan_buffer\n");
+				wlan_pcie_clear_rxbd_addr(pmadapter, rd_index);
 				ret = MLAN_STATUS_FAILURE;
 				goto done;
 			}
@@ -2616,16 +2949,15 @@ static mlan_status wlan_pcie_process_recv_data(mlan_adapter *pmadapter)
 			/* Queue the mlan_buffer again */
 			PRINTM(MERROR, "PCIE: Drop invalid packet, length=%d",
 			       rx_len);
-		}
-
-		if (MLAN_STATUS_FAILURE ==
-		    pcb->moal_map_memory(pmadapter->pmoal_handle,
-					 pmbuf->pbuf + pmbuf->data_offset,
-					 &pmbuf->buf_pa, MLAN_RX_DATA_BUF_SIZE,
-					 PCI_DMA_FROMDEVICE)) {
-			PRINTM(MERROR, "RECV DATA: moal_map_memory failed\n");
-			ret = MLAN_STATUS_FAILURE;
-			goto done;
+			if (MLAN_STATUS_FAILURE ==
+			    wlan_pcie_remap_rx_buf(pmadapter, pmbuf)) {
+				PRINTM(MERROR,
+				       "RECV DATA: moal_map_memory failed\n");
+				wlan_free_mlan_buffer(pmadapter, pmbuf);
+				wlan_pcie_clear_rxbd_addr(pmadapter, rd_index);
+				ret = MLAN_STATUS_FAILURE;
+				goto done;
+			}
 		}
 
 		PRINTM(MDAT_D,
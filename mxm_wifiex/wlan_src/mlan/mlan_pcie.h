@@ -499,6 +499,8 @@ mlan_status wlan_alloc_pcie_ring_buf(pmlan_adapter pmadapter);
 mlan_status wlan_free_pcie_ring_buf(pmlan_adapter pmadapter);
 /** Ring buffer cleanup function, e.g. on deauth */
 mlan_status wlan_clean_pcie_ring_buf(pmlan_adapter pmadapter);
+/** Start or end a TX burst */
+t_void wlan_pcie_set_tx_burst(mlan_adapter *pmadapter, t_u8 enable);
 mlan_status wlan_alloc_ssu_pcie_buf(pmlan_adapter pmadapter);
 mlan_status wlan_free_ssu_pcie_buf(pmlan_adapter pmadapter);
 
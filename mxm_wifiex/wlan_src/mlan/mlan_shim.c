@@ -314,6 +314,7 @@ mlan_status mlan_register(pmlan_device pmdevice, t_void **ppmlan_adapter)
 	MASSERT(pcb->moal_free_lock);
 	MASSERT(pcb->moal_spin_lock);
 	MASSERT(pcb->moal_spin_unlock);
+	MASSERT(pcb->moal_spin_trylock);
 	MASSERT(pcb->moal_hist_data_add);
 	MASSERT(pcb->moal_updata_peer_signal);
 	MASSERT(pcb->moal_do_div);
@@ -328,6 +329,11 @@ mlan_status mlan_register(pmlan_device pmdevice, t_void **ppmlan_adapter)
 	pmadapter->init_para.mcs32 = pmdevice->mcs32;
 	pmadapter->init_para.antcfg = pmdevice->antcfg;
 	pmadapter->init_para.dmcs = pmdevice->dmcs;
+	pmadapter->init_para.airtime_fair = pmdevice->airtime_fair;
+	pmadapter->init_para.tx_burst = pmdevice->tx_burst;
+	pmadapter->init_para.tx_codel = pmdevice->tx_codel;
+	pmadapter->init_para.amsdu_sg = pmdevice->amsdu_sg;
+	pmadapter->init_para.amsdu_adapt = pmdevice->amsdu_adapt;
 
 #ifdef SDIO
 	if (IS_SD(pmadapter->card_type)) {
@@ -1111,15 +1117,19 @@ rx_process_start:
 		if (limit && rx_num >= limit)
 			break;
 	}
-	if (rx_pkts)
-		*rx_pkts = rx_num;
 	pcb->moal_spin_lock(pmadapter->pmoal_handle, pmadapter->prx_proc_lock);
 	if (pmadapter->more_rx_task_flag) {
 		pmadapter->more_rx_task_flag = MFALSE;
-		pcb->moal_spin_unlock(pmadapter->pmoal_handle,
-				      pmadapter->prx_proc_lock);
-		goto rx_process_start;
+		/* A caller with a budget (NAPI) polls again when the
+		 * budget is used up */
+		if (!limit || rx_num < limit) {
+			pcb->moal_spin_unlock(pmadapter->pmoal_handle,
+					      pmadapter->prx_proc_lock);
+			goto rx_process_start;
+		}
 	}
+	if (rx_pkts)
+		*rx_pkts = rx_num;
 	pmadapter->mlan_rx_processing = MFALSE;
 	pcb->moal_spin_unlock(pmadapter->pmoal_handle,
 			      pmadapter->prx_proc_lock);
@@ -1346,24 +1356,12 @@ process_start:
 			}
 		}
 
+		/* Bypass packets are scheduled by wlan_wmm_process_tx */
 		if (!pmadapter->data_sent &&
 		    !wlan_11h_radar_detected_tx_blocked(pmadapter) &&
 		    !wlan_is_tdls_link_chan_switching(pmadapter->tdls_status) &&
-		    !wlan_bypass_tx_list_empty(pmadapter)) {
-			PRINTM(MINFO, "mlan_send_pkt(): deq(bybass_txq)\n");
-			wlan_process_bypass_tx(pmadapter);
-			if (pmadapter->hs_activated == MTRUE) {
-				pmadapter->is_hs_configured = MFALSE;
-				wlan_host_sleep_activated_event(
-					wlan_get_priv(pmadapter,
-						      MLAN_BSS_ROLE_ANY),
-					MFALSE);
-			}
-		}
-
-		if (!pmadapter->data_sent && !wlan_wmm_lists_empty(pmadapter) &&
-		    !wlan_11h_radar_detected_tx_blocked(pmadapter) &&
-		    !wlan_is_tdls_link_chan_switching(pmadapter->tdls_status)) {
+		    (!wlan_bypass_tx_list_empty(pmadapter) ||
+		     !wlan_wmm_lists_empty(pmadapter))) {
 			wlan_wmm_process_tx(pmadapter);
 			if (pmadapter->hs_activated == MTRUE) {
 				pmadapter->is_hs_configured = MFALSE;
@@ -1834,6 +1832,11 @@ void mlan_process_deaggr_pkt(t_void *padapter, pmlan_buffer pmbuf, t_u8 *drop)
 	default:
 		break;
 	}
+#ifdef UAP_SUPPORT
+	if (!*drop && GET_BSS_ROLE(pmpriv) == MLAN_BSS_ROLE_UAP &&
+	    !wlan_uap_bridge_amsdu_pkt(pmpriv, pmbuf))
+		*drop = MTRUE;
+#endif
 	return;
 }
 
@@ -34,6 +34,9 @@ Change Log:
 #include "mlan_fw.h"
 #include "mlan_main.h"
 #include "mlan_wmm.h"
+#ifdef PCIE
+#include "mlan_pcie.h"
+#endif /* PCIE */
 
 /********************************************************
 			Local Variables
@@ -268,6 +271,71 @@ done:
 	return ret;
 }
 
+/**
+ *  @brief This function sends a burst of packets to the card
+ *
+ *  The packets are sent in list order until the list is empty, the card
+ *  is busy or a packet is refused. A refused packet is put back at the
+ *  head of the list, so on return the list holds the packets to requeue.
+ *  On PCIe the TXBD write pointer is written once for the whole burst.
+ *
+ *  @param priv         A pointer to mlan_private structure
+ *  @param pburst       A pointer to the unlocked list of packets
+ *  @param next_pkt_len Length of the packet queued after the burst
+ *  @param psent_pkts   Returns the number of packets sent
+ *  @param psent_bytes  Returns the data length of the packets sent
+ *
+ *  @return             MLAN_STATUS_RESOURCE if a packet was refused,
+ *                      otherwise the status of the last packet
+ */
+mlan_status wlan_process_tx_burst(pmlan_private priv, pmlan_list_head pburst,
+				  t_u32 next_pkt_len, t_u32 *psent_pkts,
+				  t_u32 *psent_bytes)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+	mlan_status ret = MLAN_STATUS_SUCCESS;
+	pmlan_buffer pmbuf;
+	pmlan_buffer pmbuf_next;
+	mlan_tx_param tx_param;
+	t_u32 tx_len;
+
+	ENTER();
+	*psent_pkts = 0;
+	*psent_bytes = 0;
+#ifdef PCIE
+	if (IS_PCIE(pmadapter->card_type))
+		wlan_pcie_set_tx_burst(pmadapter, MTRUE);
+#endif
+	while ((pmbuf = (pmlan_buffer)util_dequeue_list(
+			pmadapter->pmoal_handle, pburst, MNULL, MNULL))) {
+		pmbuf_next = (pmlan_buffer)util_peek_list(
+			pmadapter->pmoal_handle, pburst, MNULL, MNULL);
+		tx_param.next_pkt_len =
+			pmbuf_next ? pmbuf_next->data_len + sizeof(TxPD) :
+				     next_pkt_len;
+		tx_len = pmbuf->data_len;
+		ret = wlan_process_tx(priv, pmbuf, &tx_param);
+		if (ret == MLAN_STATUS_RESOURCE) {
+			PRINTM(MDAT_D, "Queuing pkt back to burst %p\n", pmbuf);
+			pmbuf->flags |= MLAN_BUF_FLAG_REQUEUED_PKT;
+			util_enqueue_list_head(pmadapter->pmoal_handle, pburst,
+					       (pmlan_linked_list)pmbuf, MNULL,
+					       MNULL);
+			break;
+		}
+		(*psent_pkts)++;
+		*psent_bytes += tx_len;
+		if (pmadapter->data_sent || pmadapter->tx_lock_flag)
+			break;
+	}
+#ifdef PCIE
+	if (IS_PCIE(pmadapter->card_type))
+		wlan_pcie_set_tx_burst(pmadapter, MFALSE);
+#endif
+	LEAVE();
+	return ret;
+}
+
 /**
  *  @brief Packet send completion handling
  *
@@ -296,6 +364,26 @@ mlan_status wlan_write_data_complete(pmlan_adapter pmadapter,
 	if ((pmbuf->buf_type == MLAN_BUF_TYPE_DATA) ||
 	    (pmbuf->buf_type == MLAN_BUF_TYPE_RAW_DATA)) {
 		PRINTM(MINFO, "wlan_write_data_complete: DATA %p\n", pmbuf);
+		if (pmbuf->flags & MLAN_BUF_FLAG_AMSDU_SG) {
+			/* Fragments still attached were not given to the bus */
+			pmlan_buffer pmbuf_frag = pmbuf->pnext;
+			pmlan_buffer pmbuf_next;
+			t_u32 i;
+			for (i = 0; i < pmbuf->use_count && pmbuf_frag; i++) {
+				pmbuf_next = pmbuf_frag->pnext;
+				if (pmbuf_frag->flags &
+				    MLAN_BUF_FLAG_MOAL_TX_BUF)
+					pcb->moal_send_packet_complete(
+						pmadapter->pmoal_handle,
+						pmbuf_frag, status);
+				else
+					wlan_free_mlan_buffer(pmadapter,
+							      pmbuf_frag);
+				pmbuf_frag = pmbuf_next;
+			}
+			pmbuf->use_count = 0;
+			pmbuf->flags &= ~MLAN_BUF_FLAG_AMSDU_SG;
+		}
 #if defined(USB)
 		if ((pmbuf->flags & MLAN_BUF_FLAG_USB_TX_AGGR) &&
 		    pmbuf->use_count) {
@@ -365,6 +453,36 @@ mlan_status wlan_recv_packet_complete(pmlan_adapter pmadapter,
 	return ret;
 }
 
+/**
+ *  @brief Account a packet added to or removed from a By-pass TX queue
+ *
+ *  The caller must hold priv->bypass_txq.plock. bypass_ready_map keeps
+ *  one bit per BSS with a non-empty By-pass queue so that the scheduler
+ *  can tell in O(1) whether any control frame is waiting.
+ *
+ *  @param pmadapter  Pointer to the mlan_adapter driver data struct
+ *  @param priv       Pointer to the mlan_private driver data struct
+ *  @param delta      Change of the queued packet count
+ *
+ *  @return         N/A
+ */
+static t_void wlan_bypass_update_ready(mlan_adapter *pmadapter,
+				       pmlan_private priv, t_s32 delta)
+{
+	pmlan_callbacks pcb = &pmadapter->callbacks;
+
+	pcb->moal_spin_lock(pmadapter->pmoal_handle,
+			    pmadapter->bypass_pkt_count.plock);
+	pmadapter->bypass_pkt_count.value += delta;
+	if (util_peek_list(pmadapter->pmoal_handle, &priv->bypass_txq, MNULL,
+			   MNULL))
+		pmadapter->bypass_ready_map |= MBIT(priv->bss_index);
+	else
+		pmadapter->bypass_ready_map &= ~MBIT(priv->bss_index);
+	pcb->moal_spin_unlock(pmadapter->pmoal_handle,
+			      pmadapter->bypass_pkt_count.plock);
+}
+
 /**
  *  @brief Add packet to Bypass TX queue
  *
@@ -376,18 +494,16 @@ mlan_status wlan_recv_packet_complete(pmlan_adapter pmadapter,
 t_void wlan_add_buf_bypass_txqueue(mlan_adapter *pmadapter, pmlan_buffer pmbuf)
 {
 	pmlan_private priv = pmadapter->priv[pmbuf->bss_index];
+	pmlan_callbacks pcb = &pmadapter->callbacks;
 	ENTER();
 
 	if (pmbuf->buf_type != MLAN_BUF_TYPE_RAW_DATA)
 		pmbuf->buf_type = MLAN_BUF_TYPE_DATA;
-	util_scalar_increment(pmadapter->pmoal_handle,
-			      &pmadapter->bypass_pkt_count,
-			      pmadapter->callbacks.moal_spin_lock,
-			      pmadapter->callbacks.moal_spin_unlock);
+	pcb->moal_spin_lock(pmadapter->pmoal_handle, priv->bypass_txq.plock);
 	util_enqueue_list_tail(pmadapter->pmoal_handle, &priv->bypass_txq,
-			       (pmlan_linked_list)pmbuf,
-			       pmadapter->callbacks.moal_spin_lock,
-			       pmadapter->callbacks.moal_spin_unlock);
+			       (pmlan_linked_list)pmbuf, MNULL, MNULL);
+	wlan_bypass_update_ready(pmadapter, priv, 1);
+	pcb->moal_spin_unlock(pmadapter->pmoal_handle, priv->bypass_txq.plock);
 	LEAVE();
 }
 
@@ -400,34 +516,22 @@ t_void wlan_add_buf_bypass_txqueue(mlan_adapter *pmadapter, pmlan_buffer pmbuf)
  */
 INLINE t_u8 wlan_bypass_tx_list_empty(mlan_adapter *pmadapter)
 {
-	t_u32 bypass_pkt_count;
+	t_u32 map = pmadapter->bypass_ready_map;
 #if defined(USB)
-	if (IS_USB(pmadapter->card_type)) {
-		pmlan_callbacks pcb = &pmadapter->callbacks;
-		pmlan_private priv;
-		int j = 0;
-		for (j = 0; j < pmadapter->priv_num; ++j) {
-			priv = pmadapter->priv[j];
-			if (priv) {
-				if (!wlan_is_port_ready(pmadapter,
-							priv->port_index))
-					continue;
-				if (util_peek_list(pmadapter->pmoal_handle,
-						   &priv->bypass_txq,
-						   pcb->moal_spin_lock,
-						   pcb->moal_spin_unlock))
-					return MFALSE;
-			}
+	int j;
+
+	/* Only BSSes with queued bypass packets are looked at */
+	if (map && IS_USB(pmadapter->card_type)) {
+		for (j = 0; map; ++j, map >>= 1) {
+			if ((map & 1) && pmadapter->priv[j] &&
+			    wlan_is_port_ready(pmadapter,
+					       pmadapter->priv[j]->port_index))
+				return MFALSE;
 		}
 		return MTRUE;
 	}
 #endif
-	bypass_pkt_count =
-		util_scalar_read(pmadapter->pmoal_handle,
-				 &pmadapter->bypass_pkt_count,
-				 pmadapter->callbacks.moal_spin_lock,
-				 pmadapter->callbacks.moal_spin_unlock);
-	return (bypass_pkt_count) ? MFALSE : MTRUE;
+	return map ? MFALSE : MTRUE;
 }
 
 /**
@@ -450,10 +554,7 @@ t_void wlan_cleanup_bypass_txq(mlan_private *priv)
 		util_unlink_list(pmadapter->pmoal_handle, &priv->bypass_txq,
 				 (pmlan_linked_list)pmbuf, MNULL, MNULL);
 		wlan_write_data_complete(pmadapter, pmbuf, MLAN_STATUS_FAILURE);
-		util_scalar_decrement(pmadapter->pmoal_handle,
-				      &pmadapter->bypass_pkt_count,
-				      pmadapter->callbacks.moal_spin_lock,
-				      pmadapter->callbacks.moal_spin_unlock);
+		wlan_bypass_update_ready(pmadapter, priv, -1);
 	}
 	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
 					      priv->bypass_txq.plock);
@@ -461,85 +562,78 @@ t_void wlan_cleanup_bypass_txq(mlan_private *priv)
 }
 
 /**
- *  @brief Transmit the By-passed packet awaiting in by-pass queue
+ *  @brief Transmit one packet awaiting in a by-pass queue
+ *
+ *  The By-pass queues form a strict priority class ahead of the WMM
+ *  queues; wlan_wmm_process_tx calls this before every WMM dequeue.
+ *  BSSes are served in bss_index order.
  *
  *  @param pmadapter Pointer to the mlan_adapter driver data struct
  *
- *  @return        N/A
+ *  @return        MLAN_STATUS_SUCCESS if a packet was sent,
+ *                 MLAN_STATUS_RESOURCE if it was queued again,
+ *                 otherwise MLAN_STATUS_FAILURE
  */
-t_void wlan_process_bypass_tx(pmlan_adapter pmadapter)
+mlan_status wlan_send_bypass_packet(pmlan_adapter pmadapter)
 {
-	pmlan_buffer pmbuf;
+	pmlan_callbacks pcb = &pmadapter->callbacks;
+	pmlan_buffer pmbuf = MNULL;
 	mlan_tx_param tx_param;
-	mlan_status status = MLAN_STATUS_SUCCESS;
-	pmlan_private priv;
-	int j = 0;
+	mlan_status status;
+	pmlan_private priv = MNULL;
+	t_u32 map = pmadapter->bypass_ready_map;
+	int j;
 	ENTER();
-	do {
-		for (j = 0; j < pmadapter->priv_num; ++j) {
-			priv = pmadapter->priv[j];
-			if (priv) {
+
+	for (j = 0; map; ++j, map >>= 1) {
+		if (!(map & 1))
+			continue;
+		priv = pmadapter->priv[j];
+		if (!priv)
+			continue;
 #if defined(USB)
-				if (!wlan_is_port_ready(pmadapter,
-							priv->port_index))
-					continue;
+		if (!wlan_is_port_ready(pmadapter, priv->port_index))
+			continue;
 #endif
-				pmbuf = (pmlan_buffer)util_dequeue_list(
-					pmadapter->pmoal_handle,
-					&priv->bypass_txq,
-					pmadapter->callbacks.moal_spin_lock,
-					pmadapter->callbacks.moal_spin_unlock);
-				if (pmbuf) {
-					util_scalar_decrement(
-						pmadapter->pmoal_handle,
-						&pmadapter->bypass_pkt_count,
-						pmadapter->callbacks
-							.moal_spin_lock,
-						pmadapter->callbacks
-							.moal_spin_unlock);
-					PRINTM(MINFO,
-					       "Dequeuing bypassed packet %p\n",
-					       pmbuf);
-					if (wlan_bypass_tx_list_empty(
-						    pmadapter))
-						tx_param.next_pkt_len = 0;
-					else
-						tx_param.next_pkt_len =
-							pmbuf->data_len;
-					status = wlan_process_tx(
-						pmadapter->priv[pmbuf->bss_index],
-						pmbuf, &tx_param);
-
-					if (status == MLAN_STATUS_RESOURCE) {
-						/* Queue the packet again so
-						 * that it will be TX'ed later
-						 */
-						util_scalar_increment(
-							pmadapter->pmoal_handle,
-							&pmadapter->bypass_pkt_count,
-							pmadapter->callbacks
-								.moal_spin_lock,
-							pmadapter->callbacks
-								.moal_spin_unlock);
-
-						util_enqueue_list_head(
-							pmadapter->pmoal_handle,
+		pcb->moal_spin_lock(pmadapter->pmoal_handle,
+				    priv->bypass_txq.plock);
+		pmbuf = (pmlan_buffer)util_dequeue_list(pmadapter->pmoal_handle,
 							&priv->bypass_txq,
-							(pmlan_linked_list)pmbuf,
-							pmadapter->callbacks
-								.moal_spin_lock,
-							pmadapter->callbacks
-								.moal_spin_unlock);
-					}
-					break;
-				} else {
-					PRINTM(MINFO, "Nothing to send\n");
-				}
-			}
-		}
-	} while (!pmadapter->data_sent && !pmadapter->tx_lock_flag &&
-		 !wlan_bypass_tx_list_empty(pmadapter));
+							MNULL, MNULL);
+		if (pmbuf)
+			wlan_bypass_update_ready(pmadapter, priv, -1);
+		pcb->moal_spin_unlock(pmadapter->pmoal_handle,
+				      priv->bypass_txq.plock);
+		if (pmbuf)
+			break;
+	}
+	if (!pmbuf) {
+		PRINTM(MINFO, "Nothing to send\n");
+		LEAVE();
+		return MLAN_STATUS_FAILURE;
+	}
+
+	PRINTM(MINFO, "Dequeuing bypassed packet %p\n", pmbuf);
+	if (wlan_bypass_tx_list_empty(pmadapter))
+		tx_param.next_pkt_len = 0;
+	else
+		tx_param.next_pkt_len = pmbuf->data_len;
+	status = wlan_process_tx(priv, pmbuf, &tx_param);
+	if (status == MLAN_STATUS_RESOURCE) {
+		/* Queue the packet again so that it will be TX'ed later */
+		pcb->moal_spin_lock(pmadapter->pmoal_handle,
+				    priv->bypass_txq.plock);
+		util_enqueue_list_head(pmadapter->pmoal_handle,
+				       &priv->bypass_txq,
+				       (pmlan_linked_list)pmbuf, MNULL, MNULL);
+		wlan_bypass_update_ready(pmadapter, priv, 1);
+		pcb->moal_spin_unlock(pmadapter->pmoal_handle,
+				      priv->bypass_txq.plock);
+		LEAVE();
+		return MLAN_STATUS_RESOURCE;
+	}
 	LEAVE();
+	return MLAN_STATUS_SUCCESS;
 }
 
 /**
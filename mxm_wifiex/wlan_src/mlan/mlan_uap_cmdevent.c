@@ -3214,6 +3214,9 @@ static mlan_status wlan_uap_ret_get_log(pmlan_private pmpriv,
 
 	ENTER();
 
+	wlan_11n_update_tx_retry(pmpriv, wlan_le32_to_cpu(pget_log->tx_frame),
+				 wlan_le32_to_cpu(pget_log->retry),
+				 wlan_le32_to_cpu(pget_log->failed));
 	if (pioctl_buf) {
 		pget_info = (mlan_ds_get_info *)pioctl_buf->pbuf;
 		pget_info->param.stats.mcast_tx_frame =
@@ -345,6 +345,7 @@ mlan_status wlan_ops_uap_process_rx_packet(t_void *adapter, pmlan_buffer pmbuf)
 	t_u16 rx_pkt_type = 0;
 	sta_node *sta_ptr = MNULL;
 	t_u16 adj_rx_rate = 0;
+	t_u16 rx_rate = 0;
 	t_u8 antenna = 0;
 
 	t_u32 last_rx_sec = 0;
@@ -579,6 +580,22 @@ mlan_status wlan_ops_uap_process_rx_packet(t_void *adapter, pmlan_buffer pmbuf)
 			sta_ptr->stats.rx_packets++;
 			sta_ptr->stats.rx_bytes += prx_pd->rx_pkt_length;
 		}
+		/* TX status carries no rate. Unless the periodic TX rate
+		 * query covers the RA lists, use the station RX rate to
+		 * estimate their airtime */
+		if ((pmadapter->airtime_fair || pmadapter->amsdu_adapt) &&
+		    rx_pkt_type != PKT_TYPE_BAR &&
+		    last_rx_sec - priv->tx_rate_update_sec >
+			    2 * WMM_TX_RATE_REFRESH) {
+			rx_rate = (t_u16)wlan_index_to_data_rate(
+				pmadapter, prx_pd->rx_rate, prx_pd->rate_info,
+				0);
+			if (rx_rate && rx_rate != sta_ptr->airtime_rate) {
+				sta_ptr->airtime_rate = rx_rate;
+				wlan_wmm_update_ralist_rate(
+					priv, sta_ptr->mac_addr, rx_rate);
+			}
+		}
 	}
 
 	pmbuf->priority |= prx_pd->priority;
@@ -625,20 +642,64 @@ done:
 }
 
 /**
- *  @brief This function processes received packet and forwards it
- *          to kernel/upper layer or send back to firmware
+ *  @brief This function copies a received packet into a bridge buffer
+ *          and queues it to be sent back to firmware
  *
  *  @param priv      A pointer to mlan_private
  *  @param pmbuf     A pointer to mlan_buffer which includes the received packet
  *
- *  @return          MLAN_STATUS_SUCCESS or MLAN_STATUS_FAILURE
+ *  @return          N/A
  */
-mlan_status wlan_uap_recv_packet(mlan_private *priv, pmlan_buffer pmbuf)
+static t_void wlan_uap_bridge_copy(mlan_private *priv, pmlan_buffer pmbuf)
 {
 	pmlan_adapter pmadapter = priv->adapter;
-	mlan_status ret = MLAN_STATUS_SUCCESS;
+	pmlan_buffer newbuf;
+
+	newbuf = wlan_alloc_mlan_buffer(pmadapter, MLAN_TX_DATA_BUF_SIZE_2K, 0,
+					MOAL_MALLOC_BUFFER);
+	if (!newbuf)
+		return;
+	newbuf->bss_index = pmbuf->bss_index;
+	newbuf->buf_type = pmbuf->buf_type;
+	newbuf->priority = pmbuf->priority;
+	newbuf->in_ts_sec = pmbuf->in_ts_sec;
+	newbuf->in_ts_usec = pmbuf->in_ts_usec;
+	newbuf->data_offset =
+		(sizeof(TxPD) + priv->intf_hr_len + DMA_ALIGNMENT);
+	util_scalar_increment(pmadapter->pmoal_handle,
+			      &pmadapter->pending_bridge_pkts,
+			      pmadapter->callbacks.moal_spin_lock,
+			      pmadapter->callbacks.moal_spin_unlock);
+	newbuf->flags |= MLAN_BUF_FLAG_BRIDGE_BUF;
+
+	/* copy the data */
+	memcpy_ext(pmadapter, (t_u8 *)newbuf->pbuf + newbuf->data_offset,
+		   pmbuf->pbuf + pmbuf->data_offset, pmbuf->data_len,
+		   MLAN_TX_DATA_BUF_SIZE_2K);
+	newbuf->data_len = pmbuf->data_len;
+	wlan_wmm_add_buf_txqueue(pmadapter, newbuf);
+	if (util_scalar_read(pmadapter->pmoal_handle,
+			     &pmadapter->pending_bridge_pkts,
+			     pmadapter->callbacks.moal_spin_lock,
+			     pmadapter->callbacks.moal_spin_unlock) >
+	    RX_HIGH_THRESHOLD)
+		wlan_drop_tx_pkts(priv);
+	wlan_recv_event(priv, MLAN_EVENT_ID_DRV_DEFER_HANDLING, MNULL);
+}
+
+/**
+ *  @brief This function bridges a deaggregated AMSDU subframe: a copy
+ *          is sent back to firmware if it is for the BSS, the original
+ *          is left for the host only if it is for us
+ *
+ *  @param priv      A pointer to mlan_private
+ *  @param pmbuf     A pointer to mlan_buffer which includes the subframe
+ *
+ *  @return          MTRUE if the subframe must be sent to the host
+ */
+t_u8 wlan_uap_bridge_amsdu_pkt(mlan_private *priv, pmlan_buffer pmbuf)
+{
 	RxPacketHdr_t *prx_pkt;
-	pmlan_buffer newbuf = MNULL;
 
 	ENTER();
 
@@ -651,116 +712,57 @@ mlan_status wlan_uap_recv_packet(mlan_private *priv, pmlan_buffer pmbuf)
 	       MAC2STR(prx_pkt->eth803_hdr.dest_addr));
 
 	/* don't do packet forwarding in disconnected state */
-	if (priv->media_connected == MFALSE)
-		goto upload;
+	if (priv->media_connected == MFALSE) {
+		LEAVE();
+		return MTRUE;
+	}
 
 	if (prx_pkt->eth803_hdr.dest_addr[0] & 0x01) {
-		if (!(priv->pkt_fwd & PKT_FWD_INTRA_BCAST)) {
-			/* Multicast pkt */
-			newbuf =
-				wlan_alloc_mlan_buffer(pmadapter,
-						       MLAN_TX_DATA_BUF_SIZE_2K,
-						       0, MOAL_MALLOC_BUFFER);
-			if (newbuf) {
-				newbuf->bss_index = pmbuf->bss_index;
-				newbuf->buf_type = pmbuf->buf_type;
-				newbuf->priority = pmbuf->priority;
-				newbuf->in_ts_sec = pmbuf->in_ts_sec;
-				newbuf->in_ts_usec = pmbuf->in_ts_usec;
-				newbuf->data_offset =
-					(sizeof(TxPD) + priv->intf_hr_len +
-					 DMA_ALIGNMENT);
-				util_scalar_increment(
-					pmadapter->pmoal_handle,
-					&pmadapter->pending_bridge_pkts,
-					pmadapter->callbacks.moal_spin_lock,
-					pmadapter->callbacks.moal_spin_unlock);
-
-				newbuf->flags |= MLAN_BUF_FLAG_BRIDGE_BUF;
-
-				/* copy the data */
-				memcpy_ext(pmadapter,
-					   (t_u8 *)newbuf->pbuf +
-						   newbuf->data_offset,
-					   pmbuf->pbuf + pmbuf->data_offset,
-					   pmbuf->data_len,
-					   MLAN_TX_DATA_BUF_SIZE_2K);
-				newbuf->data_len = pmbuf->data_len;
-				wlan_wmm_add_buf_txqueue(pmadapter, newbuf);
-				if (util_scalar_read(
-					    pmadapter->pmoal_handle,
-					    &pmadapter->pending_bridge_pkts,
-					    pmadapter->callbacks.moal_spin_lock,
-					    pmadapter->callbacks
-						    .moal_spin_unlock) >
-				    RX_HIGH_THRESHOLD)
-					wlan_drop_tx_pkts(priv);
-				wlan_recv_event(
-					priv, MLAN_EVENT_ID_DRV_DEFER_HANDLING,
-					MNULL);
-			}
-		}
+		/* Multicast pkt */
+		if (!(priv->pkt_fwd & PKT_FWD_INTRA_BCAST))
+			wlan_uap_bridge_copy(priv, pmbuf);
 	} else {
 		if ((!(priv->pkt_fwd & PKT_FWD_INTRA_UCAST)) &&
 		    (wlan_get_station_entry(priv,
 					    prx_pkt->eth803_hdr.dest_addr))) {
 			/* Intra BSS packet */
-			newbuf =
-				wlan_alloc_mlan_buffer(pmadapter,
-						       MLAN_TX_DATA_BUF_SIZE_2K,
-						       0, MOAL_MALLOC_BUFFER);
-			if (newbuf) {
-				newbuf->bss_index = pmbuf->bss_index;
-				newbuf->buf_type = pmbuf->buf_type;
-				newbuf->priority = pmbuf->priority;
-				newbuf->in_ts_sec = pmbuf->in_ts_sec;
-				newbuf->in_ts_usec = pmbuf->in_ts_usec;
-				newbuf->data_offset =
-					(sizeof(TxPD) + priv->intf_hr_len +
-					 DMA_ALIGNMENT);
-				util_scalar_increment(
-					pmadapter->pmoal_handle,
-					&pmadapter->pending_bridge_pkts,
-					pmadapter->callbacks.moal_spin_lock,
-					pmadapter->callbacks.moal_spin_unlock);
-				newbuf->flags |= MLAN_BUF_FLAG_BRIDGE_BUF;
-
-				/* copy the data */
-				memcpy_ext(pmadapter,
-					   (t_u8 *)newbuf->pbuf +
-						   newbuf->data_offset,
-					   pmbuf->pbuf + pmbuf->data_offset,
-					   pmbuf->data_len,
-					   MLAN_TX_DATA_BUF_SIZE_2K);
-				newbuf->data_len = pmbuf->data_len;
-				wlan_wmm_add_buf_txqueue(pmadapter, newbuf);
-				if (util_scalar_read(
-					    pmadapter->pmoal_handle,
-					    &pmadapter->pending_bridge_pkts,
-					    pmadapter->callbacks.moal_spin_lock,
-					    pmadapter->callbacks
-						    .moal_spin_unlock) >
-				    RX_HIGH_THRESHOLD)
-					wlan_drop_tx_pkts(priv);
-				wlan_recv_event(
-					priv, MLAN_EVENT_ID_DRV_DEFER_HANDLING,
-					MNULL);
-			}
-			goto done;
+			wlan_uap_bridge_copy(priv, pmbuf);
+			LEAVE();
+			return MFALSE;
 		} else if (MLAN_STATUS_FAILURE ==
 			   wlan_check_unicast_packet(
 				   priv, prx_pkt->eth803_hdr.dest_addr)) {
 			/* drop packet */
 			PRINTM(MDATA, "Drop AMSDU dest " MACSTR "\n",
 			       MAC2STR(prx_pkt->eth803_hdr.dest_addr));
-			goto done;
+			LEAVE();
+			return MFALSE;
 		}
 	}
-upload:
+	LEAVE();
+	return MTRUE;
+}
+
+/**
+ *  @brief This function processes received packet and forwards it
+ *          to kernel/upper layer or send back to firmware
+ *
+ *  @param priv      A pointer to mlan_private
+ *  @param pmbuf     A pointer to mlan_buffer which includes the received packet
+ *
+ *  @return          MLAN_STATUS_SUCCESS or MLAN_STATUS_FAILURE
+ */
+mlan_status wlan_uap_recv_packet(mlan_private *priv, pmlan_buffer pmbuf)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+	mlan_status ret = MLAN_STATUS_SUCCESS;
+
+	ENTER();
+
 	/** send packet to moal */
-	ret = pmadapter->callbacks.moal_recv_packet(pmadapter->pmoal_handle,
-						    pmbuf);
-done:
+	if (wlan_uap_bridge_amsdu_pkt(priv, pmbuf))
+		ret = pmadapter->callbacks.moal_recv_packet(
+			pmadapter->pmoal_handle, pmbuf);
 	LEAVE();
 	return ret;
 }
@@ -245,6 +245,30 @@ static INLINE pmlan_linked_list util_dequeue_list(
 	return pnode;
 }
 
+/**
+ *  @brief This function moves all nodes of a list to the tail of another
+ *         list without locking, the source list is left empty
+ *
+ *  @param phead		List head to add the nodes to
+ *  @param plist		List head to take the nodes from
+ *
+ *  @return			N/A
+ */
+static INLINE t_void util_splice_list_tail(pmlan_list_head phead,
+					   pmlan_list_head plist)
+{
+	pmlan_linked_list pfirst = plist->pnext;
+	pmlan_linked_list plast = plist->pprev;
+
+	if (pfirst == (pmlan_linked_list)plist)
+		return;
+	pfirst->pprev = phead->pprev;
+	phead->pprev->pnext = pfirst;
+	plast->pnext = (pmlan_linked_list)phead;
+	phead->pprev = plast;
+	util_init_list((pmlan_linked_list)plist);
+}
+
 /** Access controlled scalar variable */
 typedef struct _mlan_scalar {
 	/** Value */
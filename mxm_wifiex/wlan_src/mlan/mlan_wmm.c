@@ -174,12 +174,122 @@ static raListTbl *wlan_wmm_allocate_ralist_node(pmlan_adapter pmadapter,
 	ra_list->del_ba_count = 0;
 	ra_list->total_pkts = 0;
 	ra_list->tx_pause = 0;
+	ra_list->ready_node.pprev = MNULL;
+	ra_list->ready_node.pnext = MNULL;
+	ra_list->ready_node.ra_list = ra_list;
+	ra_list->airtime_deficit = 0;
+	ra_list->airtime_rate = 0;
+	ra_list->amsdu_size = AMSDU_ADAPT_SIZE_MAX;
+	ra_list->codel_first_above = 0;
+	ra_list->codel_drop_next = 0;
+	ra_list->codel_count = 0;
+	ra_list->codel_lastcount = 0;
+	ra_list->codel_dropping = MFALSE;
+	ra_list->codel_drops = 0;
+	ra_list->codel_marks = 0;
 	PRINTM(MINFO, "RAList: Allocating buffers for TID %p\n", ra_list);
 done:
 	LEAVE();
 	return ra_list;
 }
 
+/**
+ *  @brief Find the RA hash entry of a peer
+ *
+ *  Caller must hold a ra_list_lock or ra_list_spinlock.
+ *
+ *  @param priv     Pointer to the mlan_private driver data struct
+ *  @param ra       Receiver address of the peer
+ *
+ *  @return         ralist_peer or MNULL
+ */
+static ralist_peer *wlan_wmm_find_ralist_peer(pmlan_private priv, t_u8 *ra)
+{
+	mlan_list_head *bucket = &priv->wmm.ra_hash[WMM_RA_HASH(ra)];
+	ralist_peer *peer;
+
+	peer = (ralist_peer *)util_peek_list(priv->adapter->pmoal_handle,
+					     bucket, MNULL, MNULL);
+	while (peer && peer != (ralist_peer *)bucket) {
+		if (!memcmp(priv->adapter, peer->ra, ra, MLAN_MAC_ADDR_LENGTH))
+			return peer;
+		peer = peer->pnext;
+	}
+	return MNULL;
+}
+
+/**
+ *  @brief Remove the RA hash entry of a peer and free it
+ *
+ *  Caller must hold all the TX queue locks, see wlan_wmm_lock_all.
+ *
+ *  @param priv     Pointer to the mlan_private driver data struct
+ *  @param peer     A pointer to the RA hash entry
+ *
+ *  @return         N/A
+ */
+static void wlan_wmm_free_ralist_peer(pmlan_private priv, ralist_peer *peer)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+
+	util_unlink_list(pmadapter->pmoal_handle,
+			 &priv->wmm.ra_hash[WMM_RA_HASH(peer->ra)],
+			 (pmlan_linked_list)peer, MNULL, MNULL);
+	pmadapter->callbacks.moal_mfree(pmadapter->pmoal_handle, (t_u8 *)peer);
+}
+
+/**
+ *  @brief Find the TDLS pending entry of a peer
+ *
+ *  Caller must hold tdls_pending_lock.
+ *
+ *  @param priv		A pointer to mlan_private
+ *  @param mac		TDLS peer mac address
+ *
+ *  @return		tdls_pending_peer or MNULL
+ */
+static tdls_pending_peer *wlan_find_tdls_pending_peer(pmlan_private priv,
+						      t_u8 *mac)
+{
+	mlan_list_head *bucket = &priv->tdls_pending_hash[WMM_RA_HASH(mac)];
+	tdls_pending_peer *peer;
+
+	peer = (tdls_pending_peer *)util_peek_list(priv->adapter->pmoal_handle,
+						   bucket, MNULL, MNULL);
+	while (peer && peer != (tdls_pending_peer *)bucket) {
+		if (!memcmp(priv->adapter, peer->mac, mac,
+			    MLAN_MAC_ADDR_LENGTH))
+			return peer;
+		peer = peer->pnext;
+	}
+	return MNULL;
+}
+
+/**
+ *  @brief Free the held packets of a TDLS pending entry and the entry
+ *
+ *  @param priv		A pointer to mlan_private
+ *  @param peer		A pointer to the unlinked TDLS pending entry
+ *
+ *  @return		N/A
+ */
+static t_void wlan_free_tdls_pending_peer(pmlan_private priv,
+					  tdls_pending_peer *peer)
+{
+	mlan_adapter *pmadapter = priv->adapter;
+	pmlan_buffer pmbuf;
+	t_u8 i;
+
+	for (i = 0; i < MAX_NUM_TID; ++i) {
+		while ((pmbuf = (pmlan_buffer)util_dequeue_list(
+				pmadapter->pmoal_handle, &peer->buf_head[i],
+				MNULL, MNULL)))
+			wlan_write_data_complete(pmadapter, pmbuf,
+						 MLAN_STATUS_FAILURE);
+	}
+	pmadapter->callbacks.moal_mfree(pmadapter->pmoal_handle, (t_u8 *)peer);
+}
+
 /**
  *  @brief Add packet to TDLS pending TX queue
  *
@@ -191,11 +301,42 @@ done:
 static t_void wlan_add_buf_tdls_txqueue(pmlan_private priv, pmlan_buffer pmbuf)
 {
 	mlan_adapter *pmadapter = priv->adapter;
+	t_u8 *mac = pmbuf->pbuf + pmbuf->data_offset;
+	tdls_pending_peer *peer;
+	t_u8 i;
 	ENTER();
-	util_enqueue_list_tail(pmadapter->pmoal_handle, &priv->tdls_pending_txq,
-			       (pmlan_linked_list)pmbuf,
-			       pmadapter->callbacks.moal_spin_lock,
-			       pmadapter->callbacks.moal_spin_unlock);
+	pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
+					    priv->tdls_pending_lock);
+	peer = wlan_find_tdls_pending_peer(priv, mac);
+	if (!peer) {
+		if (pmadapter->callbacks.moal_malloc(
+			    pmadapter->pmoal_handle, sizeof(tdls_pending_peer),
+			    MLAN_MEM_DEF, (t_u8 **)&peer)) {
+			pmadapter->callbacks.moal_spin_unlock(
+				pmadapter->pmoal_handle,
+				priv->tdls_pending_lock);
+			PRINTM(MERROR, "Fail to allocate tdls pending peer\n");
+			wlan_write_data_complete(pmadapter, pmbuf,
+						 MLAN_STATUS_FAILURE);
+			LEAVE();
+			return;
+		}
+		memset(pmadapter, peer, 0, sizeof(tdls_pending_peer));
+		memcpy_ext(pmadapter, peer->mac, mac, MLAN_MAC_ADDR_LENGTH,
+			   MLAN_MAC_ADDR_LENGTH);
+		for (i = 0; i < MAX_NUM_TID; ++i)
+			util_init_list((pmlan_linked_list)&peer->buf_head[i]);
+		util_enqueue_list_tail(
+			pmadapter->pmoal_handle,
+			&priv->tdls_pending_hash[WMM_RA_HASH(mac)],
+			(pmlan_linked_list)peer, MNULL, MNULL);
+	}
+	util_enqueue_list_tail(pmadapter->pmoal_handle,
+			       &peer->buf_head[pmbuf->priority],
+			       (pmlan_linked_list)pmbuf, MNULL, MNULL);
+	peer->num_pkts[pmbuf->priority]++;
+	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
+					      priv->tdls_pending_lock);
 	LEAVE();
 }
 
@@ -208,22 +349,21 @@ static t_void wlan_add_buf_tdls_txqueue(pmlan_private priv, pmlan_buffer pmbuf)
  */
 static t_void wlan_cleanup_tdls_txq(pmlan_private priv)
 {
-	pmlan_buffer pmbuf;
+	tdls_pending_peer *peer;
 	mlan_adapter *pmadapter = priv->adapter;
+	t_u8 i;
 	ENTER();
 
 	pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
-					    priv->tdls_pending_txq.plock);
-	while ((pmbuf = (pmlan_buffer)util_peek_list(pmadapter->pmoal_handle,
-						     &priv->tdls_pending_txq,
-						     MNULL, MNULL))) {
-		util_unlink_list(pmadapter->pmoal_handle,
-				 &priv->tdls_pending_txq,
-				 (pmlan_linked_list)pmbuf, MNULL, MNULL);
-		wlan_write_data_complete(pmadapter, pmbuf, MLAN_STATUS_FAILURE);
+					    priv->tdls_pending_lock);
+	for (i = 0; i < WMM_RA_HASH_SIZE; ++i) {
+		while ((peer = (tdls_pending_peer *)util_dequeue_list(
+				pmadapter->pmoal_handle,
+				&priv->tdls_pending_hash[i], MNULL, MNULL)))
+			wlan_free_tdls_pending_peer(priv, peer);
 	}
 	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
-					      priv->tdls_pending_txq.plock);
+					      priv->tdls_pending_lock);
 	LEAVE();
 }
 
@@ -398,11 +538,13 @@ static INLINE void wlan_wmm_del_pkts_in_ralist_node(pmlan_private priv,
  *
  *  @param priv			Pointer to the mlan_private driver data struct
  *  @param ra_list_head	ra list header
+ *  @param tid			tid
  *
  *  @return		N/A
  */
 static INLINE void wlan_wmm_del_pkts_in_ralist(pmlan_private priv,
-					       mlan_list_head *ra_list_head)
+					       mlan_list_head *ra_list_head,
+					       int tid)
 {
 	raListTbl *ra_list;
 
@@ -413,6 +555,7 @@ static INLINE void wlan_wmm_del_pkts_in_ralist(pmlan_private priv,
 
 	while (ra_list && ra_list != (raListTbl *)ra_list_head) {
 		wlan_wmm_del_pkts_in_ralist_node(priv, ra_list);
+		wlan_wmm_update_ralist_ready(priv, ra_list, tid);
 
 		ra_list = ra_list->pnext;
 	}
@@ -434,16 +577,19 @@ static void wlan_wmm_cleanup_queues(pmlan_private priv)
 	ENTER();
 
 	for (i = 0; i < MAX_NUM_TID; i++) {
-		wlan_wmm_del_pkts_in_ralist(priv,
-					    &priv->wmm.tid_tbl_ptr[i].ra_list);
+		wlan_wmm_del_pkts_in_ralist(
+			priv, &priv->wmm.tid_tbl_ptr[i].ra_list, i);
 		priv->wmm.pkts_queued[i] = 0;
 		priv->wmm.pkts_paused[i] = 0;
 	}
 	util_scalar_write(priv->adapter->pmoal_handle,
-			  &priv->wmm.tx_pkts_queued, 0, MNULL, MNULL);
+			  &priv->wmm.tx_pkts_queued, 0,
+			  priv->adapter->callbacks.moal_spin_lock,
+			  priv->adapter->callbacks.moal_spin_unlock);
 	util_scalar_write(priv->adapter->pmoal_handle,
-			  &priv->wmm.highest_queued_prio, HIGH_PRIO_TID, MNULL,
-			  MNULL);
+			  &priv->wmm.highest_queued_prio, HIGH_PRIO_TID,
+			  priv->adapter->callbacks.moal_spin_lock,
+			  priv->adapter->callbacks.moal_spin_unlock);
 
 	LEAVE();
 }
@@ -458,6 +604,7 @@ static void wlan_wmm_cleanup_queues(pmlan_private priv)
 static void wlan_wmm_delete_all_ralist(pmlan_private priv)
 {
 	raListTbl *ra_list;
+	ralist_peer *peer;
 	int i;
 	pmlan_adapter pmadapter = priv->adapter;
 
@@ -480,7 +627,15 @@ static void wlan_wmm_delete_all_ralist(pmlan_private priv)
 
 		util_init_list(
 			(pmlan_linked_list)&priv->wmm.tid_tbl_ptr[i].ra_list);
-		priv->wmm.tid_tbl_ptr[i].ra_list_curr = MNULL;
+		util_init_list((pmlan_linked_list)&priv->wmm.tid_tbl_ptr[i]
+				       .ready_list);
+	}
+	pmadapter->tx_ready_map[priv->bss_index] = 0;
+	for (i = 0; i < WMM_RA_HASH_SIZE; ++i) {
+		while ((peer = (ralist_peer *)util_peek_list(
+				pmadapter->pmoal_handle, &priv->wmm.ra_hash[i],
+				MNULL, MNULL)))
+			wlan_wmm_free_ralist_peer(priv, peer);
 	}
 
 	LEAVE();
@@ -601,6 +756,41 @@ static void wlan_send_wmmac_host_event(pmlan_private priv, char *type_str,
 }
 #endif /* STA_SUPPORT */
 
+/**
+ *  @brief Get the RA list of a TID to serve next under airtime fairness
+ *
+ *  Deficit round robin: a RA list at the head of the ready list that has
+ *  used up its airtime is granted a new quantum and moved to the tail,
+ *  until a RA list with airtime left heads the list.
+ *  Caller must hold the ra_list_lock of the TID.
+ *
+ *  @param priv     A pointer to mlan_private
+ *  @param tid      TID of the ready list
+ *
+ *  @return         RA list to serve or MNULL
+ */
+static raListTbl *wlan_wmm_get_airtime_ralist(pmlan_private priv, int tid)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+	tid_tbl_t *tid_ptr = &priv->wmm.tid_tbl_ptr[tid];
+	ralist_ready_node *ready_node;
+
+	while ((ready_node = (ralist_ready_node *)util_peek_list(
+			pmadapter->pmoal_handle, &tid_ptr->ready_list, MNULL,
+			MNULL))) {
+		if (ready_node->ra_list->airtime_deficit > 0)
+			return ready_node->ra_list;
+		ready_node->ra_list->airtime_deficit += WMM_AIRTIME_QUANTUM;
+		util_unlink_list(pmadapter->pmoal_handle, &tid_ptr->ready_list,
+				 (pmlan_linked_list)ready_node, MNULL, MNULL);
+		util_enqueue_list_tail(pmadapter->pmoal_handle,
+				       &tid_ptr->ready_list,
+				       (pmlan_linked_list)ready_node, MNULL,
+				       MNULL);
+	}
+	return MNULL;
+}
+
 /**
  *  @brief This function gets the highest priority list pointer
  *
@@ -615,9 +805,11 @@ static raListTbl *wlan_wmm_get_highest_priolist_ptr(pmlan_adapter pmadapter,
 						    int *tid)
 {
 	pmlan_private priv_tmp;
-	raListTbl *ptr, *head;
+	raListTbl *ptr;
+	ralist_ready_node *ready_node;
 	mlan_bssprio_node *bssprio_node, *bssprio_head;
 	tid_tbl_t *tid_ptr;
+	t_u8 ready_map;
 	int i, j;
 	int next_prio = 0;
 	int next_tid = 0;
@@ -642,6 +834,9 @@ static raListTbl *wlan_wmm_get_highest_priolist_ptr(pmlan_adapter pmadapter,
 
 		do {
 			priv_tmp = bssprio_node->priv;
+			/* Nothing ready on this BSS, skip it without locking */
+			if (!pmadapter->tx_ready_map[priv_tmp->bss_index])
+				goto next_intf;
 			if ((priv_tmp->port_ctrl_mode == MTRUE) &&
 			    (priv_tmp->port_open == MFALSE)) {
 				PRINTM(MINFO,
@@ -673,94 +868,94 @@ static raListTbl *wlan_wmm_get_highest_priolist_ptr(pmlan_adapter pmadapter,
 			}
 #endif
 
-			pmadapter->callbacks.moal_spin_lock(
-				pmadapter->pmoal_handle,
-				priv_tmp->wmm.ra_list_spinlock);
-
+			ready_map =
+				pmadapter->tx_ready_map[priv_tmp->bss_index];
 			for (i = util_scalar_read(
 				     pmadapter->pmoal_handle,
 				     &priv_tmp->wmm.highest_queued_prio, MNULL,
 				     MNULL);
 			     i >= LOW_PRIO_TID; --i) {
+				if (!(ready_map & MBIT(tos_to_tid[i])))
+					continue;
+
+				/*
+				 * The head of the ready list is the ra next in
+				 * turn; it is moved to the tail once served,
+				 * this way we pick the ra's in round robin
+				 * fashion.
+				 */
 				tid_ptr = &(priv_tmp)
 						   ->wmm
 						   .tid_tbl_ptr[tos_to_tid[i]];
-				if (!util_peek_list(pmadapter->pmoal_handle,
-						    &tid_ptr->ra_list, MNULL,
-						    MNULL))
+				wlan_wmm_lock_tid(priv_tmp, tos_to_tid[i]);
+				if (pmadapter->airtime_fair) {
+					ptr = wlan_wmm_get_airtime_ralist(
+						priv_tmp, tos_to_tid[i]);
+				} else {
+					ready_node = (ralist_ready_node *)
+						util_peek_list(
+							pmadapter->pmoal_handle,
+							&tid_ptr->ready_list,
+							MNULL, MNULL);
+					ptr = ready_node ? ready_node->ra_list :
+							   MNULL;
+				}
+				if (!ptr) {
+					wlan_wmm_unlock_tid(priv_tmp,
+							    tos_to_tid[i]);
 					continue;
+				}
 
-				/*
-				 * Always choose the next ra we transmitted
-				 * last time, this way we pick the ra's in
-				 * round robin fashion.
-				 */
-				head = ptr = tid_ptr->ra_list_curr->pnext;
-				if (ptr == (raListTbl *)&tid_ptr->ra_list)
-					head = ptr = ptr->pnext;
-
-				do {
-					if (!ptr->tx_pause &&
-					    util_peek_list(
-						    pmadapter->pmoal_handle,
-						    &ptr->buf_head, MNULL,
-						    MNULL)) {
-						/* Because WMM only support
-						 * BK/BE/VI/VO, we have 8 tid
-						 * We should balance the traffic
-						 * of the same AC */
-						if (i % 2)
-							next_prio = i - 1;
-						else
-							next_prio = i + 1;
-						next_tid =
-							tos_to_tid[next_prio];
-						if (priv_tmp->wmm.pkts_queued
-							    [next_tid] &&
-						    (priv_tmp->wmm.pkts_queued
-							     [next_tid] >
-						     priv_tmp->wmm.pkts_paused
-							     [next_tid]))
-							util_scalar_write(
-								pmadapter->pmoal_handle,
-								&priv_tmp->wmm
-									 .highest_queued_prio,
-								next_prio,
-								MNULL, MNULL);
-						else
-							/* if
-							 * highest_queued_prio >
-							 * i, set it to i */
-							util_scalar_conditional_write(
-								pmadapter->pmoal_handle,
-								&priv_tmp->wmm
-									 .highest_queued_prio,
-								MLAN_SCALAR_COND_GREATER_THAN,
-								i, i, MNULL,
-								MNULL);
-						*priv = priv_tmp;
-						*tid = tos_to_tid[i];
-						/* hold priv->ra_list_spinlock
-						 * to maintain ptr */
-						PRINTM(MDAT_D,
-						       "get highest prio ptr %p, tid %d\n",
-						       ptr, *tid);
-						LEAVE();
-						return ptr;
-					}
-
-					ptr = ptr->pnext;
-					if (ptr ==
-					    (raListTbl *)&tid_ptr->ra_list)
-						ptr = ptr->pnext;
-				} while (ptr != head);
+				/* Because WMM only support BK/BE/VI/VO, we have
+				 * 8 tid We should balance the traffic of the
+				 * same AC */
+				if (i % 2)
+					next_prio = i - 1;
+				else
+					next_prio = i + 1;
+				next_tid = tos_to_tid[next_prio];
+				if (ready_map & MBIT(next_tid))
+					util_scalar_write(
+						pmadapter->pmoal_handle,
+						&priv_tmp->wmm
+							 .highest_queued_prio,
+						next_prio,
+						pmadapter->callbacks
+							.moal_spin_lock,
+						pmadapter->callbacks
+							.moal_spin_unlock);
+				else
+					/* if highest_queued_prio > i, set it
+					 * to i */
+					util_scalar_conditional_write(
+						pmadapter->pmoal_handle,
+						&priv_tmp->wmm
+							 .highest_queued_prio,
+						MLAN_SCALAR_COND_GREATER_THAN,
+						i, i,
+						pmadapter->callbacks
+							.moal_spin_lock,
+						pmadapter->callbacks
+							.moal_spin_unlock);
+				*priv = priv_tmp;
+				*tid = tos_to_tid[i];
+				/* hold the ra_list_lock of the TID to maintain
+				 * ptr */
+				PRINTM(MDAT_D,
+				       "get highest prio ptr %p, tid %d\n", ptr,
+				       *tid);
+				LEAVE();
+				return ptr;
 			}
 
+			/* Re-read the map under ready_lock so a packet queued
+			 * meanwhile is not hidden by NO_PKT_PRIO_TID */
+			pmadapter->callbacks.moal_spin_lock(
+				pmadapter->pmoal_handle,
+				priv_tmp->wmm.ready_lock);
 			/* If priv still has packets queued, reset to
 			 * HIGH_PRIO_TID */
-			if (util_scalar_read(pmadapter->pmoal_handle,
-					     &priv_tmp->wmm.tx_pkts_queued,
-					     MNULL, MNULL))
+			if (pmadapter->tx_ready_map[priv_tmp->bss_index])
 				util_scalar_write(
 					pmadapter->pmoal_handle,
 					&priv_tmp->wmm.highest_queued_prio,
@@ -773,10 +968,9 @@ static raListTbl *wlan_wmm_get_highest_priolist_ptr(pmlan_adapter pmadapter,
 					pmadapter->pmoal_handle,
 					&priv_tmp->wmm.highest_queued_prio,
 					NO_PKT_PRIO_TID, MNULL, MNULL);
-
 			pmadapter->callbacks.moal_spin_unlock(
 				pmadapter->pmoal_handle,
-				priv_tmp->wmm.ra_list_spinlock);
+				priv_tmp->wmm.ready_lock);
 
 		next_intf:
 			bssprio_node = bssprio_node->pnext;
@@ -805,12 +999,24 @@ static int wlan_num_pkts_in_txq(mlan_private *priv, raListTbl *ptr,
 				int max_buf_size)
 {
 	int count = 0, total_size = 0;
+	int seg_size, segs;
 	pmlan_buffer pmbuf;
 
 	ENTER();
 
 	for (pmbuf = (pmlan_buffer)ptr->buf_head.pnext;
 	     pmbuf != (pmlan_buffer)(&ptr->buf_head); pmbuf = pmbuf->pnext) {
+		if (pmbuf->flags & MLAN_BUF_FLAG_TSO) {
+			/* Each TCP segment counts as a packet */
+			seg_size = pmbuf->gso_hdr_len + pmbuf->gso_size;
+			segs = MIN((int)wlan_11n_tso_segs(pmbuf),
+				   (max_buf_size - total_size - 1) / seg_size);
+			count += segs;
+			total_size += segs * seg_size;
+			if (segs < (int)wlan_11n_tso_segs(pmbuf))
+				break;
+			continue;
+		}
 		total_size += pmbuf->data_len;
 		if (total_size < max_buf_size)
 			++count;
@@ -823,7 +1029,96 @@ static int wlan_num_pkts_in_txq(mlan_private *priv, raListTbl *ptr,
 }
 
 /**
- *  @brief This function sends a single packet
+ *  @brief This function gets the number of packets allowed in one TX burst
+ *
+ *  @param pmadapter    A pointer to mlan_adapter
+ *
+ *  @return             Max number of packets to send from a RA list
+ */
+static t_u32 wlan_wmm_tx_burst_limit(pmlan_adapter pmadapter)
+{
+	t_u32 limit = pmadapter->tx_burst;
+
+	if (limit <= 1)
+		return 1;
+#ifdef PCIE
+	if (IS_PCIE(pmadapter->card_type))
+		return MIN(limit, (t_u32)(pmadapter->pcard_pcie->txrx_bd_size -
+					  pmadapter->pcard_pcie->txbd_pending));
+#endif
+#ifdef SDIO
+	if (IS_SD(pmadapter->card_type))
+		return MIN(limit,
+			   bitcount(pmadapter->pcard_sd->mp_wr_bitmap &
+				    pmadapter->pcard_sd->mp_data_port_mask));
+#endif
+	return 1;
+}
+
+/**
+ *  @brief This function moves a TX burst from a RA list to a local list
+ *
+ *  The burst ends at the packet, byte and airtime budgets, and before a
+ *  TSO or requeued packet. Must be called with the TID lock held.
+ *
+ *  @param priv          A pointer to mlan_private
+ *  @param ptr           A pointer to RA list table
+ *  @param ptrindex      ptr's TID index
+ *  @param pburst        A pointer to the list to add the packets to
+ *  @param pnext_pkt_len Returns the length of the packet after the burst
+ *
+ *  @return              Number of packets dequeued
+ */
+static t_u32 wlan_wmm_dequeue_burst(pmlan_private priv, raListTbl *ptr,
+				    int ptrindex, pmlan_list_head pburst,
+				    t_u32 *pnext_pkt_len)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+	pmlan_buffer pmbuf;
+	t_u32 limit = wlan_wmm_tx_burst_limit(pmadapter);
+	t_u32 rate = ptr->airtime_rate ? ptr->airtime_rate :
+					 WMM_AIRTIME_DEF_RATE;
+	t_s32 deficit = ptr->airtime_deficit;
+	t_u32 bytes = 0;
+	t_u32 count = 0;
+
+	while ((pmbuf = (pmlan_buffer)util_peek_list(pmadapter->pmoal_handle,
+						     &ptr->buf_head, MNULL,
+						     MNULL))) {
+		if (count &&
+		    (count >= limit || bytes >= WMM_TX_BURST_BYTES ||
+		     (pmbuf->flags &
+		      (MLAN_BUF_FLAG_TSO | MLAN_BUF_FLAG_REQUEUED_PKT)) ||
+		     (pmadapter->airtime_fair && deficit <= 0)))
+			break;
+		util_unlink_list(pmadapter->pmoal_handle, &ptr->buf_head,
+				 (pmlan_linked_list)pmbuf, MNULL, MNULL);
+		util_enqueue_list_tail(pmadapter->pmoal_handle, pburst,
+				       (pmlan_linked_list)pmbuf, MNULL, MNULL);
+		util_scalar_decrement(pmadapter->pmoal_handle,
+				      &priv->wmm.tx_pkts_queued,
+				      pmadapter->callbacks.moal_spin_lock,
+				      pmadapter->callbacks.moal_spin_unlock);
+		bytes += pmbuf->data_len;
+		deficit -= (t_s32)(pmbuf->data_len * 16 / rate);
+		count++;
+	}
+	priv->wmm.pkts_queued[ptrindex] -= count;
+	ptr->total_pkts -= count;
+	*pnext_pkt_len = pmbuf ? pmbuf->data_len + sizeof(TxPD) : 0;
+	if (!pmbuf)
+		wlan_wmm_update_ralist_ready(priv, ptr, ptrindex);
+	PRINTM(MINFO, "Dequeued %u packets from %p\n", count, ptr);
+	return count;
+}
+
+/**
+ *  @brief This function sends a single packet, or a burst of packets
+ *         from the same RA list when tx_burst is enabled
+ *
+ *  The burst is dequeued under one hold of the TID lock and handed to
+ *  wlan_process_tx_burst() in one call. Packets the card did not take
+ *  are put back at the head of the RA list in their original order.
  *
  *  @param priv         A pointer to mlan_private
  *  @param ptr          A pointer to RA list table
@@ -835,83 +1130,92 @@ static INLINE void wlan_send_single_packet(pmlan_private priv, raListTbl *ptr,
 					   int ptrindex)
 {
 	pmlan_buffer pmbuf;
-	pmlan_buffer pmbuf_next;
-	mlan_tx_param tx_param;
+	mlan_list_head burst;
 	pmlan_adapter pmadapter = priv->adapter;
-	mlan_status status = MLAN_STATUS_SUCCESS;
+	mlan_status status;
+	t_u32 next_pkt_len = 0;
+	t_u32 burst_pkts;
+	t_u32 sent_pkts = 0;
+	t_u32 sent_bytes = 0;
 
 	ENTER();
 
-	pmbuf = (pmlan_buffer)util_dequeue_list(pmadapter->pmoal_handle,
-						&ptr->buf_head, MNULL, MNULL);
-	if (pmbuf) {
-		PRINTM(MINFO, "Dequeuing the packet %p %p\n", ptr, pmbuf);
+	while ((pmbuf = (pmlan_buffer)util_peek_list(pmadapter->pmoal_handle,
+						     &ptr->buf_head, MNULL,
+						     MNULL)) &&
+	       (pmbuf->flags & MLAN_BUF_FLAG_TSO)) {
+		util_unlink_list(pmadapter->pmoal_handle, &ptr->buf_head,
+				 (pmlan_linked_list)pmbuf, MNULL, MNULL);
 		priv->wmm.pkts_queued[ptrindex]--;
 		util_scalar_decrement(pmadapter->pmoal_handle,
-				      &priv->wmm.tx_pkts_queued, MNULL, MNULL);
+				      &priv->wmm.tx_pkts_queued,
+				      pmadapter->callbacks.moal_spin_lock,
+				      pmadapter->callbacks.moal_spin_unlock);
 		ptr->total_pkts--;
-		pmbuf_next = (pmlan_buffer)util_peek_list(
-			pmadapter->pmoal_handle, &ptr->buf_head, MNULL, MNULL);
-		pmadapter->callbacks.moal_spin_unlock(
-			pmadapter->pmoal_handle, priv->wmm.ra_list_spinlock);
-
-		tx_param.next_pkt_len =
-			((pmbuf_next) ? pmbuf_next->data_len + sizeof(TxPD) :
-					0);
-		status = wlan_process_tx(priv, pmbuf, &tx_param);
+		if (!util_peek_list(pmadapter->pmoal_handle, &ptr->buf_head,
+				    MNULL, MNULL))
+			wlan_wmm_update_ralist_ready(priv, ptr, ptrindex);
+		wlan_wmm_unlock_tid(priv, ptrindex);
+		/* Send the TCP segments as single packets */
+		if (wlan_11n_tso_segment(priv, ptr, pmbuf, ptrindex) !=
+		    MLAN_STATUS_SUCCESS) {
+			LEAVE();
+			return;
+		}
+	}
+	if (!pmbuf) {
+		wlan_wmm_unlock_tid(priv, ptrindex);
+		PRINTM(MINFO, "Nothing to send\n");
+		LEAVE();
+		return;
+	}
 
-		if (status == MLAN_STATUS_RESOURCE) {
-			/** Queue the packet back at the head */
-			PRINTM(MDAT_D, "Queuing pkt back to raList %p %p\n",
-			       ptr, pmbuf);
-			pmadapter->callbacks.moal_spin_lock(
-				pmadapter->pmoal_handle,
-				priv->wmm.ra_list_spinlock);
+	util_init_list_head(pmadapter->pmoal_handle, &burst, MFALSE, MNULL);
+	burst_pkts = wlan_wmm_dequeue_burst(priv, ptr, ptrindex, &burst,
+					    &next_pkt_len);
+	wlan_wmm_unlock_tid(priv, ptrindex);
 
-			if (!wlan_is_ralist_valid(priv, ptr, ptrindex)) {
-				pmadapter->callbacks.moal_spin_unlock(
-					pmadapter->pmoal_handle,
-					priv->wmm.ra_list_spinlock);
-				wlan_write_data_complete(pmadapter, pmbuf,
-							 MLAN_STATUS_FAILURE);
-				LEAVE();
-				return;
-			}
-			priv->wmm.pkts_queued[ptrindex]++;
-			util_scalar_increment(pmadapter->pmoal_handle,
-					      &priv->wmm.tx_pkts_queued, MNULL,
-					      MNULL);
-			util_enqueue_list_head(pmadapter->pmoal_handle,
-					       &ptr->buf_head,
-					       (pmlan_linked_list)pmbuf, MNULL,
-					       MNULL);
+	status = wlan_process_tx_burst(priv, &burst, next_pkt_len, &sent_pkts,
+				       &sent_bytes);
 
-			ptr->total_pkts++;
-			pmbuf->flags |= MLAN_BUF_FLAG_REQUEUED_PKT;
-			pmadapter->callbacks.moal_spin_unlock(
-				pmadapter->pmoal_handle,
-				priv->wmm.ra_list_spinlock);
-		} else {
-			pmadapter->callbacks.moal_spin_lock(
-				pmadapter->pmoal_handle,
-				priv->wmm.ra_list_spinlock);
-			if (wlan_is_ralist_valid(priv, ptr, ptrindex)) {
-				priv->wmm.packets_out[ptrindex]++;
-				priv->wmm.tid_tbl_ptr[ptrindex].ra_list_curr =
-					ptr;
-			}
+	wlan_wmm_lock_tid(priv, ptrindex);
+	if (!wlan_is_ralist_valid(priv, ptr, ptrindex)) {
+		if (status != MLAN_STATUS_RESOURCE)
 			pmadapter->bssprio_tbl[priv->bss_priority].bssprio_cur =
 				pmadapter->bssprio_tbl[priv->bss_priority]
 					.bssprio_cur->pnext;
-			pmadapter->callbacks.moal_spin_unlock(
-				pmadapter->pmoal_handle,
-				priv->wmm.ra_list_spinlock);
-		}
-	} else {
-		pmadapter->callbacks.moal_spin_unlock(
-			pmadapter->pmoal_handle, priv->wmm.ra_list_spinlock);
-		PRINTM(MINFO, "Nothing to send\n");
+		wlan_wmm_unlock_tid(priv, ptrindex);
+		while ((pmbuf = (pmlan_buffer)util_dequeue_list(
+				pmadapter->pmoal_handle, &burst, MNULL, MNULL)))
+			wlan_write_data_complete(pmadapter, pmbuf,
+						 MLAN_STATUS_FAILURE);
+		LEAVE();
+		return;
+	}
+	if (burst_pkts > sent_pkts) {
+		/** Queue the unsent packets back at the head */
+		PRINTM(MDAT_D, "Queuing %u pkts back to raList %p\n",
+		       burst_pkts - sent_pkts, ptr);
+		util_splice_list_tail(&burst, &ptr->buf_head);
+		util_splice_list_tail(&ptr->buf_head, &burst);
+		priv->wmm.pkts_queued[ptrindex] += burst_pkts - sent_pkts;
+		util_scalar_offset(pmadapter->pmoal_handle,
+				   &priv->wmm.tx_pkts_queued,
+				   burst_pkts - sent_pkts,
+				   pmadapter->callbacks.moal_spin_lock,
+				   pmadapter->callbacks.moal_spin_unlock);
+		ptr->total_pkts += burst_pkts - sent_pkts;
+		wlan_wmm_update_ralist_ready(priv, ptr, ptrindex);
 	}
+	if (sent_pkts) {
+		priv->wmm.packets_out[ptrindex] += sent_pkts;
+		wlan_wmm_rotate_ralist_ready(priv, ptr, ptrindex, sent_bytes);
+	}
+	if (status != MLAN_STATUS_RESOURCE)
+		pmadapter->bssprio_tbl[priv->bss_priority].bssprio_cur =
+			pmadapter->bssprio_tbl[priv->bss_priority]
+				.bssprio_cur->pnext;
+	wlan_wmm_unlock_tid(priv, ptrindex);
 
 	LEAVE();
 }
@@ -953,14 +1257,17 @@ static INLINE void wlan_send_processed_packet(pmlan_private priv,
 	pmlan_buffer pmbuf;
 	pmlan_adapter pmadapter = priv->adapter;
 	mlan_status ret = MLAN_STATUS_FAILURE;
+	t_u32 tx_len;
 
 	pmbuf = (pmlan_buffer)util_dequeue_list(pmadapter->pmoal_handle,
 						&ptr->buf_head, MNULL, MNULL);
 	if (pmbuf) {
+		tx_len = pmbuf->data_len;
 		pmbuf_next = (pmlan_buffer)util_peek_list(
 			pmadapter->pmoal_handle, &ptr->buf_head, MNULL, MNULL);
-		pmadapter->callbacks.moal_spin_unlock(
-			pmadapter->pmoal_handle, priv->wmm.ra_list_spinlock);
+		if (!pmbuf_next)
+			wlan_wmm_update_ralist_ready(priv, ptr, ptrindex);
+		wlan_wmm_unlock_tid(priv, ptrindex);
 		tx_param.next_pkt_len =
 			((pmbuf_next) ? pmbuf_next->data_len + sizeof(TxPD) :
 					0);
@@ -975,14 +1282,10 @@ static INLINE void wlan_send_processed_packet(pmlan_private priv,
 #endif
 		case MLAN_STATUS_RESOURCE:
 			PRINTM(MINFO, "MLAN_STATUS_RESOURCE is returned\n");
-			pmadapter->callbacks.moal_spin_lock(
-				pmadapter->pmoal_handle,
-				priv->wmm.ra_list_spinlock);
+			wlan_wmm_lock_tid(priv, ptrindex);
 
 			if (!wlan_is_ralist_valid(priv, ptr, ptrindex)) {
-				pmadapter->callbacks.moal_spin_unlock(
-					pmadapter->pmoal_handle,
-					priv->wmm.ra_list_spinlock);
+				wlan_wmm_unlock_tid(priv, ptrindex);
 				wlan_write_data_complete(pmadapter, pmbuf,
 							 MLAN_STATUS_FAILURE);
 				LEAVE();
@@ -994,9 +1297,8 @@ static INLINE void wlan_send_processed_packet(pmlan_private priv,
 					       MNULL);
 
 			pmbuf->flags |= MLAN_BUF_FLAG_REQUEUED_PKT;
-			pmadapter->callbacks.moal_spin_unlock(
-				pmadapter->pmoal_handle,
-				priv->wmm.ra_list_spinlock);
+			wlan_wmm_update_ralist_ready(priv, ptr, ptrindex);
+			wlan_wmm_unlock_tid(priv, ptrindex);
 			break;
 		case MLAN_STATUS_FAILURE:
 			PRINTM(MERROR, "Error: Failed to write data\n");
@@ -1017,29 +1319,260 @@ static INLINE void wlan_send_processed_packet(pmlan_private priv,
 			break;
 		}
 		if (ret != MLAN_STATUS_RESOURCE) {
-			pmadapter->callbacks.moal_spin_lock(
-				pmadapter->pmoal_handle,
-				priv->wmm.ra_list_spinlock);
+			wlan_wmm_lock_tid(priv, ptrindex);
 			if (wlan_is_ralist_valid(priv, ptr, ptrindex)) {
 				priv->wmm.packets_out[ptrindex]++;
-				priv->wmm.tid_tbl_ptr[ptrindex].ra_list_curr =
-					ptr;
+				wlan_wmm_rotate_ralist_ready(priv, ptr,
+							     ptrindex, tx_len);
 				ptr->total_pkts--;
 			}
 			pmadapter->bssprio_tbl[priv->bss_priority].bssprio_cur =
 				pmadapter->bssprio_tbl[priv->bss_priority]
 					.bssprio_cur->pnext;
 			priv->wmm.pkts_queued[ptrindex]--;
-			util_scalar_decrement(pmadapter->pmoal_handle,
-					      &priv->wmm.tx_pkts_queued, MNULL,
-					      MNULL);
-			pmadapter->callbacks.moal_spin_unlock(
+			util_scalar_decrement(
 				pmadapter->pmoal_handle,
-				priv->wmm.ra_list_spinlock);
+				&priv->wmm.tx_pkts_queued,
+				pmadapter->callbacks.moal_spin_lock,
+				pmadapter->callbacks.moal_spin_unlock);
+			wlan_wmm_unlock_tid(priv, ptrindex);
 		}
 	} else {
-		pmadapter->callbacks.moal_spin_unlock(
-			pmadapter->pmoal_handle, priv->wmm.ra_list_spinlock);
+		wlan_wmm_unlock_tid(priv, ptrindex);
+	}
+}
+
+/**
+ *  @brief Integer square root
+ *
+ *  @param x        Input value
+ *
+ *  @return         floor(sqrt(x))
+ */
+static t_u32 wlan_wmm_codel_isqrt(t_u32 x)
+{
+	t_u32 res = 0;
+	t_u32 bit = (t_u32)1 << 30;
+
+	while (bit > x)
+		bit >>= 2;
+	while (bit) {
+		if (x >= res + bit) {
+			x -= res + bit;
+			res = (res >> 1) + bit;
+		} else {
+			res >>= 1;
+		}
+		bit >>= 2;
+	}
+	return res;
+}
+
+/**
+ *  @brief CoDel control law, time of the next drop
+ *
+ *  The square root is taken with 8 fractional bits, an integer root
+ *  would keep the interval at 100 ms for counts 2 and 3.
+ *
+ *  @param t        Time of the last drop, usec
+ *  @param count    Drops in the current dropping state
+ *
+ *  @return         Time of the next drop, usec
+ */
+static INLINE t_u32 wlan_wmm_codel_control_law(t_u32 t, t_u32 count)
+{
+	count = MIN(MAX(count, 1), 0xffff);
+	return t + (WMM_CODEL_INTERVAL << 8) /
+			   wlan_wmm_codel_isqrt(count << 16);
+}
+
+/**
+ *  @brief Set the ECN CE codepoint of an ECN capable IP packet
+ *
+ *  @param pmbuf    A pointer to mlan_buffer
+ *
+ *  @return         MTRUE if the packet is marked, otherwise MFALSE
+ */
+static t_u8 wlan_wmm_codel_set_ce(pmlan_buffer pmbuf)
+{
+	t_u8 *ip;
+	t_u16 eth_type;
+	t_u32 old_word;
+	t_u32 check;
+
+	/* Requeued packets already carry a TxPD */
+	if ((pmbuf->flags & MLAN_BUF_FLAG_REQUEUED_PKT) ||
+	    pmbuf->data_len < MLAN_ETHER_PKT_TYPE_OFFSET + 2 + 20)
+		return MFALSE;
+	ip = pmbuf->pbuf + pmbuf->data_offset + MLAN_ETHER_PKT_TYPE_OFFSET;
+	eth_type = mlan_ntohs(*(t_u16 *)ip);
+	ip += 2;
+	if (eth_type == MLAN_ETHER_PKT_TYPE_IP) {
+		/* ECN field is the low 2 bits of the TOS byte */
+		if (!(ip[1] & 0x03))
+			return MFALSE;
+		if ((ip[1] & 0x03) == 0x03)
+			return MTRUE;
+		old_word = (ip[0] << 8) | ip[1];
+		ip[1] |= 0x03;
+		/* Incremental header checksum update, RFC 1624 */
+		check = (~((ip[10] << 8) | ip[11]) & 0xffff) +
+			(~old_word & 0xffff) + ((ip[0] << 8) | ip[1]);
+		check = (check & 0xffff) + (check >> 16);
+		check = (check & 0xffff) + (check >> 16);
+		check = ~check & 0xffff;
+		ip[10] = (t_u8)(check >> 8);
+		ip[11] = (t_u8)check;
+		return MTRUE;
+	}
+	if (eth_type == MLAN_ETHER_PKT_TYPE_IPV6) {
+		/* ECN field is bits 4-5 of the second byte */
+		if (!(ip[1] & 0x30))
+			return MFALSE;
+		ip[1] |= 0x30;
+		return MTRUE;
+	}
+	return MFALSE;
+}
+
+/**
+ *  @brief Check the sojourn time of the head packet of a RA list
+ *
+ *  @param ra_list  A pointer to RA list table
+ *  @param pmbuf    A pointer to the head packet
+ *  @param now      Current time, usec
+ *
+ *  @return         MTRUE if the packet may be dropped, otherwise MFALSE
+ */
+static t_u8 wlan_wmm_codel_ok_to_drop(raListTbl *ra_list, pmlan_buffer pmbuf,
+				      t_u32 now)
+{
+	t_s32 sojourn;
+
+	sojourn = (t_s32)(now - (pmbuf->in_ts_sec * 1000000 +
+				 pmbuf->in_ts_usec));
+	if (!pmbuf->in_ts_sec || sojourn < WMM_CODEL_TARGET ||
+	    ra_list->total_pkts <= 1) {
+		ra_list->codel_first_above = 0;
+		return MFALSE;
+	}
+	if (!ra_list->codel_first_above) {
+		ra_list->codel_first_above = (now + WMM_CODEL_INTERVAL) | 1;
+		return MFALSE;
+	}
+	return ((t_s32)(now - ra_list->codel_first_above) >= 0) ? MTRUE :
+								  MFALSE;
+}
+
+/**
+ *  @brief Drop or ECN mark the head packet of a RA list
+ *
+ *  Caller must hold the ra_list_lock of the TID.
+ *
+ *  @param priv     A pointer to mlan_private
+ *  @param ra_list  A pointer to RA list table
+ *  @param tid      TID of the RA list
+ *  @param pmbuf    A pointer to the head packet
+ *
+ *  @return         MTRUE if the packet was marked and stays queued,
+ *                  MFALSE if it was dropped
+ */
+static t_u8 wlan_wmm_codel_drop(pmlan_private priv, raListTbl *ra_list,
+				int tid, pmlan_buffer pmbuf)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+
+	if (wlan_wmm_codel_set_ce(pmbuf)) {
+		ra_list->codel_marks++;
+		return MTRUE;
+	}
+	util_unlink_list(pmadapter->pmoal_handle, &ra_list->buf_head,
+			 (pmlan_linked_list)pmbuf, MNULL, MNULL);
+	priv->wmm.pkts_queued[tid]--;
+	util_scalar_decrement(pmadapter->pmoal_handle,
+			      &priv->wmm.tx_pkts_queued,
+			      pmadapter->callbacks.moal_spin_lock,
+			      pmadapter->callbacks.moal_spin_unlock);
+	ra_list->total_pkts--;
+	wlan_wmm_update_ralist_ready(priv, ra_list, tid);
+	ra_list->codel_drops++;
+	PRINTM(MDAT_D, "CoDel drop: tid=%d pkts=%d " MACSTR "\n", tid,
+	       ra_list->total_pkts, MAC2STR(ra_list->ra));
+	wlan_write_data_complete(pmadapter, pmbuf, MLAN_STATUS_FAILURE);
+	return MFALSE;
+}
+
+/**
+ *  @brief Apply CoDel to a RA list before packets are dequeued from it
+ *
+ *  Packets that stayed queued longer than the target for an interval
+ *  are dropped, or ECN marked when the flow is ECN capable, at the rate
+ *  given by the CoDel control law. Caller must hold the ra_list_lock
+ *  of the TID.
+ *
+ *  @param priv     A pointer to mlan_private
+ *  @param ra_list  A pointer to RA list table
+ *  @param tid      TID of the RA list
+ *
+ *  @return         N/A
+ */
+static t_void wlan_wmm_codel_dequeue(pmlan_private priv, raListTbl *ra_list,
+				     int tid)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+	pmlan_buffer pmbuf;
+	t_u32 sec = 0, usec = 0;
+	t_u32 now;
+	t_u32 delta;
+	t_u8 ok_to_drop;
+
+	pmbuf = (pmlan_buffer)util_peek_list(pmadapter->pmoal_handle,
+					     &ra_list->buf_head, MNULL, MNULL);
+	if (!pmbuf)
+		return;
+	pmadapter->callbacks.moal_get_system_time(pmadapter->pmoal_handle,
+						  &sec, &usec);
+	now = sec * 1000000 + usec;
+	ok_to_drop = wlan_wmm_codel_ok_to_drop(ra_list, pmbuf, now);
+	if (ra_list->codel_dropping) {
+		if (!ok_to_drop) {
+			ra_list->codel_dropping = MFALSE;
+			return;
+		}
+		while ((t_s32)(now - ra_list->codel_drop_next) >= 0) {
+			ra_list->codel_count++;
+			if (wlan_wmm_codel_drop(priv, ra_list, tid, pmbuf)) {
+				ra_list->codel_drop_next =
+					wlan_wmm_codel_control_law(
+						ra_list->codel_drop_next,
+						ra_list->codel_count);
+				return;
+			}
+			pmbuf = (pmlan_buffer)util_peek_list(
+				pmadapter->pmoal_handle, &ra_list->buf_head,
+				MNULL, MNULL);
+			if (!pmbuf ||
+			    !wlan_wmm_codel_ok_to_drop(ra_list, pmbuf, now)) {
+				ra_list->codel_dropping = MFALSE;
+				return;
+			}
+			ra_list->codel_drop_next = wlan_wmm_codel_control_law(
+				ra_list->codel_drop_next, ra_list->codel_count);
+		}
+	} else if (ok_to_drop) {
+		wlan_wmm_codel_drop(priv, ra_list, tid, pmbuf);
+		ra_list->codel_dropping = MTRUE;
+		/* Resume near the last drop rate if the queue went bad
+		 * again soon after leaving the dropping state */
+		delta = ra_list->codel_count - ra_list->codel_lastcount;
+		if (delta > 1 && (t_s32)(now - ra_list->codel_drop_next) <
+					 16 * WMM_CODEL_INTERVAL)
+			ra_list->codel_count = delta;
+		else
+			ra_list->codel_count = 1;
+		ra_list->codel_drop_next =
+			wlan_wmm_codel_control_law(now, ra_list->codel_count);
+		ra_list->codel_lastcount = ra_list->codel_count;
 	}
 }
 
@@ -1068,8 +1601,9 @@ static int wlan_dequeue_tx_packet(pmlan_adapter pmadapter)
 		return MLAN_STATUS_FAILURE;
 	}
 
-	/*  Note:- Spinlock is locked in wlan_wmm_get_highest_priolist_ptr
-	 *  when it returns a pointer (for the priv it returns),
+	/*  Note:- The ra_list_lock of ptrindex is locked in
+	 *  wlan_wmm_get_highest_priolist_ptr when it returns a pointer
+	 *  (for the priv it returns),
 	 *  and is unlocked in wlan_send_processed_packet,
 	 *  wlan_send_single_packet or wlan_11n_aggregate_pkt.
 	 *  The spinlock would be required for some parts of both of function.
@@ -1081,7 +1615,7 @@ static int wlan_dequeue_tx_packet(pmlan_adapter pmadapter)
 
 	/* Note:- Also, anybody adding code which does not get into
 	 * wlan_send_processed_packet, wlan_send_single_packet, or
-	 * wlan_11n_aggregate_pkt should make sure ra_list_spinlock
+	 * wlan_11n_aggregate_pkt should make sure ra_list_lock
 	 * is freed. Otherwise there would be a lock up. */
 
 	tid = wlan_get_tid(priv->adapter, ptr);
@@ -1108,13 +1642,15 @@ static int wlan_dequeue_tx_packet(pmlan_adapter pmadapter)
 				PRINTM(MERROR, "Dequeuing the packet %p %p\n",
 				       ptr, pmbuf);
 				priv->wmm.pkts_queued[ptrindex]--;
-				util_scalar_decrement(pmadapter->pmoal_handle,
-						      &priv->wmm.tx_pkts_queued,
-						      MNULL, MNULL);
-				ptr->total_pkts--;
-				pmadapter->callbacks.moal_spin_unlock(
+				util_scalar_decrement(
 					pmadapter->pmoal_handle,
-					priv->wmm.ra_list_spinlock);
+					&priv->wmm.tx_pkts_queued,
+					pmadapter->callbacks.moal_spin_lock,
+					pmadapter->callbacks.moal_spin_unlock);
+				ptr->total_pkts--;
+				wlan_wmm_update_ralist_ready(priv, ptr,
+							     ptrindex);
+				wlan_wmm_unlock_tid(priv, ptrindex);
 				wlan_write_data_complete(pmadapter, pmbuf,
 							 MLAN_STATUS_SUCCESS);
 				LEAVE();
@@ -1122,6 +1658,8 @@ static int wlan_dequeue_tx_packet(pmlan_adapter pmadapter)
 			}
 		}
 	}
+	if (pmadapter->tx_codel)
+		wlan_wmm_codel_dequeue(priv, ptr, ptrindex);
 	if (!ptr->is_wmm_enabled || priv->adapter->remain_on_channel ||
 	    (ptr->ba_status || ptr->del_ba_count >= DEL_BA_THRESHOLD)
 #ifdef STA_SUPPORT
@@ -1131,7 +1669,8 @@ static int wlan_dequeue_tx_packet(pmlan_adapter pmadapter)
 		if (ptr->is_wmm_enabled && ptr->ba_status &&
 		    ptr->amsdu_in_ampdu &&
 		    wlan_is_amsdu_allowed(priv, ptr, tid) &&
-		    (wlan_num_pkts_in_txq(priv, ptr, pmadapter->tx_buf_size) >=
+		    (wlan_num_pkts_in_txq(
+			     priv, ptr, wlan_11n_amsdu_size(pmadapter, ptr)) >=
 		     MIN_NUM_AMSDU)) {
 			wlan_11n_aggregate_pkt(priv, ptr, priv->intf_hr_len,
 					       ptrindex);
@@ -1140,6 +1679,8 @@ static int wlan_dequeue_tx_packet(pmlan_adapter pmadapter)
 	} else {
 		if (wlan_is_ampdu_allowed(priv, ptr, tid) &&
 		    (ptr->packet_count > ptr->ba_packet_threshold)) {
+			/* tx BA stream table is under ra_list_spinlock */
+			wlan_request_ralist_lock(priv);
 			if (wlan_is_bastream_avail(priv)) {
 				PRINTM(MINFO,
 				       "BA setup threshold %d reached. tid=%d\n",
@@ -1167,9 +1708,11 @@ static int wlan_dequeue_tx_packet(pmlan_adapter pmadapter)
 							ra, 1);
 				}
 			}
+			wlan_release_ralist_lock(priv);
 		}
 		if (wlan_is_amsdu_allowed(priv, ptr, tid) &&
-		    (wlan_num_pkts_in_txq(priv, ptr, pmadapter->tx_buf_size) >=
+		    (wlan_num_pkts_in_txq(
+			     priv, ptr, wlan_11n_amsdu_size(pmadapter, ptr)) >=
 		     MIN_NUM_AMSDU)) {
 			wlan_11n_aggregate_pkt(priv, ptr, priv->intf_hr_len,
 					       ptrindex);
@@ -1197,14 +1740,14 @@ t_u16 wlan_update_ralist_tx_pause(pmlan_private priv, t_u8 *mac, t_u8 tx_pause)
 	raListTbl *ra_list;
 	int i;
 	pmlan_adapter pmadapter = priv->adapter;
+	ralist_peer *peer;
 	t_u32 pkt_cnt = 0;
-	t_u32 tx_pkts_queued = 0;
 	ENTER();
 
-	pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
-					    priv->wmm.ra_list_spinlock);
-	for (i = 0; i < MAX_NUM_TID; ++i) {
-		ra_list = wlan_wmm_get_ralist_node(priv, i, mac);
+	wlan_wmm_lock_all(priv);
+	peer = wlan_wmm_find_ralist_peer(priv, mac);
+	for (i = 0; peer && i < MAX_NUM_TID; ++i) {
+		ra_list = peer->ra_list[i];
 		if (ra_list && ra_list->tx_pause != tx_pause) {
 			pkt_cnt += ra_list->total_pkts;
 			ra_list->tx_pause = tx_pause;
@@ -1212,25 +1755,22 @@ t_u16 wlan_update_ralist_tx_pause(pmlan_private priv, t_u8 *mac, t_u8 tx_pause)
 				priv->wmm.pkts_paused[i] += ra_list->total_pkts;
 			else
 				priv->wmm.pkts_paused[i] -= ra_list->total_pkts;
+			wlan_wmm_update_ralist_ready(priv, ra_list, i);
 		}
 	}
 	if (pkt_cnt) {
-		tx_pkts_queued = util_scalar_read(pmadapter->pmoal_handle,
-						  &priv->wmm.tx_pkts_queued,
-						  MNULL, MNULL);
-		if (tx_pause)
-			tx_pkts_queued -= pkt_cnt;
-		else
-			tx_pkts_queued += pkt_cnt;
-		util_scalar_write(priv->adapter->pmoal_handle,
-				  &priv->wmm.tx_pkts_queued, tx_pkts_queued,
-				  MNULL, MNULL);
+		/* The count is shared by all TIDs, update it under its lock */
+		util_scalar_offset(pmadapter->pmoal_handle,
+				   &priv->wmm.tx_pkts_queued,
+				   tx_pause ? -(t_s32)pkt_cnt : (t_s32)pkt_cnt,
+				   pmadapter->callbacks.moal_spin_lock,
+				   pmadapter->callbacks.moal_spin_unlock);
 		util_scalar_write(priv->adapter->pmoal_handle,
 				  &priv->wmm.highest_queued_prio, HIGH_PRIO_TID,
-				  MNULL, MNULL);
+				  pmadapter->callbacks.moal_spin_lock,
+				  pmadapter->callbacks.moal_spin_unlock);
 	}
-	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
-					      priv->wmm.ra_list_spinlock);
+	wlan_wmm_unlock_all(priv);
 	LEAVE();
 	return pkt_cnt;
 }
@@ -1251,11 +1791,9 @@ t_void wlan_update_non_tdls_ralist(mlan_private *priv, t_u8 *mac, t_u8 tx_pause)
 	int i;
 	pmlan_adapter pmadapter = priv->adapter;
 	t_u32 pkt_cnt = 0;
-	t_u32 tx_pkts_queued = 0;
 	ENTER();
 
-	pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
-					    priv->wmm.ra_list_spinlock);
+	wlan_wmm_lock_all(priv);
 	for (i = 0; i < MAX_NUM_TID; ++i) {
 		ra_list = (raListTbl *)util_peek_list(
 			priv->adapter->pmoal_handle,
@@ -1274,166 +1812,342 @@ t_void wlan_update_non_tdls_ralist(mlan_private *priv, t_u8 *mac, t_u8 tx_pause)
 				else
 					priv->wmm.pkts_paused[i] -=
 						ra_list->total_pkts;
+				wlan_wmm_update_ralist_ready(priv, ra_list, i);
 			}
 			ra_list = ra_list->pnext;
 		}
 	}
 	if (pkt_cnt) {
-		tx_pkts_queued = util_scalar_read(pmadapter->pmoal_handle,
-						  &priv->wmm.tx_pkts_queued,
-						  MNULL, MNULL);
-		if (tx_pause)
-			tx_pkts_queued -= pkt_cnt;
-		else
-			tx_pkts_queued += pkt_cnt;
-		util_scalar_write(priv->adapter->pmoal_handle,
-				  &priv->wmm.tx_pkts_queued, tx_pkts_queued,
-				  MNULL, MNULL);
+		/* The count is shared by all TIDs, update it under its lock */
+		util_scalar_offset(pmadapter->pmoal_handle,
+				   &priv->wmm.tx_pkts_queued,
+				   tx_pause ? -(t_s32)pkt_cnt : (t_s32)pkt_cnt,
+				   pmadapter->callbacks.moal_spin_lock,
+				   pmadapter->callbacks.moal_spin_unlock);
 		util_scalar_write(priv->adapter->pmoal_handle,
 				  &priv->wmm.highest_queued_prio, HIGH_PRIO_TID,
-				  MNULL, MNULL);
+				  pmadapter->callbacks.moal_spin_lock,
+				  pmadapter->callbacks.moal_spin_unlock);
+	}
+	wlan_wmm_unlock_all(priv);
+	LEAVE();
+	return;
+}
+
+/**
+ *  @brief Remove TDLS ralist and move packets to AP's ralist
+ *
+ *  @param priv		  A pointer to mlan_private
+ *  @param mac        TDLS peer mac address
+ *
+ *  @return           N/A
+ */
+static t_void wlan_wmm_delete_tdls_ralist(pmlan_private priv, t_u8 *mac)
+{
+	raListTbl *ra_list;
+	raListTbl *ra_list_ap = MNULL;
+	ralist_peer *peer;
+	int i;
+	pmlan_adapter pmadapter = priv->adapter;
+	pmlan_buffer pmbuf;
+	ENTER();
+
+	peer = wlan_wmm_find_ralist_peer(priv, mac);
+	if (!peer) {
+		LEAVE();
+		return;
+	}
+	for (i = 0; i < MAX_NUM_TID; ++i) {
+		ra_list = peer->ra_list[i];
+		if (ra_list) {
+			PRINTM(MDATA, "delete TDLS ralist %p\n", ra_list);
+			ra_list_ap = (raListTbl *)util_peek_list(
+				pmadapter->pmoal_handle,
+				&priv->wmm.tid_tbl_ptr[i].ra_list, MNULL,
+				MNULL);
+			if (!ra_list_ap) {
+				LEAVE();
+				return;
+			}
+			while ((pmbuf = (pmlan_buffer)util_peek_list(
+					pmadapter->pmoal_handle,
+					&ra_list->buf_head, MNULL, MNULL))) {
+				util_unlink_list(pmadapter->pmoal_handle,
+						 &ra_list->buf_head,
+						 (pmlan_linked_list)pmbuf,
+						 MNULL, MNULL);
+				util_enqueue_list_tail(pmadapter->pmoal_handle,
+						       &ra_list_ap->buf_head,
+						       (pmlan_linked_list)pmbuf,
+						       MNULL, MNULL);
+				ra_list_ap->total_pkts++;
+				ra_list_ap->packet_count++;
+			}
+			wlan_wmm_update_ralist_ready(priv, ra_list, i);
+			wlan_wmm_update_ralist_ready(priv, ra_list_ap, i);
+			util_free_list_head(
+				(t_void *)pmadapter->pmoal_handle,
+				&ra_list->buf_head,
+				pmadapter->callbacks.moal_free_lock);
+
+			util_unlink_list(pmadapter->pmoal_handle,
+					 &priv->wmm.tid_tbl_ptr[i].ra_list,
+					 (pmlan_linked_list)ra_list, MNULL,
+					 MNULL);
+			pmadapter->callbacks.moal_mfree(pmadapter->pmoal_handle,
+							(t_u8 *)ra_list);
+			peer->ra_list[i] = MNULL;
+		}
+	}
+	wlan_wmm_free_ralist_peer(priv, peer);
+
+	LEAVE();
+}
+#endif /* STA_SUPPORT */
+/********************************************************
+			Global Functions
+********************************************************/
+
+/**
+ *  @brief Take all the TX queue locks of an interface
+ *
+ *  The TX queue of an interface is protected by one ra_list_lock per TID.
+ *  Enqueue and dequeue hold only the lock of the TID they work on, while
+ *  adding or removing RA lists holds all of them plus ra_list_spinlock.
+ *  Locks are taken in this order and released in reverse:
+ *    ra_list_lock of TID 0 .. MAX_NUM_TID - 1, ra_list_spinlock
+ *  ready_lock is not taken here. It protects tx_ready_map and is the lock
+ *  of the tx_pkts_queued and highest_queued_prio scalars, it is only held
+ *  around those updates and always taken last.
+ *
+ *  @param priv     A pointer to mlan_private
+ *
+ *  @return         N/A
+ */
+t_void wlan_wmm_lock_all(pmlan_private priv)
+{
+	int i;
+
+	for (i = 0; i < MAX_NUM_TID; i++)
+		wlan_wmm_lock_tid(priv, i);
+	wlan_request_ralist_lock(priv);
+}
+
+/**
+ *  @brief Release the locks taken by wlan_wmm_lock_all
+ *
+ *  @param priv     A pointer to mlan_private
+ *
+ *  @return         N/A
+ */
+t_void wlan_wmm_unlock_all(pmlan_private priv)
+{
+	int i;
+
+	wlan_release_ralist_lock(priv);
+	for (i = MAX_NUM_TID - 1; i >= 0; i--)
+		wlan_wmm_unlock_tid(priv, i);
+}
+
+/**
+ *  @brief Sync the ready list membership of a RA list with its queue state
+ *
+ *  A RA list is ready when it has packets queued and is not paused. Ready
+ *  RA lists are linked on the TID ready list and the TID bit is set in
+ *  tx_ready_map, so the dequeue path never walks idle RA lists.
+ *  Caller must hold the ra_list_lock of the TID.
+ *
+ *  @param priv     A pointer to mlan_private
+ *  @param ra_list  A pointer to RA list table
+ *  @param tid      TID of the RA list
+ *
+ *  @return         N/A
+ */
+t_void wlan_wmm_update_ralist_ready(pmlan_private priv, raListTbl *ra_list,
+				    int tid)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+	tid_tbl_t *tid_ptr = &priv->wmm.tid_tbl_ptr[tid];
+	t_u8 ready = MFALSE;
+	t_u8 map_bit;
+
+	if (!ra_list->tx_pause &&
+	    util_peek_list(pmadapter->pmoal_handle, &ra_list->buf_head, MNULL,
+			   MNULL))
+		ready = MTRUE;
+
+	/* ready_node.pnext is MNULL while the node is not linked */
+	if (ready && !ra_list->ready_node.pnext) {
+		util_enqueue_list_tail(pmadapter->pmoal_handle,
+				       &tid_ptr->ready_list,
+				       (pmlan_linked_list)&ra_list->ready_node,
+				       MNULL, MNULL);
+	} else if (!ready && ra_list->ready_node.pnext) {
+		util_unlink_list(pmadapter->pmoal_handle, &tid_ptr->ready_list,
+				 (pmlan_linked_list)&ra_list->ready_node, MNULL,
+				 MNULL);
+		/* An idle RA list keeps its debt but does not bank airtime */
+		if (ra_list->airtime_deficit > 0)
+			ra_list->airtime_deficit = 0;
+	}
+
+	map_bit = 0;
+	if (util_peek_list(pmadapter->pmoal_handle, &tid_ptr->ready_list,
+			   MNULL, MNULL))
+		map_bit = MBIT(tid);
+	/* Only the ra_list_lock holder of this TID flips its bit, the map
+	 * itself is shared by all TIDs of the interface */
+	if ((pmadapter->tx_ready_map[priv->bss_index] & MBIT(tid)) != map_bit) {
+		pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
+						    priv->wmm.ready_lock);
+		pmadapter->tx_ready_map[priv->bss_index] ^= MBIT(tid);
+		pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
+						      priv->wmm.ready_lock);
+	}
+}
+
+/**
+ *  @brief Move a served RA list behind the other ready RA lists of its TID
+ *
+ *  With airtime fairness the airtime needed for the sent bytes is charged
+ *  to the RA list, which keeps its turn until the deficit is used up.
+ *  Caller must hold the ra_list_lock of the TID.
+ *
+ *  @param priv     A pointer to mlan_private
+ *  @param ra_list  A pointer to RA list table
+ *  @param tid      TID of the RA list
+ *  @param len      Number of bytes sent from the RA list
+ *
+ *  @return         N/A
+ */
+t_void wlan_wmm_rotate_ralist_ready(pmlan_private priv, raListTbl *ra_list,
+				    int tid, t_u32 len)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+	tid_tbl_t *tid_ptr = &priv->wmm.tid_tbl_ptr[tid];
+	t_u32 rate;
+
+	if (!ra_list->ready_node.pnext)
+		return;
+	if (pmadapter->airtime_fair) {
+		rate = ra_list->airtime_rate ? ra_list->airtime_rate :
+					       WMM_AIRTIME_DEF_RATE;
+		/* len * 8 bits / (rate * 0.5 Mbps) gives usec */
+		ra_list->airtime_deficit -= (t_s32)(len * 16 / rate);
+		if (ra_list->airtime_deficit > 0)
+			return;
 	}
-	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
-					      priv->wmm.ra_list_spinlock);
-	LEAVE();
-	return;
+	util_unlink_list(pmadapter->pmoal_handle, &tid_ptr->ready_list,
+			 (pmlan_linked_list)&ra_list->ready_node, MNULL, MNULL);
+	util_enqueue_list_tail(pmadapter->pmoal_handle, &tid_ptr->ready_list,
+			       (pmlan_linked_list)&ra_list->ready_node, MNULL,
+			       MNULL);
 }
 
 /**
- *  @brief find tdls buffer from ralist
+ *  @brief Update the data rate used for airtime accounting of RA lists
  *
- *  @param priv		  A pointer to mlan_private
- *  @param ralist     A pointer to ralistTbl
- *  @param mac        TDLS peer mac address
+ *  @param priv     A pointer to mlan_private
+ *  @param ra       RA of the RA lists, MNULL to update all RA lists
+ *  @param rate     Data rate in 500 Kbps units
  *
- *  @return           pmlan_buffer or MNULL
+ *  @return         N/A
  */
-static pmlan_buffer wlan_find_tdls_packets(mlan_private *priv,
-					   raListTbl *ra_list, t_u8 *mac)
+t_void wlan_wmm_update_ralist_rate(pmlan_private priv, t_u8 *ra, t_u16 rate)
 {
-	pmlan_buffer pmbuf = MNULL;
-	mlan_adapter *pmadapter = priv->adapter;
-	t_u8 ra[MLAN_MAC_ADDR_LENGTH];
+	pmlan_adapter pmadapter = priv->adapter;
+	raListTbl *ra_list;
+	int i;
+
 	ENTER();
-	pmbuf = (pmlan_buffer)util_peek_list(priv->adapter->pmoal_handle,
-					     &ra_list->buf_head, MNULL, MNULL);
-	if (!pmbuf) {
+	if (!rate) {
 		LEAVE();
-		return MNULL;
+		return;
 	}
-	while (pmbuf != (pmlan_buffer)&ra_list->buf_head) {
-		memcpy_ext(pmadapter, ra, pmbuf->pbuf + pmbuf->data_offset,
-			   MLAN_MAC_ADDR_LENGTH, MLAN_MAC_ADDR_LENGTH);
-		if (!memcmp(priv->adapter, ra, mac, MLAN_MAC_ADDR_LENGTH)) {
-			LEAVE();
-			return pmbuf;
+	for (i = 0; i < MAX_NUM_TID; ++i) {
+		wlan_wmm_lock_tid(priv, i);
+		if (ra) {
+			ra_list = wlan_wmm_get_ralist_node(priv, i, ra);
+			if (ra_list) {
+				ra_list->airtime_rate = rate;
+				if (pmadapter->amsdu_adapt)
+					wlan_11n_update_amsdu_size(priv,
+								   ra_list);
+			}
+			wlan_wmm_unlock_tid(priv, i);
+			continue;
+		}
+		ra_list = (raListTbl *)util_peek_list(
+			pmadapter->pmoal_handle,
+			&priv->wmm.tid_tbl_ptr[i].ra_list, MNULL, MNULL);
+		while (ra_list &&
+		       ra_list != (raListTbl *)&priv->wmm.tid_tbl_ptr[i]
+					  .ra_list) {
+			ra_list->airtime_rate = rate;
+			if (pmadapter->amsdu_adapt)
+				wlan_11n_update_amsdu_size(priv, ra_list);
+			ra_list = ra_list->pnext;
 		}
-		pmbuf = pmbuf->pnext;
+		wlan_wmm_unlock_tid(priv, i);
 	}
 	LEAVE();
-	return MNULL;
 }
 
 /**
- *  @brief find tdls buffer from tdls pending queue
+ *  @brief Check if the TX rate of an interface is the rate of all its
+ *         RA lists
  *
- *  @param priv		  A pointer to mlan_private
- *  @param mac        TDLS peer mac address
+ *  This holds for a STA, which sends all its data through the AP, and
+ *  for a uAP with a single associated station. A uAP with several
+ *  stations only gets one TX rate for all of them, its RA lists keep
+ *  the RX rate of their station as the estimate.
  *
- *  @return           pmlan_buffer or MNULL
+ *  @param priv     A pointer to mlan_private
+ *
+ *  @return         MTRUE or MFALSE
  */
-static pmlan_buffer wlan_find_packets_tdls_txq(mlan_private *priv, t_u8 *mac)
+t_u8 wlan_wmm_tx_rate_for_all_ra(pmlan_private priv)
 {
-	pmlan_buffer pmbuf = MNULL;
-	mlan_adapter *pmadapter = priv->adapter;
-	t_u8 ra[MLAN_MAC_ADDR_LENGTH];
-	ENTER();
-	pmbuf = (pmlan_buffer)util_peek_list(priv->adapter->pmoal_handle,
-					     &priv->tdls_pending_txq, MNULL,
-					     MNULL);
-	if (!pmbuf) {
-		LEAVE();
-		return MNULL;
-	}
-	while (pmbuf != (pmlan_buffer)&priv->tdls_pending_txq) {
-		memcpy_ext(pmadapter, ra, pmbuf->pbuf + pmbuf->data_offset,
-			   MLAN_MAC_ADDR_LENGTH, MLAN_MAC_ADDR_LENGTH);
-		if (!memcmp(priv->adapter, ra, mac, MLAN_MAC_ADDR_LENGTH)) {
-			LEAVE();
-			return pmbuf;
-		}
-		pmbuf = pmbuf->pnext;
-	}
-	LEAVE();
-	return MNULL;
+	sta_node *sta_ptr;
+
+	if (!queuing_ra_based(priv))
+		return MTRUE;
+	sta_ptr = (sta_node *)util_peek_list(priv->adapter->pmoal_handle,
+					     &priv->sta_list, MNULL, MNULL);
+	return (sta_ptr && sta_ptr->pnext == (sta_node *)&priv->sta_list) ?
+		       MTRUE :
+		       MFALSE;
 }
 
 /**
- *  @brief Remove TDLS ralist and move packets to AP's ralist
+ *  @brief Update the adaptive AMSDU size of all RA lists
  *
- *  @param priv		  A pointer to mlan_private
- *  @param mac        TDLS peer mac address
+ *  @param priv     A pointer to mlan_private
  *
- *  @return           N/A
+ *  @return         N/A
  */
-static t_void wlan_wmm_delete_tdls_ralist(pmlan_private priv, t_u8 *mac)
+t_void wlan_wmm_update_ralist_amsdu(pmlan_private priv)
 {
+	pmlan_adapter pmadapter = priv->adapter;
 	raListTbl *ra_list;
-	raListTbl *ra_list_ap = MNULL;
 	int i;
-	pmlan_adapter pmadapter = priv->adapter;
-	pmlan_buffer pmbuf;
-	ENTER();
 
+	ENTER();
 	for (i = 0; i < MAX_NUM_TID; ++i) {
-		ra_list = wlan_wmm_get_ralist_node(priv, i, mac);
-		if (ra_list) {
-			PRINTM(MDATA, "delete TDLS ralist %p\n", ra_list);
-			ra_list_ap = (raListTbl *)util_peek_list(
-				pmadapter->pmoal_handle,
-				&priv->wmm.tid_tbl_ptr[i].ra_list, MNULL,
-				MNULL);
-			if (!ra_list_ap) {
-				LEAVE();
-				return;
-			}
-			while ((pmbuf = (pmlan_buffer)util_peek_list(
-					pmadapter->pmoal_handle,
-					&ra_list->buf_head, MNULL, MNULL))) {
-				util_unlink_list(pmadapter->pmoal_handle,
-						 &ra_list->buf_head,
-						 (pmlan_linked_list)pmbuf,
-						 MNULL, MNULL);
-				util_enqueue_list_tail(pmadapter->pmoal_handle,
-						       &ra_list_ap->buf_head,
-						       (pmlan_linked_list)pmbuf,
-						       MNULL, MNULL);
-				ra_list_ap->total_pkts++;
-				ra_list_ap->packet_count++;
-			}
-			util_free_list_head(
-				(t_void *)pmadapter->pmoal_handle,
-				&ra_list->buf_head,
-				pmadapter->callbacks.moal_free_lock);
-
-			util_unlink_list(pmadapter->pmoal_handle,
-					 &priv->wmm.tid_tbl_ptr[i].ra_list,
-					 (pmlan_linked_list)ra_list, MNULL,
-					 MNULL);
-			pmadapter->callbacks.moal_mfree(pmadapter->pmoal_handle,
-							(t_u8 *)ra_list);
-			if (priv->wmm.tid_tbl_ptr[i].ra_list_curr == ra_list)
-				priv->wmm.tid_tbl_ptr[i].ra_list_curr =
-					ra_list_ap;
+		wlan_wmm_lock_tid(priv, i);
+		ra_list = (raListTbl *)util_peek_list(
+			pmadapter->pmoal_handle,
+			&priv->wmm.tid_tbl_ptr[i].ra_list, MNULL, MNULL);
+		while (ra_list &&
+		       ra_list != (raListTbl *)&priv->wmm.tid_tbl_ptr[i]
+					  .ra_list) {
+			wlan_11n_update_amsdu_size(priv, ra_list);
+			ra_list = ra_list->pnext;
 		}
+		wlan_wmm_unlock_tid(priv, i);
 	}
-
 	LEAVE();
 }
-#endif /* STA_SUPPORT */
-/********************************************************
-			Global Functions
-********************************************************/
 
 /**
  *  @brief Get the threshold value for BA setup using system time.
@@ -1498,8 +2212,7 @@ t_void wlan_clean_txrx(pmlan_private priv)
 	if (IS_PCIE(pmadapter->card_type))
 		wlan_clean_pcie_ring_buf(priv->adapter);
 #endif
-	pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
-					    priv->wmm.ra_list_spinlock);
+	wlan_wmm_lock_all(priv);
 	wlan_wmm_cleanup_queues(priv);
 	wlan_wmm_delete_all_ralist(priv);
 	memcpy_ext(pmadapter, tos_to_tid, ac_to_tid, sizeof(tos_to_tid),
@@ -1519,8 +2232,7 @@ t_void wlan_clean_txrx(pmlan_private priv)
 		       sizeof(pmadapter->pcard_sd->mpa_rx_count));
 	}
 #endif
-	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
-					      priv->wmm.ra_list_spinlock);
+	wlan_wmm_unlock_all(priv);
 
 	LEAVE();
 }
@@ -1711,12 +2423,32 @@ void wlan_ralist_add(mlan_private *priv, t_u8 *ra)
 {
 	int i;
 	raListTbl *ra_list;
+	ralist_peer *peer;
 	pmlan_adapter pmadapter = priv->adapter;
 	tdlsStatus_e status;
 
 	ENTER();
 
+	peer = wlan_wmm_find_ralist_peer(priv, ra);
+	if (!peer) {
+		if (pmadapter->callbacks.moal_malloc(
+			    pmadapter->pmoal_handle, sizeof(ralist_peer),
+			    MLAN_MEM_DEF, (t_u8 **)&peer)) {
+			PRINTM(MERROR, "Fail to allocate ralist peer\n");
+			LEAVE();
+			return;
+		}
+		memset(pmadapter, peer, 0, sizeof(ralist_peer));
+		memcpy_ext(pmadapter, peer->ra, ra, MLAN_MAC_ADDR_LENGTH,
+			   MLAN_MAC_ADDR_LENGTH);
+		util_enqueue_list_tail(pmadapter->pmoal_handle,
+				       &priv->wmm.ra_hash[WMM_RA_HASH(ra)],
+				       (pmlan_linked_list)peer, MNULL, MNULL);
+	}
 	for (i = 0; i < MAX_NUM_TID; ++i) {
+		/* Keep the RA lists the peer already has */
+		if (peer->ra_list[i])
+			continue;
 		ra_list = wlan_wmm_allocate_ralist_node(pmadapter, ra);
 		PRINTM(MINFO, "Creating RA List %p for tid %d\n", ra_list, i);
 		if (!ra_list)
@@ -1724,6 +2456,8 @@ void wlan_ralist_add(mlan_private *priv, t_u8 *ra)
 		ra_list->max_amsdu = 0;
 		ra_list->ba_status = BA_STREAM_NOT_SETUP;
 		ra_list->amsdu_in_ampdu = MFALSE;
+		if (pmadapter->amsdu_adapt)
+			wlan_11n_update_amsdu_size(priv, ra_list);
 		if (queuing_ra_based(priv)) {
 			ra_list->is_wmm_enabled = wlan_is_wmm_enabled(priv, ra);
 			if (ra_list->is_wmm_enabled)
@@ -1763,9 +2497,7 @@ void wlan_ralist_add(mlan_private *priv, t_u8 *ra)
 				       &priv->wmm.tid_tbl_ptr[i].ra_list,
 				       (pmlan_linked_list)ra_list, MNULL,
 				       MNULL);
-
-		if (!priv->wmm.tid_tbl_ptr[i].ra_list_curr)
-			priv->wmm.tid_tbl_ptr[i].ra_list_curr = ra_list;
+		peer->ra_list[i] = ra_list;
 	}
 
 	LEAVE();
@@ -1829,6 +2561,21 @@ t_void wlan_wmm_init(pmlan_adapter pmadapter)
 
 	ENTER();
 
+	pmadapter->airtime_fair = pmadapter->init_para.airtime_fair;
+	if (pmadapter->airtime_fair)
+		PRINTM(MMSG, "wmm: airtime fair TX scheduling enabled\n");
+	pmadapter->tx_burst =
+		MIN(pmadapter->init_para.tx_burst, WMM_TX_BURST_MAX);
+	if (pmadapter->tx_burst > 1)
+		PRINTM(MMSG, "wmm: TX burst of %d packets\n",
+		       pmadapter->tx_burst);
+	pmadapter->tx_codel = pmadapter->init_para.tx_codel;
+	if (pmadapter->tx_codel)
+		PRINTM(MMSG, "wmm: CoDel queue management enabled\n");
+	pmadapter->amsdu_sg = pmadapter->init_para.amsdu_sg;
+	pmadapter->amsdu_adapt = pmadapter->init_para.amsdu_adapt;
+	if (pmadapter->amsdu_adapt)
+		PRINTM(MMSG, "wmm: adaptive AMSDU size enabled\n");
 	for (j = 0; j < pmadapter->priv_num; ++j) {
 		priv = pmadapter->priv[j];
 		if (priv) {
@@ -1840,7 +2587,6 @@ t_void wlan_wmm_init(pmlan_adapter pmadapter)
 						tos_to_tid_inv[i];
 				priv->wmm.pkts_queued[i] = 0;
 				priv->wmm.pkts_paused[i] = 0;
-				priv->wmm.tid_tbl_ptr[i].ra_list_curr = MNULL;
 			}
 			priv->wmm.drv_pkt_delay_max = WMM_DRV_DELAY_MAX;
 
@@ -1966,11 +2712,7 @@ int wlan_wmm_lists_empty(pmlan_adapter pmadapter)
 				continue;
 #endif
 
-			if (util_scalar_read(
-				    pmadapter->pmoal_handle,
-				    &priv->wmm.tx_pkts_queued,
-				    pmadapter->callbacks.moal_spin_lock,
-				    pmadapter->callbacks.moal_spin_unlock)) {
+			if (pmadapter->tx_ready_map[priv->bss_index]) {
 				LEAVE();
 				return MFALSE;
 			}
@@ -1992,23 +2734,11 @@ int wlan_wmm_lists_empty(pmlan_adapter pmadapter)
  */
 raListTbl *wlan_wmm_get_ralist_node(pmlan_private priv, t_u8 tid, t_u8 *ra_addr)
 {
-	raListTbl *ra_list;
+	ralist_peer *peer;
 	ENTER();
-	ra_list =
-		(raListTbl *)util_peek_list(priv->adapter->pmoal_handle,
-					    &priv->wmm.tid_tbl_ptr[tid].ra_list,
-					    MNULL, MNULL);
-	while (ra_list &&
-	       (ra_list != (raListTbl *)&priv->wmm.tid_tbl_ptr[tid].ra_list)) {
-		if (!memcmp(priv->adapter, ra_list->ra, ra_addr,
-			    MLAN_MAC_ADDR_LENGTH)) {
-			LEAVE();
-			return ra_list;
-		}
-		ra_list = ra_list->pnext;
-	}
+	peer = wlan_wmm_find_ralist_peer(priv, ra_addr);
 	LEAVE();
-	return MNULL;
+	return peer ? peer->ra_list[tid] : MNULL;
 }
 
 /**
@@ -2044,6 +2774,65 @@ int wlan_is_ralist_valid(mlan_private *priv, raListTbl *ra_list, int ptrindex)
 	return MFALSE;
 }
 
+/**
+ *  @brief Drop the packets of a RA list, unlink it from its TID and
+ *         free it
+ *
+ *  Caller must hold all the TX queue locks, see wlan_wmm_lock_all, and
+ *  account the returned packets with wlan_wmm_sub_tx_pkts_queued.
+ *
+ *  @param priv		A pointer to mlan_private
+ *  @param ra_list	A pointer to RA list table
+ *  @param tid		TID of the RA list
+ *
+ *  @return		Number of dropped packets that were not paused
+ */
+static t_u32 wlan_wmm_free_ralist_node(pmlan_private priv,
+				       raListTbl *ra_list, int tid)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+	t_u32 pkt_cnt = 0;
+
+	PRINTM(MINFO, "delete sta ralist %p\n", ra_list);
+	priv->wmm.pkts_queued[tid] -= ra_list->total_pkts;
+	if (ra_list->tx_pause)
+		priv->wmm.pkts_paused[tid] -= ra_list->total_pkts;
+	else
+		pkt_cnt = ra_list->total_pkts;
+	wlan_wmm_del_pkts_in_ralist_node(priv, ra_list);
+	wlan_wmm_update_ralist_ready(priv, ra_list, tid);
+
+	util_unlink_list(pmadapter->pmoal_handle,
+			 &priv->wmm.tid_tbl_ptr[tid].ra_list,
+			 (pmlan_linked_list)ra_list, MNULL, MNULL);
+	pmadapter->callbacks.moal_mfree(pmadapter->pmoal_handle,
+					(t_u8 *)ra_list);
+	return pkt_cnt;
+}
+
+/**
+ *  @brief Take dropped packets off the queued TX packet count
+ *
+ *  @param priv		A pointer to mlan_private
+ *  @param pkt_cnt	Number of dropped packets
+ *
+ *  @return		N/A
+ */
+static t_void wlan_wmm_sub_tx_pkts_queued(pmlan_private priv, t_u32 pkt_cnt)
+{
+	pmlan_adapter pmadapter = priv->adapter;
+
+	if (!pkt_cnt)
+		return;
+	util_scalar_offset(pmadapter->pmoal_handle, &priv->wmm.tx_pkts_queued,
+			   -(t_s32)pkt_cnt, pmadapter->callbacks.moal_spin_lock,
+			   pmadapter->callbacks.moal_spin_unlock);
+	util_scalar_write(pmadapter->pmoal_handle,
+			  &priv->wmm.highest_queued_prio, HIGH_PRIO_TID,
+			  pmadapter->callbacks.moal_spin_lock,
+			  pmadapter->callbacks.moal_spin_unlock);
+}
+
 /**
  *  @brief  Update an existing raList with a new RA and 11n capability
  *
@@ -2058,13 +2847,22 @@ int wlan_ralist_update(mlan_private *priv, t_u8 *old_ra, t_u8 *new_ra)
 	t_u8 tid;
 	int update_count;
 	raListTbl *ra_list;
+	ralist_peer *peer;
+	ralist_peer *existing;
+	t_u32 pkt_cnt = 0;
+	pmlan_adapter pmadapter = priv->adapter;
 
 	ENTER();
 
 	update_count = 0;
 
+	peer = wlan_wmm_find_ralist_peer(priv, old_ra);
+	if (!peer) {
+		LEAVE();
+		return update_count;
+	}
 	for (tid = 0; tid < MAX_NUM_TID; ++tid) {
-		ra_list = wlan_wmm_get_ralist_node(priv, tid, old_ra);
+		ra_list = peer->ra_list[tid];
 
 		if (ra_list) {
 			update_count++;
@@ -2083,6 +2881,7 @@ int wlan_ralist_update(mlan_private *priv, t_u8 *old_ra, t_u8 *new_ra)
 			}
 
 			ra_list->tx_pause = MFALSE;
+			wlan_wmm_update_ralist_ready(priv, ra_list, tid);
 			ra_list->packet_count = 0;
 			ra_list->ba_packet_threshold =
 				wlan_get_random_ba_threshold(priv->adapter);
@@ -2098,6 +2897,41 @@ int wlan_ralist_update(mlan_private *priv, t_u8 *old_ra, t_u8 *new_ra)
 				   MLAN_MAC_ADDR_LENGTH, MLAN_MAC_ADDR_LENGTH);
 		}
 	}
+	if (!memcmp(pmadapter, old_ra, new_ra, MLAN_MAC_ADDR_LENGTH)) {
+		LEAVE();
+		return update_count;
+	}
+	wlan_wmm_lock_all(priv);
+	util_unlink_list(pmadapter->pmoal_handle,
+			 &priv->wmm.ra_hash[WMM_RA_HASH(old_ra)],
+			 (pmlan_linked_list)peer, MNULL, MNULL);
+	existing = wlan_wmm_find_ralist_peer(priv, new_ra);
+	if (existing) {
+		/* The new RA has its own entry already: hand over the RA
+		 * lists it lacks, drop the ones that would duplicate it */
+		for (tid = 0; tid < MAX_NUM_TID; ++tid) {
+			ra_list = peer->ra_list[tid];
+			if (!ra_list)
+				continue;
+			if (!existing->ra_list[tid]) {
+				existing->ra_list[tid] = ra_list;
+				continue;
+			}
+			pkt_cnt += wlan_wmm_free_ralist_node(priv, ra_list,
+							     tid);
+		}
+		pmadapter->callbacks.moal_mfree(pmadapter->pmoal_handle,
+						(t_u8 *)peer);
+		wlan_wmm_sub_tx_pkts_queued(priv, pkt_cnt);
+	} else {
+		/* Rehash the peer under its new RA */
+		memcpy_ext(pmadapter, peer->ra, new_ra, MLAN_MAC_ADDR_LENGTH,
+			   MLAN_MAC_ADDR_LENGTH);
+		util_enqueue_list_tail(pmadapter->pmoal_handle,
+				       &priv->wmm.ra_hash[WMM_RA_HASH(new_ra)],
+				       (pmlan_linked_list)peer, MNULL, MNULL);
+	}
+	wlan_wmm_unlock_all(priv);
 
 	LEAVE();
 	return update_count;
@@ -2117,6 +2951,7 @@ t_void wlan_wmm_add_buf_txqueue(pmlan_adapter pmadapter, pmlan_buffer pmbuf)
 	t_u32 tid;
 	raListTbl *ra_list;
 	t_u8 ra[MLAN_MAC_ADDR_LENGTH], tid_down;
+	t_u8 by_ra = MTRUE;
 	tdlsStatus_e status;
 #ifdef UAP_SUPPORT
 	psta_node sta_ptr = MNULL;
@@ -2133,32 +2968,31 @@ t_void wlan_wmm_add_buf_txqueue(pmlan_adapter pmadapter, pmlan_buffer pmbuf)
 		return;
 	}
 	tid = pmbuf->priority;
-	pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
-					    priv->wmm.ra_list_spinlock);
 	tid_down = wlan_wmm_downgrade_tid(priv, tid);
 
 	/* In case of infra as we have already created the list during
 	   association we just don't have to call get_queue_raptr, we will have
 	   only 1 raptr for a tid in case of infra */
 	if (!queuing_ra_based(priv)) {
+		wlan_wmm_lock_tid(priv, tid_down);
 		memcpy_ext(pmadapter, ra, pmbuf->pbuf + pmbuf->data_offset,
 			   MLAN_MAC_ADDR_LENGTH, MLAN_MAC_ADDR_LENGTH);
 		status = wlan_get_tdls_link_status(priv, ra);
 		if (MTRUE == wlan_is_tdls_link_setup(status)) {
-			ra_list = wlan_wmm_get_queue_raptr(priv, tid_down, ra);
+			ra_list = wlan_wmm_get_ralist_node(priv, tid_down, ra);
 			pmbuf->flags |= MLAN_BUF_FLAG_TDLS;
 		} else if (status == TDLS_SETUP_INPROGRESS) {
 			wlan_add_buf_tdls_txqueue(priv, pmbuf);
-			pmadapter->callbacks.moal_spin_unlock(
-				pmadapter->pmoal_handle,
-				priv->wmm.ra_list_spinlock);
+			wlan_wmm_unlock_tid(priv, tid_down);
 			LEAVE();
 			return;
-		} else
+		} else {
 			ra_list = (raListTbl *)util_peek_list(
 				pmadapter->pmoal_handle,
 				&priv->wmm.tid_tbl_ptr[tid_down].ra_list, MNULL,
 				MNULL);
+			by_ra = MFALSE;
+		}
 	} else {
 		if (pmbuf->flags & MLAN_BUF_FLAG_EASYMESH)
 			memcpy_ext(pmadapter, ra, pmbuf->mac,
@@ -2184,7 +3018,19 @@ t_void wlan_wmm_add_buf_txqueue(pmlan_adapter pmadapter, pmlan_buffer pmbuf)
 			}
 		}
 #endif
-		ra_list = wlan_wmm_get_queue_raptr(priv, tid_down, ra);
+		wlan_wmm_lock_tid(priv, tid_down);
+		ra_list = wlan_wmm_get_ralist_node(priv, tid_down, ra);
+	}
+
+	if (!ra_list && by_ra) {
+		/* Adding a RA list changes the RA hash, which needs all the
+		 * TX queue locks */
+		wlan_wmm_unlock_tid(priv, tid_down);
+		wlan_wmm_lock_all(priv);
+		wlan_wmm_get_queue_raptr(priv, tid_down, ra);
+		wlan_wmm_unlock_all(priv);
+		wlan_wmm_lock_tid(priv, tid_down);
+		ra_list = wlan_wmm_get_ralist_node(priv, tid_down, ra);
 	}
 
 	if (!ra_list) {
@@ -2192,8 +3038,7 @@ t_void wlan_wmm_add_buf_txqueue(pmlan_adapter pmadapter, pmlan_buffer pmbuf)
 		PRINTM(MWARN,
 		       "Drop packet %p, ra_list=%p, media_connected=%d\n",
 		       pmbuf, ra_list, priv->media_connected);
-		pmadapter->callbacks.moal_spin_unlock(
-			pmadapter->pmoal_handle, priv->wmm.ra_list_spinlock);
+		wlan_wmm_unlock_tid(priv, tid_down);
 		wlan_write_data_complete(pmadapter, pmbuf, MLAN_STATUS_FAILURE);
 		LEAVE();
 		return;
@@ -2213,14 +3058,19 @@ t_void wlan_wmm_add_buf_txqueue(pmlan_adapter pmadapter, pmlan_buffer pmbuf)
 	if (ra_list->tx_pause) {
 		priv->wmm.pkts_paused[tid_down]++;
 	} else {
+		wlan_wmm_update_ralist_ready(priv, ra_list, tid_down);
 		util_scalar_increment(pmadapter->pmoal_handle,
-				      &priv->wmm.tx_pkts_queued, MNULL, MNULL);
+				      &priv->wmm.tx_pkts_queued,
+				      pmadapter->callbacks.moal_spin_lock,
+				      pmadapter->callbacks.moal_spin_unlock);
 		/* if highest_queued_prio < prio(tid_down), set it to
 		 * prio(tid_down) */
 		util_scalar_conditional_write(
 			pmadapter->pmoal_handle, &priv->wmm.highest_queued_prio,
 			MLAN_SCALAR_COND_LESS_THAN, tos_to_tid_inv[tid_down],
-			tos_to_tid_inv[tid_down], MNULL, MNULL);
+			tos_to_tid_inv[tid_down],
+			pmadapter->callbacks.moal_spin_lock,
+			pmadapter->callbacks.moal_spin_unlock);
 	}
 	/* Record the current time the packet was queued; used to determine
 	 *   the amount of time the packet was queued in the driver before it
@@ -2230,8 +3080,7 @@ t_void wlan_wmm_add_buf_txqueue(pmlan_adapter pmadapter, pmlan_buffer pmbuf)
 	 */
 	pmadapter->callbacks.moal_get_system_time(
 		pmadapter->pmoal_handle, &pmbuf->in_ts_sec, &pmbuf->in_ts_usec);
-	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
-					      priv->wmm.ra_list_spinlock);
+	wlan_wmm_unlock_tid(priv, tid_down);
 
 	LEAVE();
 }
@@ -2544,6 +3393,42 @@ t_u8 wlan_wmm_compute_driver_packet_delay(pmlan_private priv,
 	return ret_val;
 }
 
+/**
+ *  @brief Query the TX rate of the interfaces that send data
+ *
+ *  Firmware reports no rate with TX status, so while airtime fairness or
+ *  adaptive AMSDU is on, the TX rate of an interface with queued packets
+ *  is queried every WMM_TX_RATE_REFRESH seconds. The response sets the
+ *  rate of the RA lists, see wlan_wmm_tx_rate_for_all_ra().
+ *
+ *  @param pmadapter Pointer to the mlan_adapter driver data struct
+ *
+ *  @return        N/A
+ */
+static void wlan_wmm_refresh_tx_rate(pmlan_adapter pmadapter)
+{
+	pmlan_private priv;
+	t_u32 sec = 0, usec = 0;
+	int i;
+
+	if (!pmadapter->airtime_fair && !pmadapter->amsdu_adapt)
+		return;
+	pmadapter->callbacks.moal_get_system_time(pmadapter->pmoal_handle,
+						  &sec, &usec);
+	for (i = 0; i < pmadapter->priv_num; i++) {
+		priv = pmadapter->priv[i];
+		if (!priv || !priv->media_connected ||
+		    sec - priv->tx_rate_query_sec < WMM_TX_RATE_REFRESH ||
+		    !wlan_wmm_tx_rate_for_all_ra(priv) ||
+		    !util_scalar_read(pmadapter->pmoal_handle,
+				      &priv->wmm.tx_pkts_queued, MNULL, MNULL))
+			continue;
+		priv->tx_rate_query_sec = sec;
+		wlan_prepare_cmd(priv, HostCmd_CMD_802_11_TX_RATE_QUERY,
+				 HostCmd_ACT_GEN_GET, 0, MNULL, MNULL);
+	}
+}
+
 /**
  *  @brief Transmit the highest priority packet awaiting in the WMM Queues
  *
@@ -2555,9 +3440,15 @@ void wlan_wmm_process_tx(pmlan_adapter pmadapter)
 {
 	ENTER();
 
+	wlan_wmm_refresh_tx_rate(pmadapter);
 	do {
-		if (wlan_dequeue_tx_packet(pmadapter))
+		/* Bypass packets (EAPOL, ARP, ...) go ahead of all WMM ACs */
+		if (!wlan_bypass_tx_list_empty(pmadapter)) {
+			if (wlan_send_bypass_packet(pmadapter))
+				break;
+		} else if (wlan_dequeue_tx_packet(pmadapter)) {
 			break;
+		}
 #ifdef SDIO
 		if (IS_SD(pmadapter->card_type) &&
 		    (pmadapter->ireg & UP_LD_CMD_PORT_HOST_INT_STATUS)) {
@@ -2578,7 +3469,8 @@ void wlan_wmm_process_tx(pmlan_adapter pmadapter)
 #endif
 		/* Check if busy */
 	} while (!pmadapter->data_sent && !pmadapter->tx_lock_flag &&
-		 !wlan_wmm_lists_empty(pmadapter));
+		 (!wlan_bypass_tx_list_empty(pmadapter) ||
+		  !wlan_wmm_lists_empty(pmadapter)));
 
 	LEAVE();
 	return;
@@ -2651,13 +3543,18 @@ static INLINE t_u8 wlan_del_tx_pkts_in_ralist(pmlan_private priv,
 				priv->wmm.pkts_queued[tid]--;
 				priv->num_drop_pkts++;
 				ra_list->total_pkts--;
+				wlan_wmm_update_ralist_ready(priv, ra_list,
+							     tid);
 				if (ra_list->tx_pause)
 					priv->wmm.pkts_paused[tid]--;
 				else
 					util_scalar_decrement(
 						pmadapter->pmoal_handle,
 						&priv->wmm.tx_pkts_queued,
-						MNULL, MNULL);
+						pmadapter->callbacks
+							.moal_spin_lock,
+						pmadapter->callbacks
+							.moal_spin_unlock);
 				ret = MTRUE;
 				break;
 			}
@@ -2680,20 +3577,20 @@ t_void wlan_drop_tx_pkts(pmlan_private priv)
 {
 	int j;
 	static int i;
-	pmlan_adapter pmadapter = priv->adapter;
-	pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
-					    priv->wmm.ra_list_spinlock);
+	t_u8 dropped;
+
 	for (j = 0; j < MAX_NUM_TID; j++, i++) {
 		if (i == MAX_NUM_TID)
 			i = 0;
-		if (wlan_del_tx_pkts_in_ralist(
-			    priv, &priv->wmm.tid_tbl_ptr[i].ra_list, i)) {
+		wlan_wmm_lock_tid(priv, i);
+		dropped = wlan_del_tx_pkts_in_ralist(
+			priv, &priv->wmm.tid_tbl_ptr[i].ra_list, i);
+		wlan_wmm_unlock_tid(priv, i);
+		if (dropped) {
 			i++;
 			break;
 		}
 	}
-	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
-					      priv->wmm.ra_list_spinlock);
 	return;
 }
 
@@ -2707,52 +3604,22 @@ t_void wlan_drop_tx_pkts(pmlan_private priv)
  */
 t_void wlan_wmm_delete_peer_ralist(pmlan_private priv, t_u8 *mac)
 {
-	raListTbl *ra_list;
 	int i;
-	pmlan_adapter pmadapter = priv->adapter;
+	ralist_peer *peer;
 	t_u32 pkt_cnt = 0;
-	t_u32 tx_pkts_queued = 0;
 
 	ENTER();
-	pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
-					    priv->wmm.ra_list_spinlock);
-	for (i = 0; i < MAX_NUM_TID; ++i) {
-		ra_list = wlan_wmm_get_ralist_node(priv, i, mac);
-		if (ra_list) {
-			PRINTM(MINFO, "delete sta ralist %p\n", ra_list);
-			priv->wmm.pkts_queued[i] -= ra_list->total_pkts;
-			if (ra_list->tx_pause)
-				priv->wmm.pkts_paused[i] -= ra_list->total_pkts;
-			else
-				pkt_cnt += ra_list->total_pkts;
-			wlan_wmm_del_pkts_in_ralist_node(priv, ra_list);
-
-			util_unlink_list(pmadapter->pmoal_handle,
-					 &priv->wmm.tid_tbl_ptr[i].ra_list,
-					 (pmlan_linked_list)ra_list, MNULL,
-					 MNULL);
-			pmadapter->callbacks.moal_mfree(pmadapter->pmoal_handle,
-							(t_u8 *)ra_list);
-			if (priv->wmm.tid_tbl_ptr[i].ra_list_curr == ra_list)
-				priv->wmm.tid_tbl_ptr[i].ra_list_curr =
-					(raListTbl *)&priv->wmm.tid_tbl_ptr[i]
-						.ra_list;
-		}
-	}
-	if (pkt_cnt) {
-		tx_pkts_queued = util_scalar_read(pmadapter->pmoal_handle,
-						  &priv->wmm.tx_pkts_queued,
-						  MNULL, MNULL);
-		tx_pkts_queued -= pkt_cnt;
-		util_scalar_write(priv->adapter->pmoal_handle,
-				  &priv->wmm.tx_pkts_queued, tx_pkts_queued,
-				  MNULL, MNULL);
-		util_scalar_write(priv->adapter->pmoal_handle,
-				  &priv->wmm.highest_queued_prio, HIGH_PRIO_TID,
-				  MNULL, MNULL);
+	wlan_wmm_lock_all(priv);
+	peer = wlan_wmm_find_ralist_peer(priv, mac);
+	for (i = 0; peer && i < MAX_NUM_TID; ++i) {
+		if (peer->ra_list[i])
+			pkt_cnt += wlan_wmm_free_ralist_node(
+				priv, peer->ra_list[i], i);
 	}
-	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
-					      priv->wmm.ra_list_spinlock);
+	if (peer)
+		wlan_wmm_free_ralist_peer(priv, peer);
+	wlan_wmm_sub_tx_pkts_queued(priv, pkt_cnt);
+	wlan_wmm_unlock_all(priv);
 	LEAVE();
 }
 
@@ -2767,45 +3634,56 @@ t_void wlan_wmm_delete_peer_ralist(pmlan_private priv, t_u8 *mac)
  */
 t_void wlan_hold_tdls_packets(pmlan_private priv, t_u8 *mac)
 {
-	pmlan_buffer pmbuf;
+	pmlan_buffer pmbuf, pnext;
 	mlan_adapter *pmadapter = priv->adapter;
 	raListTbl *ra_list = MNULL;
 	t_u8 i;
 
 	ENTER();
-	pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
-					    priv->wmm.ra_list_spinlock);
+	wlan_wmm_lock_all(priv);
 	PRINTM(MDATA, "wlan_hold_tdls_packets: " MACSTR "\n", MAC2STR(mac));
 	for (i = 0; i < MAX_NUM_TID; ++i) {
 		ra_list = (raListTbl *)util_peek_list(
 			pmadapter->pmoal_handle,
 			&priv->wmm.tid_tbl_ptr[i].ra_list, MNULL, MNULL);
-		if (ra_list) {
-			while ((pmbuf = wlan_find_tdls_packets(priv, ra_list,
-							       mac))) {
+		if (!ra_list)
+			continue;
+		/* Move the packets to the peer in one pass over the list */
+		pmbuf = (pmlan_buffer)util_peek_list(pmadapter->pmoal_handle,
+						     &ra_list->buf_head, MNULL,
+						     MNULL);
+		while (pmbuf && pmbuf != (pmlan_buffer)&ra_list->buf_head) {
+			pnext = pmbuf->pnext;
+			if (!memcmp(pmadapter, pmbuf->pbuf + pmbuf->data_offset,
+				    mac, MLAN_MAC_ADDR_LENGTH)) {
 				util_unlink_list(pmadapter->pmoal_handle,
 						 &ra_list->buf_head,
 						 (pmlan_linked_list)pmbuf,
 						 MNULL, MNULL);
 				ra_list->total_pkts--;
 				priv->wmm.pkts_queued[i]--;
-				util_scalar_decrement(pmadapter->pmoal_handle,
-						      &priv->wmm.tx_pkts_queued,
-						      MNULL, MNULL);
+				util_scalar_decrement(
+					pmadapter->pmoal_handle,
+					&priv->wmm.tx_pkts_queued,
+					pmadapter->callbacks.moal_spin_lock,
+					pmadapter->callbacks.moal_spin_unlock);
 				ra_list->packet_count--;
-				wlan_add_buf_tdls_txqueue(priv, pmbuf);
 				PRINTM(MDATA, "hold tdls packet=%p\n", pmbuf);
+				wlan_add_buf_tdls_txqueue(priv, pmbuf);
 			}
+			pmbuf = pnext;
 		}
+		wlan_wmm_update_ralist_ready(priv, ra_list, i);
 	}
-	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
-					      priv->wmm.ra_list_spinlock);
+	wlan_wmm_unlock_all(priv);
 	LEAVE();
 }
 
 /**
  *  @brief move TDLS packets back to ralist
  *
+ *  The held packets of the peer are spliced to the RA list of each TID.
+ *
  *  @param priv		  A pointer to mlan_private
  *  @param mac        TDLS peer mac address
  *  @param status     tdlsStatus
@@ -2818,6 +3696,8 @@ t_void wlan_restore_tdls_packets(pmlan_private priv, t_u8 *mac,
 	pmlan_buffer pmbuf;
 	mlan_adapter *pmadapter = priv->adapter;
 	raListTbl *ra_list = MNULL;
+	tdls_pending_peer *peer;
+	mlan_list_head *pkts;
 	t_u32 tid;
 	t_u32 tid_down;
 
@@ -2825,55 +3705,73 @@ t_void wlan_restore_tdls_packets(pmlan_private priv, t_u8 *mac,
 	PRINTM(MDATA, "wlan_restore_tdls_packets: " MACSTR " status=%d\n",
 	       MAC2STR(mac), status);
 
-	pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
-					    priv->wmm.ra_list_spinlock);
+	wlan_wmm_lock_all(priv);
 
-	while ((pmbuf = wlan_find_packets_tdls_txq(priv, mac))) {
+	pmadapter->callbacks.moal_spin_lock(pmadapter->pmoal_handle,
+					    priv->tdls_pending_lock);
+	peer = wlan_find_tdls_pending_peer(priv, mac);
+	if (peer)
 		util_unlink_list(pmadapter->pmoal_handle,
-				 &priv->tdls_pending_txq,
-				 (pmlan_linked_list)pmbuf, MNULL, MNULL);
-		tid = pmbuf->priority;
+				 &priv->tdls_pending_hash[WMM_RA_HASH(mac)],
+				 (pmlan_linked_list)peer, MNULL, MNULL);
+	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
+					      priv->tdls_pending_lock);
+
+	for (tid = 0; peer && tid < MAX_NUM_TID; ++tid) {
+		if (!peer->num_pkts[tid])
+			continue;
+		pkts = &peer->buf_head[tid];
 		tid_down = wlan_wmm_downgrade_tid(priv, tid);
-		if (status == TDLS_SETUP_COMPLETE) {
+		if (status == TDLS_SETUP_COMPLETE)
 			ra_list = wlan_wmm_get_queue_raptr(priv, tid_down, mac);
-			pmbuf->flags |= MLAN_BUF_FLAG_TDLS;
-		} else {
+		else
 			ra_list = (raListTbl *)util_peek_list(
 				pmadapter->pmoal_handle,
 				&priv->wmm.tid_tbl_ptr[tid_down].ra_list, MNULL,
 				MNULL);
-			pmbuf->flags &= ~MLAN_BUF_FLAG_TDLS;
-		}
 		if (!ra_list) {
+			/* Dropped by wlan_free_tdls_pending_peer */
 			PRINTM_NETINTF(MWARN, priv);
 			PRINTM(MWARN,
-			       "Drop packet %p, ra_list=%p media_connected=%d\n",
-			       pmbuf, ra_list, priv->media_connected);
-			wlan_write_data_complete(pmadapter, pmbuf,
-						 MLAN_STATUS_FAILURE);
+			       "Drop %d packets, ra_list=%p media_connected=%d\n",
+			       peer->num_pkts[tid], ra_list,
+			       priv->media_connected);
 			continue;
 		}
+		pmbuf = (pmlan_buffer)pkts->pnext;
+		while (pmbuf != (pmlan_buffer)pkts) {
+			if (status == TDLS_SETUP_COMPLETE)
+				pmbuf->flags |= MLAN_BUF_FLAG_TDLS;
+			else
+				pmbuf->flags &= ~MLAN_BUF_FLAG_TDLS;
+			pmbuf = pmbuf->pnext;
+		}
 		PRINTM_NETINTF(MDATA, priv);
-		PRINTM(MDATA,
-		       "ADD TDLS pkt %p (priority=%d) back to ra_list %p\n",
-		       pmbuf, pmbuf->priority, ra_list);
-		util_enqueue_list_tail(pmadapter->pmoal_handle,
-				       &ra_list->buf_head,
-				       (pmlan_linked_list)pmbuf, MNULL, MNULL);
-		ra_list->total_pkts++;
-		ra_list->packet_count++;
-		priv->wmm.pkts_queued[tid_down]++;
-		util_scalar_increment(pmadapter->pmoal_handle,
-				      &priv->wmm.tx_pkts_queued, MNULL, MNULL);
+		PRINTM(MDATA, "ADD %d TDLS pkts (tid=%d) back to ra_list %p\n",
+		       peer->num_pkts[tid], tid, ra_list);
+		util_splice_list_tail(&ra_list->buf_head, pkts);
+		ra_list->total_pkts += peer->num_pkts[tid];
+		ra_list->packet_count += peer->num_pkts[tid];
+		wlan_wmm_update_ralist_ready(priv, ra_list, tid_down);
+		priv->wmm.pkts_queued[tid_down] += peer->num_pkts[tid];
+		util_scalar_offset(pmadapter->pmoal_handle,
+				   &priv->wmm.tx_pkts_queued,
+				   peer->num_pkts[tid],
+				   pmadapter->callbacks.moal_spin_lock,
+				   pmadapter->callbacks.moal_spin_unlock);
 		util_scalar_conditional_write(
 			pmadapter->pmoal_handle, &priv->wmm.highest_queued_prio,
 			MLAN_SCALAR_COND_LESS_THAN, tos_to_tid_inv[tid_down],
-			tos_to_tid_inv[tid_down], MNULL, MNULL);
+			tos_to_tid_inv[tid_down],
+			pmadapter->callbacks.moal_spin_lock,
+			pmadapter->callbacks.moal_spin_unlock);
+		peer->num_pkts[tid] = 0;
 	}
+	if (peer)
+		wlan_free_tdls_pending_peer(priv, peer);
 	if (status != TDLS_SETUP_COMPLETE)
 		wlan_wmm_delete_tdls_ralist(priv, mac);
-	pmadapter->callbacks.moal_spin_unlock(pmadapter->pmoal_handle,
-					      priv->wmm.ra_list_spinlock);
+	wlan_wmm_unlock_all(priv);
 	LEAVE();
 }
 
@@ -3662,10 +4560,17 @@ int wlan_get_ralist_info(mlan_private *priv, ralist_info *buf)
 			(raListTbl *)util_peek_list(priv->adapter->pmoal_handle,
 						    ra_list_head, MNULL, MNULL);
 		while (ra_list && ra_list != (raListTbl *)ra_list_head) {
-			if (ra_list->total_pkts) {
+			if (ra_list->total_pkts || ra_list->codel_drops ||
+			    ra_list->codel_marks ||
+			    (priv->adapter->amsdu_adapt &&
+			     ra_list->amsdu_size != AMSDU_ADAPT_SIZE_MAX)) {
 				plist->total_pkts = ra_list->total_pkts;
 				plist->tid = i;
 				plist->tx_pause = ra_list->tx_pause;
+				plist->codel_drops = ra_list->codel_drops;
+				plist->codel_marks = ra_list->codel_marks;
+				plist->amsdu_size = (t_u16)wlan_11n_amsdu_size(
+					priv->adapter, ra_list);
 				memcpy_ext(priv->adapter, plist->ra,
 					   ra_list->ra, MLAN_MAC_ADDR_LENGTH,
 					   MLAN_MAC_ADDR_LENGTH);
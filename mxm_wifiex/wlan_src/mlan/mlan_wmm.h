@@ -121,6 +121,52 @@ static INLINE t_void wlan_release_ralist_lock(pmlan_private priv)
 	return;
 }
 
+/**
+ *  @brief This function takes the RA list lock of a TID
+ *
+ *  @param priv         A pointer to mlan_private structure
+ *  @param tid          TID of the RA lists
+ *
+ *  @return             N/A
+ */
+static INLINE t_void wlan_wmm_lock_tid(pmlan_private priv, int tid)
+{
+	mlan_adapter *pmadapter = priv->adapter;
+	mlan_callbacks *pcb = (mlan_callbacks *)&pmadapter->callbacks;
+	tid_tbl_t *tid_ptr = &priv->wmm.tid_tbl_ptr[tid];
+
+	if (pcb->moal_spin_trylock(pmadapter->pmoal_handle,
+				   tid_ptr->ra_list_lock) !=
+	    MLAN_STATUS_SUCCESS) {
+		pcb->moal_spin_lock(pmadapter->pmoal_handle,
+				    tid_ptr->ra_list_lock);
+		tid_ptr->lock_contended++;
+	}
+	tid_ptr->lock_acquired++;
+}
+
+/**
+ *  @brief This function releases the RA list lock of a TID
+ *
+ *  @param priv         A pointer to mlan_private structure
+ *  @param tid          TID of the RA lists
+ *
+ *  @return             N/A
+ */
+static INLINE t_void wlan_wmm_unlock_tid(pmlan_private priv, int tid)
+{
+	mlan_adapter *pmadapter = priv->adapter;
+
+	pmadapter->callbacks.moal_spin_unlock(
+		pmadapter->pmoal_handle,
+		priv->wmm.tid_tbl_ptr[tid].ra_list_lock);
+}
+
+/** Take all RA list locks of the interface */
+t_void wlan_wmm_lock_all(pmlan_private priv);
+/** Release all RA list locks of the interface */
+t_void wlan_wmm_unlock_all(pmlan_private priv);
+
 /** Add buffer to WMM Tx queue */
 void wlan_wmm_add_buf_txqueue(pmlan_adapter pmadapter, pmlan_buffer pmbuf);
 /** Add to RA list */
@@ -136,6 +182,18 @@ int wlan_wmm_lists_empty(pmlan_adapter pmadapter);
 t_void wlan_wmm_process_tx(pmlan_adapter pmadapter);
 /** Test to see if the ralist ptr is valid */
 int wlan_is_ralist_valid(mlan_private *priv, raListTbl *ra_list, int tid);
+/** Sync the ready list state of a ralist */
+t_void wlan_wmm_update_ralist_ready(pmlan_private priv, raListTbl *ra_list,
+				    int tid);
+/** Rotate a served ralist to the tail of its ready list */
+t_void wlan_wmm_rotate_ralist_ready(pmlan_private priv, raListTbl *ra_list,
+				    int tid, t_u32 len);
+/** Update the airtime accounting rate of ralists */
+t_void wlan_wmm_update_ralist_rate(pmlan_private priv, t_u8 *ra, t_u16 rate);
+/** Check if the TX rate of an interface is the rate of all its RA lists */
+t_u8 wlan_wmm_tx_rate_for_all_ra(pmlan_private priv);
+/** Update the adaptive AMSDU size of all RA lists */
+t_void wlan_wmm_update_ralist_amsdu(pmlan_private priv);
 
 raListTbl *wlan_wmm_get_ralist_node(pmlan_private priv, t_u8 tid,
 				    t_u8 *ra_addr);
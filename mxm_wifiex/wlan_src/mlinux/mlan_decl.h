@@ -648,6 +648,15 @@ typedef enum {
 
 #define MLAN_BUF_FLAG_MC_AGGR_PKT MBIT(17)
 
+/** Buffer flag for scatter-gather AMSDU, fragments linked by pnext */
+#define MLAN_BUF_FLAG_AMSDU_SG MBIT(18)
+
+/** Buffer flag for TCP segmentation offload packet */
+#define MLAN_BUF_FLAG_TSO MBIT(19)
+
+/** Buffer flag for RX buffer owned by the moal DMA-mapped page pool */
+#define MLAN_BUF_FLAG_RX_POOL MBIT(20)
+
 #ifdef DEBUG_LEVEL1
 /** Debug level bit definition */
 #define MMSG MBIT(0)
@@ -1386,6 +1395,16 @@ typedef struct _mlan_buffer {
 	t_u32 extra_ts_usec;
 	/** When TX ra mac address,  When Rx Ta mac address*/
 	t_u8 mac[MLAN_MAC_ADDR_LENGTH];
+	/** TSO: MSS of the TCP segments */
+	t_u16 gso_size;
+	/** TSO: length of Ethernet, IP and TCP headers */
+	t_u16 gso_hdr_len;
+	/** TSO: offset of IP header */
+	t_u8 gso_ip_off;
+	/** TSO: offset of TCP header */
+	t_u8 gso_tcp_off;
+	/** TSO: payload already segmented */
+	t_u32 gso_offset;
 	/** Fields below are valid for MLAN module only */
 	/** Pointer to parent mlan_buffer */
 	struct _mlan_buffer *pparent;
@@ -2471,6 +2490,8 @@ typedef struct _mlan_callbacks {
 	/** moal_recv_amsdu_packet */
 	mlan_status (*moal_recv_amsdu_packet)(t_void *pmoal,
 					      pmlan_buffer pmbuf);
+	/** moal_recv_batch */
+	t_void (*moal_recv_batch)(t_void *pmoal, t_u8 start);
 	/** moal_recv_event */
 	mlan_status (*moal_recv_event)(t_void *pmoal, pmlan_event pmevent);
 	/** moal_ioctl_complete */
@@ -2523,6 +2544,12 @@ typedef struct _mlan_callbacks {
 	/** moal_unmap_memory */
 	mlan_status (*moal_unmap_memory)(t_void *pmoal, t_u8 *pbuf,
 					 t_u64 buf_pa, t_u32 size, t_u32 flag);
+	/** moal_alloc_rx_buffer */
+	mlan_status (*moal_alloc_rx_buffer)(t_void *pmoal, t_u32 size,
+					    pmlan_buffer *pmbuf);
+	/** moal_sync_rx_buffer */
+	mlan_status (*moal_sync_rx_buffer)(t_void *pmoal, pmlan_buffer pmbuf,
+					   t_u32 size, t_u8 for_device);
 #endif /* PCIE */
 	/** moal_memset */
 	t_void *(*moal_memset)(t_void *pmoal, t_void *pmem, t_u8 byte,
@@ -2561,6 +2588,11 @@ typedef struct _mlan_callbacks {
 					t_u8 periodic, t_u32 msec);
 	/** moal_stop_timer*/
 	mlan_status (*moal_stop_timer)(t_void *pmoal, t_void *ptimer);
+	/** moal_init_hrtimer, one-shot high resolution timer driven by
+	 *  moal_start_timer/moal_stop_timer/moal_free_timer */
+	mlan_status (*moal_init_hrtimer)(
+		t_void *pmoal, t_void **pptimer,
+		IN t_void (*callback)(t_void *pcontext), t_void *pcontext);
 	/** moal_init_lock */
 	mlan_status (*moal_init_lock)(t_void *pmoal, t_void **pplock);
 	/** moal_free_lock */
@@ -2569,6 +2601,8 @@ typedef struct _mlan_callbacks {
 	mlan_status (*moal_spin_lock)(t_void *pmoal, t_void *plock);
 	/** moal_spin_unlock */
 	mlan_status (*moal_spin_unlock)(t_void *pmoal, t_void *plock);
+	/** moal_spin_trylock */
+	mlan_status (*moal_spin_trylock)(t_void *pmoal, t_void *plock);
 	/** moal_print */
 	t_void (*moal_print)(t_void *pmoal, t_u32 level, char *pformat, IN...);
 	/** moal_print_netintf */
@@ -2590,6 +2624,10 @@ typedef struct _mlan_callbacks {
 					    unsigned int rsvd1);
 	void (*moal_amsdu_tp_accounting)(t_void *pmoal, t_s32 delay,
 					 t_s32 copy_delay);
+	/** moal_copy_tx_data */
+	mlan_status (*moal_copy_tx_data)(t_void *pmoal, pmlan_buffer pmbuf,
+					 t_u32 offset, t_u8 *dst, t_u32 len,
+					 t_u16 *pcsum);
 } mlan_callbacks, *pmlan_callbacks;
 
 /** Parameter unchanged, use MLAN default setting */
@@ -2748,6 +2786,16 @@ typedef struct _mlan_device {
 	t_u32 antcfg;
 	/** dmcs */
 	t_u8 dmcs;
+	/** airtime fair TX scheduling */
+	t_u8 airtime_fair;
+	/** Packets sent from a RA list per dequeue */
+	t_u8 tx_burst;
+	/** CoDel queue management of RA lists */
+	t_u8 tx_codel;
+	/** Scatter-gather AMSDU */
+	t_u8 amsdu_sg;
+	/** Adaptive AMSDU size */
+	t_u8 amsdu_adapt;
 } mlan_device, *pmlan_device;
 
 /** MLAN API function prototype */
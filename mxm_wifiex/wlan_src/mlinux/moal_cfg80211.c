@@ -2676,9 +2676,8 @@ static int woal_mgmt_tx(moal_private *priv, const u8 *buf, size_t len,
 	t_u16 pkt_len = 0;
 	t_u32 pkt_type;
 	t_u32 tx_control;
-	unsigned long flags;
 	struct sk_buff *skb = NULL;
-	struct tx_status_info *tx_info = NULL;
+	t_u32 tx_gen = 0;
 	t_u32 remain_len = 0;
 	t_u32 buf_flags = 0;
 	t_u8 tx_seq_num = 0;
@@ -2761,30 +2760,16 @@ static int woal_mgmt_tx(moal_private *priv, const u8 *buf, size_t len,
 		if (!priv->tx_seq_num)
 			priv->tx_seq_num++;
 		tx_seq_num = priv->tx_seq_num++;
-		tx_info = kzalloc(sizeof(struct tx_status_info), GFP_ATOMIC);
-		if (tx_info) {
-			skb = alloc_skb(len, GFP_ATOMIC);
-			if (skb) {
-				moal_memcpy_ext(priv->phandle, skb->data, buf,
-						len, len);
-				skb_put(skb, len);
-				spin_lock_irqsave(&priv->tx_stat_lock, flags);
-				tx_info->tx_cookie = cookie;
-				tx_info->tx_skb = skb;
-				tx_info->tx_seq_num = tx_seq_num;
-				if ((priv->bss_role == MLAN_BSS_ROLE_UAP) &&
-				    (priv->phandle->remain_on_channel && !wait))
-					tx_info->cancel_remain_on_channel =
-						MTRUE;
-				INIT_LIST_HEAD(&tx_info->link);
-				list_add_tail(&tx_info->link,
-					      &priv->tx_stat_queue);
-				spin_unlock_irqrestore(&priv->tx_stat_lock,
-						       flags);
-			} else {
-				kfree(tx_info);
-				tx_info = NULL;
-			}
+		skb = alloc_skb(len, GFP_ATOMIC);
+		if (skb) {
+			moal_memcpy_ext(priv->phandle, skb->data, buf, len,
+					len);
+			skb_put(skb, len);
+			tx_gen = woal_add_tx_info(
+				priv, tx_seq_num, skb, cookie,
+				(priv->bss_role == MLAN_BSS_ROLE_UAP) &&
+					priv->phandle->remain_on_channel &&
+					!wait);
 		}
 	}
 	if (priv->phandle->cmd_tx_data) {
@@ -2798,12 +2783,12 @@ static int woal_mgmt_tx(moal_private *priv, const u8 *buf, size_t len,
 		if (status != MLAN_STATUS_SUCCESS) {
 			PRINTM(MERROR, "Fail to send packet status=%d\n",
 			       status);
-			if (tx_info)
-				woal_remove_tx_info(priv, tx_info->tx_seq_num);
+			if (tx_gen)
+				woal_remove_tx_info(priv, tx_seq_num, tx_gen);
 			ret = -EFAULT;
 			goto done;
 		}
-		if (!tx_info) {
+		if (!tx_gen) {
 			/* Delay 30ms to guarantee the packet has been already
 			 * tx'ed, because if we call cfg80211_mgmt_tx_status()
 			 * immediately, then wpa_supplicant will call
@@ -2847,7 +2832,7 @@ static int woal_mgmt_tx(moal_private *priv, const u8 *buf, size_t len,
 			 * action handshake to wait 30ms.
 			 */
 			if (buf_flags == MLAN_BUF_FLAG_TX_STATUS) {
-				if (tx_info)
+				if (tx_gen)
 					break;
 				else
 					woal_sched_timeout(30);
@@ -2879,8 +2864,8 @@ done:
 			kfree(ioctl_req);
 	} else {
 		if (status != MLAN_STATUS_PENDING) {
-			if (tx_info)
-				woal_remove_tx_info(priv, tx_info->tx_seq_num);
+			if (tx_gen)
+				woal_remove_tx_info(priv, tx_seq_num, tx_gen);
 		}
 	}
 
@@ -3404,6 +3389,7 @@ int woal_cfg80211_set_qos_map(struct wiphy *wiphy, struct net_device *dev,
 	/**clear dscp map*/
 	if (!qos_map) {
 		memset(priv->dscp_map, 0xFF, sizeof(priv->dscp_map));
+		woal_flush_tx_flow_cache(priv);
 		goto done;
 	}
 
@@ -3429,6 +3415,7 @@ int woal_cfg80211_set_qos_map(struct wiphy *wiphy, struct net_device *dev,
 				qos_map->dscp_exception[i].up;
 		}
 	}
+	woal_flush_tx_flow_cache(priv);
 
 	/**UAP update (re)associate response*/
 	if (priv->bss_type == MLAN_BSS_TYPE_UAP) {
@@ -106,6 +106,10 @@ static struct debug_data items[] = {
 	 INFO_ADDR},
 	{"tx_pkts_queued", item_size(tx_pkts_queued), item_addr(tx_pkts_queued),
 	 INFO_ADDR},
+	{"ralist_lock_acquired", item_size(ralist_lock_acquired),
+	 item_addr(ralist_lock_acquired), INFO_ADDR},
+	{"ralist_lock_contended", item_size(ralist_lock_contended),
+	 item_addr(ralist_lock_contended), INFO_ADDR},
 	{"pps_uapsd_mode", item_size(pps_uapsd_mode), item_addr(pps_uapsd_mode),
 	 INFO_ADDR},
 	{"sleep_pd", item_size(sleep_pd), item_addr(sleep_pd), INFO_ADDR},
@@ -312,6 +316,10 @@ static struct debug_data uap_items[] = {
 	 INFO_ADDR},
 	{"tx_pkts_queued", item_size(tx_pkts_queued), item_addr(tx_pkts_queued),
 	 INFO_ADDR},
+	{"ralist_lock_acquired", item_size(ralist_lock_acquired),
+	 item_addr(ralist_lock_acquired), INFO_ADDR},
+	{"ralist_lock_contended", item_size(ralist_lock_contended),
+	 item_addr(ralist_lock_contended), INFO_ADDR},
 	{"tx_pause", item_size(tx_pause), item_addr(tx_pause), INFO_ADDR},
 	{"bypass_pkt_count", item_size(bypass_pkt_count),
 	 item_addr(bypass_pkt_count), INFO_ADDR},
@@ -1091,6 +1099,15 @@ static int woal_debug_read(struct seq_file *sfp, void *data)
 	seq_printf(sfp, "tcp_ack_drop_cnt=%d\n", priv->tcp_ack_drop_cnt);
 	seq_printf(sfp, "tcp_ack_cnt=%d\n", priv->tcp_ack_cnt);
 	seq_printf(sfp, "tcp_ack_payload=%d\n", priv->tcp_ack_payload);
+	seq_printf(sfp, "tcp_ack_hold_cnt=%u\n", priv->tcp_ack_hold_cnt);
+	seq_printf(sfp, "tcp_ack_flush_cnt=%u\n", priv->tcp_ack_flush_cnt);
+	seq_printf(sfp, "tcp_ack_timer_cnt=%u\n", priv->tcp_ack_timer_cnt);
+	seq_printf(sfp, "tx_flow_hit=%u tx_flow_miss=%u\n", priv->tx_flow_hit,
+		   priv->tx_flow_miss);
+	seq_printf(sfp, "tx_stage_reorder=%u\n", priv->tx_stage_reorder);
+	seq_printf(sfp, "tx_xmit_cnt=%u tx_kick_cnt=%u\n",
+		   atomic_read(&priv->phandle->tx_xmit_cnt),
+		   atomic_read(&priv->phandle->tx_kick_cnt));
 #if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
 	for (i = 0; i < 4; i++)
 		seq_printf(sfp, "wmm_tx_pending[%d]:%d\n", i,
@@ -1115,14 +1132,15 @@ static int woal_debug_read(struct seq_file *sfp, void *data)
 			seq_printf(
 				sfp,
 				"tid = %d, ta =  %02x:%02x:%02x:%02x:%02x:%02x, start_win = %d, "
-				"win_size = %d, amsdu=%d",
+				"win_size = %d, amsdu=%d flush_time=%u",
 				(int)info->rx_tbl[i].tid, info->rx_tbl[i].ta[0],
 				info->rx_tbl[i].ta[1], info->rx_tbl[i].ta[2],
 				info->rx_tbl[i].ta[3], info->rx_tbl[i].ta[4],
 				info->rx_tbl[i].ta[5],
 				(int)info->rx_tbl[i].start_win,
 				(int)info->rx_tbl[i].win_size,
-				(int)info->rx_tbl[i].amsdu);
+				(int)info->rx_tbl[i].amsdu,
+				info->rx_tbl[i].flush_time);
 			seq_printf(sfp, "\n");
 
 			seq_printf(sfp, "buffer: ");
@@ -1135,15 +1153,31 @@ static int woal_debug_read(struct seq_file *sfp, void *data)
 			seq_printf(sfp, "\n");
 		}
 	}
+	for (i = 0; i < MAX_NUM_TID; i++) {
+		for (j = 0; j < RX_REORDER_HIST_NUM; j++)
+			if (info->rx_reorder_hist[i][j])
+				break;
+		if (j == RX_REORDER_HIST_NUM)
+			continue;
+		seq_printf(sfp, "rx_reorder_hole tid=%d flushed=%u ms:", i,
+			   info->rx_reorder_flush[i]);
+		for (j = 0; j < RX_REORDER_HIST_NUM - 1; j++)
+			seq_printf(sfp, " <%u:%u", 1U << j,
+				   info->rx_reorder_hist[i][j]);
+		seq_printf(sfp, " >=%u:%u\n", 1U << (RX_REORDER_HIST_NUM - 2),
+			   info->rx_reorder_hist[i][j]);
+	}
 	for (i = 0; i < info->ralist_num; i++) {
 		seq_printf(
 			sfp,
-			"ralist ra: %02x:%02x:%02x:%02x:%02x:%02x tid=%d pkts=%d pause=%d\n",
+			"ralist ra: %02x:%02x:%02x:%02x:%02x:%02x tid=%d pkts=%d pause=%d codel_drops=%u codel_marks=%u amsdu_size=%d\n",
 			info->ralist[i].ra[0], info->ralist[i].ra[1],
 			info->ralist[i].ra[2], info->ralist[i].ra[3],
 			info->ralist[i].ra[4], info->ralist[i].ra[5],
 			info->ralist[i].tid, info->ralist[i].total_pkts,
-			info->ralist[i].tx_pause);
+			info->ralist[i].tx_pause, info->ralist[i].codel_drops,
+			info->ralist[i].codel_marks,
+			info->ralist[i].amsdu_size);
 	}
 
 	for (i = 0; i < info->tdls_peer_num; i++) {
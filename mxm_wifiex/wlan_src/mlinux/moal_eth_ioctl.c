@@ -8975,6 +8975,7 @@ static int woal_priv_set_get_dscp_map(moal_private *priv, t_u8 *respbuf,
 		pos = respbuf + header_len;
 		moal_memcpy_ext(priv->phandle, priv->dscp_map, pos,
 				sizeof(priv->dscp_map), sizeof(priv->dscp_map));
+		woal_flush_tx_flow_cache(priv);
 	}
 
 	copy_size = MIN(sizeof(priv->dscp_map), respbuflen);
@@ -192,6 +192,27 @@ static int fw_serial = 1;
 /** napi support*/
 static int napi;
 
+/** airtime fairness for TX scheduling */
+static int airtime_fair;
+
+/** packets sent from a RA list per TX dequeue */
+static int tx_burst;
+
+/** byte queue limits for kernel TX queues */
+static int tx_bql = 1;
+
+/** CoDel queue management of RA lists */
+static int tx_codel;
+
+/** scatter-gather AMSDU */
+static int amsdu_sg;
+
+/** adaptive AMSDU size */
+static int amsdu_adapt;
+
+/** TCP segmentation offload */
+static int tx_gso;
+
 /** DPD data config file */
 static char *dpd_data_cfg;
 
@@ -241,6 +262,8 @@ static int usb_aggr;
 /* Enable/disable Message Signaled Interrupt (MSI) */
 int pcie_int_mode = PCIE_INT_MODE_MSI;
 static int ring_size;
+/* Enable/disable the RX page pool */
+int pcie_rx_pool;
 #endif /* PCIE */
 
 static int low_power_mode_enable;
@@ -1264,6 +1287,86 @@ static mlan_status parse_cfg_read_block(t_u8 *data, t_u32 size,
 			PRINTM(MMSG, "napi %s\n",
 			       moal_extflg_isset(handle, EXT_NAPI) ? "on" :
 								     "off");
+		} else if (strncmp(line, "airtime_fair",
+				   strlen("airtime_fair")) == 0) {
+			if (parse_line_read_int(line, &out_data) !=
+			    MLAN_STATUS_SUCCESS)
+				goto err;
+			if (out_data)
+				moal_extflg_set(handle, EXT_AIRTIME_FAIR);
+			else
+				moal_extflg_clear(handle, EXT_AIRTIME_FAIR);
+			PRINTM(MMSG, "airtime_fair %s\n",
+			       moal_extflg_isset(handle, EXT_AIRTIME_FAIR) ?
+				       "on" :
+				       "off");
+		} else if (strncmp(line, "tx_burst", strlen("tx_burst")) ==
+			   0) {
+			if (parse_line_read_int(line, &out_data) !=
+			    MLAN_STATUS_SUCCESS)
+				goto err;
+			params->tx_burst = out_data;
+			PRINTM(MMSG, "tx_burst=%d\n", params->tx_burst);
+		} else if (strncmp(line, "tx_bql", strlen("tx_bql")) == 0) {
+			if (parse_line_read_int(line, &out_data) !=
+			    MLAN_STATUS_SUCCESS)
+				goto err;
+			if (out_data)
+				moal_extflg_set(handle, EXT_TX_BQL);
+			else
+				moal_extflg_clear(handle, EXT_TX_BQL);
+			PRINTM(MMSG, "tx_bql %s\n",
+			       moal_extflg_isset(handle, EXT_TX_BQL) ? "on" :
+								       "off");
+		} else if (strncmp(line, "tx_codel", strlen("tx_codel")) == 0) {
+			if (parse_line_read_int(line, &out_data) !=
+			    MLAN_STATUS_SUCCESS)
+				goto err;
+			if (out_data)
+				moal_extflg_set(handle, EXT_TX_CODEL);
+			else
+				moal_extflg_clear(handle, EXT_TX_CODEL);
+			PRINTM(MMSG, "tx_codel %s\n",
+			       moal_extflg_isset(handle, EXT_TX_CODEL) ?
+				       "on" :
+				       "off");
+		} else if (strncmp(line, "amsdu_sg", strlen("amsdu_sg")) == 0) {
+			if (parse_line_read_int(line, &out_data) !=
+			    MLAN_STATUS_SUCCESS)
+				goto err;
+			if (out_data)
+				moal_extflg_set(handle, EXT_AMSDU_SG);
+			else
+				moal_extflg_clear(handle, EXT_AMSDU_SG);
+			PRINTM(MMSG, "amsdu_sg %s\n",
+			       moal_extflg_isset(handle, EXT_AMSDU_SG) ?
+				       "on" :
+				       "off");
+		} else if (strncmp(line, "amsdu_adapt",
+				   strlen("amsdu_adapt")) == 0) {
+			if (parse_line_read_int(line, &out_data) !=
+			    MLAN_STATUS_SUCCESS)
+				goto err;
+			if (out_data)
+				moal_extflg_set(handle, EXT_AMSDU_ADAPT);
+			else
+				moal_extflg_clear(handle, EXT_AMSDU_ADAPT);
+			PRINTM(MMSG, "amsdu_adapt %s\n",
+			       moal_extflg_isset(handle, EXT_AMSDU_ADAPT) ?
+				       "on" :
+				       "off");
+		} else if (strncmp(line, "tx_gso", strlen("tx_gso")) == 0) {
+			if (parse_line_read_int(line, &out_data) !=
+			    MLAN_STATUS_SUCCESS)
+				goto err;
+			if (out_data)
+				moal_extflg_set(handle, EXT_TX_GSO);
+			else
+				moal_extflg_clear(handle, EXT_TX_GSO);
+			PRINTM(MMSG, "tx_gso %s\n",
+			       moal_extflg_isset(handle, EXT_TX_GSO) ?
+				       "on" :
+				       "off");
 		} else if (strncmp(line, "tx_work", strlen("tx_work")) == 0) {
 			if (parse_line_read_int(line, &out_data) !=
 			    MLAN_STATUS_SUCCESS)
@@ -1811,12 +1914,26 @@ static void woal_setup_module_param(moal_handle *handle, moal_mod_para *params)
 		handle->params.gtk_rekey_offload = params->gtk_rekey_offload;
 	handle->params.multi_dtim = multi_dtim;
 	handle->params.inact_tmo = inact_tmo;
+	handle->params.tx_burst = tx_burst;
 	if (params) {
 		handle->params.multi_dtim = params->multi_dtim;
 		handle->params.inact_tmo = params->inact_tmo;
+		handle->params.tx_burst = params->tx_burst;
 	}
 	if (napi)
 		moal_extflg_set(handle, EXT_NAPI);
+	if (airtime_fair)
+		moal_extflg_set(handle, EXT_AIRTIME_FAIR);
+	if (tx_bql)
+		moal_extflg_set(handle, EXT_TX_BQL);
+	if (tx_codel)
+		moal_extflg_set(handle, EXT_TX_CODEL);
+	if (amsdu_sg)
+		moal_extflg_set(handle, EXT_AMSDU_SG);
+	if (amsdu_adapt)
+		moal_extflg_set(handle, EXT_AMSDU_ADAPT);
+	if (tx_gso)
+		moal_extflg_set(handle, EXT_TX_GSO);
 	if (tx_work)
 		moal_extflg_set(handle, EXT_TX_WORK);
 
@@ -2844,6 +2961,10 @@ MODULE_PARM_DESC(ring_size,
 		 "adma dma ring size: 32/64/128/256/512, default 128");
 module_param(pcie_int_mode, int, 0);
 MODULE_PARM_DESC(pcie_int_mode, "0: Legacy mode; 1: MSI mode; 2: MSI-X mode");
+module_param(pcie_rx_pool, int, 0);
+MODULE_PARM_DESC(
+	pcie_rx_pool,
+	"1: Recycle RX buffers through a DMA-mapped page pool; 0: Map a new buffer per packet (default)");
 #endif /* PCIE */
 module_param(low_power_mode_enable, int, 0);
 MODULE_PARM_DESC(low_power_mode_enable, "0/1: Disable/Enable Low Power Mode");
@@ -2927,7 +3048,41 @@ module_param(inact_tmo, ushort, 0);
 MODULE_PARM_DESC(inact_tmo, "IEEE ps inactivity timout value");
 
 module_param(napi, int, 0);
-MODULE_PARM_DESC(napi, "1: enable napi api; 0: disable napi");
+MODULE_PARM_DESC(napi, "1: enable napi api with GRO in rx; 0: disable napi");
+
+module_param(airtime_fair, int, 0);
+MODULE_PARM_DESC(airtime_fair,
+		 "1: Enable airtime fair TX scheduling; 0: Disable (default)");
+
+module_param(tx_burst, int, 0);
+MODULE_PARM_DESC(
+	tx_burst,
+	"Max packets sent from a RA list per TX dequeue (max 64); 0: no burst (default)");
+
+module_param(tx_bql, int, 0);
+MODULE_PARM_DESC(
+	tx_bql,
+	"1: Size kernel TX queues with byte queue limits (default); 0: Use fixed packet thresholds");
+
+module_param(tx_codel, int, 0);
+MODULE_PARM_DESC(
+	tx_codel,
+	"1: Drop or ECN mark packets queued too long per RA/TID (CoDel); 0: Disable (default)");
+
+module_param(amsdu_sg, int, 0);
+MODULE_PARM_DESC(
+	amsdu_sg,
+	"1: Build AMSDU as scatter-gather list where the bus supports it; 0: Copy subframes (default)");
+
+module_param(amsdu_adapt, int, 0);
+MODULE_PARM_DESC(
+	amsdu_adapt,
+	"1: Adapt AMSDU size per RA to TX rate and retries; 0: Use peer max AMSDU size (default)");
+
+module_param(tx_gso, int, 0);
+MODULE_PARM_DESC(
+	tx_gso,
+	"1: Accept TSO packets and segment them in the driver; 0: Let the kernel segment them (default)");
 
 #if CFG80211_VERSION_CODE >= KERNEL_VERSION(3, 14, 0)
 module_param(dfs_offload, int, 0);
@@ -58,7 +58,12 @@ Change log:
 #include <linux/if_ether.h>
 #include <linux/in.h>
 #include <linux/tcp.h>
+#include <linux/ipv6.h>
+#include <linux/jhash.h>
 #include <net/tcp.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 4, 0)
+#include <net/gso.h>
+#endif
 #include <net/dsfield.h>
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 15, 0)
 #include <linux/mpls.h>
@@ -920,6 +925,7 @@ static mlan_callbacks woal_callbacks = {
 	.moal_send_packet_complete = moal_send_packet_complete,
 	.moal_recv_packet = moal_recv_packet,
 	.moal_recv_amsdu_packet = moal_recv_amsdu_packet,
+	.moal_recv_batch = moal_recv_batch,
 	.moal_recv_event = moal_recv_event,
 	.moal_ioctl_complete = moal_ioctl_complete,
 	.moal_alloc_mlan_buffer = moal_alloc_mlan_buffer,
@@ -944,6 +950,8 @@ static mlan_callbacks woal_callbacks = {
 	.moal_mfree_consistent = moal_mfree_consistent,
 	.moal_map_memory = moal_map_memory,
 	.moal_unmap_memory = moal_unmap_memory,
+	.moal_alloc_rx_buffer = moal_alloc_rx_buffer,
+	.moal_sync_rx_buffer = moal_sync_rx_buffer,
 #endif /* PCIE */
 	.moal_memset = moal_memset,
 	.moal_memcpy = moal_memcpy,
@@ -958,10 +966,12 @@ static mlan_callbacks woal_callbacks = {
 	.moal_free_timer = moal_free_timer,
 	.moal_start_timer = moal_start_timer,
 	.moal_stop_timer = moal_stop_timer,
+	.moal_init_hrtimer = moal_init_hrtimer,
 	.moal_init_lock = moal_init_lock,
 	.moal_free_lock = moal_free_lock,
 	.moal_spin_lock = moal_spin_lock,
 	.moal_spin_unlock = moal_spin_unlock,
+	.moal_spin_trylock = moal_spin_trylock,
 	.moal_print = moal_print,
 	.moal_print_netintf = moal_print_netintf,
 	.moal_assert = moal_assert,
@@ -971,6 +981,7 @@ static mlan_callbacks woal_callbacks = {
 	.moal_tp_accounting = moal_tp_accounting,
 	.moal_tp_accounting_rx_param = moal_tp_accounting_rx_param,
 	.moal_amsdu_tp_accounting = moal_amsdu_tp_accounting,
+	.moal_copy_tx_data = moal_copy_tx_data,
 };
 
 int woal_open(struct net_device *dev);
@@ -1018,6 +1029,8 @@ static struct work_struct hang_work;
 static struct workqueue_struct *register_workqueue;
 /** register work */
 static struct work_struct register_work;
+/** TCP session cache */
+static struct kmem_cache *tcp_sess_cache;
 
 /**
  *  @brief This function send fw dump event to kernel
@@ -2447,6 +2460,11 @@ mlan_status woal_init_sw(moal_handle *handle)
 	device.second_mac = handle->second_mac;
 	device.antcfg = handle->params.antcfg;
 	device.dmcs = moal_extflg_isset(handle, EXT_DMCS);
+	device.airtime_fair = moal_extflg_isset(handle, EXT_AIRTIME_FAIR);
+	device.tx_burst = (t_u8)handle->params.tx_burst;
+	device.tx_codel = moal_extflg_isset(handle, EXT_TX_CODEL);
+	device.amsdu_sg = moal_extflg_isset(handle, EXT_AMSDU_SG);
+	device.amsdu_adapt = moal_extflg_isset(handle, EXT_AMSDU_ADAPT);
 
 	for (i = 0; i < handle->drv_mode.intf_num; i++) {
 		device.bss_attr[i].bss_type =
@@ -4624,11 +4642,12 @@ mlan_status woal_init_fw(moal_handle *handle)
  *
  *  @param pmbuf   A pointer to mlan_buffer
  *  @param skb     A pointer to struct sk_buff
+ *  @param hash    Flow hash of the packet
  *
  *  @return        N/A
  */
 void woal_fill_mlan_buffer(moal_private *priv, mlan_buffer *pmbuf,
-			   struct sk_buff *skb)
+			   struct sk_buff *skb, t_u32 hash)
 {
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 6, 0)
 	struct timespec64 ts;
@@ -4687,7 +4706,7 @@ void woal_fill_mlan_buffer(moal_private *priv, mlan_buffer *pmbuf,
 
 	if ((priv->enable_mc_aggr || priv->enable_uc_nonaggr) &&
 	    priv->num_mcast_addr) {
-		if (woal_find_mcast_node_tx(priv, skb)) {
+		if (woal_find_mcast_node_tx(priv, skb, hash)) {
 			mc_txcontrol *tx_ctrl =
 				(mc_txcontrol *)(skb->data + skb->len -
 						 sizeof(mc_txcontrol));
@@ -5018,6 +5037,33 @@ static struct device_type wlan_type = {
 };
 #endif
 
+/** Net device features for TSO */
+#define WOAL_TSO_FEATURES                                                      \
+	(NETIF_F_SG | NETIF_F_IP_CSUM | NETIF_F_IPV6_CSUM | NETIF_F_TSO |      \
+	 NETIF_F_TSO6)
+
+/**
+ *  @brief This function sets the TSO features of the net device
+ *
+ *  TSO needs SG and checksum offload. Checksums of TSO packets are done
+ *  in MLAN when they are segmented, other packets are checksummed and
+ *  linearized in woal_start_xmit.
+ *
+ *  @param dev      A pointer to net_device structure
+ *  @param priv     A pointer to moal_private structure
+ *
+ *  @return         N/A
+ */
+static void woal_init_tso_features(struct net_device *dev, moal_private *priv)
+{
+	if (!moal_extflg_isset(priv->phandle, EXT_TX_GSO))
+		return;
+	dev->features |= WOAL_TSO_FEATURES;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 39)
+	dev->hw_features |= WOAL_TSO_FEATURES;
+#endif
+}
+
 #ifdef STA_SUPPORT
 #if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
 /** Network device handlers */
@@ -5112,6 +5158,7 @@ mlan_status woal_init_sta_dev(struct net_device *dev, moal_private *priv)
 	}
 #endif
 	dev->flags |= IFF_BROADCAST | IFF_MULTICAST;
+	woal_init_tso_features(dev, priv);
 
 #ifdef STA_CFG80211
 	if (IS_STA_CFG80211(priv->phandle->params.cfg80211_wext))
@@ -5200,6 +5247,7 @@ mlan_status woal_init_uap_dev(struct net_device *dev, moal_private *priv)
 	dev->hard_header_len += MLAN_MIN_DATA_HEADER_LEN + sizeof(mlan_buffer) +
 				priv->extra_tx_head_len;
 #endif
+	woal_init_tso_features(dev, priv);
 	/** don't need register to wext */
 	if (priv->bss_type == MLAN_BSS_TYPE_DFS) {
 		LEAVE();
@@ -5339,18 +5387,14 @@ moal_private *woal_add_interface(moal_handle *handle, t_u8 bss_index,
 	else if (bss_type == MLAN_BSS_TYPE_DFS)
 		priv->bss_role = MLAN_BSS_ROLE_UAP;
 
-	INIT_LIST_HEAD(&priv->tcp_sess_queue);
-	spin_lock_init(&priv->tcp_sess_lock);
+	woal_init_priv_tx(priv);
 #ifdef STA_SUPPORT
 	INIT_LIST_HEAD(&priv->tdls_list);
+	for (i = 0; i < TDLS_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&priv->tdls_hash[i]);
 	spin_lock_init(&priv->tdls_lock);
 #endif
 
-	INIT_LIST_HEAD(&priv->tx_stat_queue);
-	spin_lock_init(&priv->tx_stat_lock);
-	INIT_LIST_HEAD(&priv->mcast_list);
-	spin_lock_init(&priv->mcast_lock);
-
 #ifdef STA_CFG80211
 #ifdef STA_SUPPORT
 	spin_lock_init(&priv->connect_lock);
@@ -6054,6 +6098,55 @@ void woal_flush_workqueue(moal_handle *handle)
 	LEAVE();
 }
 
+/**
+ *  @brief This function gets the interface whose queues stage the
+ *         tx work packets of an interface
+ *
+ *  AP_VLAN interfaces are not in handle->priv, so they stage on the
+ *  queues of their parent interface that tx work drains.
+ *
+ *  @param priv      A pointer to moal_private structure
+ *
+ *  @return          A pointer to moal_private structure
+ */
+static moal_private *woal_tx_stage_priv(moal_private *priv)
+{
+#ifdef UAP_SUPPORT
+#if defined(UAP_CFG80211) || defined(STA_CFG80211)
+	if (priv->wdev && priv->wdev->iftype == NL80211_IFTYPE_AP_VLAN)
+		return priv->parent_priv;
+#endif
+#endif
+	return priv;
+}
+
+/**
+ *  @brief This function drops the packets staged for tx work
+ *
+ *  @param priv      A pointer to moal_private structure
+ *
+ *  @return        N/A
+ */
+static void woal_flush_tx_stage(moal_private *priv)
+{
+	moal_private *stage_priv = woal_tx_stage_priv(priv);
+	struct sk_buff_head *stage;
+	struct sk_buff *skb, *tmp;
+	int i;
+
+	for (i = 0; i < (int)ARRAY_SIZE(stage_priv->tx_q); i++) {
+		stage = &stage_priv->tx_q[i];
+		spin_lock_bh(&stage->lock);
+		skb_queue_walk_safe (stage, skb, tmp) {
+			if (priv != stage_priv && skb->dev != priv->netdev)
+				continue;
+			__skb_unlink(skb, stage);
+			dev_kfree_skb_any(skb);
+		}
+		spin_unlock_bh(&stage->lock);
+	}
+}
+
 /**
  *  @brief This function cancel all works in the queue
  *  and destroy the main workqueue.
@@ -6064,6 +6157,8 @@ void woal_flush_workqueue(moal_handle *handle)
  */
 void woal_terminate_workqueue(moal_handle *handle)
 {
+	int cpu;
+
 	ENTER();
 
 	/* Terminate main workqueue */
@@ -6083,6 +6178,13 @@ void woal_terminate_workqueue(moal_handle *handle)
 		destroy_workqueue(handle->tx_workqueue);
 		handle->tx_workqueue = NULL;
 	}
+	if (handle->rx_batch) {
+		for_each_possible_cpu (cpu)
+			skb_queue_purge(
+				&per_cpu_ptr(handle->rx_batch, cpu)->skbs);
+		free_percpu(handle->rx_batch);
+		handle->rx_batch = NULL;
+	}
 #if defined(USB) || defined(SDIO)
 	if (IS_USB(handle->card_type) || IS_SD(handle->card_type)) {
 		if (handle->rx_workqueue) {
@@ -6227,6 +6329,9 @@ int woal_open(struct net_device *dev)
 	}
 #endif
 
+#if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
+	woal_tx_queue_reset(priv);
+#endif
 	if (carrier_on == MTRUE) {
 		if (!netif_carrier_ok(priv->netdev))
 			netif_carrier_on(priv->netdev);
@@ -6270,6 +6375,7 @@ int woal_close(struct net_device *dev)
 		if ((dev->ieee80211_ptr) &&
 		    (dev->ieee80211_ptr->iftype == NL80211_IFTYPE_AP_VLAN)) {
 			woal_stop_queue(priv->netdev);
+			woal_flush_tx_stage(priv);
 			MODULE_PUT;
 			LEAVE();
 			return 0;
@@ -6336,6 +6442,9 @@ int woal_close(struct net_device *dev)
 #endif
 	if (!priv->bss_virtual)
 		woal_stop_queue(priv->netdev);
+#if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
+	woal_tx_queue_reset(priv);
+#endif
 	MODULE_PUT;
 #if defined(USB)
 	if (IS_USB(priv->phandle->card_type)) {
@@ -6843,6 +6952,217 @@ struct net_device_stats *woal_get_stats(struct net_device *dev)
 	return &priv->stats;
 }
 
+/**
+ *  @brief This function initializes the TX state of a new interface
+ *
+ *  Used by both woal_add_interface() and woal_alloc_virt_interface().
+ *
+ *  @param priv      A pointer to moal_private structure
+ *
+ *  @return          N/A
+ */
+void woal_init_priv_tx(moal_private *priv)
+{
+	woal_init_tcp_sess_queue(priv);
+	woal_init_tx_flow_cache(priv);
+	spin_lock_init(&priv->bql_lock);
+	memset(priv->bql_inflight, 0, sizeof(priv->bql_inflight));
+	memset(priv->tx_stat_tbl, 0, sizeof(priv->tx_stat_tbl));
+	priv->tx_stat_gen = 0;
+	spin_lock_init(&priv->tx_stat_lock);
+	woal_init_mcast_list(priv);
+}
+
+/**
+ *  @brief This function initializes the TX flow cache
+ *
+ *  @param priv      A pointer to moal_private structure
+ *
+ *  @return          N/A
+ */
+void woal_init_tx_flow_cache(moal_private *priv)
+{
+	int i;
+
+	memset(priv->tx_flow_cache, 0, sizeof(priv->tx_flow_cache));
+	for (i = 0; i < TX_FLOW_CACHE_SIZE; i++)
+		seqcount_init(&priv->tx_flow_cache[i].seq);
+	/* Generation 0 marks an unused entry */
+	priv->tx_flow_gen = 1;
+	priv->tx_flow_hit = 0;
+	priv->tx_flow_miss = 0;
+	spin_lock_init(&priv->tx_flow_lock);
+}
+
+/**
+ *  @brief This function invalidates the TX flow cache
+ *
+ *  It is called when what the cache memoizes changes: the DSCP map, the
+ *  multicast list or the TDLS peers.
+ *
+ *  @param priv      A pointer to moal_private structure
+ *
+ *  @return          N/A
+ */
+void woal_flush_tx_flow_cache(moal_private *priv)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&priv->tx_flow_lock, flags);
+	if (!++priv->tx_flow_gen)
+		priv->tx_flow_gen = 1;
+	spin_unlock_irqrestore(&priv->tx_flow_lock, flags);
+}
+
+/**
+ *  @brief This function gets the flow hash of a TX packet
+ *
+ *  @param skb       A pointer to skb buffer.
+ *
+ *  @return          Flow hash, 0 if there is none
+ */
+static inline t_u32 woal_tx_flow_hash(struct sk_buff *skb)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 14, 0)
+	return skb_get_hash(skb);
+#else
+	return skb_get_rxhash(skb);
+#endif
+}
+
+/**
+ *  @brief This function gets the DS field a TX packet is classified from
+ *
+ *  @param skb       A pointer to sk_buff structure
+ *
+ *  @return          DSCP bits of the IPv4 TOS or IPv6 traffic class,
+ *                   0 for other packets
+ */
+static inline t_u8 woal_tx_flow_dscp(struct sk_buff *skb)
+{
+	switch (skb->protocol) {
+	case htons(ETH_P_IP):
+		return ipv4_get_dsfield(ip_hdr(skb)) & 0xfc;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 3, 0)
+	case htons(ETH_P_IPV6):
+		return ipv6_get_dsfield(ipv6_hdr(skb)) & 0xfc;
+#endif
+	default:
+		return 0;
+	}
+}
+
+/**
+ *  @brief This function checks if a TX packet carries a VLAN tag
+ *
+ *  @param skb       A pointer to sk_buff structure
+ *
+ *  @return          MTRUE or MFALSE
+ */
+static inline t_u8 woal_skb_vlan_tagged(struct sk_buff *skb)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 0, 0)
+	return skb_vlan_tag_present(skb) ? MTRUE : MFALSE;
+#else
+	return MFALSE;
+#endif
+}
+
+/**
+ *  @brief This function gets the cached state of the flow of a TX packet
+ *
+ *  The entry is read without tx_flow_lock, retrying if a writer
+ *  changed it meanwhile.
+ *
+ *  @param priv      A pointer to moal_private structure
+ *  @param hash      Flow hash of the packet, from woal_tx_flow_hash()
+ *  @param da        Destination address of the packet
+ *  @param dscp      DS field of the packet, TX_FLOW_TID is only
+ *                   returned if the TID was cached for the same one
+ *  @param tid       A pointer to return the cached TID
+ *  @param gen       A pointer to return the cache generation, passed
+ *                   back to woal_set_tx_flow()
+ *
+ *  @return          TX_FLOW_xxx flags, 0 if the flow is not cached
+ */
+static t_u8 woal_get_tx_flow(moal_private *priv, t_u32 hash, const t_u8 *da,
+			     t_u8 dscp, t_u8 *tid, t_u32 *gen)
+{
+	struct tx_flow *flow;
+	unsigned int seq;
+	t_u8 ret;
+	t_u8 flow_tid;
+	t_u8 flow_dscp;
+
+	*gen = priv->tx_flow_gen;
+	if (!hash)
+		return 0;
+	flow = &priv->tx_flow_cache[hash & (TX_FLOW_CACHE_SIZE - 1)];
+	do {
+		seq = read_seqcount_begin(&flow->seq);
+		ret = 0;
+		flow_tid = flow->tid;
+		flow_dscp = flow->dscp;
+		if (flow->gen == *gen && flow->hash == hash &&
+		    !memcmp(flow->da, da, ETH_ALEN))
+			ret = flow->flags;
+	} while (read_seqcount_retry(&flow->seq, seq));
+	if (flow_dscp != dscp)
+		ret &= ~TX_FLOW_TID;
+	if (ret && tid)
+		*tid = flow_tid;
+	return ret;
+}
+
+/**
+ *  @brief This function caches state of the flow of a TX packet
+ *
+ *  Nothing is cached if the cache was flushed since the lookup that
+ *  returned gen, as the state may have been computed from stale lists.
+ *
+ *  @param priv      A pointer to moal_private structure
+ *  @param hash      Flow hash of the packet, from woal_tx_flow_hash()
+ *  @param da        Destination address of the packet
+ *  @param gen       Cache generation returned by woal_get_tx_flow()
+ *  @param set       TX_FLOW_xxx flags to set
+ *  @param tid       TID of the flow, with TX_FLOW_TID set
+ *  @param dscp      DS field the TID was classified from
+ *
+ *  @return          N/A
+ */
+static void woal_set_tx_flow(moal_private *priv, t_u32 hash, const t_u8 *da,
+			     t_u32 gen, t_u8 set, t_u8 tid, t_u8 dscp)
+{
+	struct tx_flow *flow;
+	unsigned long flags;
+
+	if (!hash)
+		return;
+	flow = &priv->tx_flow_cache[hash & (TX_FLOW_CACHE_SIZE - 1)];
+	spin_lock_irqsave(&priv->tx_flow_lock, flags);
+	if (gen != priv->tx_flow_gen) {
+		spin_unlock_irqrestore(&priv->tx_flow_lock, flags);
+		return;
+	}
+	write_seqcount_begin(&flow->seq);
+	if (flow->gen != gen || flow->hash != hash ||
+	    memcmp(flow->da, da, ETH_ALEN)) {
+		/* Replace the entry of another flow */
+		flow->hash = hash;
+		flow->gen = gen;
+		moal_memcpy_ext(priv->phandle, flow->da, da, ETH_ALEN,
+				sizeof(flow->da));
+		flow->flags = 0;
+	}
+	flow->flags |= set;
+	if (set & TX_FLOW_TID) {
+		flow->tid = tid;
+		flow->dscp = dscp;
+	}
+	write_seqcount_end(&flow->seq);
+	spin_unlock_irqrestore(&priv->tx_flow_lock, flags);
+}
+
 #if !defined(STA_CFG80211) && !defined(UAP_CFG80211)
 /**
  *  @brief This function determine the 802.1p/1d tag to use
@@ -6941,6 +7261,9 @@ u16 woal_select_queue(struct net_device *dev, struct sk_buff *skb
 )
 {
 	moal_private *priv = (moal_private *)netdev_priv(dev);
+	t_u32 hash;
+	t_u32 gen;
+	t_u8 dscp;
 	t_u8 tid = 0;
 	t_u8 index = 0;
 
@@ -6949,6 +7272,21 @@ u16 woal_select_queue(struct net_device *dev, struct sk_buff *skb
 		LEAVE();
 		return index;
 	}
+	/* A priority of 256 to 263 or a VLAN tag set per packet overrides
+	 * the DS field of the flow, such packets are always classified */
+	if ((skb->priority >= 256 && skb->priority <= 263) ||
+	    woal_skb_vlan_tagged(skb))
+		hash = 0;
+	else
+		hash = woal_tx_flow_hash(skb);
+	dscp = woal_tx_flow_dscp(skb);
+	if (woal_get_tx_flow(priv, hash, skb->data, dscp, &tid, &gen) &
+	    TX_FLOW_TID) {
+		skb->priority = tid;
+		priv->tx_flow_hit++;
+		goto select;
+	}
+	priv->tx_flow_miss++;
 #if defined(STA_CFG80211) || defined(UAP_CFG80211)
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 14, 0)
 	tid = skb->priority = cfg80211_classify8021d(skb, NULL);
@@ -6970,6 +7308,8 @@ u16 woal_select_queue(struct net_device *dev, struct sk_buff *skb
 		tid = skb->priority = 7;
 		break;
 	}
+	woal_set_tx_flow(priv, hash, skb->data, gen, TX_FLOW_TID, tid, dscp);
+select:
 	index = mlan_select_wmm_queue(priv->phandle->pmlan_adapter,
 				      priv->bss_index, tid);
 	PRINTM(MDATA, "select queue: tid=%d, index=%d\n", tid, index);
@@ -6979,71 +7319,121 @@ u16 woal_select_queue(struct net_device *dev, struct sk_buff *skb
 #endif
 
 /**
- *  @brief This function flush tx status queue
+ *  @brief This function reports the status of a mgmt frame whose tx status
+ *         will not come from firmware and frees its skb
  *
  *  @param priv      A pointer to moal_private structure
+ *  @param tx_info   A pointer to the tx_status_info taken from the table
+ *  @param ack       Whether to report the frame as acked
  *
  *  @return          N/A
  */
-void woal_flush_tx_stat_queue(moal_private *priv)
+static void woal_drop_tx_info(moal_private *priv,
+			      struct tx_status_info *tx_info, bool ack)
 {
-	struct tx_status_info *tx_info = NULL, *tmp_node;
-	unsigned long flags;
-	struct sk_buff *skb = NULL;
-	spin_lock_irqsave(&priv->tx_stat_lock, flags);
-	list_for_each_entry_safe (tx_info, tmp_node, &priv->tx_stat_queue,
-				  link) {
-		list_del(&tx_info->link);
-		spin_unlock_irqrestore(&priv->tx_stat_lock, flags);
-		skb = (struct sk_buff *)tx_info->tx_skb;
-		if (tx_info->tx_cookie) {
+	struct sk_buff *skb = (struct sk_buff *)tx_info->tx_skb;
+
+	if (tx_info->tx_cookie) {
 #if defined(STA_CFG80211) || defined(UAP_CFG80211)
 #if CFG80211_VERSION_CODE >= KERNEL_VERSION(2, 6, 37)
 #if CFG80211_VERSION_CODE < KERNEL_VERSION(3, 6, 0)
-			cfg80211_mgmt_tx_status(priv->netdev,
-						tx_info->tx_cookie, skb->data,
-						skb->len, true, GFP_ATOMIC);
+		cfg80211_mgmt_tx_status(priv->netdev, tx_info->tx_cookie,
+					skb->data, skb->len, ack, GFP_ATOMIC);
 #else
-			cfg80211_mgmt_tx_status(priv->wdev, tx_info->tx_cookie,
-						skb->data, skb->len, true,
-						GFP_ATOMIC);
+		cfg80211_mgmt_tx_status(priv->wdev, tx_info->tx_cookie,
+					skb->data, skb->len, ack, GFP_ATOMIC);
 #endif
 #endif
 #endif
-		}
-		dev_kfree_skb_any(skb);
-		kfree(tx_info);
-		spin_lock_irqsave(&priv->tx_stat_lock, flags);
 	}
-	INIT_LIST_HEAD(&priv->tx_stat_queue);
-	spin_unlock_irqrestore(&priv->tx_stat_lock, flags);
-	spin_lock_bh(&(priv->tx_q.lock));
-	__skb_queue_purge(&priv->tx_q);
-	spin_unlock_bh(&(priv->tx_q.lock));
+	dev_kfree_skb_any(skb);
+}
+
+/**
+ *  @brief This function flush tx status queue
+ *
+ *  @param priv      A pointer to moal_private structure
+ *
+ *  @return          N/A
+ */
+void woal_flush_tx_stat_queue(moal_private *priv)
+{
+	struct tx_status_info tx_info;
+	int i;
+
+	for (i = 0; i < TX_STAT_TBL_SIZE; i++) {
+		if (woal_take_tx_info(priv, i, &tx_info))
+			woal_drop_tx_info(priv, &tx_info, true);
+	}
+	woal_flush_tx_stage(priv);
 }
 
 /**
- *  @brief This function gets tx info from tx_stat_queue
+ *  @brief This function adds tx info to the tx status table
+ *
+ *  A pending entry with the same tx seq number is older than 255 frames;
+ *  its status is reported as not acked.
  *
  *  @param priv      	A pointer to moal_private structure
  *  @param tx_seq_num   tx seq number
+ *  @param skb          A pointer to the copy of the mgmt frame
+ *  @param cookie       cookie of the mgmt frame
+ *  @param cancel_remain_on_channel  cancel remain on channel on tx status
  *
- *  @return          A pointer to the tcp tx_status_info structure, if found.
- *                   Otherwise, null
+ *  @return          Generation of the entry
  */
-struct tx_status_info *woal_get_tx_info(moal_private *priv, t_u8 tx_seq_num)
+t_u32 woal_add_tx_info(moal_private *priv, t_u8 tx_seq_num,
+		       struct sk_buff *skb, t_u64 cookie,
+		       t_u8 cancel_remain_on_channel)
 {
-	struct tx_status_info *tx_info = NULL;
+	struct tx_status_info *tx_info = &priv->tx_stat_tbl[tx_seq_num];
+	struct tx_status_info old_info;
+	unsigned long flags;
+	t_u32 gen;
 	ENTER();
 
-	list_for_each_entry (tx_info, &priv->tx_stat_queue, link) {
-		if (tx_info->tx_seq_num == tx_seq_num) {
-			LEAVE();
-			return tx_info;
-		}
+	spin_lock_irqsave(&priv->tx_stat_lock, flags);
+	old_info = *tx_info;
+	if (!++priv->tx_stat_gen)
+		priv->tx_stat_gen = 1;
+	gen = priv->tx_stat_gen;
+	tx_info->tx_gen = gen;
+	tx_info->tx_cookie = cookie;
+	tx_info->cancel_remain_on_channel = cancel_remain_on_channel;
+	tx_info->tx_skb = skb;
+	spin_unlock_irqrestore(&priv->tx_stat_lock, flags);
+	if (old_info.tx_skb) {
+		PRINTM(MINFO, "Replace stale tx status entry %d\n", tx_seq_num);
+		woal_drop_tx_info(priv, &old_info, false);
 	}
 	LEAVE();
-	return NULL;
+	return gen;
+}
+
+/**
+ *  @brief This function takes tx info out of the tx status table
+ *
+ *  @param priv      	A pointer to moal_private structure
+ *  @param tx_seq_num   tx seq number
+ *  @param tx_info      A pointer to return the tx_status_info
+ *
+ *  @return          MTRUE if the entry is in use, otherwise MFALSE
+ */
+t_u8 woal_take_tx_info(moal_private *priv, t_u8 tx_seq_num,
+		       struct tx_status_info *tx_info)
+{
+	struct tx_status_info *entry = &priv->tx_stat_tbl[tx_seq_num];
+	unsigned long flags;
+	t_u8 ret = MFALSE;
+
+	spin_lock_irqsave(&priv->tx_stat_lock, flags);
+	if (entry->tx_skb) {
+		*tx_info = *entry;
+		memset(entry, 0, sizeof(*entry));
+		ret = MTRUE;
+	}
+	spin_unlock_irqrestore(&priv->tx_stat_lock, flags);
+	return ret;
 }
 
 /**
@@ -7051,29 +7441,62 @@ struct tx_status_info *woal_get_tx_info(moal_private *priv, t_u8 tx_seq_num)
  *
  *  @param priv      		A pointer to moal_private structure
  *  @param tx_seq_num           tx seq number
+ *  @param gen                  generation returned by woal_add_tx_info
  *
  *  @return	         N/A
  */
-void woal_remove_tx_info(moal_private *priv, t_u8 tx_seq_num)
+void woal_remove_tx_info(moal_private *priv, t_u8 tx_seq_num, t_u32 gen)
 {
-	struct tx_status_info *tx_info, *tmp = NULL;
+	struct tx_status_info *tx_info = &priv->tx_stat_tbl[tx_seq_num];
+	struct sk_buff *skb = NULL;
 	unsigned long flags;
 	ENTER();
 
 	spin_lock_irqsave(&priv->tx_stat_lock, flags);
-	list_for_each_entry_safe (tx_info, tmp, &priv->tx_stat_queue, link) {
-		if (tx_info->tx_seq_num == tx_seq_num) {
-			list_del(&tx_info->link);
-			dev_kfree_skb_any((struct sk_buff *)tx_info->tx_skb);
-			kfree(tx_info);
-			break;
-		}
+	/* The entry may have been reused for a newer frame */
+	if (tx_info->tx_gen == gen) {
+		skb = (struct sk_buff *)tx_info->tx_skb;
+		memset(tx_info, 0, sizeof(*tx_info));
 	}
 	spin_unlock_irqrestore(&priv->tx_stat_lock, flags);
+	if (skb)
+		dev_kfree_skb_any(skb);
 
 	LEAVE();
 }
 
+/**
+ *  @brief This function initializes mcast list
+ *
+ *  @param priv      A pointer to moal_private structure
+ *
+ *  @return          N/A
+ */
+void woal_init_mcast_list(moal_private *priv)
+{
+	int i;
+
+	INIT_LIST_HEAD(&priv->mcast_list);
+	for (i = 0; i < MCAST_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&priv->mcast_hash[i]);
+	spin_lock_init(&priv->mcast_lock);
+}
+
+/**
+ *  @brief This function gets the hash bucket of a mcast address
+ *
+ *  @param priv      A pointer to moal_private structure
+ *  @param addr      A pointer to mcast address
+ *
+ *  @return          A pointer to the hash bucket
+ */
+static inline struct list_head *woal_mcast_bucket(moal_private *priv,
+						  t_u8 *addr)
+{
+	return &priv->mcast_hash[jhash(addr, ETH_ALEN, 0) &
+				 (MCAST_HASH_SIZE - 1)];
+}
+
 /**
  *  @brief This function flush mcast list
  *
@@ -7088,11 +7511,13 @@ void woal_flush_mcast_list(moal_private *priv)
 	spin_lock_irqsave(&priv->mcast_lock, flags);
 	list_for_each_entry_safe (node, tmp_node, &priv->mcast_list, link) {
 		list_del(&node->link);
-		kfree(node);
+		list_del_rcu(&node->hash_link);
+		kfree_rcu(node, rcu);
 	}
 	INIT_LIST_HEAD(&priv->mcast_list);
 	priv->num_mcast_addr = 0;
 	spin_unlock_irqrestore(&priv->mcast_lock, flags);
+	woal_flush_tx_flow_cache(priv);
 }
 
 /**
@@ -7100,28 +7525,42 @@ void woal_flush_mcast_list(moal_private *priv)
  *
  *  @param priv      A pointer to moal_private structure
  *  @param skb       A pointer to skb buffer.
+ *  @param hash      Flow hash of the packet
  *
  *  @return          N/A
  */
-t_u8 woal_find_mcast_node_tx(moal_private *priv, struct sk_buff *skb)
+t_u8 woal_find_mcast_node_tx(moal_private *priv, struct sk_buff *skb,
+			     t_u32 hash)
 {
 	struct mcast_node *node = NULL;
-	unsigned long flags;
+	struct list_head *head;
 	t_u8 ret = MFALSE;
 	t_u8 ra[MLAN_MAC_ADDR_LENGTH] = {0};
+	t_u32 gen;
+	t_u8 flow;
 	ENTER();
+	flow = woal_get_tx_flow(priv, hash, skb->data, 0, NULL, &gen);
+	if (flow & TX_FLOW_MCAST_CHECKED) {
+		LEAVE();
+		return (flow & TX_FLOW_MCAST) ? MTRUE : MFALSE;
+	}
 	moal_memcpy_ext(priv->phandle, ra, skb->data, MLAN_MAC_ADDR_LENGTH,
 			sizeof(ra));
 	//    if (ra[0] & 0x01){
-	spin_lock_irqsave(&priv->mcast_lock, flags);
-	list_for_each_entry (node, &priv->mcast_list, link) {
+	/* Lockless lookup, the lists are only changed under mcast_lock */
+	head = woal_mcast_bucket(priv, ra);
+	rcu_read_lock();
+	list_for_each_entry_rcu (node, head, hash_link) {
 		if (!memcmp(node->mcast_addr, ra, ETH_ALEN)) {
 			ret = MTRUE;
 			break;
 		}
 	}
-	spin_unlock_irqrestore(&priv->mcast_lock, flags);
+	rcu_read_unlock();
 	//    }
+	woal_set_tx_flow(priv, hash, ra, gen,
+			 TX_FLOW_MCAST_CHECKED | (ret ? TX_FLOW_MCAST : 0), 0,
+			 0);
 	LEAVE();
 	return ret;
 }
@@ -7137,11 +7576,13 @@ t_u8 woal_find_mcast_node_tx(moal_private *priv, struct sk_buff *skb)
 t_void woal_add_mcast_node(moal_private *priv, t_u8 *mcast_addr)
 {
 	struct mcast_node *node = NULL;
+	struct list_head *head;
 	unsigned long flags;
 	t_u8 find_node = MFALSE;
 	if (priv) {
+		head = woal_mcast_bucket(priv, mcast_addr);
 		spin_lock_irqsave(&priv->mcast_lock, flags);
-		list_for_each_entry (node, &priv->mcast_list, link) {
+		list_for_each_entry (node, head, hash_link) {
 			if (!memcmp(node->mcast_addr, mcast_addr, ETH_ALEN)) {
 				find_node = MTRUE;
 				break;
@@ -7155,12 +7596,14 @@ t_void woal_add_mcast_node(moal_private *priv, t_u8 *mcast_addr)
 						mcast_addr, ETH_ALEN, ETH_ALEN);
 				INIT_LIST_HEAD(&node->link);
 				list_add_tail(&node->link, &priv->mcast_list);
+				list_add_tail_rcu(&node->hash_link, head);
 				PRINTM(MCMND,
 				       "Add to mcast list: node=" MACSTR "\n",
 				       MAC2STR(mcast_addr));
 			}
 		}
 		spin_unlock_irqrestore(&priv->mcast_lock, flags);
+		woal_flush_tx_flow_cache(priv);
 	}
 }
 
@@ -7174,19 +7617,24 @@ t_void woal_add_mcast_node(moal_private *priv, t_u8 *mcast_addr)
  */
 void woal_remove_mcast_node(moal_private *priv, t_u8 *mcast_addr)
 {
-	struct mcast_node *node, *tmp = NULL;
+	struct mcast_node *node = NULL;
+	struct list_head *head;
 	unsigned long flags;
 	ENTER();
 
+	head = woal_mcast_bucket(priv, mcast_addr);
 	spin_lock_irqsave(&priv->mcast_lock, flags);
-	list_for_each_entry_safe (node, tmp, &priv->mcast_list, link) {
+	list_for_each_entry (node, head, hash_link) {
 		if (!memcmp(node->mcast_addr, mcast_addr, ETH_ALEN)) {
 			list_del(&node->link);
-			kfree(node);
+			list_del_rcu(&node->hash_link);
+			/* Readers on the TX path may still see the node */
+			kfree_rcu(node, rcu);
 			break;
 		}
 	}
 	spin_unlock_irqrestore(&priv->mcast_lock, flags);
+	woal_flush_tx_flow_cache(priv);
 
 	LEAVE();
 }
@@ -7206,11 +7654,13 @@ void woal_flush_tdls_list(moal_private *priv)
 	spin_lock_irqsave(&priv->tdls_lock, flags);
 	list_for_each_entry_safe (peer, tmp_node, &priv->tdls_list, link) {
 		list_del(&peer->link);
-		kfree(peer);
+		list_del_rcu(&peer->hash_link);
+		kfree_rcu(peer, rcu);
 	}
 	INIT_LIST_HEAD(&priv->tdls_list);
 	spin_unlock_irqrestore(&priv->tdls_lock, flags);
 	priv->tdls_check_tx = MFALSE;
+	woal_flush_tx_flow_cache(priv);
 }
 
 #if CFG80211_VERSION_CODE >= KERNEL_VERSION(3, 8, 0)
@@ -7219,101 +7669,166 @@ void woal_flush_tdls_list(moal_private *priv)
  *
  *  @param priv      A pointer to moal_private structure
  *  @param skb       A pointer to skb buffer.
+ *  @param hash      Flow hash of the packet
  *
  *  @return          N/A
  */
-static void woal_tdls_check_tx(moal_private *priv, struct sk_buff *skb)
+static void woal_tdls_check_tx(moal_private *priv, struct sk_buff *skb,
+			       t_u32 hash)
 {
 	struct tdls_peer *peer = NULL;
 	unsigned long flags;
 	t_u8 ra[MLAN_MAC_ADDR_LENGTH] = {0};
+	t_u32 gen;
+	t_u8 flow;
 	ENTER();
+	/* Only packets to a TDLS peer need the check */
+	flow = woal_get_tx_flow(priv, hash, skb->data, 0, NULL, &gen);
+	if ((flow & TX_FLOW_TDLS_CHECKED) && !(flow & TX_FLOW_TDLS)) {
+		LEAVE();
+		return;
+	}
+	flow = TX_FLOW_TDLS_CHECKED;
 	moal_memcpy_ext(priv->phandle, ra, skb->data, MLAN_MAC_ADDR_LENGTH,
 			sizeof(ra));
-	spin_lock_irqsave(&priv->tdls_lock, flags);
-	list_for_each_entry (peer, &priv->tdls_list, link) {
-		if (!memcmp(peer->peer_addr, ra, ETH_ALEN)) {
-			if (peer->rssi &&
-			    (peer->rssi <= TDLS_RSSI_HIGH_THRESHOLD)) {
-				if ((peer->link_status == TDLS_NOT_SETUP) &&
-				    (peer->num_failure <
-				     TDLS_MAX_FAILURE_COUNT)) {
-					peer->link_status =
-						TDLS_SETUP_INPROGRESS;
-					PRINTM(MMSG,
-					       "Wlan: Set up TDLS link,peer=" MACSTR
-					       " rssi=%d\n",
-					       MAC2STR(peer->peer_addr),
-					       -peer->rssi);
-					cfg80211_tdls_oper_request(
-						priv->netdev, peer->peer_addr,
-						NL80211_TDLS_SETUP, 0,
-						GFP_ATOMIC);
-					priv->tdls_check_tx = MFALSE;
-				}
-			}
+	rcu_read_lock();
+	list_for_each_entry_rcu (peer, &priv->tdls_hash[TDLS_HASH(ra)],
+				 hash_link) {
+		if (memcmp(peer->peer_addr, ra, ETH_ALEN))
+			continue;
+		flow |= TX_FLOW_TDLS;
+		if (!peer->rssi || (peer->rssi > TDLS_RSSI_HIGH_THRESHOLD) ||
+		    (peer->link_status != TDLS_NOT_SETUP))
 			break;
-		}
+		/* Recheck under the lock before starting the setup */
+		spin_lock_irqsave(&priv->tdls_lock, flags);
+		if ((peer->link_status == TDLS_NOT_SETUP) &&
+		    (peer->num_failure < TDLS_MAX_FAILURE_COUNT)) {
+			peer->link_status = TDLS_SETUP_INPROGRESS;
+			PRINTM(MMSG,
+			       "Wlan: Set up TDLS link,peer=" MACSTR
+			       " rssi=%d\n",
+			       MAC2STR(peer->peer_addr), -peer->rssi);
+			cfg80211_tdls_oper_request(priv->netdev,
+						   peer->peer_addr,
+						   NL80211_TDLS_SETUP, 0,
+						   GFP_ATOMIC);
+			priv->tdls_check_tx = MFALSE;
+		}
+		spin_unlock_irqrestore(&priv->tdls_lock, flags);
+		break;
 	}
-	spin_unlock_irqrestore(&priv->tdls_lock, flags);
+	rcu_read_unlock();
+	woal_set_tx_flow(priv, hash, ra, gen, flow, 0, 0);
 	LEAVE();
 }
 #endif
 #endif
 
+static void woal_tcp_ack_timer_func(void *context);
+
 /**
- *  @brief This function flush tcp session queue
+ *  @brief This function initializes tcp session queue
  *
  *  @param priv      A pointer to moal_private structure
  *
  *  @return          N/A
  */
-void woal_flush_tcp_sess_queue(moal_private *priv)
+void woal_init_tcp_sess_queue(moal_private *priv)
 {
-	struct tcp_sess *tcp_sess = NULL, *tmp_node;
-	unsigned long flags;
-	struct sk_buff *skb;
-	spin_lock_irqsave(&priv->tcp_sess_lock, flags);
-	list_for_each_entry_safe (tcp_sess, tmp_node, &priv->tcp_sess_queue,
-				  link) {
-		list_del(&tcp_sess->link);
-		if (atomic_read(&tcp_sess->is_timer_set))
-			woal_cancel_timer(&tcp_sess->ack_timer);
-		skb = (struct sk_buff *)tcp_sess->ack_skb;
-		if (skb)
-			dev_kfree_skb_any(skb);
-		kfree(tcp_sess);
-	}
-	INIT_LIST_HEAD(&priv->tcp_sess_queue);
+	int i;
+
+	for (i = 0; i < TCP_SESS_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&priv->tcp_sess_hash[i]);
+	priv->tcp_sess_ageout_idx = 0;
+	INIT_LIST_HEAD(&priv->tcp_ack_hold_list);
+	woal_initialize_timer(&priv->tcp_ack_timer, woal_tcp_ack_timer_func,
+			      priv);
+	priv->tcp_ack_timer_set = MFALSE;
+	spin_lock_init(&priv->tcp_sess_lock);
+}
+
+/**
+ *  @brief This function removes a tcp session and frees its held ack
+ *
+ *  @param tcp_sess  A pointer to tcp session
+ *
+ *  @return          N/A
+ */
+static void woal_free_tcp_sess(struct tcp_sess *tcp_sess)
+{
+	struct sk_buff *skb;
+
+	list_del(&tcp_sess->link);
+	if (!list_empty(&tcp_sess->hold_link))
+		list_del(&tcp_sess->hold_link);
+	skb = (struct sk_buff *)tcp_sess->ack_skb;
+	if (skb)
+		dev_kfree_skb_any(skb);
+	kmem_cache_free(tcp_sess_cache, tcp_sess);
+}
+
+/**
+ *  @brief This function flush tcp session queue
+ *
+ *  @param priv      A pointer to moal_private structure
+ *
+ *  @return          N/A
+ */
+void woal_flush_tcp_sess_queue(moal_private *priv)
+{
+	struct tcp_sess *tcp_sess = NULL, *tmp_node;
+	unsigned long flags;
+	int i;
+	woal_cancel_timer(&priv->tcp_ack_timer);
+	spin_lock_irqsave(&priv->tcp_sess_lock, flags);
+	priv->tcp_ack_timer_set = MFALSE;
+	for (i = 0; i < TCP_SESS_HASH_SIZE; i++) {
+		list_for_each_entry_safe (tcp_sess, tmp_node,
+					  &priv->tcp_sess_hash[i], link)
+			woal_free_tcp_sess(tcp_sess);
+	}
+	INIT_LIST_HEAD(&priv->tcp_ack_hold_list);
 	priv->tcp_ack_drop_cnt = 0;
 	priv->tcp_ack_cnt = 0;
+	priv->tcp_ack_hold_cnt = 0;
+	priv->tcp_ack_flush_cnt = 0;
+	priv->tcp_ack_timer_cnt = 0;
 	spin_unlock_irqrestore(&priv->tcp_sess_lock, flags);
 }
 
 /**
- *  @brief This function gets tcp session from the tcp session queue
+ *  @brief This function gets the tcp session hash bucket of a key
  *
  *  @param priv      A pointer to moal_private structure
- *  @param src_ip    IP address of the device
- *  @param src_port  TCP port of the device
- *  @param dst_ip    IP address of the client
- *  @param dst_port  TCP port of the client
+ *  @param key       A pointer to tcp session key
+ *
+ *  @return          A pointer to the hash bucket
+ */
+static inline struct list_head *woal_tcp_sess_bucket(moal_private *priv,
+						     struct tcp_sess_key *key)
+{
+	return &priv->tcp_sess_hash[jhash2((u32 *)key, sizeof(*key) / 4, 0) &
+				    (TCP_SESS_HASH_SIZE - 1)];
+}
+
+/**
+ *  @brief This function gets tcp session from the tcp session queue
+ *
+ *  @param head      A pointer to the hash bucket of the key
+ *  @param key       A pointer to tcp session key
  *
  *  @return          A pointer to the tcp session data structure, if found.
  *                   Otherwise, null
  */
-static inline struct tcp_sess *woal_get_tcp_sess(moal_private *priv,
-						 t_u32 src_ip, t_u16 src_port,
-						 t_u32 dst_ip, t_u16 dst_port)
+static inline struct tcp_sess *woal_get_tcp_sess(struct list_head *head,
+						 struct tcp_sess_key *key)
 {
 	struct tcp_sess *tcp_sess = NULL;
 	ENTER();
 
-	list_for_each_entry (tcp_sess, &priv->tcp_sess_queue, link) {
-		if ((tcp_sess->src_ip_addr == src_ip) &&
-		    (tcp_sess->src_tcp_port == src_port) &&
-		    (tcp_sess->dst_ip_addr == dst_ip) &&
-		    (tcp_sess->dst_tcp_port == dst_port)) {
+	list_for_each_entry (tcp_sess, head, link) {
+		if (!memcmp(&tcp_sess->key, key, sizeof(*key))) {
 			LEAVE();
 			return tcp_sess;
 		}
@@ -7324,154 +7839,212 @@ static inline struct tcp_sess *woal_get_tcp_sess(moal_private *priv,
 
 #define TCP_SESS_AGEOUT 300
 /**
- *  @brief This function flush tcp session queue
+ *  @brief This function ages out the tcp sessions of a hash bucket
  *
- *  @param priv      A pointer to moal_private structure
+ *  @param head      A pointer to the hash bucket
+ *  @param t         Current time
  *
  *  @return          N/A
  */
-static void woal_ageout_tcp_sess_queue(moal_private *priv)
+static void woal_ageout_tcp_sess_bucket(struct list_head *head,
+					wifi_timeval *t)
 {
 	struct tcp_sess *tcp_sess = NULL, *tmp_node;
-	wifi_timeval t;
-	struct sk_buff *skb;
-	woal_get_monotonic_time(&t);
-	list_for_each_entry_safe (tcp_sess, tmp_node, &priv->tcp_sess_queue,
-				  link) {
-		if (t.time_sec >
+
+	list_for_each_entry_safe (tcp_sess, tmp_node, head, link) {
+		if (t->time_sec >
 		    (tcp_sess->update_time.time_sec + TCP_SESS_AGEOUT)) {
 			PRINTM(MDATA, "wlan: ageout TCP seesion %p\n",
 			       tcp_sess);
-			list_del(&tcp_sess->link);
-			if (atomic_read(&tcp_sess->is_timer_set))
-				woal_cancel_timer(&tcp_sess->ack_timer);
-			skb = (struct sk_buff *)tcp_sess->ack_skb;
-			if (skb)
-				dev_kfree_skb_any(skb);
-			kfree(tcp_sess);
+			woal_free_tcp_sess(tcp_sess);
 		}
 	}
 }
 
 /**
- *  @brief This function send the holding tcp ack packet
- *  re-assoc thread.
+ *  @brief This function ages out tcp sessions
+ *
+ *  The bucket of a new session and one more bucket in turn are aged out,
+ *  so every bucket is visited without walking the whole hash.
+ *
+ *  @param priv      A pointer to moal_private structure
+ *  @param head      A pointer to the hash bucket of the new session
+ *
+ *  @return          N/A
+ */
+static void woal_ageout_tcp_sess_queue(moal_private *priv,
+				       struct list_head *head)
+{
+	wifi_timeval t;
+	woal_get_monotonic_time(&t);
+	woal_ageout_tcp_sess_bucket(head, &t);
+	woal_ageout_tcp_sess_bucket(
+		&priv->tcp_sess_hash[priv->tcp_sess_ageout_idx], &t);
+	priv->tcp_sess_ageout_idx =
+		(priv->tcp_sess_ageout_idx + 1) & (TCP_SESS_HASH_SIZE - 1);
+}
+
+#if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
+/**
+ *  @brief This function accounts a packet queued to MLAN on its kernel
+ *  TX queue and stops the queue when it is full
+ *
+ *  With tx_bql the queue is sized in bytes by the kernel, MAX_TX_PENDING
+ *  is kept as a hard limit on the number of packets. It must be called
+ *  before mlan_send_packet(), MLAN may complete the packet before that
+ *  call returns. A packet MLAN does not queue is taken back with
+ *  woal_tx_queue_completed().
+ *
+ *  @param priv     A pointer to moal_private structure
+ *  @param len      Length of the packet
+ *  @param index    Kernel TX queue index
  *
- *  @param context  A pointer to context
  *  @return         N/A
  */
-static void woal_tcp_ack_timer_func(void *context)
+void woal_tx_queue_sent(moal_private *priv, t_u32 len, t_u32 index)
 {
-	struct tcp_sess *tcp_session = (struct tcp_sess *)context;
-	moal_private *priv = (moal_private *)tcp_session->priv;
+	struct netdev_queue *txq;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 3, 0)
 	unsigned long flags;
-	mlan_buffer *pmbuf;
-	struct sk_buff *skb;
-	mlan_status status;
-#if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
-	t_u32 index = 0;
 #endif
-	ENTER();
-	spin_lock_irqsave(&priv->tcp_sess_lock, flags);
-	atomic_set(&tcp_session->is_timer_set, MFALSE);
-	skb = (struct sk_buff *)tcp_session->ack_skb;
-	pmbuf = (mlan_buffer *)tcp_session->pmbuf;
-	tcp_session->ack_skb = NULL;
-	tcp_session->pmbuf = NULL;
-	spin_unlock_irqrestore(&priv->tcp_sess_lock, flags);
-	if (skb && pmbuf) {
-#if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
-		index = skb_get_queue_mapping(skb);
+
+#ifdef UAP_SUPPORT
+#if defined(UAP_CFG80211) || defined(STA_CFG80211)
+	/* Completion is accounted on the parent interface */
+	if (priv->wdev && priv->wdev->iftype == NL80211_IFTYPE_AP_VLAN)
+		priv = priv->parent_priv;
 #endif
-		status = mlan_send_packet(priv->phandle->pmlan_adapter, pmbuf);
-		switch (status) {
-		case MLAN_STATUS_PENDING:
-			atomic_inc(&priv->phandle->tx_pending);
-#if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
-			atomic_inc(&priv->wmm_tx_pending[index]);
-			if (atomic_read(&priv->wmm_tx_pending[index]) >=
-			    MAX_TX_PENDING) {
-				struct netdev_queue *txq = netdev_get_tx_queue(
-					priv->netdev, index);
-				netif_tx_stop_queue(txq);
-				moal_tp_accounting_rx_param(
-					(t_void *)priv->phandle, 8, 0);
-				PRINTM(MINFO, "Stop Kernel Queue : %d\n",
-				       index);
-			}
-#else
-			if (atomic_read(&priv->phandle->tx_pending) >=
-			    MAX_TX_PENDING)
-				woal_stop_queue(priv->netdev);
-#endif /*#if LINUX_VERSION_CODE > KERNEL_VERSION(2,6,29)*/
-			queue_work(priv->phandle->workqueue,
-				   &priv->phandle->main_work);
-			break;
-		case MLAN_STATUS_SUCCESS:
-			priv->stats.tx_packets++;
-			priv->stats.tx_bytes += skb->len;
-			dev_kfree_skb_any(skb);
-			break;
-		case MLAN_STATUS_FAILURE:
-		default:
-			priv->stats.tx_dropped++;
-			dev_kfree_skb_any(skb);
-			break;
+#endif
+	txq = netdev_get_tx_queue(priv->netdev, index);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 3, 0)
+	if (moal_extflg_isset(priv->phandle, EXT_TX_BQL)) {
+		spin_lock_irqsave(&priv->bql_lock, flags);
+		netdev_tx_sent_queue(txq, len);
+		priv->bql_inflight[index] += len;
+		spin_unlock_irqrestore(&priv->bql_lock, flags);
+	}
+#endif
+	if (atomic_inc_return(&priv->wmm_tx_pending[index]) >= MAX_TX_PENDING) {
+		netif_tx_stop_queue(txq);
+		moal_tp_accounting_rx_param((t_void *)priv->phandle, 8, 0);
+		PRINTM(MINFO, "Stop Kernel Queue : %d\n", index);
+	}
+}
+
+/**
+ *  @brief This function accounts a completed packet on its kernel TX
+ *  queue and wakes the queue when there is room again
+ *
+ *  The bytes reported are capped at what is in flight, so a completion
+ *  for a packet sent before woal_tx_queue_reset() cannot underflow the
+ *  byte queue limits.
+ *
+ *  @param priv     A pointer to moal_private structure
+ *  @param len      Length of the packet
+ *  @param index    Kernel TX queue index
+ *
+ *  @return         N/A
+ */
+void woal_tx_queue_completed(moal_private *priv, t_u32 len, t_u32 index)
+{
+	struct netdev_queue *txq;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 3, 0)
+	unsigned long flags;
+#endif
+
+#ifdef UAP_SUPPORT
+#if defined(UAP_CFG80211) || defined(STA_CFG80211)
+	/* Sent packets are accounted on the parent interface */
+	if (priv->wdev && priv->wdev->iftype == NL80211_IFTYPE_AP_VLAN)
+		priv = priv->parent_priv;
+#endif
+#endif
+	txq = netdev_get_tx_queue(priv->netdev, index);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 3, 0)
+	if (moal_extflg_isset(priv->phandle, EXT_TX_BQL)) {
+		spin_lock_irqsave(&priv->bql_lock, flags);
+		len = MIN(len, priv->bql_inflight[index]);
+		if (len) {
+			priv->bql_inflight[index] -= len;
+			netdev_tx_completed_queue(txq, 1, len);
+		}
+		spin_unlock_irqrestore(&priv->bql_lock, flags);
+	}
+#endif
+	if (atomic_dec_return(&priv->wmm_tx_pending[index]) == LOW_TX_PENDING) {
+		if (netif_tx_queue_stopped(txq)) {
+			netif_tx_wake_queue(txq);
+			PRINTM(MINFO, "Wakeup Kernel Queue:%d\n", index);
 		}
 	}
-	LEAVE();
-	return;
 }
 
 /**
- *  @brief This function send the tcp ack
+ *  @brief This function resets the byte queue limits of all kernel TX
+ *  queues of an interface
  *
+ *  Packets dropped without a completion, e.g. across a close or a
+ *  firmware reset, would otherwise leave their bytes in flight and keep
+ *  the queue stopped. Completions still to come for packets sent before
+ *  the reset are capped by woal_tx_queue_completed().
+ *
+ *  @param priv     A pointer to moal_private structure
  *
- *  @param priv         A pointer to moal_private structure
- *  @param tcp_session  A pointer to tcp_session
  *  @return         N/A
  */
-static void woal_send_tcp_ack(moal_private *priv, struct tcp_sess *tcp_session)
+void woal_tx_queue_reset(moal_private *priv)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 3, 0)
+	unsigned long flags;
+	t_u32 index;
+
+	spin_lock_irqsave(&priv->bql_lock, flags);
+	for (index = 0; index < ARRAY_SIZE(priv->bql_inflight) &&
+			index < priv->netdev->num_tx_queues;
+	     index++) {
+		netdev_tx_reset_queue(netdev_get_tx_queue(priv->netdev, index));
+		priv->bql_inflight[index] = 0;
+	}
+	spin_unlock_irqrestore(&priv->bql_lock, flags);
+#endif
+}
+#endif
+
+/**
+ *  @brief This function sends a tcp ack taken from its session
+ *
+ *  @param priv     A pointer to moal_private structure
+ *  @param skb      A pointer to the tcp ack skb
+ *  @param pmbuf    A pointer to mlan_buffer of the skb
+ *
+ *  @return         MTRUE if the ack is queued to MLAN, otherwise MFALSE
+ */
+static t_u8 woal_send_held_tcp_ack(moal_private *priv, struct sk_buff *skb,
+				   mlan_buffer *pmbuf)
 {
 	mlan_status status;
-	struct sk_buff *skb = (struct sk_buff *)tcp_session->ack_skb;
-	mlan_buffer *pmbuf = (mlan_buffer *)tcp_session->pmbuf;
+	t_u32 len = skb->len;
 #if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
 	t_u32 index = 0;
 #endif
-	ENTER();
-	if (atomic_cmpxchg(&tcp_session->is_timer_set, MTRUE, MFALSE)) {
-		woal_cancel_timer(&tcp_session->ack_timer);
-	}
-	tcp_session->ack_skb = NULL;
-	tcp_session->pmbuf = NULL;
+
+	/* Account before MLAN owns the skb, it may complete it at once */
+	atomic_inc(&priv->phandle->tx_pending);
 #if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
 	index = skb_get_queue_mapping(skb);
+	woal_tx_queue_sent(priv, len, index);
 #endif
 	status = mlan_send_packet(priv->phandle->pmlan_adapter, pmbuf);
 	switch (status) {
 	case MLAN_STATUS_PENDING:
-		atomic_inc(&priv->phandle->tx_pending);
-#if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
-		atomic_inc(&priv->wmm_tx_pending[index]);
-		if (atomic_read(&priv->wmm_tx_pending[index]) >=
-		    MAX_TX_PENDING) {
-			struct netdev_queue *txq =
-				netdev_get_tx_queue(priv->netdev, index);
-			netif_tx_stop_queue(txq);
-			moal_tp_accounting_rx_param((t_void *)priv->phandle, 8,
-						    0);
-			PRINTM(MINFO, "Stop Kernel Queue : %d\n", index);
-		}
-#else
+#if LINUX_VERSION_CODE <= KERNEL_VERSION(2, 6, 29)
 		if (atomic_read(&priv->phandle->tx_pending) >= MAX_TX_PENDING)
 			woal_stop_queue(priv->netdev);
-#endif /*#if LINUX_VERSION_CODE > KERNEL_VERSION(2,6,29)*/
-		queue_work(priv->phandle->workqueue, &priv->phandle->main_work);
-		break;
+#endif
+		return MTRUE;
 	case MLAN_STATUS_SUCCESS:
 		priv->stats.tx_packets++;
-		priv->stats.tx_bytes += skb->len;
+		priv->stats.tx_bytes += len;
 		dev_kfree_skb_any(skb);
 		break;
 	case MLAN_STATUS_FAILURE:
@@ -7480,6 +8053,111 @@ static void woal_send_tcp_ack(moal_private *priv, struct tcp_sess *tcp_session)
 		dev_kfree_skb_any(skb);
 		break;
 	}
+	atomic_dec(&priv->phandle->tx_pending);
+#if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
+	woal_tx_queue_completed(priv, len, index);
+#endif
+	return MFALSE;
+}
+
+/**
+ *  @brief This function sends the held tcp acks whose hold time is over
+ *
+ *  One timer per interface serves all tcp sessions. The held acks are
+ *  taken off their sessions under the lock and sent in one batch.
+ *
+ *  @param context  A pointer to moal_private structure
+ *  @return         N/A
+ */
+static void woal_tcp_ack_timer_func(void *context)
+{
+	moal_private *priv = (moal_private *)context;
+	struct tcp_sess *tcp_session, *tmp_node;
+	struct sk_buff_head flush_q;
+	unsigned long flags;
+	struct sk_buff *skb;
+	t_u8 queued = MFALSE;
+
+	ENTER();
+	skb_queue_head_init(&flush_q);
+	spin_lock_irqsave(&priv->tcp_sess_lock, flags);
+	priv->tcp_ack_timer_set = MFALSE;
+	priv->tcp_ack_timer_cnt++;
+	list_for_each_entry_safe (tcp_session, tmp_node,
+				  &priv->tcp_ack_hold_list, hold_link) {
+		if (time_before(jiffies, tcp_session->hold_expire))
+			break;
+		list_del_init(&tcp_session->hold_link);
+		skb = (struct sk_buff *)tcp_session->ack_skb;
+		tcp_session->ack_skb = NULL;
+		tcp_session->pmbuf = NULL;
+		if (skb)
+			__skb_queue_tail(&flush_q, skb);
+	}
+	if (!list_empty(&priv->tcp_ack_hold_list)) {
+		priv->tcp_ack_timer_set = MTRUE;
+		woal_mod_timer(&priv->tcp_ack_timer, MOAL_TIMER_1MS);
+	}
+	priv->tcp_ack_flush_cnt += skb_queue_len(&flush_q);
+	spin_unlock_irqrestore(&priv->tcp_sess_lock, flags);
+
+	while ((skb = __skb_dequeue(&flush_q)) != NULL) {
+		if (woal_send_held_tcp_ack(priv, skb,
+					   (mlan_buffer *)skb->head))
+			queued = MTRUE;
+	}
+	if (queued)
+		queue_work(priv->phandle->workqueue, &priv->phandle->main_work);
+	LEAVE();
+	return;
+}
+
+/**
+ *  @brief This function holds a tcp ack in its session
+ *
+ *  Caller must hold tcp_sess_lock.
+ *
+ *  @param priv         A pointer to moal_private structure
+ *  @param tcp_session  A pointer to tcp_session
+ *  @param pmbuf        A pointer to mlan_buffer of the tcp ack
+ *  @return             N/A
+ */
+static void woal_hold_tcp_ack(moal_private *priv, struct tcp_sess *tcp_session,
+			      mlan_buffer *pmbuf)
+{
+	struct sk_buff *skb = (struct sk_buff *)pmbuf->pdesc;
+
+	tcp_session->ack_skb = pmbuf->pdesc;
+	tcp_session->pmbuf = pmbuf;
+	pmbuf->flags |= MLAN_BUF_FLAG_TCP_ACK;
+	skb->cb[0] = 0;
+	tcp_session->hold_expire = jiffies + msecs_to_jiffies(MOAL_TIMER_1MS);
+	list_add_tail(&tcp_session->hold_link, &priv->tcp_ack_hold_list);
+	priv->tcp_ack_hold_cnt++;
+	if (!priv->tcp_ack_timer_set) {
+		priv->tcp_ack_timer_set = MTRUE;
+		woal_mod_timer(&priv->tcp_ack_timer, MOAL_TIMER_1MS);
+	}
+}
+
+/**
+ *  @brief This function send the tcp ack
+ *
+ *
+ *  @param priv         A pointer to moal_private structure
+ *  @param tcp_session  A pointer to tcp_session
+ *  @return         N/A
+ */
+static void woal_send_tcp_ack(moal_private *priv, struct tcp_sess *tcp_session)
+{
+	struct sk_buff *skb = (struct sk_buff *)tcp_session->ack_skb;
+	mlan_buffer *pmbuf = (mlan_buffer *)tcp_session->pmbuf;
+	ENTER();
+	list_del_init(&tcp_session->hold_link);
+	tcp_session->ack_skb = NULL;
+	tcp_session->pmbuf = NULL;
+	if (woal_send_held_tcp_ack(priv, skb, pmbuf))
+		queue_work(priv->phandle->workqueue, &priv->phandle->main_work);
 	LEAVE();
 }
 
@@ -7493,35 +8171,76 @@ static void woal_send_tcp_ack(moal_private *priv, struct tcp_sess *tcp_session)
  * not hold
  *
  */
-static int woal_process_tcp_ack(moal_private *priv, mlan_buffer *pmbuf)
+static int woal_process_tcp_ack(moal_private *priv, mlan_buffer *pmbuf,
+				t_u32 hash)
 {
 	int ret = 0;
 	unsigned long flags;
 	struct tcp_sess *tcp_session;
+	struct tcp_sess_key key;
+	struct list_head *head;
 	struct ethhdr *ethh = NULL;
 	struct iphdr *iph = NULL;
+	struct ipv6hdr *ip6h = NULL;
 	struct tcphdr *tcph = NULL;
 	t_u32 ack_seq;
+	t_u32 payload_len;
+	t_u32 gen;
 	struct sk_buff *skb;
 
 	ENTER();
 
 	/** check the tcp packet */
 	ethh = (struct ethhdr *)(pmbuf->pbuf + pmbuf->data_offset);
-	if (ntohs(ethh->h_proto) != ETH_P_IP) {
+	if (woal_get_tx_flow(priv, hash, ethh->h_dest, 0, NULL, &gen) &
+	    TX_FLOW_NOT_TCP) {
 		LEAVE();
 		return 0;
 	}
-	iph = (struct iphdr *)((t_u8 *)ethh + sizeof(struct ethhdr));
-	if (iph->protocol != IPPROTO_TCP) {
+	memset(&key, 0, sizeof(key));
+	switch (ntohs(ethh->h_proto)) {
+	case ETH_P_IP:
+		iph = (struct iphdr *)((t_u8 *)ethh + sizeof(struct ethhdr));
+		if (iph->protocol != IPPROTO_TCP) {
+			woal_set_tx_flow(priv, hash, ethh->h_dest, gen,
+					 TX_FLOW_NOT_TCP, 0, 0);
+			LEAVE();
+			return 0;
+		}
+		tcph = (struct tcphdr *)((t_u8 *)iph + iph->ihl * 4);
+		payload_len = ntohs(iph->tot_len) - iph->ihl * 4;
+		key.src_ip_addr[0] = (__force t_u32)iph->saddr;
+		key.dst_ip_addr[0] = (__force t_u32)iph->daddr;
+		break;
+	case ETH_P_IPV6:
+		ip6h = (struct ipv6hdr *)((t_u8 *)ethh + sizeof(struct ethhdr));
+		/* ACKs with extension headers are not suppressed */
+		if (ip6h->nexthdr != IPPROTO_TCP) {
+			woal_set_tx_flow(priv, hash, ethh->h_dest, gen,
+					 TX_FLOW_NOT_TCP, 0, 0);
+			LEAVE();
+			return 0;
+		}
+		tcph = (struct tcphdr *)((t_u8 *)ip6h + sizeof(*ip6h));
+		payload_len = ntohs(ip6h->payload_len);
+		moal_memcpy_ext(priv->phandle, key.src_ip_addr, &ip6h->saddr,
+				sizeof(ip6h->saddr), sizeof(key.src_ip_addr));
+		moal_memcpy_ext(priv->phandle, key.dst_ip_addr, &ip6h->daddr,
+				sizeof(ip6h->daddr), sizeof(key.dst_ip_addr));
+		break;
+	default:
+		woal_set_tx_flow(priv, hash, ethh->h_dest, gen,
+				 TX_FLOW_NOT_TCP, 0, 0);
 		LEAVE();
 		return 0;
 	}
-	tcph = (struct tcphdr *)((t_u8 *)iph + iph->ihl * 4);
+	key.src_tcp_port = (__force t_u16)tcph->source;
+	key.dst_tcp_port = (__force t_u16)tcph->dest;
+	key.proto = ntohs(ethh->h_proto);
 
 	if (*((t_u8 *)tcph + 13) == 0x10) {
 		/* Only replace ACK */
-		if (ntohs(iph->tot_len) > (iph->ihl + tcph->doff) * 4) {
+		if (payload_len > tcph->doff * 4) {
 			priv->tcp_ack_payload++;
 			/* Don't drop ACK with payload */
 			/* TODO: should we delete previous TCP session */
@@ -7529,17 +8248,15 @@ static int woal_process_tcp_ack(moal_private *priv, mlan_buffer *pmbuf)
 			return ret;
 		}
 		priv->tcp_ack_cnt++;
+		head = woal_tcp_sess_bucket(priv, &key);
 		spin_lock_irqsave(&priv->tcp_sess_lock, flags);
-		tcp_session = woal_get_tcp_sess(priv, (__force t_u32)iph->saddr,
-						(__force t_u16)tcph->source,
-						(__force t_u32)iph->daddr,
-						(__force t_u16)tcph->dest);
+		tcp_session = woal_get_tcp_sess(head, &key);
 		if (!tcp_session) {
 			/* check any aging out sessions can be removed */
-			woal_ageout_tcp_sess_queue(priv);
+			woal_ageout_tcp_sess_queue(priv, head);
 
-			tcp_session =
-				kmalloc(sizeof(struct tcp_sess), GFP_ATOMIC);
+			tcp_session = kmem_cache_alloc(tcp_sess_cache,
+						       GFP_ATOMIC);
 			if (!tcp_session) {
 				PRINTM(MERROR, "Fail to allocate tcp_sess.\n");
 				spin_unlock_irqrestore(&priv->tcp_sess_lock,
@@ -7550,40 +8267,20 @@ static int woal_process_tcp_ack(moal_private *priv, mlan_buffer *pmbuf)
 			PRINTM(MDATA, "wlan: create TCP seesion %p\n",
 			       tcp_session);
 
-			tcp_session->ack_skb = pmbuf->pdesc;
-			tcp_session->pmbuf = pmbuf;
-			pmbuf->flags |= MLAN_BUF_FLAG_TCP_ACK;
-			tcp_session->src_ip_addr = (__force t_u32)iph->saddr;
-			tcp_session->dst_ip_addr = (__force t_u32)iph->daddr;
-			tcp_session->src_tcp_port = (__force t_u32)tcph->source;
-			tcp_session->dst_tcp_port = (__force t_u32)tcph->dest;
+			tcp_session->key = key;
 			tcp_session->ack_seq = ntohl(tcph->ack_seq);
 			tcp_session->priv = (void *)priv;
-			skb = (struct sk_buff *)pmbuf->pdesc;
-			skb->cb[0] = 0;
-			/* Initialize the timer for tcp ack */
-			woal_initialize_timer(&tcp_session->ack_timer,
-					      woal_tcp_ack_timer_func,
-					      tcp_session);
-			atomic_set(&tcp_session->is_timer_set, MTRUE);
-			woal_mod_timer(&tcp_session->ack_timer, MOAL_TIMER_1MS);
-			list_add_tail(&tcp_session->link,
-				      &priv->tcp_sess_queue);
+			woal_hold_tcp_ack(priv, tcp_session, pmbuf);
+			list_add_tail(&tcp_session->link, head);
 			spin_unlock_irqrestore(&priv->tcp_sess_lock, flags);
 			ret = HOLD_TCP_ACK;
 			LEAVE();
 			return ret;
 		} else if (!tcp_session->ack_skb) {
 			woal_get_monotonic_time(&tcp_session->update_time);
-			tcp_session->ack_skb = pmbuf->pdesc;
-			tcp_session->pmbuf = pmbuf;
-			pmbuf->flags |= MLAN_BUF_FLAG_TCP_ACK;
 			tcp_session->ack_seq = ntohl(tcph->ack_seq);
 			tcp_session->priv = (void *)priv;
-			skb = (struct sk_buff *)pmbuf->pdesc;
-			skb->cb[0] = 0;
-			atomic_set(&tcp_session->is_timer_set, MTRUE);
-			woal_mod_timer(&tcp_session->ack_timer, MOAL_TIMER_1MS);
+			woal_hold_tcp_ack(priv, tcp_session, pmbuf);
 			spin_unlock_irqrestore(&priv->tcp_sess_lock, flags);
 			ret = HOLD_TCP_ACK;
 			LEAVE();
@@ -7796,22 +8493,65 @@ static BOOLEAN woal_check_easymesh_packet(moal_private *priv,
 #endif
 #endif
 
+/**
+ *  @brief This function prepares a packet for the TSO features
+ *
+ *  Packets other than TSO ones are linearized and checksummed here. TSO
+ *  packets keep their fragments, only their headers are made linear for
+ *  MLAN to segment them.
+ *
+ *  @param skb     A pointer to sk_buff structure
+ *
+ *  @return        0 --success, 1 --TSO packet MLAN can not segment,
+ *                 otherwise fail
+ */
+static int woal_tx_offload(struct sk_buff *skb)
+{
+	if (!skb_is_gso(skb)) {
+		if (skb_linearize(skb))
+			return -ENOMEM;
+		if (skb->ip_summed == CHECKSUM_PARTIAL)
+			return skb_checksum_help(skb);
+		return 0;
+	}
+	if (!(skb_shinfo(skb)->gso_type & (SKB_GSO_TCPV4 | SKB_GSO_TCPV6)) ||
+	    skb_network_offset(skb) != ETH_HLEN)
+		return 1;
+	/* IPv6 extension headers are not handled */
+	if ((skb_shinfo(skb)->gso_type & SKB_GSO_TCPV6) &&
+	    skb_transport_offset(skb) != ETH_HLEN + sizeof(struct ipv6hdr))
+		return 1;
+	if (!pskb_may_pull(skb, skb_transport_offset(skb) + tcp_hdrlen(skb)))
+		return -ENOMEM;
+	return 0;
+}
+
 /**
  *  @brief This function handles packet transmission
  *
+ *  The main process is kicked once for a burst of packets: while the
+ *  kernel has more packets to send, the kick is deferred unless the
+ *  TX queue got stopped.
+ *
+ *  @param priv    A pointer to moal_private structure
  *  @param skb     A pointer to sk_buff structure
- *  @param dev     A pointer to net_device structure
+ *  @param more    MTRUE if more packets follow right after this one
  *
  *  @return        N/A
  */
-static void woal_start_xmit(moal_private *priv, struct sk_buff *skb)
+static void woal_start_xmit(moal_private *priv, struct sk_buff *skb,
+			    t_u8 more)
 {
 	mlan_buffer *pmbuf = NULL;
 	mlan_status status;
 	struct sk_buff *new_skb = NULL;
+	struct sk_buff *segs, *next;
+	moal_handle *handle = priv->phandle;
 #if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
 	t_u32 index = 0;
 #endif
+	t_u32 len;
+	t_u32 hash;
 	int ret = 0;
 
 #ifdef UAP_SUPPORT
@@ -7822,9 +8562,11 @@ static void woal_start_xmit(moal_private *priv, struct sk_buff *skb)
 
 	ENTER();
 
+	atomic_inc(&handle->tx_xmit_cnt);
 	priv->num_tx_timeout = 0;
 	if (!skb->len ||
-	    (skb->len > (priv->netdev->mtu + sizeof(struct ethhdr)))) {
+	    (!skb_is_gso(skb) &&
+	     skb->len > (priv->netdev->mtu + sizeof(struct ethhdr)))) {
 		PRINTM(MERROR, "Tx Error: Bad skb length %d : %d\n", skb->len,
 		       priv->netdev->mtu);
 		dev_kfree_skb_any(skb);
@@ -7859,10 +8601,44 @@ static void woal_start_xmit(moal_private *priv, struct sk_buff *skb)
 
 		PRINTM(MINFO, "new skb headroom %d\n", skb_headroom(skb));
 	}
+	if (moal_extflg_isset(handle, EXT_TX_GSO)) {
+		ret = woal_tx_offload(skb);
+		if (ret > 0) {
+			/* Segment it here and send the segments */
+			segs = skb_gso_segment(skb, 0);
+			dev_kfree_skb_any(skb);
+			if (IS_ERR_OR_NULL(segs)) {
+				priv->stats.tx_dropped++;
+				goto done;
+			}
+			for (; segs; segs = next) {
+				next = segs->next;
+				segs->next = NULL;
+				woal_start_xmit(priv, segs,
+						next ? MTRUE : more);
+			}
+			LEAVE();
+			return;
+		}
+		if (ret < 0) {
+			PRINTM(MERROR, "Tx: Cannot prepare skb for TSO\n");
+			dev_kfree_skb_any(skb);
+			priv->stats.tx_dropped++;
+			goto done;
+		}
+	}
 	pmbuf = (mlan_buffer *)skb->head;
 	memset((t_u8 *)pmbuf, 0, sizeof(mlan_buffer));
 	pmbuf->bss_index = priv->bss_index;
-	woal_fill_mlan_buffer(priv, pmbuf, skb);
+	hash = woal_tx_flow_hash(skb);
+	woal_fill_mlan_buffer(priv, pmbuf, skb, hash);
+	if (skb_is_gso(skb)) {
+		pmbuf->flags |= MLAN_BUF_FLAG_TSO;
+		pmbuf->gso_size = skb_shinfo(skb)->gso_size;
+		pmbuf->gso_ip_off = skb_network_offset(skb);
+		pmbuf->gso_tcp_off = skb_transport_offset(skb);
+		pmbuf->gso_hdr_len = pmbuf->gso_tcp_off + tcp_hdrlen(skb);
+	}
 
 #ifdef UAP_SUPPORT
 #if defined(UAP_CFG80211) || defined(STA_CFG80211)
@@ -7873,8 +8649,7 @@ static void woal_start_xmit(moal_private *priv, struct sk_buff *skb)
 		     !priv->media_connected)) {
 			priv->stats.tx_dropped++;
 			dev_kfree_skb_any(skb);
-			LEAVE();
-			return;
+			goto done;
 		}
 		multi_ap_packet = woal_check_easymesh_packet(priv, pmbuf);
 	}
@@ -7882,22 +8657,24 @@ static void woal_start_xmit(moal_private *priv, struct sk_buff *skb)
 #endif
 
 	if (priv->enable_tcp_ack_enh == MTRUE) {
-		ret = woal_process_tcp_ack(priv, pmbuf);
+		ret = woal_process_tcp_ack(priv, pmbuf, hash);
 		if (ret)
 			goto done;
 	}
 #if defined(STA_CFG80211) && defined(UAP_CFG80211)
 #if CFG80211_VERSION_CODE >= KERNEL_VERSION(3, 8, 0)
+	/* TSO packets are segmented in MLAN, they are not monitored */
 	if (priv->phandle->mon_if &&
 	    (priv->phandle->mon_if->flag & MLAN_NETMON_DATA) &&
-	    (priv->phandle->mon_if->flag & MLAN_NETMON_TX))
+	    (priv->phandle->mon_if->flag & MLAN_NETMON_TX) &&
+	    !skb_is_gso(skb))
 		woal_send_tx_pkt_to_mon_if(priv, pmbuf);
 #endif
 #endif
 #ifdef STA_CFG80211
 #if CFG80211_VERSION_CODE >= KERNEL_VERSION(3, 8, 0)
 	if (priv->enable_auto_tdls && priv->tdls_check_tx)
-		woal_tdls_check_tx(priv, skb);
+		woal_tdls_check_tx(priv, skb, hash);
 #endif
 #endif
 #if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
@@ -7912,11 +8689,19 @@ static void woal_start_xmit(moal_private *priv, struct sk_buff *skb)
 		       priv->phandle->tx_time_start.time_sec,
 		       priv->phandle->tx_time_start.time_usec);
 	}
+	/*
+	 * Account before MLAN owns the skb: it may be completed, and freed,
+	 * before mlan_send_packet() returns. The skb is not touched once it
+	 * is pending.
+	 */
+	len = skb->len;
+	atomic_inc(&handle->tx_pending);
+#if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
+	woal_tx_queue_sent(priv, len, index);
+#endif
 	status = mlan_send_packet(priv->phandle->pmlan_adapter, pmbuf);
 	switch (status) {
 	case MLAN_STATUS_PENDING:
-		atomic_inc(&priv->phandle->tx_pending);
-
 #ifdef UAP_SUPPORT
 #if defined(UAP_CFG80211) || defined(STA_CFG80211)
 		if (priv->wdev->iftype == NL80211_IFTYPE_AP_VLAN)
@@ -7925,37 +8710,41 @@ static void woal_start_xmit(moal_private *priv, struct sk_buff *skb)
 #endif
 
 #if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
-		atomic_inc(&priv->wmm_tx_pending[index]);
-		if (atomic_read(&priv->wmm_tx_pending[index]) >=
-		    MAX_TX_PENDING) {
-			struct netdev_queue *txq =
-				netdev_get_tx_queue(priv->netdev, index);
-			netif_tx_stop_queue(txq);
-			moal_tp_accounting_rx_param((t_void *)priv->phandle, 8,
-						    0);
-			PRINTM(MINFO, "Stop Kernel Queue : %d\n", index);
-		}
+		/* No more packet comes from a stopped queue */
+		if (more && woal_tx_queue_stopped(priv->netdev, index))
+			more = MFALSE;
 #else
 		if (atomic_read(&priv->phandle->tx_pending) >= MAX_TX_PENDING)
 			woal_stop_queue(priv->netdev);
+		more = MFALSE;
 #endif /*#if LINUX_VERSION_CODE > KERNEL_VERSION(2,6,29)*/
-
-		if (!mlan_is_main_process_running(priv->phandle->pmlan_adapter))
-			queue_work(priv->phandle->workqueue,
-				   &priv->phandle->main_work);
+		atomic_set(&handle->tx_kick_deferred, MTRUE);
 		break;
 	case MLAN_STATUS_SUCCESS:
 		priv->stats.tx_packets++;
-		priv->stats.tx_bytes += skb->len;
+		priv->stats.tx_bytes += len;
 		dev_kfree_skb_any(skb);
-		break;
+		goto unsent;
 	case MLAN_STATUS_FAILURE:
 	default:
 		priv->stats.tx_dropped++;
 		dev_kfree_skb_any(skb);
-		break;
+		goto unsent;
 	}
+	goto done;
+unsent:
+	/* Not queued to MLAN, take the accounting back */
+	atomic_dec(&handle->tx_pending);
+#if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
+	woal_tx_queue_completed(priv, len, index);
+#endif
 done:
+	/* Kick for the packets queued so far at the end of a burst */
+	if (!more && atomic_xchg(&handle->tx_kick_deferred, MFALSE) &&
+	    !mlan_is_main_process_running(handle->pmlan_adapter)) {
+		atomic_inc(&handle->tx_kick_cnt);
+		queue_work(handle->workqueue, &handle->main_work);
+	}
 	LEAVE();
 	return;
 }
@@ -7971,6 +8760,10 @@ done:
 netdev_tx_t woal_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	moal_private *priv = (moal_private *)netdev_priv(dev);
+	t_u8 more = woal_xmit_more(skb);
+	moal_private *stage_priv;
+	struct sk_buff_head *stage;
+	t_u32 index;
 	ENTER();
 	PRINTM(MDATA, "%lu : %s (bss=%d): Data <= kernel\n", jiffies, dev->name,
 	       priv->bss_index);
@@ -7990,15 +8783,27 @@ netdev_tx_t woal_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
 		goto done;
 	}
 	if (moal_extflg_isset(priv->phandle, EXT_TX_WORK)) {
-		spin_lock_bh(&(priv->tx_q.lock));
-		__skb_queue_tail(&(priv->tx_q), skb);
-		spin_unlock_bh(&(priv->tx_q.lock));
-
-		queue_work(priv->phandle->tx_workqueue,
-			   &priv->phandle->tx_work);
+		index = skb_get_queue_mapping(skb);
+		/* tx work finds the interface from skb->dev */
+		skb->dev = dev;
+		/* The stack serializes the senders of a TX queue, so only
+		 * tx work competes for its staging queue, which keeps the
+		 * order of the TX queue */
+		stage_priv = woal_tx_stage_priv(priv);
+		index %= ARRAY_SIZE(priv->tx_q);
+		stage = &stage_priv->tx_q[index];
+		spin_lock_bh(&stage->lock);
+		TX_STAGE_SEQ(skb) = stage_priv->tx_q_seq[index]++;
+		__skb_queue_tail(stage, skb);
+		spin_unlock_bh(&stage->lock);
+
+		if (!more ||
+		    woal_tx_queue_stopped(dev, skb_get_queue_mapping(skb)))
+			queue_work(priv->phandle->tx_workqueue,
+				   &priv->phandle->tx_work);
 		goto done;
 	}
-	woal_start_xmit(priv, skb);
+	woal_start_xmit(priv, skb, more);
 done:
 	LEAVE();
 	return 0;
@@ -8232,6 +9037,7 @@ void woal_init_priv(moal_private *priv, t_u8 wait_option)
 	int i;
 #endif
 #endif
+	int q;
 
 	ENTER();
 #ifdef STA_SUPPORT
@@ -8306,12 +9112,17 @@ void woal_init_priv(moal_private *priv, t_u8 wait_option)
 	}
 #endif
 
-	skb_queue_head_init(&priv->tx_q);
+	for (q = 0; q < (int)ARRAY_SIZE(priv->tx_q); q++)
+		skb_queue_head_init(&priv->tx_q[q]);
+	memset(priv->tx_q_seq, 0, sizeof(priv->tx_q_seq));
+	memset(priv->tx_q_next, 0, sizeof(priv->tx_q_next));
+	priv->tx_stage_reorder = 0;
 	memset(&priv->tx_protocols, 0, sizeof(dot11_protocol));
 	memset(&priv->rx_protocols, 0, sizeof(dot11_protocol));
 	priv->media_connected = MFALSE;
 
 	memset(priv->dscp_map, 0xFF, sizeof(priv->dscp_map));
+	woal_flush_tx_flow_cache(priv);
 
 #if defined(STA_CFG80211) || defined(UAP_CFG80211)
 	priv->probereq_index = MLAN_CUSTOM_IE_AUTO_IDX_MASK;
@@ -8337,6 +9148,9 @@ void woal_init_priv(moal_private *priv, t_u8 wait_option)
 	priv->tcp_ack_drop_cnt = 0;
 	priv->tcp_ack_cnt = 0;
 	priv->tcp_ack_payload = 0;
+	priv->tcp_ack_hold_cnt = 0;
+	priv->tcp_ack_flush_cnt = 0;
+	priv->tcp_ack_timer_cnt = 0;
 	priv->tcp_ack_max_hold = TCP_ACK_MAX_HOLD;
 
 	priv->enable_auto_tdls = MFALSE;
@@ -9597,6 +10411,7 @@ void woal_update_dscp_mapping(moal_private *priv)
 			}
 		}
 	}
+	woal_flush_tx_flow_cache(priv);
 	kfree(assoc_rsp);
 	LEAVE();
 }
@@ -11361,7 +12176,7 @@ mlan_status woal_request_country_power_table(moal_private *priv, char *country,
 static int woal_netdev_poll_rx(struct napi_struct *napi, int budget)
 {
 	moal_handle *handle = container_of(napi, moal_handle, napi_rx);
-	t_u8 recv = budget;
+	t_u8 recv = MIN(budget, 0xff);
 
 	ENTER();
 	if (handle->surprise_removed == MTRUE) {
@@ -11375,12 +12190,16 @@ static int woal_netdev_poll_rx(struct napi_struct *napi, int budget)
 		LEAVE();
 		return 0;
 	}
+	/* The budget bounds mlan_rx_process; packets delivered from here
+	 * go through napi_gro_receive (see woal_netif_rx) */
+	handle->napi_cpu = smp_processor_id();
 	if (MLAN_STATUS_SUCCESS !=
 	    mlan_rx_process(handle->pmlan_adapter, &recv))
 		PRINTM(MERROR, "%s: mlan_rx_process failed \n", __func__);
+	handle->napi_cpu = -1;
 	if (recv < budget) {
 #if CFG80211_VERSION_CODE >= KERNEL_VERSION(4, 10, 0)
-		if (false == napi_complete(napi))
+		if (false == napi_complete_done(napi, recv))
 			PRINTM(MINFO, "%s: napi_complete with false \n",
 			       __func__);
 #else
@@ -11845,21 +12664,60 @@ t_void woal_pcie_delayed_tx_work(struct work_struct *work)
 #endif // PCIE
 
 /**
- *  @brief This function dequeue pkt from list
+ *  @brief This function moves the packets of all the tx staging queues
+ *         to a list, keeping the order of each queue
  *
+ *  @param handle  A pointer to moal_handle
  *  @param list    A pointer to struct sk_buff_head
  *
- *  @return        skb buffer
+ *  @return        N/A
  */
+static void woal_splice_tx_stage(moal_handle *handle,
+				 struct sk_buff_head *list)
+{
+	moal_private *priv;
+	struct sk_buff_head *stage;
+	int i, j;
 
-static struct sk_buff *woal_skb_dequeue_spinlock(struct sk_buff_head *list)
+	for (i = 0; i < MIN(handle->priv_num, MLAN_MAX_BSS_NUM); i++) {
+		priv = handle->priv[i];
+		if (!priv)
+			continue;
+		for (j = 0; j < (int)ARRAY_SIZE(priv->tx_q); j++) {
+			stage = &priv->tx_q[j];
+			if (skb_queue_empty(stage))
+				continue;
+			spin_lock_bh(&stage->lock);
+			skb_queue_splice_tail_init(stage, list);
+			spin_unlock_bh(&stage->lock);
+		}
+	}
+}
+
+/**
+ *  @brief This function checks that tx work sends the packets of a
+ *         staging queue in the order they were staged
+ *
+ *  Packets flushed from a queue leave gaps in its sequence, only a
+ *  packet older than the last one sent is counted as reordered.
+ *
+ *  @param priv    A pointer to moal_private structure
+ *  @param skb     A pointer to sk_buff structure taken from tx staging
+ *
+ *  @return        N/A
+ */
+static void woal_check_tx_stage_seq(moal_private *priv, struct sk_buff *skb)
 {
-	struct sk_buff *result;
+	moal_private *stage_priv = woal_tx_stage_priv(priv);
+	t_u32 index = skb_get_queue_mapping(skb) % ARRAY_SIZE(priv->tx_q);
+	t_u32 seq = TX_STAGE_SEQ(skb);
 
-	spin_lock_bh(&list->lock);
-	result = __skb_dequeue(list);
-	spin_unlock_bh(&list->lock);
-	return result;
+	if ((t_s32)(seq - stage_priv->tx_q_next[index]) < 0) {
+		stage_priv->tx_stage_reorder++;
+		PRINTM(MERROR, "tx work reorder: queue %u seq %u expected %u\n",
+		       index, seq, stage_priv->tx_q_next[index]);
+	}
+	stage_priv->tx_q_next[index] = seq + 1;
 }
 
 /**
@@ -11873,7 +12731,7 @@ static t_void woal_tx_work_handler(struct work_struct *work)
 {
 	moal_handle *handle = container_of(work, moal_handle, tx_work);
 	moal_private *priv = NULL;
-	int i = 0;
+	struct sk_buff_head list;
 	struct sk_buff *skb = NULL;
 #if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 10) &&                           \
 	LINUX_VERSION_CODE <= KERNEL_VERSION(5, 8, 18)
@@ -11913,10 +12771,15 @@ static t_void woal_tx_work_handler(struct work_struct *work)
 #endif
 	}
 
-	for (i = 0; i < MIN(handle->priv_num, MLAN_MAX_BSS_NUM); i++) {
-		priv = handle->priv[i];
-		while ((skb = woal_skb_dequeue_spinlock(&priv->tx_q)) != NULL) {
-			woal_start_xmit(priv, skb);
+	__skb_queue_head_init(&list);
+	for (;;) {
+		woal_splice_tx_stage(handle, &list);
+		if (skb_queue_empty(&list))
+			break;
+		while ((skb = __skb_dequeue(&list)) != NULL) {
+			priv = (moal_private *)netdev_priv(skb->dev);
+			woal_check_tx_stage_seq(priv, skb);
+			woal_start_xmit(priv, skb, !skb_queue_empty(&list));
 		}
 	}
 
@@ -12161,6 +13024,7 @@ moal_handle *woal_add_card(void *card, struct device *dev, moal_if_ops *if_ops,
 	mlan_status status = MLAN_STATUS_SUCCESS;
 	int netlink_num = NETLINK_NXP;
 	int index = 0;
+	int cpu;
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 6, 0)
 	struct netlink_kernel_cfg cfg = {
 		.groups = NL_MULTICAST_GROUP,
@@ -12505,6 +13369,16 @@ moal_handle *woal_add_card(void *card, struct device *dev, moal_if_ops *if_ops,
 #endif // PCIE
 
 #define NAPI_BUDGET 64
+	handle->napi_cpu = -1;
+	/* RX batching is an optimization, go on without it on failure */
+	handle->rx_batch = alloc_percpu(struct woal_rx_batch);
+	if (handle->rx_batch) {
+		for_each_possible_cpu (cpu)
+			skb_queue_head_init(
+				&per_cpu_ptr(handle->rx_batch, cpu)->skbs);
+	} else {
+		PRINTM(MERROR, "Failed to allocate rx batch\n");
+	}
 	if (moal_extflg_isset(handle, EXT_NAPI)) {
 		init_dummy_netdev(&handle->napi_dev);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 1, 0)
@@ -13205,6 +14079,9 @@ static void woal_post_reset(moal_handle *handle)
 	for (intf_num = 0; intf_num < handle->priv_num; intf_num++) {
 		if (handle->priv[intf_num]) {
 			netif_device_attach(handle->priv[intf_num]->netdev);
+#if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
+			woal_tx_queue_reset(handle->priv[intf_num]);
+#endif
 			woal_start_queue(handle->priv[intf_num]->netdev);
 		}
 	}
@@ -13458,9 +14335,20 @@ static int woal_init_module(void)
 	/* Init mutex */
 	MOAL_INIT_SEMAPHORE(&AddRemoveCardSem);
 
+	tcp_sess_cache = kmem_cache_create("moal_tcp_sess",
+					   sizeof(struct tcp_sess), 0, 0, NULL);
+	if (!tcp_sess_cache) {
+		PRINTM(MERROR,
+		       "woal_init_module: Unable to create TCP session cache\n");
+		LEAVE();
+		return -ENOMEM;
+	}
+
 	if (woal_root_proc_init() != MLAN_STATUS_SUCCESS) {
 		PRINTM(MERROR,
 		       "woal_init_module: Unable to create /proc/mwlan/ directory\n");
+		kmem_cache_destroy(tcp_sess_cache);
+		tcp_sess_cache = NULL;
 		LEAVE();
 		return -EFAULT;
 	}
@@ -13724,6 +14612,8 @@ exit_sem_err:
 	}
 
 	woal_root_proc_remove();
+	kmem_cache_destroy(tcp_sess_cache);
+	tcp_sess_cache = NULL;
 
 	LEAVE();
 }
@@ -48,6 +48,7 @@ Change log:
 #include <uapi/linux/sched/types.h>
 #endif
 #include <linux/timer.h>
+#include <linux/hrtimer.h>
 #include <linux/ioport.h>
 #include <linux/pci.h>
 #include <linux/ctype.h>
@@ -318,6 +319,7 @@ extern struct semaphore AddRemoveCardSem;
 extern int wifi_status;
 extern int max_tx_buf;
 extern int pcie_int_mode;
+extern int pcie_rx_pool;
 
 #ifdef STA_SUPPORT
 #if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
@@ -432,8 +434,23 @@ typedef struct _moal_drv_timer {
 	t_u32 timer_is_periodic;
 	/** Is timer cancelled ? */
 	t_u32 timer_is_canceled;
+	/** High resolution timer, used instead of tl when high_res is set */
+	struct hrtimer hrt;
+	/** Is timer high resolution ? */
+	t_u8 high_res;
 } moal_drv_timer, *pmoal_drv_timer;
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 16, 0)
+/** hrtimer mode, expiring in softirq context like timer_list */
+#define WOAL_HRTIMER_MODE HRTIMER_MODE_REL_SOFT
+#else
+#define WOAL_HRTIMER_MODE HRTIMER_MODE_REL
+#endif
+
+/** Convert milliseconds to ktime */
+#define WOAL_MS_TO_KTIME(ms)                                                   \
+	ktime_set((ms) / 1000, ((ms) % 1000) * NSEC_PER_MSEC)
+
 /**
  *  @brief Timer handler
  *
@@ -490,6 +507,53 @@ static inline void woal_initialize_timer(pmoal_drv_timer timer,
 	timer->timer_is_canceled = MTRUE;
 	timer->time_period = 0;
 	timer->timer_is_periodic = MFALSE;
+	timer->high_res = MFALSE;
+}
+
+/**
+ *  @brief High resolution timer handler
+ *
+ *  @param t		hrtimer structure
+ *
+ *  @return		HRTIMER_RESTART or HRTIMER_NORESTART
+ */
+static inline enum hrtimer_restart woal_hrtimer_handler(struct hrtimer *t)
+{
+	pmoal_drv_timer timer = container_of(t, moal_drv_timer, hrt);
+
+	if (!timer->timer_is_canceled)
+		timer->timer_function(timer->function_context);
+
+	if (timer->timer_is_periodic == MTRUE && !timer->timer_is_canceled) {
+		hrtimer_forward_now(t, WOAL_MS_TO_KTIME(timer->time_period));
+		return HRTIMER_RESTART;
+	}
+	/* The function may have restarted the timer itself */
+	return HRTIMER_NORESTART;
+}
+
+/**
+ *  @brief Initialize high resolution timer
+ *
+ *  @param timer		Timer structure
+ *  @param TimerFunction	Timer function
+ *  @param FunctionContext	Timer function context
+ *
+ *  @return			N/A
+ */
+static inline void woal_initialize_hrtimer(pmoal_drv_timer timer,
+					   void (*TimerFunction)(void *context),
+					   void *FunctionContext)
+{
+	woal_initialize_timer(timer, TimerFunction, FunctionContext);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+	hrtimer_setup(&timer->hrt, woal_hrtimer_handler, CLOCK_MONOTONIC,
+		      WOAL_HRTIMER_MODE);
+#else
+	hrtimer_init(&timer->hrt, CLOCK_MONOTONIC, WOAL_HRTIMER_MODE);
+	timer->hrt.function = woal_hrtimer_handler;
+#endif
+	timer->high_res = MTRUE;
 }
 
 /**
@@ -504,6 +568,12 @@ static inline void woal_mod_timer(pmoal_drv_timer timer,
 				  t_u32 millisecondperiod)
 {
 	timer->time_period = millisecondperiod;
+	if (timer->high_res) {
+		timer->timer_is_canceled = MFALSE;
+		hrtimer_start(&timer->hrt, WOAL_MS_TO_KTIME(millisecondperiod),
+			      WOAL_HRTIMER_MODE);
+		return;
+	}
 	mod_timer(&timer->tl, jiffies + (millisecondperiod * HZ) / 1000);
 	timer->timer_is_canceled = MFALSE;
 }
@@ -517,7 +587,13 @@ static inline void woal_mod_timer(pmoal_drv_timer timer,
  */
 static inline void woal_cancel_timer(moal_drv_timer *timer)
 {
-	if (timer->timer_is_periodic || in_atomic() || irqs_disabled())
+	if (timer->high_res) {
+		timer->timer_is_canceled = MTRUE;
+		if (in_atomic() || irqs_disabled())
+			hrtimer_try_to_cancel(&timer->hrt);
+		else
+			hrtimer_cancel(&timer->hrt);
+	} else if (timer->timer_is_periodic || in_atomic() || irqs_disabled())
 		del_timer(&timer->tl);
 	else
 		del_timer_sync(&timer->tl);
@@ -1143,13 +1219,24 @@ struct debug_data_priv {
 #define TCP_ACK_MAX_HOLD 9
 #define DROP_TCP_ACK 1
 #define HOLD_TCP_ACK 2
+/** Number of buckets in the TCP session hash, must be a power of 2 */
+#define TCP_SESS_HASH_SIZE 256
+/** TCP session key */
+struct tcp_sess_key {
+	/** IP addresses, an IPv4 address is in the first word */
+	t_u32 src_ip_addr[4];
+	t_u32 dst_ip_addr[4];
+	t_u16 src_tcp_port;
+	t_u16 dst_tcp_port;
+	/** ETH_P_IP or ETH_P_IPV6 */
+	t_u16 proto;
+	/** Keeps the key free of padding */
+	t_u16 reserved;
+};
 struct tcp_sess {
 	struct list_head link;
 	/** tcp session info */
-	t_u32 src_ip_addr;
-	t_u32 dst_ip_addr;
-	t_u16 src_tcp_port;
-	t_u16 dst_tcp_port;
+	struct tcp_sess_key key;
 	/** tx ack packet info */
 	t_u32 ack_seq;
 	/** tcp ack buffer */
@@ -1158,20 +1245,57 @@ struct tcp_sess {
 	void *priv;
 	/** pmbuf */
 	void *pmbuf;
-	/** timer for ack */
-	moal_drv_timer ack_timer __ATTRIB_ALIGN__;
-	/** timer is set */
-	atomic_t is_timer_set;
+	/** Link in the held ack list while ack_skb is held */
+	struct list_head hold_link;
+	/** Time in jiffies the held ack is sent at */
+	unsigned long hold_expire;
 	/** last update time*/
 	wifi_timeval update_time;
 };
 
+/** Staging sequence number of a tx work packet, kept in skb->cb */
+#define TX_STAGE_SEQ(skb) (*(t_u32 *)((skb)->cb + 4))
+
+/** Number of entries in the TX flow cache, must be a power of 2 */
+#define TX_FLOW_CACHE_SIZE 64
+/** TX flow flag: TID is cached */
+#define TX_FLOW_TID MBIT(0)
+/** TX flow flag: multicast aggregation checked */
+#define TX_FLOW_MCAST_CHECKED MBIT(1)
+/** TX flow flag: DA is in the multicast list */
+#define TX_FLOW_MCAST MBIT(2)
+/** TX flow flag: TDLS peer checked */
+#define TX_FLOW_TDLS_CHECKED MBIT(3)
+/** TX flow flag: DA is in the TDLS peer list */
+#define TX_FLOW_TDLS MBIT(4)
+/** TX flow flag: not a TCP flow, no TCP ACK to process */
+#define TX_FLOW_NOT_TCP MBIT(5)
+/** TX flow cache entry */
+struct tx_flow {
+	/** Lets the TX path read the entry without tx_flow_lock */
+	seqcount_t seq;
+	/** Flow hash of the skb */
+	t_u32 hash;
+	/** Cache generation the entry is valid for */
+	t_u32 gen;
+	/** Destination address */
+	t_u8 da[ETH_ALEN];
+	/** TID of the flow */
+	t_u8 tid;
+	/** DS field the TID was classified from */
+	t_u8 dscp;
+	/** TX_FLOW_xxx flags */
+	t_u8 flags;
+};
+
+/** Number of TX status entries, one per 8-bit TX sequence number */
+#define TX_STAT_TBL_SIZE 256
+
 struct tx_status_info {
-	struct list_head link;
+	/** generation of the entry, 0 if the entry is unused */
+	t_u32 tx_gen;
 	/** cookie */
 	t_u64 tx_cookie;
-	/** seq_num */
-	t_u8 tx_seq_num;
 	/** cancel remain on channel when receive tx status */
 	t_u8 cancel_remain_on_channel;
 	/**          skb */
@@ -1299,9 +1423,19 @@ typedef enum _tdlsStatus_e {
 	TDLS_IN_OFF_CHANNEL,
 } tdlsStatus_e;
 
+/** Number of buckets of the TDLS peer hash, must be a power of 2 */
+#define TDLS_HASH_SIZE 16
+/** TDLS peer hash bucket of a MAC address */
+#define TDLS_HASH(addr)                                                        \
+	(((addr)[3] ^ (addr)[4] ^ (addr)[5]) & (TDLS_HASH_SIZE - 1))
+
 /** tdls peer_info */
 struct tdls_peer {
 	struct list_head link;
+	/** link in the TDLS peer hash bucket, walked under RCU */
+	struct list_head hash_link;
+	/** rcu head to free the peer */
+	struct rcu_head rcu;
 	/** MAC address information */
 	t_u8 peer_addr[ETH_ALEN];
 	/** rssi */
@@ -1314,9 +1448,18 @@ struct tdls_peer {
 	t_u8 num_failure;
 };
 
+/** Number of buckets of the mcast group hash, must be a power of 2;
+ *  with at most MLAN_MAX_MULTICAST_LIST_SIZE groups a TX lookup walks
+ *  two nodes on average */
+#define MCAST_HASH_SIZE 16
+
 /** mcast node */
 struct mcast_node {
 	struct list_head link;
+	/** link in the mcast group hash bucket, walked under RCU */
+	struct list_head hash_link;
+	/** rcu head to free the node */
+	struct rcu_head rcu;
 	/** mcast address information */
 	t_u8 mcast_addr[ETH_ALEN];
 };
@@ -1510,6 +1653,22 @@ struct _moal_private {
 	t_u32 tcp_ack_cnt;
 	/** Statistics of tcp ack with payload*/
 	t_u32 tcp_ack_payload;
+	/** Statistics of tcp ack held */
+	t_u32 tcp_ack_hold_cnt;
+	/** Statistics of held tcp ack sent by the hold timer */
+	t_u32 tcp_ack_flush_cnt;
+	/** Statistics of hold timer runs */
+	t_u32 tcp_ack_timer_cnt;
+	/** TX flow cache */
+	struct tx_flow tx_flow_cache[TX_FLOW_CACHE_SIZE];
+	/** TX flow cache generation, bumped to invalidate the cache */
+	t_u32 tx_flow_gen;
+	/** TX flow cache lock, serializes the writers */
+	spinlock_t tx_flow_lock;
+	/** Statistics of TX flow cache hits */
+	t_u32 tx_flow_hit;
+	/** Statistics of TX flow cache misses */
+	t_u32 tx_flow_miss;
 #ifdef UAP_SUPPORT
 	/** uAP started or not */
 	BOOLEAN bss_started;
@@ -1796,8 +1955,16 @@ struct _moal_private {
 	/** MLAN debug info */
 	struct debug_data_priv items_priv;
 
-	/** tcp session queue */
-	struct list_head tcp_sess_queue;
+	/** tcp session hash */
+	struct list_head tcp_sess_hash[TCP_SESS_HASH_SIZE];
+	/** Next tcp session hash bucket to age out */
+	t_u32 tcp_sess_ageout_idx;
+	/** tcp sessions holding an ack, oldest first */
+	struct list_head tcp_ack_hold_list;
+	/** Timer sending the held tcp acks */
+	moal_drv_timer tcp_ack_timer __ATTRIB_ALIGN__;
+	/** tcp_ack_timer is set */
+	t_u8 tcp_ack_timer_set;
 	/** TCP Ack enhance flag */
 	t_u8 enable_tcp_ack_enh;
 	/** TCP Ack drop count */
@@ -1808,6 +1975,8 @@ struct _moal_private {
 	spinlock_t mcast_lock;
 	/** mcast list */
 	struct list_head mcast_list;
+	/** mcast group hash, updated under mcast_lock */
+	struct list_head mcast_hash[MCAST_HASH_SIZE];
 	/** num_mcast_addr */
 	t_u32 num_mcast_addr;
 	/** enable mc_aggr */
@@ -1816,6 +1985,8 @@ struct _moal_private {
 	t_u8 enable_uc_nonaggr;
 	/** tcp list */
 	struct list_head tdls_list;
+	/** TDLS peer hash, updated under tdls_lock */
+	struct list_head tdls_hash[TDLS_HASH_SIZE];
 	/** tdls spin lock */
 	spinlock_t tdls_lock;
 	/** auto tdls  flag */
@@ -1826,15 +1997,28 @@ struct _moal_private {
 #if CFG80211_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
 	atomic_t wmm_tx_pending[4];
 #endif
-	struct sk_buff_head tx_q;
+	/** tx work staging queue per net device TX queue */
+	struct sk_buff_head tx_q[4];
+	/** sequence number of the next packet staged on each tx_q */
+	t_u32 tx_q_seq[4];
+	/** sequence number tx work expects next from each tx_q */
+	t_u32 tx_q_next[4];
+	/** packets tx work took out of staging order */
+	t_u32 tx_stage_reorder;
 	/** per interface extra headroom */
 	t_u16 extra_tx_head_len;
+	/** byte queue limit accounting lock */
+	spinlock_t bql_lock;
+	/** bytes reported to byte queue limits and not completed yet */
+	t_u32 bql_inflight[4];
 	/** TX status spin lock */
 	spinlock_t tx_stat_lock;
 	/** tx_seq_num */
 	t_u8 tx_seq_num;
-	/** tx status queue */
-	struct list_head tx_stat_queue;
+	/** tx status table indexed by tx_seq_num */
+	struct tx_status_info tx_stat_tbl[TX_STAT_TBL_SIZE];
+	/** generation of the last tx status entry */
+	t_u32 tx_stat_gen;
 	/** rx hgm data */
 	phgm_data hist_data[MAX_ANTENNA_NUM];
 	t_u8 random_mac[MLAN_MAC_ADDR_LENGTH];
@@ -2412,6 +2596,12 @@ enum ext_mod_params {
 	EXT_PMQOS,
 	EXT_CHAN_TRACK,
 	EXT_DMCS,
+	EXT_AIRTIME_FAIR,
+	EXT_TX_BQL,
+	EXT_TX_CODEL,
+	EXT_AMSDU_SG,
+	EXT_AMSDU_ADAPT,
+	EXT_TX_GSO,
 	EXT_MAX_PARAM,
 };
 
@@ -2508,6 +2698,7 @@ typedef struct _moal_mod_para {
 	int gtk_rekey_offload;
 	t_u16 multi_dtim;
 	t_u16 inact_tmo;
+	int tx_burst;
 	int drcs_chantime_mode;
 	char *reg_alpha2;
 	int dfs53cfg;
@@ -2599,6 +2790,14 @@ typedef struct _moal_tp_acnt_t {
 	moal_drv_timer timer;
 } moal_tp_acnt_t;
 
+/** Per-CPU batch of received packets, see moal_recv_batch */
+struct woal_rx_batch {
+	/** Packets waiting for delivery */
+	struct sk_buff_head skbs;
+	/** Nesting depth of the open batch, 0 if none */
+	int depth;
+};
+
 /** Handle data structure for MOAL */
 struct _moal_handle {
 	/** MLAN adapter structure */
@@ -2718,6 +2917,12 @@ struct _moal_handle {
 	atomic_t rx_pending;
 	/** Tx packet pending count in mlan */
 	atomic_t tx_pending;
+	/** Tx packets from the kernel */
+	atomic_t tx_xmit_cnt;
+	/** Main process kicks for Tx packets from the kernel */
+	atomic_t tx_kick_cnt;
+	/** Tx packets queued to mlan wait for a main process kick */
+	atomic_t tx_kick_deferred;
 	/** IOCTL pending count in mlan */
 	atomic_t ioctl_pending;
 	/** lock count */
@@ -3027,6 +3232,10 @@ struct _moal_handle {
 	mlan_ds_misc_keep_alive_rx keep_alive_rx[MAX_KEEP_ALIVE_RX_ID];
 	struct net_device napi_dev;
 	struct napi_struct napi_rx;
+	/** CPU running woal_netdev_poll_rx, -1 when not polling */
+	int napi_cpu;
+	/** per-CPU batches of received packets */
+	struct woal_rx_batch __percpu *rx_batch;
 	/* bus interface operations */
 	moal_if_ops ops;
 	/* module parameter data */
@@ -3183,6 +3392,47 @@ static inline void woal_stop_queue(struct net_device *dev)
 #endif
 }
 
+/**
+ *  @brief Check if the kernel has more packets for the driver right after
+ *  this one
+ *
+ *  @param skb		A pointer to sk_buff structure
+ *
+ *  @return			MTRUE or MFALSE
+ */
+static inline t_u8 woal_xmit_more(struct sk_buff *skb)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0)
+	return netdev_xmit_more() ? MTRUE : MFALSE;
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(3, 18, 0)
+	return skb->xmit_more ? MTRUE : MFALSE;
+#else
+	return MFALSE;
+#endif
+}
+
+/**
+ *  @brief Check if a kernel TX queue is stopped by the driver or by BQL
+ *
+ *  @param dev		A pointer to net_device structure
+ *  @param index	Kernel TX queue index
+ *
+ *  @return			MTRUE or MFALSE
+ */
+static inline t_u8 woal_tx_queue_stopped(struct net_device *dev, t_u32 index)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 3, 0)
+	return netif_xmit_stopped(netdev_get_tx_queue(dev, index)) ? MTRUE :
+								      MFALSE;
+#elif LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
+	return netif_tx_queue_stopped(netdev_get_tx_queue(dev, index)) ?
+		       MTRUE :
+		       MFALSE;
+#else
+	return netif_queue_stopped(dev) ? MTRUE : MFALSE;
+#endif
+}
+
 /**
  *  @brief wake queue
  *
@@ -4121,7 +4371,7 @@ mlan_status woal_init_uap_dev(struct net_device *dev, moal_private *priv);
 #endif
 mlan_status woal_update_drv_tbl(moal_handle *handle, int drv_mode_local);
 void woal_fill_mlan_buffer(moal_private *priv, mlan_buffer *pmbuf,
-			   struct sk_buff *skb);
+			   struct sk_buff *skb, t_u32 hash);
 moal_private *woal_add_interface(moal_handle *handle, t_u8 bss_num,
 				 t_u8 bss_type);
 void woal_clean_up(moal_handle *handle);
@@ -4187,6 +4437,10 @@ void woal_save_conn_params(moal_private *priv,
 void woal_clear_conn_params(moal_private *priv);
 #endif
 
+void woal_init_priv_tx(moal_private *priv);
+void woal_init_tcp_sess_queue(moal_private *priv);
+void woal_init_tx_flow_cache(moal_private *priv);
+void woal_flush_tx_flow_cache(moal_private *priv);
 void woal_flush_tcp_sess_queue(moal_private *priv);
 #ifdef STA_CFG80211
 void woal_flush_tdls_list(moal_private *priv);
@@ -4200,13 +4454,24 @@ int woal_is_connected(moal_private *priv, mlan_ssid_bssid *ssid_bssid);
 int woal_priv_hostcmd(moal_private *priv, t_u8 *respbuf, t_u32 respbuflen,
 		      t_u8 wait_option);
 void woal_flush_tx_stat_queue(moal_private *priv);
-struct tx_status_info *woal_get_tx_info(moal_private *priv, t_u8 tx_seq_num);
-void woal_remove_tx_info(moal_private *priv, t_u8 tx_seq_num);
-
+#if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
+void woal_tx_queue_sent(moal_private *priv, t_u32 len, t_u32 index);
+void woal_tx_queue_completed(moal_private *priv, t_u32 len, t_u32 index);
+void woal_tx_queue_reset(moal_private *priv);
+#endif
+t_u32 woal_add_tx_info(moal_private *priv, t_u8 tx_seq_num,
+			struct sk_buff *skb, t_u64 cookie,
+			t_u8 cancel_remain_on_channel);
+t_u8 woal_take_tx_info(moal_private *priv, t_u8 tx_seq_num,
+		       struct tx_status_info *tx_info);
+void woal_remove_tx_info(moal_private *priv, t_u8 tx_seq_num, t_u32 gen);
+
+void woal_init_mcast_list(moal_private *priv);
 void woal_flush_mcast_list(moal_private *priv);
 t_void woal_add_mcast_node(moal_private *priv, t_u8 *mcast_addr);
 void woal_remove_mcast_node(moal_private *priv, t_u8 *mcast_addr);
-t_u8 woal_find_mcast_node_tx(moal_private *priv, struct sk_buff *skb);
+t_u8 woal_find_mcast_node_tx(moal_private *priv, struct sk_buff *skb,
+			     t_u32 hash);
 
 mlan_status woal_request_country_power_table(moal_private *priv, char *region,
 					     t_u8 wait_option);
@@ -1316,6 +1316,64 @@ err_enable_dev:
 	return MLAN_STATUS_FAILURE;
 }
 
+#ifdef PCIE_RX_PAGE_POOL
+/**
+ *  @brief This function creates the page pool backing the RX ring
+ *
+ *  Pages stay DMA-mapped while they cycle between the RX ring and the
+ *  network stack. Failure is not fatal, the RX ring then falls back to
+ *  mapping a fresh skb for every packet.
+ *
+ *  @param card   A pointer to pcie_service_card structure
+ *
+ *  @return         N/A
+ */
+static void woal_pcie_create_rx_pool(pcie_service_card *card)
+{
+	struct page_pool_params pp = {0};
+	struct page_pool *pool;
+
+	card->rx_pool_order =
+		get_order(PCIE_RX_POOL_OFFSET + PCIE_RX_POOL_BUF_LEN +
+			  SKB_DATA_ALIGN(sizeof(struct skb_shared_info)));
+	pp.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV;
+	pp.order = card->rx_pool_order;
+	pp.pool_size = PCIE_RX_POOL_SIZE;
+	pp.nid = dev_to_node(&card->dev->dev);
+	pp.dev = &card->dev->dev;
+	pp.dma_dir = DMA_FROM_DEVICE;
+	pp.offset = PCIE_RX_POOL_OFFSET;
+	pp.max_len = PCIE_RX_POOL_BUF_LEN;
+
+	pool = page_pool_create(&pp);
+	if (IS_ERR(pool)) {
+		PRINTM(MERROR, "RX page pool create failed: %ld\n",
+		       PTR_ERR(pool));
+		pool = NULL;
+	}
+	card->rx_pool = pool;
+}
+
+/**
+ *  @brief This function destroys the RX page pool
+ *
+ *  Must be called after mlan has freed the RX ring, as no buffer may be
+ *  allocated from the pool afterwards. Pages still held by the network
+ *  stack are released by the pool once they are freed.
+ *
+ *  @param card   A pointer to pcie_service_card structure
+ *
+ *  @return         N/A
+ */
+static void woal_pcie_destroy_rx_pool(pcie_service_card *card)
+{
+	if (card->rx_pool) {
+		page_pool_destroy(card->rx_pool);
+		card->rx_pool = NULL;
+	}
+}
+#endif
+
 /**
  *  @brief This function initializes the PCI-E host
  *  memory space, etc.
@@ -1385,6 +1443,10 @@ static mlan_status woal_pcie_init(pcie_service_card *card)
 	       "PCI memory map Virt0: %p PCI memory map Virt2: "
 	       "%p\n",
 	       card->pci_mmap, card->pci_mmap1);
+#ifdef PCIE_RX_PAGE_POOL
+	if (pcie_rx_pool)
+		woal_pcie_create_rx_pool(card);
+#endif
 
 	return MLAN_STATUS_SUCCESS;
 
@@ -1530,6 +1592,9 @@ done:
 /**
  *  @brief This function cleans up the host memory spaces
  *
+ *  Callers run this after woal_remove_card() or a failed woal_add_card(),
+ *  which free the mlan adapter and with it the RX ring buffers.
+ *
  *  @param card   A pointer to pcie_service_card structure
  *
  *  @return         N/A
@@ -1540,6 +1605,9 @@ static void woal_pcie_cleanup(pcie_service_card *card)
 	pdev = card->dev;
 	PRINTM(MINFO, "Clearing driver ready signature\n");
 
+#ifdef PCIE_RX_PAGE_POOL
+	woal_pcie_destroy_rx_pool(card);
+#endif
 	if (pdev) {
 		pci_iounmap(pdev, card->pci_mmap);
 		pci_iounmap(pdev, card->pci_mmap1);
@@ -72,6 +72,11 @@ Change log:
 #include <linux/pcieport_if.h>
 #endif
 #include <linux/interrupt.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 6, 0)
+#include <net/page_pool/helpers.h>
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(5, 15, 0)
+#include <net/page_pool.h>
+#endif
 
 #include "moal_main.h"
 
@@ -137,6 +142,24 @@ Change log:
 #define PCIE_NUM_MSIX_VECTORS 4
 #endif
 
+#if defined(CONFIG_PAGE_POOL) &&                                              \
+	LINUX_VERSION_CODE >= KERNEL_VERSION(5, 15, 0)
+/** RX ring buffers are recycled through a DMA-mapped page pool */
+#define PCIE_RX_PAGE_POOL
+/** Number of free pages cached by the RX page pool. Ring slots hold
+ *  their page and only pages the stack frees while the ring is full wait
+ *  here, so the largest RX ring (ADMA_MAX_TXRX_BD) bounds what is worth
+ *  keeping mapped; further pages go back to the page allocator */
+#define PCIE_RX_POOL_SIZE 512
+/** Offset of the DMA area in a pool page, past mlan_buffer and headroom */
+#define PCIE_RX_POOL_OFFSET                                                    \
+	ALIGN(sizeof(mlan_buffer) + MLAN_RX_HEADER_LEN, SMP_CACHE_BYTES)
+/** Length of the DMA area in a pool page. With the offset and
+ *  skb_shared_info it needs an order-1 page on 4 KB page systems, the
+ *  same 8 KB the kmalloc'ed skb of the non-pool path takes per slot */
+#define PCIE_RX_POOL_BUF_LEN MLAN_RX_DATA_BUF_SIZE
+#endif
+
 typedef struct _msix_context {
 	/** pci_dev structure pointer */
 	struct pci_dev *dev;
@@ -162,6 +185,12 @@ typedef struct _pcie_service_card {
 	struct msix_entry msix_entries[PCIE_NUM_MSIX_VECTORS];
 	msix_context msix_contexts[PCIE_NUM_MSIX_VECTORS];
 #endif
+#ifdef PCIE_RX_PAGE_POOL
+	/** page pool backing the RX ring, NULL to use plain skbs */
+	struct page_pool *rx_pool;
+	/** page order of the RX pool pages */
+	t_u32 rx_pool_order;
+#endif
 } pcie_service_card, *ppcie_service_card;
 
 /** Register to bus driver function */
@@ -323,6 +323,87 @@ mlan_status moal_unmap_memory(t_void *pmoal, t_u8 *pbuf, t_u64 buf_pa,
 
 	return MLAN_STATUS_SUCCESS;
 }
+
+/**
+ *  @brief Allocate a DMA-mapped RX buffer from the RX page pool
+ *
+ *  The skb is built on a pool page and marked for recycle, so the page
+ *  returns to the pool still mapped when the stack frees the skb.
+ *
+ *  @param pmoal Pointer to the MOAL context
+ *  @param size         Size of the DMA area
+ *  @param pmbuf        Pointer to store the allocated mlan_buffer
+ *
+ *  @return             MLAN_STATUS_SUCCESS or MLAN_STATUS_FAILURE
+ */
+mlan_status moal_alloc_rx_buffer(t_void *pmoal, t_u32 size,
+				 pmlan_buffer *pmbuf)
+{
+#ifdef PCIE_RX_PAGE_POOL
+	moal_handle *handle = (moal_handle *)pmoal;
+	pcie_service_card *card = (pcie_service_card *)handle->card;
+	mlan_buffer *pbuf;
+	struct sk_buff *skb;
+	struct page *page;
+
+	if (!card || !card->rx_pool || size > PCIE_RX_POOL_BUF_LEN)
+		return MLAN_STATUS_FAILURE;
+	page = page_pool_dev_alloc_pages(card->rx_pool);
+	if (!page)
+		return MLAN_STATUS_FAILURE;
+	skb = build_skb(page_address(page), PAGE_SIZE << card->rx_pool_order);
+	if (!skb) {
+		page_pool_put_full_page(card->rx_pool, page, false);
+		return MLAN_STATUS_FAILURE;
+	}
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 16, 0)
+	skb_mark_for_recycle(skb, page, card->rx_pool);
+#else
+	skb_mark_for_recycle(skb);
+#endif
+	skb_reserve(skb, sizeof(mlan_buffer));
+	pbuf = (mlan_buffer *)skb->head;
+	memset((u8 *)pbuf, 0, sizeof(mlan_buffer));
+	pbuf->pdesc = (t_void *)skb;
+	pbuf->pbuf = (t_u8 *)skb->data;
+	pbuf->data_offset = PCIE_RX_POOL_OFFSET - sizeof(mlan_buffer);
+	pbuf->data_len = size;
+	pbuf->flags = MLAN_BUF_FLAG_RX_POOL;
+	pbuf->buf_pa = page_pool_get_dma_addr(page) + PCIE_RX_POOL_OFFSET;
+	atomic_inc(&handle->mbufalloc_count);
+	*pmbuf = pbuf;
+	return MLAN_STATUS_SUCCESS;
+#else
+	return MLAN_STATUS_FAILURE;
+#endif
+}
+
+/**
+ *  @brief Sync an RX pool buffer for CPU or device access
+ *
+ *  @param pmoal Pointer to the MOAL context
+ *  @param pmbuf        Pointer to the mlan_buffer from the RX pool
+ *  @param size         Size of the DMA area to sync
+ *  @param for_device   MTRUE to give the buffer back to the device
+ *
+ *  @return             MLAN_STATUS_SUCCESS or MLAN_STATUS_FAILURE
+ */
+mlan_status moal_sync_rx_buffer(t_void *pmoal, pmlan_buffer pmbuf,
+				t_u32 size, t_u8 for_device)
+{
+	moal_handle *handle = (moal_handle *)pmoal;
+	pcie_service_card *card = (pcie_service_card *)handle->card;
+
+	if (!card)
+		return MLAN_STATUS_FAILURE;
+	if (for_device)
+		dma_sync_single_for_device(&card->dev->dev, pmbuf->buf_pa,
+					   size, DMA_FROM_DEVICE);
+	else
+		dma_sync_single_for_cpu(&card->dev->dev, pmbuf->buf_pa, size,
+					DMA_FROM_DEVICE);
+	return MLAN_STATUS_SUCCESS;
+}
 #endif /* PCIE */
 
 /**
@@ -529,9 +610,41 @@ mlan_status moal_init_timer(t_void *pmoal, t_void **pptimer,
 	return MLAN_STATUS_SUCCESS;
 }
 
+/**
+ *  @brief Initializes the high resolution timer
+ *
+ *  @param pmoal Pointer to the MOAL context
+ *  @param pptimer      Pointer to the timer
+ *  @param callback     Pointer to callback function
+ *  @param pcontext     Pointer to context
+ *
+ *  @return             MLAN_STATUS_SUCCESS or MLAN_STATUS_FAILURE
+ */
+mlan_status moal_init_hrtimer(t_void *pmoal, t_void **pptimer,
+			      IN t_void (*callback)(t_void *pcontext),
+			      t_void *pcontext)
+{
+	moal_drv_timer *timer = NULL;
+	gfp_t mem_flag = (in_interrupt() || in_atomic() || irqs_disabled()) ?
+				 GFP_ATOMIC :
+				 GFP_KERNEL;
+
+	timer = kmalloc(sizeof(moal_drv_timer), mem_flag);
+	if (timer == NULL)
+		return MLAN_STATUS_FAILURE;
+	woal_initialize_hrtimer(timer, callback, pcontext);
+	*pptimer = (t_void *)timer;
+
+	return MLAN_STATUS_SUCCESS;
+}
+
 /**
  *  @brief Free the timer
  *
+ *  A high resolution timer is cancelled with hrtimer_cancel(), which
+ *  waits for a running handler before the memory is freed. mlan frees
+ *  its timers with the adapter, from process context.
+ *
  *  @param pmoal Pointer to the MOAL context
  *  @param ptimer   Pointer to the timer
  *
@@ -542,8 +655,14 @@ mlan_status moal_free_timer(t_void *pmoal, t_void *ptimer)
 	moal_drv_timer *timer = (moal_drv_timer *)ptimer;
 
 	if (timer) {
-		if ((timer->timer_is_canceled == MFALSE) &&
-		    timer->time_period) {
+		/* A high resolution timer may restart from its own handler,
+		 * woal_cancel_timer() only tries to cancel it in atomic
+		 * context */
+		if (timer->high_res) {
+			timer->timer_is_canceled = MTRUE;
+			hrtimer_cancel(&timer->hrt);
+		} else if ((timer->timer_is_canceled == MFALSE) &&
+			 timer->time_period) {
 			PRINTM(MWARN,
 			       "mlan try to free timer without stop timer!\n");
 			woal_cancel_timer(timer);
@@ -671,6 +790,26 @@ mlan_status moal_spin_unlock(t_void *pmoal, t_void *plock)
 	return MLAN_STATUS_SUCCESS;
 }
 
+/**
+ *  @brief Try to take a spin lock without spinning
+ *
+ *  @param pmoal Pointer to the MOAL context
+ *  @param plock    Pointer to the lock
+ *
+ *  @return         MLAN_STATUS_SUCCESS if the lock was taken, otherwise
+ *                  MLAN_STATUS_FAILURE
+ */
+mlan_status moal_spin_trylock(t_void *pmoal, t_void *plock)
+{
+	moal_lock *mlock = plock;
+	unsigned long flags = 0;
+
+	if (!spin_trylock_irqsave(&mlock->lock, flags))
+		return MLAN_STATUS_FAILURE;
+	mlock->flags = flags;
+	return MLAN_STATUS_SUCCESS;
+}
+
 /**
  *  @brief  This function collects AMSDU TP statistics.
  *
@@ -1172,22 +1311,8 @@ mlan_status moal_send_packet_complete(t_void *pmoal, pmlan_buffer pmbuf,
 				index = skb_get_queue_mapping(skb);
 				if (index < 4) {
 					atomic_dec(&handle->tx_pending);
-					if (atomic_dec_return(
-						    &priv->wmm_tx_pending[index]) ==
-					    LOW_TX_PENDING) {
-						struct netdev_queue *txq =
-							netdev_get_tx_queue(
-								priv->netdev,
+					woal_tx_queue_completed(priv, skb->len,
 								index);
-						if (netif_tx_queue_stopped(
-							    txq)) {
-							netif_tx_wake_queue(
-								txq);
-							PRINTM(MINFO,
-							       "Wakeup Kernel Queue:%d\n",
-							       index);
-						}
-					}
 				} else {
 					PRINTM(MERROR,
 					       "Invalid queue index for skb\n");
@@ -1252,6 +1377,37 @@ done:
 	return MLAN_STATUS_SUCCESS;
 }
 
+/**
+ *  @brief This function copies data of a TX packet and computes its
+ *         Internet checksum, used to segment TSO packets
+ *
+ *  @param pmoal    Pointer to the MOAL context
+ *  @param pmbuf    Pointer to the mlan buffer structure
+ *  @param offset   Offset of the data from the start of the packet
+ *  @param dst      Pointer to the destination buffer
+ *  @param len      Length of the data
+ *  @param pcsum    Pointer to the folded checksum, host order
+ *
+ *  @return         MLAN_STATUS_SUCCESS or MLAN_STATUS_FAILURE
+ */
+mlan_status moal_copy_tx_data(t_void *pmoal, pmlan_buffer pmbuf, t_u32 offset,
+			      t_u8 *dst, t_u32 len, t_u16 *pcsum)
+{
+	struct sk_buff *skb = (struct sk_buff *)pmbuf->pdesc;
+	__wsum csum;
+
+	if (!skb || offset > skb->len || len > skb->len - offset)
+		return MLAN_STATUS_FAILURE;
+	/* Copy and checksum in the same pass over the payload */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+	csum = skb_copy_and_csum_bits(skb, offset, dst, len);
+#else
+	csum = skb_copy_and_csum_bits(skb, offset, dst, len, 0);
+#endif
+	*pcsum = (t_u16)~ntohs((__force __be16)csum_fold(csum));
+	return MLAN_STATUS_SUCCESS;
+}
+
 #ifdef USB
 /**
  *  @brief This function is called when MLAN complete receiving
@@ -1917,6 +2073,135 @@ static struct net_device *moal_get_netdev_from_stalist(moal_private *priv, t_u16
 #endif
 #endif
 
+/**
+ *  @brief This function hands a received packet to the network stack
+ *
+ *  Inside the NAPI poll the packet goes through GRO; otherwise the
+ *  delivery depends on the calling context and the net_rx parameter.
+ *
+ *  @param handle   A pointer to moal_handle structure
+ *  @param skb      A pointer to the received sk_buff
+ *
+ *  @return         N/A
+ */
+static void woal_netif_rx(moal_handle *handle, struct sk_buff *skb)
+{
+	struct woal_rx_batch *batch;
+
+	if (handle->rx_batch) {
+		batch = get_cpu_ptr(handle->rx_batch);
+		/* An open batch keeps BH disabled, so it is ours */
+		if (batch->depth &&
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0)
+		    !in_hardirq()) {
+#else
+		    !in_irq()) {
+#endif
+			__skb_queue_tail(&batch->skbs, skb);
+			put_cpu_ptr(handle->rx_batch);
+			return;
+		}
+		put_cpu_ptr(handle->rx_batch);
+	}
+	if (handle->napi_cpu == raw_smp_processor_id() &&
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0)
+	    !in_hardirq()) {
+#else
+	    !in_irq()) {
+#endif
+		napi_gro_receive(&handle->napi_rx, skb);
+		return;
+	}
+	if (in_interrupt()) {
+		netif_rx(skb);
+		return;
+	}
+	if (atomic_read(&handle->rx_pending) > MAX_RX_PENDING_THRHLD) {
+		netif_rx(skb);
+	} else if (handle->params.net_rx == MTRUE) {
+		local_bh_disable();
+		netif_receive_skb(skb);
+		local_bh_enable();
+	} else {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 17, 0)
+		netif_rx(skb);
+#else
+		netif_rx_ni(skb);
+#endif
+	}
+}
+
+/**
+ *  @brief This function delivers the packets of a closed RX batch
+ *
+ *  @param handle   A pointer to moal_handle structure
+ *  @param skbs     A pointer to the queued packets
+ *
+ *  @return         N/A
+ */
+static void woal_flush_rx_batch(moal_handle *handle, struct sk_buff_head *skbs)
+{
+	struct sk_buff *skb;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+	struct list_head list;
+#endif
+
+	if (handle->napi_cpu == smp_processor_id()) {
+		while ((skb = __skb_dequeue(skbs)))
+			napi_gro_receive(&handle->napi_rx, skb);
+		return;
+	}
+	if (handle->params.net_rx == MTRUE &&
+	    atomic_read(&handle->rx_pending) <= MAX_RX_PENDING_THRHLD) {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+		INIT_LIST_HEAD(&list);
+		while ((skb = __skb_dequeue(skbs)))
+			list_add_tail(&skb->list, &list);
+		netif_receive_skb_list(&list);
+#else
+		while ((skb = __skb_dequeue(skbs)))
+			netif_receive_skb(skb);
+#endif
+		return;
+	}
+	/* BH is disabled here, backlog processing runs on local_bh_enable */
+	while ((skb = __skb_dequeue(skbs)))
+		netif_rx(skb);
+}
+
+/**
+ *  @brief This function opens or closes a batch of received packets
+ *
+ *  Packets passed up by this CPU while a batch is open are delivered
+ *  in one go when the outermost batch is closed.
+ *
+ *  @param pmoal    Pointer to the MOAL context
+ *  @param start    MTRUE to open a batch, MFALSE to close it
+ *
+ *  @return         N/A
+ */
+t_void moal_recv_batch(t_void *pmoal, t_u8 start)
+{
+	moal_handle *handle = (moal_handle *)pmoal;
+	struct woal_rx_batch *batch;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0)
+	if (!handle->rx_batch || in_hardirq())
+#else
+	if (!handle->rx_batch || in_irq())
+#endif
+		return;
+	if (start) {
+		local_bh_disable();
+		this_cpu_ptr(handle->rx_batch)->depth++;
+		return;
+	}
+	batch = this_cpu_ptr(handle->rx_batch);
+	if (!--batch->depth)
+		woal_flush_rx_batch(handle, &batch->skbs);
+	local_bh_enable();
+}
+
 /**
  *  @brief This function uploads amsdu packet to the network stack
  *
@@ -1955,6 +2240,11 @@ mlan_status moal_recv_amsdu_packet(t_void *pmoal, pmlan_buffer pmbuf)
 
 	memset(&mbuf, 0, sizeof(mlan_buffer));
 	mbuf.bss_index = pmbuf->bss_index;
+	/* Carried over to the copy of a subframe bridged in uAP mode */
+	mbuf.buf_type = pmbuf->buf_type;
+	mbuf.priority = pmbuf->priority;
+	mbuf.in_ts_sec = pmbuf->in_ts_sec;
+	mbuf.in_ts_usec = pmbuf->in_ts_usec;
 
 	priv = woal_bss_index_to_priv(pmoal, pmbuf->bss_index);
 	if (priv == NULL) {
@@ -2060,26 +2350,7 @@ mlan_status moal_recv_amsdu_packet(t_void *pmoal, pmlan_buffer pmbuf)
 		}
 		frame->protocol = eth_type_trans(frame, netdev);
 		frame->ip_summed = CHECKSUM_NONE;
-		if (in_interrupt())
-			netif_rx(frame);
-		else {
-			if (atomic_read(&handle->rx_pending) >
-			    MAX_RX_PENDING_THRHLD)
-				netif_rx(frame);
-			else {
-				if (handle->params.net_rx == MTRUE) {
-					local_bh_disable();
-					netif_receive_skb(frame);
-					local_bh_enable();
-				} else {
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 17, 0)
-					netif_rx(frame);
-#else
-					netif_rx_ni(frame);
-#endif
-				}
-			}
-		}
+		woal_netif_rx(handle, frame);
 	}
 	if (handle->tp_acnt.on) {
 		if (pmbuf->in_ts_sec)
@@ -2387,25 +2658,8 @@ mlan_status moal_recv_packet(t_void *pmoal, pmlan_buffer pmbuf)
 			if (priv->phandle->tp_acnt.drop_point == RX_DROP_P4) {
 				status = MLAN_STATUS_PENDING;
 				dev_kfree_skb(skb);
-			} else if (in_interrupt())
-				netif_rx(skb);
-			else {
-				if (atomic_read(&handle->rx_pending) >
-				    MAX_RX_PENDING_THRHLD)
-					netif_rx(skb);
-				else {
-					if (handle->params.net_rx == MTRUE) {
-						local_bh_disable();
-						netif_receive_skb(skb);
-						local_bh_enable();
-					} else {
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 17, 0)
-						netif_rx(skb);
-#else
-						netif_rx_ni(skb);
-#endif
-					}
-				}
+			} else {
+				woal_netif_rx(handle, skb);
 			}
 			if (priv->phandle->tp_acnt.on) {
 				if (pmbuf && pmbuf->in_ts_sec)
@@ -4498,28 +4752,23 @@ mlan_status moal_recv_event(t_void *pmoal, pmlan_event pmevent)
 		break;
 	case MLAN_EVENT_ID_FW_TX_STATUS: {
 #if defined(STA_CFG80211) || defined(UAP_CFG80211)
-		unsigned long flag;
 		tx_status_event *tx_status =
 			(tx_status_event *)(pmevent->event_buf + 4);
-		struct tx_status_info *tx_info = NULL;
+		struct tx_status_info tx_info;
 		PRINTM(MEVENT,
 		       "Wlan: Tx status: tx_token=%d, pkt_type=0x%x, status=%d priv->tx_seq_num=%d\n",
 		       tx_status->tx_token_id, tx_status->packet_type,
 		       tx_status->status, priv->tx_seq_num);
-		spin_lock_irqsave(&priv->tx_stat_lock, flag);
-		tx_info = woal_get_tx_info(priv, tx_status->tx_token_id);
-		if (tx_info) {
+		if (woal_take_tx_info(priv, tx_status->tx_token_id, &tx_info)) {
 			bool ack;
-			struct sk_buff *skb = (struct sk_buff *)tx_info->tx_skb;
-			list_del(&tx_info->link);
-			spin_unlock_irqrestore(&priv->tx_stat_lock, flag);
+			struct sk_buff *skb = (struct sk_buff *)tx_info.tx_skb;
 			if (!tx_status->status)
 				ack = true;
 			else
 				ack = false;
 #if defined(STA_CFG80211) || defined(UAP_CFG80211)
 			if (priv->phandle->remain_on_channel &&
-			    tx_info->cancel_remain_on_channel) {
+			    tx_info.cancel_remain_on_channel) {
 				remain_priv =
 					priv->phandle->priv
 						[priv->phandle->remain_bss_index];
@@ -4538,16 +4787,16 @@ mlan_status moal_recv_event(t_void *pmoal, pmlan_event pmevent)
 #endif
 			PRINTM(MEVENT, "Wlan: Tx status=%d\n", ack);
 #if defined(STA_CFG80211) || defined(UAP_CFG80211)
-			if (tx_info->tx_cookie) {
+			if (tx_info.tx_cookie) {
 #if CFG80211_VERSION_CODE >= KERNEL_VERSION(2, 6, 37)
 #if CFG80211_VERSION_CODE < KERNEL_VERSION(3, 6, 0)
 				cfg80211_mgmt_tx_status(priv->netdev,
-							tx_info->tx_cookie,
+							tx_info.tx_cookie,
 							skb->data, skb->len,
 							ack, GFP_ATOMIC);
 #else
 				cfg80211_mgmt_tx_status(priv->wdev,
-							tx_info->tx_cookie,
+							tx_info.tx_cookie,
 							skb->data, skb->len,
 							ack, GFP_ATOMIC);
 #endif
@@ -4564,9 +4813,6 @@ mlan_status moal_recv_event(t_void *pmoal, pmlan_event pmevent)
 #endif
 #endif
 			dev_kfree_skb_any(skb);
-			kfree(tx_info);
-		} else {
-			spin_unlock_irqrestore(&priv->tx_stat_lock, flag);
 		}
 #endif
 	} break;
@@ -4897,7 +5143,9 @@ t_void moal_updata_peer_signal(t_void *pmoal, t_u32 bss_index, t_u8 *peer_addr,
 	priv = woal_bss_index_to_priv(pmoal, bss_index);
 	if (priv && priv->enable_auto_tdls) {
 		spin_lock_irqsave(&priv->tdls_lock, flags);
-		list_for_each_entry (peer, &priv->tdls_list, link) {
+		list_for_each_entry (peer,
+				     &priv->tdls_hash[TDLS_HASH(peer_addr)],
+				     hash_link) {
 			if (!memcmp(peer->peer_addr, peer_addr, ETH_ALEN)) {
 				peer->rssi = nflr - snr;
 				peer->rssi_jiffies = jiffies;
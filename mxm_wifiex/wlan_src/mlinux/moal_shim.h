@@ -42,6 +42,8 @@ mlan_status moal_alloc_mlan_buffer(t_void *pmoal, t_u32 size,
 mlan_status moal_free_mlan_buffer(t_void *pmoal, pmlan_buffer pmbuf);
 mlan_status moal_send_packet_complete(t_void *pmoal, pmlan_buffer pmbuf,
 				      mlan_status status);
+mlan_status moal_copy_tx_data(t_void *pmoal, pmlan_buffer pmbuf, t_u32 offset,
+			      t_u8 *dst, t_u32 len, t_u16 *pcsum);
 #ifdef USB
 mlan_status moal_recv_complete(t_void *pmoal, pmlan_buffer pmbuf, t_u32 port,
 			       mlan_status status);
@@ -61,6 +63,7 @@ mlan_status moal_read_data_sync(t_void *pmoal, pmlan_buffer pmbuf, t_u32 port,
 				t_u32 timeout);
 mlan_status moal_recv_amsdu_packet(t_void *pmoal, pmlan_buffer pmbuf);
 mlan_status moal_recv_packet(t_void *pmoal, pmlan_buffer pmbuf);
+t_void moal_recv_batch(t_void *pmoal, t_u8 start);
 mlan_status moal_recv_event(t_void *pmoal, pmlan_event pmevent);
 mlan_status moal_malloc(t_void *pmoal, t_u32 size, t_u32 flag, t_u8 **ppbuf);
 mlan_status moal_mfree(t_void *pmoal, t_u8 *pbuf);
@@ -75,6 +78,10 @@ mlan_status moal_map_memory(t_void *pmoal, t_u8 *pbuf, t_u64 *pbuf_pa,
 			    t_u32 size, t_u32 flag);
 mlan_status moal_unmap_memory(t_void *pmoal, t_u8 *pbuf, t_u64 buf_pa,
 			      t_u32 size, t_u32 flag);
+mlan_status moal_alloc_rx_buffer(t_void *pmoal, t_u32 size,
+				 pmlan_buffer *pmbuf);
+mlan_status moal_sync_rx_buffer(t_void *pmoal, pmlan_buffer pmbuf,
+				t_u32 size, t_u8 for_device);
 #endif /* PCIE */
 t_void *moal_memset(t_void *pmoal, t_void *pmem, t_u8 byte, t_u32 num);
 t_void *moal_memcpy(t_void *pmoal, t_void *pdest, const t_void *psrc,
@@ -95,6 +102,7 @@ mlan_status moal_init_lock(t_void *pmoal, t_void **pplock);
 mlan_status moal_free_lock(t_void *pmoal, t_void *plock);
 mlan_status moal_spin_lock(t_void *pmoal, t_void *plock);
 mlan_status moal_spin_unlock(t_void *pmoal, t_void *plock);
+mlan_status moal_spin_trylock(t_void *pmoal, t_void *plock);
 t_void moal_print(t_void *pmoal, t_u32 level, char *pformat, IN...);
 t_void moal_print_netintf(t_void *pmoal, t_u32 bss_index, t_u32 level);
 t_void moal_assert(t_void *pmoal, t_u32 cond);
@@ -112,6 +120,9 @@ mlan_status moal_free_timer(t_void *pmoal, t_void *ptimer);
 mlan_status moal_start_timer(t_void *pmoal, t_void *ptimer, t_u8 periodic,
 			     t_u32 msec);
 mlan_status moal_stop_timer(t_void *pmoal, t_void *ptimer);
+mlan_status moal_init_hrtimer(t_void *pmoal, t_void **pptimer,
+			      IN t_void (*callback)(t_void *pcontext),
+			      t_void *pcontext);
 void moal_tp_accounting(t_void *pmoal, void *buf, t_u32 drop_point);
 void moal_tp_accounting_rx_param(t_void *pmoal, unsigned int type,
 				 unsigned int rsvd1);
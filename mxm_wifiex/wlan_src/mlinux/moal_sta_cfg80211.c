@@ -7299,7 +7299,9 @@ static t_void woal_updata_peer_status(moal_private *priv, t_u8 *peer_addr,
 	unsigned long flags;
 	if (priv && priv->enable_auto_tdls) {
 		spin_lock_irqsave(&priv->tdls_lock, flags);
-		list_for_each_entry (peer, &priv->tdls_list, link) {
+		list_for_each_entry (peer,
+				     &priv->tdls_hash[TDLS_HASH(peer_addr)],
+				     hash_link) {
 			if (!memcmp(peer->peer_addr, peer_addr, ETH_ALEN)) {
 				if ((link_status == TDLS_NOT_SETUP) &&
 				    (peer->link_status ==
@@ -7330,7 +7332,9 @@ static t_void woal_add_tdls_peer(moal_private *priv, t_u8 *peer)
 	t_u8 find_peer = MFALSE;
 	if (priv && priv->enable_auto_tdls) {
 		spin_lock_irqsave(&priv->tdls_lock, flags);
-		list_for_each_entry (tdls_peer, &priv->tdls_list, link) {
+		list_for_each_entry (tdls_peer,
+				     &priv->tdls_hash[TDLS_HASH(peer)],
+				     hash_link) {
 			if (!memcmp(tdls_peer->peer_addr, peer, ETH_ALEN)) {
 				tdls_peer->link_status = TDLS_SETUP_INPROGRESS;
 				tdls_peer->rssi_jiffies = jiffies;
@@ -7352,12 +7356,16 @@ static t_void woal_add_tdls_peer(moal_private *priv, t_u8 *peer)
 				INIT_LIST_HEAD(&tdls_peer->link);
 				list_add_tail(&tdls_peer->link,
 					      &priv->tdls_list);
+				list_add_tail_rcu(
+					&tdls_peer->hash_link,
+					&priv->tdls_hash[TDLS_HASH(peer)]);
 				PRINTM(MCMND,
 				       "Add to TDLS list: peer=" MACSTR "\n",
 				       MAC2STR(peer));
 			}
 		}
 		spin_unlock_irqrestore(&priv->tdls_lock, flags);
+		woal_flush_tx_flow_cache(priv);
 	}
 }
 
@@ -8062,6 +8070,7 @@ static int woal_send_tdls_data_frame(struct wiphy *wiphy,
 	mlan_status status = MLAN_STATUS_SUCCESS;
 	struct sk_buff *skb = NULL;
 	int ret = 0;
+	t_u32 len;
 #if CFG80211_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
 	t_u32 index = 0;
 #endif
@@ -8145,17 +8154,17 @@ static int woal_send_tdls_data_frame(struct wiphy *wiphy,
 	DBG_HEXDUMP(MDAT_D, "TDLS data:", pmbuf->pbuf + pmbuf->data_offset,
 		    pmbuf->data_len);
 
+	/* Account before MLAN owns the skb, it may complete it at once */
+	len = skb->len;
+	atomic_inc(&priv->phandle->tx_pending);
 #if CFG80211_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
 	index = skb_get_queue_mapping(skb);
+	woal_tx_queue_sent(priv, len, index);
 #endif
 	status = mlan_send_packet(priv->phandle->pmlan_adapter, pmbuf);
 
 	switch (status) {
 	case MLAN_STATUS_PENDING:
-		atomic_inc(&priv->phandle->tx_pending);
-#if CFG80211_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
-		atomic_inc(&priv->wmm_tx_pending[index]);
-#endif
 		queue_work(priv->phandle->workqueue, &priv->phandle->main_work);
 		/*delay 10 ms to guarantee the teardown/confirm frame can be
 		 * sent out before disalbe/enable tdls link if we don't delay
@@ -8175,6 +8184,12 @@ static int woal_send_tdls_data_frame(struct wiphy *wiphy,
 		ret = -ENOTSUPP;
 		break;
 	}
+	if (status != MLAN_STATUS_PENDING) {
+		atomic_dec(&priv->phandle->tx_pending);
+#if CFG80211_VERSION_CODE > KERNEL_VERSION(2, 6, 29)
+		woal_tx_queue_completed(priv, len, index);
+#endif
+	}
 
 	LEAVE();
 	return ret;
@@ -1943,13 +1943,7 @@ moal_private *woal_alloc_virt_interface(moal_handle *handle, t_u8 bss_index,
 	priv->bss_type = bss_type;
 	priv->bss_role = MLAN_BSS_ROLE_STA;
 
-	INIT_LIST_HEAD(&priv->tcp_sess_queue);
-	spin_lock_init(&priv->tcp_sess_lock);
-
-	INIT_LIST_HEAD(&priv->tx_stat_queue);
-	spin_lock_init(&priv->tx_stat_lock);
-	INIT_LIST_HEAD(&priv->mcast_list);
-	spin_lock_init(&priv->mcast_lock);
+	woal_init_priv_tx(priv);
 
 	spin_lock_init(&priv->connect_lock);
 
@@ -3042,6 +3036,7 @@ int woal_cfg80211_del_beacon(struct wiphy *wiphy, struct net_device *dev)
 	woal_cancel_scan(priv, MOAL_IOCTL_WAIT);
 #endif
 	memset(priv->dscp_map, 0xFF, sizeof(priv->dscp_map));
+	woal_flush_tx_flow_cache(priv);
 	woal_deauth_all_station(priv);
 #if CFG80211_VERSION_CODE >= KERNEL_VERSION(3, 14, 0)
 	if (moal_extflg_isset(priv->phandle, EXT_DFS_OFFLOAD))